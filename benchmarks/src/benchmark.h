@@ -0,0 +1,55 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_BENCHMARK_H
+#define AVS_COMMONS_BENCHMARK_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <avsystem/commons/time.h>
+
+/* common helpers for the benchmark programs; these are standalone
+ * executables, not a part of the library */
+
+static inline uint32_t benchmark_rand(uint32_t *seed) {
+    /* xorshift32 */
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+static inline avs_time_monotonic_t benchmark_start(void) {
+    return avs_time_monotonic_now();
+}
+
+/* returns nanoseconds elapsed since start */
+static inline double benchmark_elapsed_ns(avs_time_monotonic_t start) {
+    int64_t ns = 0;
+    avs_time_duration_to_scalar(
+            &ns, AVS_TIME_NS,
+            avs_time_monotonic_diff(avs_time_monotonic_now(), start));
+    return (double) ns;
+}
+
+static inline void benchmark_report(const char *name, size_t n,
+                                    double elapsed_ns) {
+    printf("%-40s n=%-9lu %10.2f ns/elem %12.3f ms\n", name, (unsigned long) n,
+           elapsed_ns / (double) n, elapsed_ns / 1e6);
+}
+
+#endif /* AVS_COMMONS_BENCHMARK_H */
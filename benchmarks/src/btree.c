@@ -0,0 +1,159 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <avsystem/commons/btree.h>
+#include <avsystem/commons/rbtree.h>
+
+#include "benchmark.h"
+
+/* compares random-order insertion, lookups and in-order iteration of
+ * AVS_BTREE against AVS_RBTREE, for small (uint32_t) keys */
+
+static int compare_uint32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+    return x < y ? -1 : (x > y);
+}
+
+/* random permutation of even numbers from 0 to 2 * (n - 1) */
+static uint32_t *make_keys(size_t n) {
+    uint32_t *keys = (uint32_t *) malloc(n * sizeof(*keys));
+    size_t i;
+    if (!keys) {
+        abort();
+    }
+    for (i = 0; i < n; ++i) {
+        keys[i] = (uint32_t) (2 * i);
+    }
+    srand(0);
+    for (i = n; i > 1; --i) {
+        size_t j = (size_t) rand() % i;
+        uint32_t tmp = keys[i - 1];
+        keys[i - 1] = keys[j];
+        keys[j] = tmp;
+    }
+    return keys;
+}
+
+static void check_found(size_t found, size_t n) {
+    /* only even keys were inserted */
+    if (found != n / 2) {
+        fprintf(stderr, "invalid number of elements found!\n");
+        abort();
+    }
+}
+
+static void benchmark_rbtree(const uint32_t *keys, size_t n) {
+    AVS_RBTREE(uint32_t) tree = AVS_RBTREE_NEW_WITH_POOL(uint32_t,
+                                                         compare_uint32, NULL);
+    AVS_RBTREE_ELEM(uint32_t) it;
+    avs_time_monotonic_t start;
+    size_t found = 0;
+    uint64_t sum = 0;
+    size_t i;
+
+    start = benchmark_start();
+    for (i = 0; i < n; ++i) {
+        AVS_RBTREE_ELEM(uint32_t) elem = AVS_RBTREE_ELEM_NEW_IN(tree, uint32_t);
+        if (!elem) {
+            abort();
+        }
+        *elem = keys[i];
+        AVS_RBTREE_INSERT(tree, elem);
+    }
+    benchmark_report("AVS_RBTREE_INSERT (pool)", n, benchmark_elapsed_ns(start));
+
+    start = benchmark_start();
+    for (i = 0; i < n; ++i) {
+        uint32_t key = keys[i] / 2;
+        found += !!AVS_RBTREE_FIND(tree, &key);
+    }
+    benchmark_report("AVS_RBTREE_FIND", n, benchmark_elapsed_ns(start));
+    check_found(found, n);
+
+    start = benchmark_start();
+    AVS_RBTREE_FOREACH(it, tree) {
+        sum += *it;
+    }
+    benchmark_report("AVS_RBTREE_FOREACH", n, benchmark_elapsed_ns(start));
+    printf("(checksum %llu)\n", (unsigned long long) sum);
+
+    AVS_RBTREE_DELETE(&tree);
+}
+
+static void benchmark_btree(const uint32_t *keys, size_t n) {
+    AVS_BTREE(uint32_t) tree = AVS_BTREE_NEW(uint32_t, compare_uint32);
+    avs_btree_iter_t iter;
+    uint32_t *it;
+    avs_time_monotonic_t start;
+    size_t found = 0;
+    uint64_t sum = 0;
+    size_t i;
+
+    if (!tree) {
+        abort();
+    }
+    start = benchmark_start();
+    for (i = 0; i < n; ++i) {
+        if (!AVS_BTREE_INSERT(tree, &keys[i])) {
+            abort();
+        }
+    }
+    benchmark_report("AVS_BTREE_INSERT", n, benchmark_elapsed_ns(start));
+
+    start = benchmark_start();
+    for (i = 0; i < n; ++i) {
+        uint32_t key = keys[i] / 2;
+        found += !!AVS_BTREE_FIND(tree, &key);
+    }
+    benchmark_report("AVS_BTREE_FIND", n, benchmark_elapsed_ns(start));
+    check_found(found, n);
+
+    start = benchmark_start();
+    AVS_BTREE_FOREACH(it, iter, tree) {
+        sum += *it;
+    }
+    benchmark_report("AVS_BTREE_FOREACH", n, benchmark_elapsed_ns(start));
+    printf("(checksum %llu)\n", (unsigned long long) sum);
+
+    AVS_BTREE_DELETE(&tree);
+}
+
+static void benchmark(size_t n) {
+    uint32_t *keys = make_keys(n);
+    benchmark_rbtree(keys, n);
+    benchmark_btree(keys, n);
+    free(keys);
+}
+
+int main(int argc, char *argv[]) {
+    static const size_t DEFAULT_SIZES[] = { 1000, 100000, 1000000 };
+    size_t i;
+
+    if (argc > 1) {
+        benchmark((size_t) strtoul(argv[1], NULL, 10));
+        return 0;
+    }
+    for (i = 0; i < sizeof(DEFAULT_SIZES) / sizeof(DEFAULT_SIZES[0]); ++i) {
+        benchmark(DEFAULT_SIZES[i]);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <avsystem/commons/list.h>
+
+#include "benchmark.h"
+
+/* compares AVS_LIST_SORT against the recursive top-down merge sort it
+ * replaced, on random and nearly sorted lists */
+
+typedef struct {
+    uint32_t key;
+    uint32_t payload;
+} elem_t;
+
+static int compare_elems(const void *a, const void *b, size_t size) {
+    uint32_t x = ((const elem_t *) a)->key;
+    uint32_t y = ((const elem_t *) b)->key;
+    (void) size;
+    return x < y ? -1 : (x > y);
+}
+
+/* reference implementation: the previous avs_list_sort__ */
+static void half_list(void *list, void **part2_ptr) {
+    size_t length = AVS_LIST_SIZE(list);
+    length /= 2;
+    while (--length) {
+        list = AVS_LIST_NEXT(list);
+    }
+    *part2_ptr = AVS_LIST_NEXT(list);
+    AVS_LIST_NEXT(list) = NULL;
+}
+
+static void top_down_sort(void **list_ptr,
+                          avs_list_comparator_func_t comparator,
+                          size_t element_size) {
+    AVS_LIST(void) part1 = NULL;
+    AVS_LIST(void) part2 = NULL;
+    if (!list_ptr || !*list_ptr || !AVS_LIST_NEXT(*list_ptr)) {
+        return;
+    }
+    part1 = *list_ptr;
+    half_list(part1, &part2);
+    top_down_sort(&part1, comparator, element_size);
+    top_down_sort(&part2, comparator, element_size);
+    avs_list_merge__(&part1, &part2, comparator, element_size);
+    *list_ptr = part1;
+}
+
+typedef enum { PATTERN_RANDOM, PATTERN_NEARLY_SORTED } pattern_t;
+
+/* nodes are allocated from an arena, so that all runs start with the same,
+ * sequential memory layout regardless of what the allocator did before */
+static AVS_LIST(elem_t) make_list(avs_list_arena_t *arena, size_t n,
+                                  pattern_t pattern) {
+    AVS_LIST(elem_t) list = NULL;
+    AVS_LIST(elem_t) *append_ptr = &list;
+    uint32_t seed = 2463534242u;
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        AVS_LIST(elem_t) elem = AVS_LIST_NEW_ELEMENT_IN(arena, elem_t);
+        if (!elem) {
+            abort();
+        }
+        if (pattern == PATTERN_RANDOM) {
+            elem->key = benchmark_rand(&seed);
+        } else {
+            /* sorted, with about 1% of elements out of place */
+            elem->key = (uint32_t) i * 16;
+            if (benchmark_rand(&seed) % 100 == 0) {
+                elem->key = benchmark_rand(&seed) % ((uint32_t) n * 16);
+            }
+        }
+        elem->payload = (uint32_t) i;
+        *append_ptr = elem;
+        append_ptr = AVS_LIST_NEXT_PTR(append_ptr);
+    }
+    return list;
+}
+
+static void check_sorted(AVS_LIST(elem_t) list) {
+    AVS_LIST(elem_t) it;
+    const elem_t *prev = NULL;
+    AVS_LIST_FOREACH(it, list) {
+        if (prev && prev->key > it->key) {
+            fprintf(stderr, "list not sorted!\n");
+            abort();
+        }
+        prev = it;
+    }
+}
+
+static void benchmark(size_t n, pattern_t pattern, const char *pattern_name) {
+    char name[64];
+    avs_list_arena_t *arena = avs_list_arena_new(1024 * 1024);
+    AVS_LIST(elem_t) list;
+    avs_time_monotonic_t start;
+
+    if (!arena) {
+        abort();
+    }
+    list = make_list(arena, n, pattern);
+    start = benchmark_start();
+    top_down_sort((void **) &list, compare_elems, sizeof(elem_t));
+    snprintf(name, sizeof(name), "top-down merge sort, %s", pattern_name);
+    benchmark_report(name, n, benchmark_elapsed_ns(start));
+    check_sorted(list);
+    avs_list_arena_reset(arena);
+
+    list = make_list(arena, n, pattern);
+    start = benchmark_start();
+    AVS_LIST_SORT(&list, compare_elems);
+    snprintf(name, sizeof(name), "AVS_LIST_SORT, %s", pattern_name);
+    benchmark_report(name, n, benchmark_elapsed_ns(start));
+    check_sorted(list);
+    avs_list_arena_delete(&arena);
+}
+
+static void benchmark_all(size_t n) {
+    benchmark(n, PATTERN_RANDOM, "random");
+    benchmark(n, PATTERN_NEARLY_SORTED, "nearly sorted");
+}
+
+int main(int argc, char *argv[]) {
+    static const size_t DEFAULT_SIZES[] = { 10000, 100000, 1000000 };
+    size_t i;
+
+    if (argc > 1) {
+        benchmark_all((size_t) strtoul(argv[1], NULL, 10));
+        return 0;
+    }
+    for (i = 0; i < sizeof(DEFAULT_SIZES) / sizeof(DEFAULT_SIZES[0]); ++i) {
+        benchmark_all(DEFAULT_SIZES[i]);
+        printf("\n");
+    }
+    return 0;
+}
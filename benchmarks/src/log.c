@@ -0,0 +1,103 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <avsystem/commons/log.h>
+
+#include "benchmark.h"
+
+/* compares the cost of enabled log statements formatted immediately,
+ * recorded in the binary logging mode and dropped by the rate limit */
+
+static size_t HANDLED;
+
+static void counting_handler(avs_log_level_t level,
+                             const char *module,
+                             const char *message) {
+    (void) level;
+    (void) module;
+    (void) message;
+    ++HANDLED;
+}
+
+static void log_messages(size_t n) {
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        avs_log(benchmark, INFO, "request %u from %s: status %d, %.3f ms",
+                (unsigned) i, "192.0.2.1", 200, (double) i * 0.001);
+    }
+}
+
+static void log_ratelimited(size_t n) {
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        AVS_LOG_RATELIMITED(benchmark, INFO, 10, 1000,
+                            "request %u from %s: status %d, %.3f ms",
+                            (unsigned) i, "192.0.2.1", 200, (double) i * 0.001);
+    }
+}
+
+static void benchmark(size_t n) {
+    avs_time_monotonic_t start;
+
+    HANDLED = 0;
+    start = benchmark_start();
+    log_messages(n);
+    benchmark_report("avs_log formatted", n, benchmark_elapsed_ns(start));
+
+    start = benchmark_start();
+    log_ratelimited(n);
+    benchmark_report("AVS_LOG_RATELIMITED", n, benchmark_elapsed_ns(start));
+
+    /* large enough not to be drained while recording */
+    if (avs_log_binary_start(n * 128)) {
+        printf("binary logging mode not available\n");
+        return;
+    }
+    /* ignore the cost of allocating the buffer and faulting its pages in */
+    log_messages(n);
+    avs_log_binary_flush();
+    HANDLED = 0;
+    start = benchmark_start();
+    log_messages(n);
+    benchmark_report("avs_log binary record", n, benchmark_elapsed_ns(start));
+    start = benchmark_start();
+    avs_log_binary_stop();
+    benchmark_report("avs_log binary drain", n, benchmark_elapsed_ns(start));
+    if (HANDLED != n) {
+        fprintf(stderr, "lost log messages!\n");
+        abort();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    static const size_t DEFAULT_SIZES[] = { 1000, 100000, 1000000 };
+    size_t i;
+
+    avs_log_set_handler(counting_handler);
+    if (argc > 1) {
+        benchmark((size_t) strtoul(argv[1], NULL, 10));
+        return 0;
+    }
+    for (i = 0; i < sizeof(DEFAULT_SIZES) / sizeof(DEFAULT_SIZES[0]); ++i) {
+        benchmark(DEFAULT_SIZES[i]);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <avsystem/commons/rbtree.h>
+
+#include "benchmark.h"
+
+/* compares building an AVS_RBTREE from sorted keys by repeated
+ * AVS_RBTREE_INSERT against AVS_RBTREE_BUILD_FROM_ARRAY, with nodes allocated
+ * either with calloc() or from a slab pool */
+
+static int compare_uint32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+    return x < y ? -1 : (x > y);
+}
+
+static void check_tree(AVS_RBTREE(uint32_t) tree, size_t n) {
+    AVS_RBTREE_ELEM(uint32_t) it;
+    uint32_t expected = 0;
+
+    if (AVS_RBTREE_SIZE(tree) != n) {
+        fprintf(stderr, "invalid tree size!\n");
+        abort();
+    }
+    AVS_RBTREE_FOREACH(it, tree) {
+        if (*it != expected) {
+            fprintf(stderr, "tree not sorted!\n");
+            abort();
+        }
+        expected += 2;
+    }
+}
+
+static void benchmark_insert(const char *name, AVS_RBTREE(uint32_t) tree,
+                             const uint32_t *keys, size_t n) {
+    avs_time_monotonic_t start = benchmark_start();
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        AVS_RBTREE_ELEM(uint32_t) elem = AVS_RBTREE_ELEM_NEW_IN(tree, uint32_t);
+        if (!elem) {
+            abort();
+        }
+        *elem = keys[i];
+        AVS_RBTREE_INSERT(tree, elem);
+    }
+    benchmark_report(name, n, benchmark_elapsed_ns(start));
+}
+
+static void benchmark_build(const char *name, AVS_RBTREE(uint32_t) tree,
+                            const uint32_t *keys, size_t n) {
+    avs_time_monotonic_t start = benchmark_start();
+    if (AVS_RBTREE_BUILD_FROM_ARRAY(tree, keys, n)) {
+        abort();
+    }
+    benchmark_report(name, n, benchmark_elapsed_ns(start));
+}
+
+static void benchmark_delete(const char *name, AVS_RBTREE(uint32_t) *tree,
+                             size_t n) {
+    avs_time_monotonic_t start = benchmark_start();
+    AVS_RBTREE_DELETE(tree);
+    benchmark_report(name, n, benchmark_elapsed_ns(start));
+}
+
+static void benchmark(size_t n) {
+    uint32_t *keys = (uint32_t *) malloc(n * sizeof(*keys));
+    AVS_RBTREE(uint32_t) tree;
+    size_t i;
+
+    if (!keys) {
+        abort();
+    }
+    for (i = 0; i < n; ++i) {
+        keys[i] = (uint32_t) (2 * i);
+    }
+
+    tree = AVS_RBTREE_NEW(uint32_t, compare_uint32);
+    benchmark_insert("AVS_RBTREE_INSERT", tree, keys, n);
+    check_tree(tree, n);
+    benchmark_delete("AVS_RBTREE_DELETE", &tree, n);
+
+    tree = AVS_RBTREE_NEW_WITH_POOL(uint32_t, compare_uint32, NULL);
+    benchmark_insert("AVS_RBTREE_INSERT (pool)", tree, keys, n);
+    check_tree(tree, n);
+    benchmark_delete("AVS_RBTREE_DELETE (pool)", &tree, n);
+
+    tree = AVS_RBTREE_NEW(uint32_t, compare_uint32);
+    benchmark_build("AVS_RBTREE_BUILD_FROM_ARRAY", tree, keys, n);
+    check_tree(tree, n);
+    AVS_RBTREE_DELETE(&tree);
+
+    tree = AVS_RBTREE_NEW_WITH_POOL(uint32_t, compare_uint32, NULL);
+    benchmark_build("AVS_RBTREE_BUILD_FROM_ARRAY (pool)", tree, keys, n);
+    check_tree(tree, n);
+    AVS_RBTREE_DELETE(&tree);
+
+    free(keys);
+}
+
+int main(int argc, char *argv[]) {
+    static const size_t DEFAULT_SIZES[] = { 1000, 100000, 1000000 };
+    size_t i;
+
+    if (argc > 1) {
+        benchmark((size_t) strtoul(argv[1], NULL, 10));
+        return 0;
+    }
+    for (i = 0; i < sizeof(DEFAULT_SIZES) / sizeof(DEFAULT_SIZES[0]); ++i) {
+        benchmark(DEFAULT_SIZES[i]);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <avsystem/commons/list.h>
+#include <avsystem/commons/unrolled_list.h>
+#include <avsystem/commons/vector.h>
+
+#include "benchmark.h"
+
+/* compares AVS_UNROLLED_LIST with AVS_LIST and AVS_VECTOR used as a FIFO
+ * queue of small elements: push n elements, iterate over all of them, then
+ * pop all of them from the front */
+
+typedef struct {
+    double push_ns;
+    double iterate_ns;
+    double pop_ns;
+} results_t;
+
+static volatile uint64_t SINK;
+
+static void report(const char *container, size_t n, const results_t *results) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s push", container);
+    benchmark_report(name, n, results->push_ns);
+    snprintf(name, sizeof(name), "%s iterate", container);
+    benchmark_report(name, n, results->iterate_ns);
+    snprintf(name, sizeof(name), "%s pop", container);
+    benchmark_report(name, n, results->pop_ns);
+}
+
+static void benchmark_list(size_t n) {
+    AVS_LIST(uint32_t) list = NULL;
+    AVS_LIST(uint32_t) *append_ptr = &list;
+    AVS_LIST(uint32_t) it;
+    results_t results;
+    avs_time_monotonic_t start;
+    uint64_t sum = 0;
+    size_t i;
+
+    start = benchmark_start();
+    for (i = 0; i < n; ++i) {
+        AVS_LIST(uint32_t) elem = AVS_LIST_NEW_ELEMENT(uint32_t);
+        if (!elem) {
+            abort();
+        }
+        *elem = (uint32_t) i;
+        *append_ptr = elem;
+        append_ptr = AVS_LIST_NEXT_PTR(append_ptr);
+    }
+    results.push_ns = benchmark_elapsed_ns(start);
+
+    start = benchmark_start();
+    AVS_LIST_FOREACH(it, list) {
+        sum += *it;
+    }
+    results.iterate_ns = benchmark_elapsed_ns(start);
+
+    start = benchmark_start();
+    while (list) {
+        sum += *list;
+        AVS_LIST_DELETE(&list);
+    }
+    results.pop_ns = benchmark_elapsed_ns(start);
+
+    SINK = sum;
+    report("AVS_LIST", n, &results);
+}
+
+static void benchmark_vector(size_t n) {
+    AVS_VECTOR(uint32_t) vec = AVS_VECTOR_NEW(uint32_t);
+    results_t results;
+    avs_time_monotonic_t start;
+    uint64_t sum = 0;
+    size_t head;
+    size_t i;
+
+    if (!vec) {
+        abort();
+    }
+    start = benchmark_start();
+    for (i = 0; i < n; ++i) {
+        uint32_t value = (uint32_t) i;
+        if (AVS_VECTOR_PUSH(&vec, &value)) {
+            abort();
+        }
+    }
+    results.push_ns = benchmark_elapsed_ns(start);
+
+    start = benchmark_start();
+    for (i = 0; i < n; ++i) {
+        sum += (*vec)[i];
+    }
+    results.iterate_ns = benchmark_elapsed_ns(start);
+
+    /* removing elements one by one from the front of a vector is O(n) each;
+     * a queue built on a vector would rather advance a head index and
+     * compact lazily, which is what is measured here */
+    start = benchmark_start();
+    for (head = 0; head < n; ++head) {
+        sum += (*vec)[head];
+    }
+    AVS_VECTOR_ERASE_RANGE(&vec, 0, head);
+    results.pop_ns = benchmark_elapsed_ns(start);
+
+    SINK = sum;
+    AVS_VECTOR_DELETE(&vec);
+    report("AVS_VECTOR", n, &results);
+}
+
+static void benchmark_unrolled_list(size_t n) {
+    AVS_UNROLLED_LIST(uint32_t) list = AVS_UNROLLED_LIST_NEW(uint32_t);
+    avs_unrolled_list_iter_t iter;
+    uint32_t *it;
+    results_t results;
+    avs_time_monotonic_t start;
+    uint64_t sum = 0;
+    size_t i;
+
+    if (!list) {
+        abort();
+    }
+    start = benchmark_start();
+    for (i = 0; i < n; ++i) {
+        uint32_t value = (uint32_t) i;
+        if (!AVS_UNROLLED_LIST_PUSH_BACK(list, &value)) {
+            abort();
+        }
+    }
+    results.push_ns = benchmark_elapsed_ns(start);
+
+    start = benchmark_start();
+    AVS_UNROLLED_LIST_FOREACH(it, iter, list) {
+        sum += *it;
+    }
+    results.iterate_ns = benchmark_elapsed_ns(start);
+
+    start = benchmark_start();
+    while ((it = AVS_UNROLLED_LIST_FRONT(list))) {
+        sum += *it;
+        AVS_UNROLLED_LIST_POP_FRONT(list);
+    }
+    results.pop_ns = benchmark_elapsed_ns(start);
+
+    SINK = sum;
+    AVS_UNROLLED_LIST_DELETE(&list);
+    report("AVS_UNROLLED_LIST", n, &results);
+}
+
+static void benchmark_all(size_t n) {
+    benchmark_list(n);
+    benchmark_vector(n);
+    benchmark_unrolled_list(n);
+}
+
+int main(int argc, char *argv[]) {
+    static const size_t DEFAULT_SIZES[] = { 1000, 100000, 1000000 };
+    size_t i;
+
+    if (argc > 1) {
+        benchmark_all((size_t) strtoul(argv[1], NULL, 10));
+        return 0;
+    }
+    for (i = 0; i < sizeof(DEFAULT_SIZES) / sizeof(DEFAULT_SIZES[0]); ++i) {
+        benchmark_all(DEFAULT_SIZES[i]);
+        printf("\n");
+    }
+    return 0;
+}
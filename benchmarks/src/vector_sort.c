@@ -0,0 +1,122 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avsystem/commons/vector.h>
+
+#include "benchmark.h"
+
+/* compares avs_vector_sort__ (comparator called through a pointer),
+ * AVS_VECTOR_SORT_INLINE and AVS_VECTOR_RADIX_SORT on integer keys of
+ * various widths */
+
+#define DEFINE_KEY_TYPE(Type)                                               \
+    static int compare_##Type(const void *a, const void *b) {               \
+        Type x = *(const Type *) a;                                         \
+        Type y = *(const Type *) b;                                         \
+        return x < y ? -1 : (x > y);                                        \
+    }                                                                       \
+                                                                            \
+    static inline int compare_inline_##Type(const Type *a, const Type *b) { \
+        return *a < *b ? -1 : (*a > *b);                                    \
+    }                                                                       \
+                                                                            \
+    AVS_VECTOR_SORT_INLINE(sort_inline_##Type, Type, compare_inline_##Type) \
+                                                                            \
+    static AVS_VECTOR(Type) make_vector_##Type(size_t n) {                  \
+        AVS_VECTOR(Type) vec = AVS_VECTOR_NEW(Type);                        \
+        uint32_t seed = 2463534242u;                                        \
+        size_t i;                                                           \
+        if (!vec || AVS_VECTOR_RESERVE(&vec, n)) {                          \
+            abort();                                                        \
+        }                                                                   \
+        for (i = 0; i < n; ++i) {                                           \
+            uint64_t value = ((uint64_t) benchmark_rand(&seed) << 32)       \
+                             | benchmark_rand(&seed);                       \
+            Type elem = (Type) value;                                       \
+            AVS_VECTOR_PUSH(&vec, &elem);                                   \
+        }                                                                   \
+        return vec;                                                         \
+    }                                                                       \
+                                                                            \
+    static void check_sorted_##Type(AVS_VECTOR(Type) vec) {                 \
+        size_t i;                                                           \
+        for (i = 1; i < AVS_VECTOR_SIZE(vec); ++i) {                        \
+            if ((*vec)[i - 1] > (*vec)[i]) {                                \
+                fprintf(stderr, "vector not sorted!\n");                    \
+                abort();                                                    \
+            }                                                               \
+        }                                                                   \
+    }                                                                       \
+                                                                            \
+    static void benchmark_##Type(size_t n) {                                \
+        AVS_VECTOR(Type) vec;                                               \
+        avs_time_monotonic_t start;                                         \
+                                                                            \
+        vec = make_vector_##Type(n);                                        \
+        start = benchmark_start();                                          \
+        AVS_VECTOR_SORT(&vec, compare_##Type);                              \
+        benchmark_report("AVS_VECTOR_SORT " #Type, n,                       \
+                         benchmark_elapsed_ns(start));                      \
+        check_sorted_##Type(vec);                                           \
+        AVS_VECTOR_DELETE(&vec);                                            \
+                                                                            \
+        vec = make_vector_##Type(n);                                        \
+        start = benchmark_start();                                          \
+        sort_inline_##Type(&vec);                                           \
+        benchmark_report("AVS_VECTOR_SORT_INLINE " #Type, n,                \
+                         benchmark_elapsed_ns(start));                      \
+        check_sorted_##Type(vec);                                           \
+        AVS_VECTOR_DELETE(&vec);                                            \
+                                                                            \
+        vec = make_vector_##Type(n);                                        \
+        start = benchmark_start();                                          \
+        if (AVS_VECTOR_RADIX_SORT(&vec, 0, sizeof(Type))) {                 \
+            abort();                                                        \
+        }                                                                   \
+        benchmark_report("AVS_VECTOR_RADIX_SORT " #Type, n,                 \
+                         benchmark_elapsed_ns(start));                      \
+        check_sorted_##Type(vec);                                           \
+        AVS_VECTOR_DELETE(&vec);                                            \
+    }
+
+DEFINE_KEY_TYPE(uint16_t)
+DEFINE_KEY_TYPE(uint32_t)
+DEFINE_KEY_TYPE(uint64_t)
+
+int main(int argc, char *argv[]) {
+    static const size_t DEFAULT_SIZES[] = { 1000, 100000, 1000000 };
+    size_t i;
+
+    if (argc > 1) {
+        size_t n = (size_t) strtoul(argv[1], NULL, 10);
+        benchmark_uint16_t(n);
+        benchmark_uint32_t(n);
+        benchmark_uint64_t(n);
+        return 0;
+    }
+    for (i = 0; i < sizeof(DEFAULT_SIZES) / sizeof(DEFAULT_SIZES[0]); ++i) {
+        benchmark_uint16_t(DEFAULT_SIZES[i]);
+        benchmark_uint32_t(DEFAULT_SIZES[i]);
+        benchmark_uint64_t(DEFAULT_SIZES[i]);
+        printf("\n");
+    }
+    return 0;
+}
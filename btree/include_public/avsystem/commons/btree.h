@@ -0,0 +1,367 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_BTREE_H
+#define AVS_COMMONS_BTREE_H
+
+#include <stddef.h>
+
+#include <avsystem/commons/defs.h>
+
+/**
+ * @file btree.h
+ *
+ * Generic ordered container, implemented as a B+-tree.
+ *
+ * Elements are stored by value, sorted, in wide leaf nodes that are linked
+ * together for in-order iteration. Inner nodes only hold copies of separator
+ * elements and child pointers. All nodes span a few cache lines and are
+ * allocated at cache line boundaries, so a lookup touches one node per level
+ * of a tree that is much shallower than an equivalent @ref AVS_RBTREE, and
+ * searches contiguous memory within each node.
+ *
+ * The comparator has the same semantics as in @ref AVS_RBTREE, so any
+ * @ref avs_btree_element_comparator_t may be used with both containers.
+ *
+ * Unlike with @ref AVS_RBTREE, element pointers are invalidated by any
+ * operation that inserts or removes elements, as elements are moved within
+ * and between nodes.
+ *
+ * <example>
+ * @code
+ * static int int_cmp(const void *a, const void *b) {
+ *     int x = *(const int *) a;
+ *     int y = *(const int *) b;
+ *     return (x > y) - (x < y);
+ * }
+ *
+ * AVS_BTREE(int) tree = AVS_BTREE_NEW(int, int_cmp);
+ * avs_btree_iter_t iter;
+ * int *elem;
+ * int value;
+ *
+ * for (value = 0; value < 100; ++value) {
+ *     AVS_BTREE_INSERT(tree, &value);
+ * }
+ *
+ * // prints 42, 43, ..., 99
+ * value = 42;
+ * AVS_BTREE_FOREACH_FROM(elem, iter, tree, &value) {
+ *     printf("%d\n", *elem);
+ * }
+ *
+ * AVS_BTREE_DELETE(&tree);
+ * @endcode
+ * </example>
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Element comparator type, compatible with
+ * @ref avs_rbtree_element_comparator_t.
+ *
+ * @returns Negative value if @p a < @p b, zero if @p a == @p b, positive value
+ *          if @p a > @p b. The comparator MUST establish a total ordering of
+ *          elements.
+ */
+typedef int avs_btree_element_comparator_t(const void *a, const void *b);
+
+/** Internal leaf node structure. Do not use directly. */
+typedef struct avs_btree_leaf_struct__ {
+    struct avs_btree_leaf_struct__ *next;
+    size_t count;
+    union {
+        char bytes[1]; /* variable length */
+        avs_max_align_t align;
+    } data;
+} avs_btree_leaf_t__;
+
+/**
+ * Iterator state for @ref AVS_BTREE_FOREACH and
+ * @ref AVS_BTREE_FOREACH_FROM. Its fields are internal.
+ */
+typedef struct {
+    avs_btree_leaf_t__ *leaf;
+    char *elem;
+    char *end;
+    size_t elem_size;
+} avs_btree_iter_t;
+
+/* Internal functions. Use macros defined below instead. */
+void **avs_btree_new__(size_t elem_size,
+                       avs_btree_element_comparator_t *cmp,
+                       size_t node_bytes);
+void avs_btree_delete__(void ***tree_ptr);
+void avs_btree_clear__(void **tree);
+size_t avs_btree_size__(void **tree);
+void *avs_btree_find__(void **tree, const void *value);
+void *avs_btree_lower_bound__(void **tree, const void *value);
+void *avs_btree_upper_bound__(void **tree, const void *value);
+void *avs_btree_last__(void **tree);
+void *avs_btree_insert__(void **tree, const void *value);
+int avs_btree_erase__(void **tree, const void *value);
+void *avs_btree_iter_begin__(avs_btree_iter_t *iter, void **tree);
+void *avs_btree_iter_begin_from__(avs_btree_iter_t *iter, void **tree,
+                                  const void *value);
+
+static inline void *avs_btree_iter_next__(avs_btree_iter_t *iter) {
+    iter->elem += iter->elem_size;
+    if (iter->elem == iter->end) {
+        if (!(iter->leaf = iter->leaf->next)) {
+            return NULL;
+        }
+        iter->elem = iter->leaf->data.bytes;
+        iter->end = iter->elem + iter->leaf->count * iter->elem_size;
+    }
+    return iter->elem;
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#define _AVS_BTREE_TYPECHECK(first_ptr_type, second_ptr_type) \
+    ((void) (sizeof((first_ptr_type) < (second_ptr_type))))
+
+#ifdef __cplusplus
+template <typename T>
+static inline T *AVS_BTREE_CALL_WITH_ELEM_CAST__(void *(*func)(void **),
+                                                 T **tree) {
+    return (T *) func((void **) tree);
+}
+
+template <typename Func, typename T, typename Arg>
+static inline T *AVS_BTREE_CALL_WITH_ELEM_CAST__(const Func &func,
+                                                 T **tree, const Arg &arg) {
+    return (T *) func((void **) tree, arg);
+}
+
+template <typename T>
+static inline T *avs_btree_iter_begin_impl__(avs_btree_iter_t *iter,
+                                             T **tree) {
+    return (T *) avs_btree_iter_begin__(iter, (void **) tree);
+}
+
+template <typename T>
+static inline T *avs_btree_iter_begin_from_impl__(avs_btree_iter_t *iter,
+                                                  T **tree, const T *value) {
+    return (T *) avs_btree_iter_begin_from__(iter, (void **) tree, value);
+}
+
+template <typename T>
+static inline T *avs_btree_iter_next_impl__(avs_btree_iter_t *iter, T *) {
+    return (T *) avs_btree_iter_next__(iter);
+}
+
+#define AVS_BTREE_ITER_BEGIN__(iter, tree) \
+    (avs_btree_iter_begin_impl__(&(iter), (tree)))
+#define AVS_BTREE_ITER_BEGIN_FROM__(iter, tree, val_ptr) \
+    (avs_btree_iter_begin_from_impl__(&(iter), (tree), (val_ptr)))
+#define AVS_BTREE_ITER_NEXT__(iter, elem) \
+    (avs_btree_iter_next_impl__(&(iter), (elem)))
+#else
+#define AVS_BTREE_CALL_WITH_ELEM_CAST__(func, ...) \
+    ((AVS_TYPEOF_PTR(*(AVS_VARARG0(__VA_ARGS__)))) \
+        func((void **) __VA_ARGS__))
+
+#define AVS_BTREE_ITER_BEGIN__(iter, tree) \
+    ((AVS_TYPEOF_PTR(*(tree))) avs_btree_iter_begin__(&(iter), \
+                                                      (void **) (tree)))
+#define AVS_BTREE_ITER_BEGIN_FROM__(iter, tree, val_ptr) \
+    (_AVS_BTREE_TYPECHECK(*(tree), (val_ptr)), \
+     (AVS_TYPEOF_PTR(*(tree))) avs_btree_iter_begin_from__( \
+             &(iter), (void **) (tree), (val_ptr)))
+#define AVS_BTREE_ITER_NEXT__(iter, elem) \
+    ((AVS_TYPEOF_PTR(elem)) avs_btree_iter_next__(&(iter)))
+#endif
+
+/**
+ * B+-tree type for a given element type.
+ *
+ * The tree object is a pointer to a variable that holds a pointer to the
+ * smallest element, or NULL if the tree is empty - see @ref AVS_BTREE_FIRST.
+ */
+#define AVS_BTREE(type) type**
+
+/**
+ * Default size of a single tree node, in bytes, used by @ref AVS_BTREE_NEW.
+ */
+#define AVS_BTREE_DEFAULT_NODE_BYTES 256
+
+/**
+ * Creates an empty B+-tree with elements of given @p type.
+ *
+ * Nodes are sized to approximately @ref AVS_BTREE_DEFAULT_NODE_BYTES, but
+ * hold no fewer than 4 elements.
+ *
+ * @param type Type of elements stored in the tree.
+ * @param cmp  Element comparator, see @ref avs_btree_element_comparator_t.
+ *
+ * @returns Created tree object on success, NULL in case of error.
+ */
+#define AVS_BTREE_NEW(type, cmp) \
+    ((AVS_BTREE(type)) avs_btree_new__(sizeof(type), (cmp), 0))
+
+/**
+ * Creates an empty B+-tree with elements of given @p type, with nodes sized
+ * to approximately @p node_bytes bytes.
+ *
+ * @returns Created tree object on success, NULL in case of error.
+ */
+#define AVS_BTREE_NEW_WITH_NODE_SIZE(type, cmp, node_bytes) \
+    ((AVS_BTREE(type)) avs_btree_new__(sizeof(type), (cmp), (node_bytes)))
+
+/**
+ * Releases the tree and all its elements, and sets <c>*tree_ptr</c> to NULL.
+ * Does nothing if @p tree_ptr or <c>*tree_ptr</c> is NULL.
+ *
+ * To free resources owned by the elements, iterate over them with
+ * @ref AVS_BTREE_FOREACH first.
+ */
+#define AVS_BTREE_DELETE(tree_ptr) avs_btree_delete__((void ***) (tree_ptr))
+
+/**
+ * Removes all elements from the tree.
+ */
+#define AVS_BTREE_CLEAR(tree) avs_btree_clear__((void **) (tree))
+
+/**
+ * @returns Number of elements stored in the tree. Complexity: O(1).
+ */
+#define AVS_BTREE_SIZE(tree) avs_btree_size__((void **) (tree))
+
+/**
+ * @returns Pointer to the smallest element of @p tree, or NULL if it is empty.
+ *          Complexity: O(1).
+ */
+#define AVS_BTREE_FIRST(tree) (*(tree))
+
+/**
+ * @returns Pointer to the largest element of @p tree, or NULL if it is empty.
+ *          Complexity: O(log n).
+ */
+#define AVS_BTREE_LAST(tree) \
+    AVS_BTREE_CALL_WITH_ELEM_CAST__(avs_btree_last__, (tree))
+
+/**
+ * Finds an element equal to @p val_ptr in @p tree.
+ *
+ * Complexity: O((log n) * c), where c is the complexity of the comparator.
+ *
+ * @returns Found element pointer, or NULL if the tree does not contain such
+ *          element.
+ */
+#define AVS_BTREE_FIND(tree, val_ptr) \
+    (_AVS_BTREE_TYPECHECK(*(tree), (val_ptr)), \
+     AVS_BTREE_CALL_WITH_ELEM_CAST__(avs_btree_find__, (tree), (val_ptr)))
+
+/**
+ * Finds the first element in @p tree that is greater or equal to
+ * @p val_ptr.
+ *
+ * Complexity: O((log n) * c), where c is the complexity of the comparator.
+ *
+ * @returns Found element pointer, or NULL if all elements are strictly less
+ *          than @p val_ptr.
+ */
+#define AVS_BTREE_LOWER_BOUND(tree, val_ptr) \
+    (_AVS_BTREE_TYPECHECK(*(tree), (val_ptr)), \
+     AVS_BTREE_CALL_WITH_ELEM_CAST__(avs_btree_lower_bound__, (tree), \
+                                     (val_ptr)))
+
+/**
+ * Finds the first element in @p tree that is strictly greater than
+ * @p val_ptr.
+ *
+ * Complexity: O((log n) * c), where c is the complexity of the comparator.
+ *
+ * @returns Found element pointer, or NULL if all elements are less or equal
+ *          to @p val_ptr.
+ */
+#define AVS_BTREE_UPPER_BOUND(tree, val_ptr) \
+    (_AVS_BTREE_TYPECHECK(*(tree), (val_ptr)), \
+     AVS_BTREE_CALL_WITH_ELEM_CAST__(avs_btree_upper_bound__, (tree), \
+                                     (val_ptr)))
+
+/**
+ * Inserts a copy of the value pointed to by @p val_ptr into the tree, if an
+ * equal element does not yet exist in it.
+ *
+ * Complexity: O((log n) * c + m), where c is the complexity of the comparator
+ * and m is the number of elements per node.
+ *
+ * @returns:
+ * - pointer to the inserted element on success,
+ * - a pointer to the equal element if one already existed in the tree,
+ * - NULL in case of memory allocation failure.
+ */
+#define AVS_BTREE_INSERT(tree, val_ptr) \
+    (_AVS_BTREE_TYPECHECK(*(tree), (val_ptr)), \
+     AVS_BTREE_CALL_WITH_ELEM_CAST__(avs_btree_insert__, (tree), (val_ptr)))
+
+/**
+ * Removes the element equal to @p val_ptr from the tree, if it exists.
+ *
+ * Complexity: O((log n) * c + m), where c is the complexity of the comparator
+ * and m is the number of elements per node.
+ *
+ * @returns 0 if the element has been removed, or a negative value if the tree
+ *          does not contain such element.
+ */
+#define AVS_BTREE_ERASE(tree, val_ptr) \
+    (_AVS_BTREE_TYPECHECK(*(tree), (val_ptr)), \
+     avs_btree_erase__((void **) (tree), (val_ptr)))
+
+/**
+ * Iterates over all elements of the tree, in ascending order.
+ *
+ * The tree MUST NOT be modified during iteration.
+ *
+ * @param elem Iterator variable of element pointer type.
+ *
+ * @param iter Helper variable of type @ref avs_btree_iter_t.
+ *
+ * @param tree The tree to iterate over.
+ */
+#define AVS_BTREE_FOREACH(elem, iter, tree) \
+    for ((elem) = AVS_BTREE_ITER_BEGIN__(iter, tree); \
+         (elem); \
+         (elem) = AVS_BTREE_ITER_NEXT__(iter, elem))
+
+/**
+ * Iterates over elements of the tree that are greater or equal to
+ * @p val_ptr, in ascending order. Only one lookup is performed - subsequent
+ * elements are visited by following links between leaf nodes.
+ *
+ * The tree MUST NOT be modified during iteration.
+ *
+ * @param elem    Iterator variable of element pointer type.
+ *
+ * @param iter    Helper variable of type @ref avs_btree_iter_t.
+ *
+ * @param tree    The tree to iterate over.
+ *
+ * @param val_ptr Pointer to the lower bound of the iterated range.
+ */
+#define AVS_BTREE_FOREACH_FROM(elem, iter, tree, val_ptr) \
+    for ((elem) = AVS_BTREE_ITER_BEGIN_FROM__(iter, tree, val_ptr); \
+         (elem); \
+         (elem) = AVS_BTREE_ITER_NEXT__(iter, elem))
+
+#endif /* AVS_COMMONS_BTREE_H */
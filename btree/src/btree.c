@@ -0,0 +1,659 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_config.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avsystem/commons/btree.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+/*
+ * Tree layout (B+-tree):
+ *
+ * - leaves hold between capacity / 2 and capacity elements (the root leaf may
+ *   hold fewer), sorted and packed at the beginning of the node; all leaves
+ *   are linked in ascending order through their next pointers,
+ *
+ * - inner nodes hold count keys and count + 1 children, where key i is
+ *   a copy of some element that is greater than all elements in child i and
+ *   less or equal to all elements in child i + 1. Keys are not necessarily
+ *   present in the leaves, as they are not updated when elements are removed.
+ *
+ * Every node has room for one element (or key and child) more than its
+ * capacity, so that an element may always be inserted before the node is
+ * split. Nodes are allocated at cache line boundaries.
+ */
+
+#define CACHE_LINE_SIZE 64
+#define MIN_NODE_CAPACITY 4
+
+/*
+ * Inner nodes other than the root have at least 3 children, so this is more
+ * than enough for any number of elements that fits in memory.
+ */
+#define MAX_HEIGHT 48
+
+typedef avs_btree_leaf_t__ btree_leaf_t;
+
+typedef struct {
+    size_t count;
+    /* count + 1 children, followed by count keys at inner_keys_offset */
+    void *children[1];
+} btree_inner_t;
+
+typedef struct {
+    char pad;
+    avs_max_align_t value;
+} btree_alignment_helper_t;
+
+#define MAX_ALIGNMENT offsetof(btree_alignment_helper_t, value)
+
+typedef struct {
+    /* pointer to the smallest element; the tree handle points here */
+    void *first;
+    avs_btree_element_comparator_t *cmp;
+    size_t elem_size;
+    size_t size;
+    /* number of inner node levels above the leaves */
+    size_t height;
+    void *root;
+    btree_leaf_t *head;
+    size_t leaf_capacity;
+    size_t leaf_bytes;
+    size_t inner_capacity;
+    size_t inner_keys_offset;
+    size_t inner_bytes;
+} btree_t;
+
+/* inner nodes on the way from the root to a leaf, with child indices */
+typedef struct {
+    btree_inner_t *nodes[MAX_HEIGHT];
+    size_t indices[MAX_HEIGHT];
+} btree_path_t;
+
+static btree_t *get_tree(void **tree) {
+    return AVS_CONTAINER_OF(tree, btree_t, first);
+}
+
+static size_t round_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/*
+ * The pointer returned by malloc() is stored right before the aligned node.
+ * malloc() results are aligned at least to sizeof(void *), so there is always
+ * enough room for it.
+ */
+static void *node_alloc(size_t size) {
+    char *raw = (char *) malloc(size + CACHE_LINE_SIZE);
+    char *node;
+    if (!raw) {
+        return NULL;
+    }
+    node = raw + CACHE_LINE_SIZE - (size_t) ((uintptr_t) raw % CACHE_LINE_SIZE);
+    ((void **) (void *) node)[-1] = raw;
+    return node;
+}
+
+static void node_free(void *node) {
+    if (node) {
+        free(((void **) node)[-1]);
+    }
+}
+
+static char *leaf_elem(const btree_t *tree, btree_leaf_t *leaf,
+                       size_t index) {
+    return leaf->data.bytes + index * tree->elem_size;
+}
+
+static char *inner_key(const btree_t *tree, btree_inner_t *node,
+                       size_t index) {
+    return (char *) node + tree->inner_keys_offset + index * tree->elem_size;
+}
+
+/*
+ * Returns the number of leading elements of the sorted array that are less
+ * than value, or less or equal to value if or_equal is non-zero.
+ */
+static size_t search(const btree_t *tree, const char *elems, size_t count,
+                     const void *value, int or_equal) {
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int result = tree->cmp(elems + mid * tree->elem_size, value);
+        if (result < 0 || (or_equal && result == 0)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static btree_leaf_t *find_leaf(const btree_t *tree, const void *value,
+                               btree_path_t *path) {
+    void *node = tree->root;
+    size_t level;
+    for (level = 0; level < tree->height; ++level) {
+        btree_inner_t *inner = (btree_inner_t *) node;
+        size_t index = search(tree, inner_key(tree, inner, 0), inner->count,
+                              value, 1);
+        if (path) {
+            path->nodes[level] = inner;
+            path->indices[level] = index;
+        }
+        node = inner->children[index];
+    }
+    return (btree_leaf_t *) node;
+}
+
+static void free_subtree(void *node, size_t height) {
+    if (height > 0) {
+        btree_inner_t *inner = (btree_inner_t *) node;
+        size_t i;
+        for (i = 0; i <= inner->count; ++i) {
+            free_subtree(inner->children[i], height - 1);
+        }
+    }
+    node_free(node);
+}
+
+void **avs_btree_new__(size_t elem_size,
+                       avs_btree_element_comparator_t *cmp,
+                       size_t node_bytes) {
+    const size_t leaf_data_offset = offsetof(btree_leaf_t, data);
+    const size_t children_offset = offsetof(btree_inner_t, children);
+    size_t inner_fixed_bytes;
+    btree_t *tree;
+
+    assert(elem_size > 0);
+    assert(cmp);
+    if (!node_bytes) {
+        node_bytes = AVS_BTREE_DEFAULT_NODE_BYTES;
+    }
+
+    tree = (btree_t *) calloc(1, sizeof(btree_t));
+    if (!tree) {
+        return NULL;
+    }
+    tree->cmp = cmp;
+    tree->elem_size = elem_size;
+
+    if (node_bytes > leaf_data_offset) {
+        tree->leaf_capacity = (node_bytes - leaf_data_offset) / elem_size;
+    }
+    /* one slot is reserved for insertion into a full leaf */
+    tree->leaf_capacity = tree->leaf_capacity > MIN_NODE_CAPACITY + 1
+            ? tree->leaf_capacity - 1
+            : MIN_NODE_CAPACITY;
+    tree->leaf_bytes = round_up(leaf_data_offset
+                                        + (tree->leaf_capacity + 1) * elem_size,
+                                CACHE_LINE_SIZE);
+
+    /* room for the spare key and child, and for padding before the keys */
+    inner_fixed_bytes = children_offset + 2 * sizeof(void *) + elem_size
+                        + MAX_ALIGNMENT;
+    if (node_bytes > inner_fixed_bytes) {
+        tree->inner_capacity = (node_bytes - inner_fixed_bytes)
+                               / (elem_size + sizeof(void *));
+    }
+    tree->inner_capacity = AVS_MAX(tree->inner_capacity, MIN_NODE_CAPACITY);
+    tree->inner_keys_offset =
+            round_up(children_offset
+                             + (tree->inner_capacity + 2) * sizeof(void *),
+                     MAX_ALIGNMENT);
+    tree->inner_bytes = round_up(tree->inner_keys_offset
+                                         + (tree->inner_capacity + 1)
+                                                   * elem_size,
+                                 CACHE_LINE_SIZE);
+    return &tree->first;
+}
+
+void avs_btree_clear__(void **tree_) {
+    btree_t *tree = get_tree(tree_);
+    if (tree->root) {
+        free_subtree(tree->root, tree->height);
+    }
+    tree->first = NULL;
+    tree->size = 0;
+    tree->height = 0;
+    tree->root = NULL;
+    tree->head = NULL;
+}
+
+void avs_btree_delete__(void ***tree_ptr) {
+    if (tree_ptr && *tree_ptr) {
+        avs_btree_clear__(*tree_ptr);
+        free(get_tree(*tree_ptr));
+        *tree_ptr = NULL;
+    }
+}
+
+size_t avs_btree_size__(void **tree) {
+    return get_tree(tree)->size;
+}
+
+void *avs_btree_find__(void **tree_, const void *value) {
+    btree_t *tree = get_tree(tree_);
+    btree_leaf_t *leaf;
+    size_t index;
+    if (!tree->root) {
+        return NULL;
+    }
+    leaf = find_leaf(tree, value, NULL);
+    index = search(tree, leaf->data.bytes, leaf->count, value, 0);
+    if (index < leaf->count
+            && !tree->cmp(leaf_elem(tree, leaf, index), value)) {
+        return leaf_elem(tree, leaf, index);
+    }
+    return NULL;
+}
+
+static void *bound(btree_t *tree, const void *value, int or_equal) {
+    btree_leaf_t *leaf;
+    size_t index;
+    if (!tree->root) {
+        return NULL;
+    }
+    leaf = find_leaf(tree, value, NULL);
+    index = search(tree, leaf->data.bytes, leaf->count, value, or_equal);
+    if (index < leaf->count) {
+        return leaf_elem(tree, leaf, index);
+    }
+    return leaf->next ? leaf->next->data.bytes : NULL;
+}
+
+void *avs_btree_lower_bound__(void **tree, const void *value) {
+    return bound(get_tree(tree), value, 0);
+}
+
+void *avs_btree_upper_bound__(void **tree, const void *value) {
+    return bound(get_tree(tree), value, 1);
+}
+
+void *avs_btree_last__(void **tree_) {
+    btree_t *tree = get_tree(tree_);
+    void *node = tree->root;
+    size_t level;
+    if (!node) {
+        return NULL;
+    }
+    for (level = 0; level < tree->height; ++level) {
+        btree_inner_t *inner = (btree_inner_t *) node;
+        node = inner->children[inner->count];
+    }
+    return leaf_elem(tree, (btree_leaf_t *) node,
+                     ((btree_leaf_t *) node)->count - 1);
+}
+
+static btree_leaf_t *create_root_leaf(btree_t *tree) {
+    btree_leaf_t *leaf = (btree_leaf_t *) node_alloc(tree->leaf_bytes);
+    if (leaf) {
+        leaf->next = NULL;
+        leaf->count = 0;
+        tree->root = leaf;
+        tree->head = leaf;
+        tree->first = leaf->data.bytes;
+    }
+    return leaf;
+}
+
+/*
+ * Inserts key at index and child at index + 1 into an inner node. The node
+ * MUST have room for them, i.e. count MUST NOT exceed capacity.
+ */
+static void inner_insert(const btree_t *tree, btree_inner_t *node,
+                         size_t index, const void *key, void *child) {
+    assert(node->count <= tree->inner_capacity);
+    memmove(inner_key(tree, node, index + 1), inner_key(tree, node, index),
+            (node->count - index) * tree->elem_size);
+    memcpy(inner_key(tree, node, index), key, tree->elem_size);
+    memmove(&node->children[index + 2], &node->children[index + 1],
+            (node->count - index) * sizeof(void *));
+    node->children[index + 1] = child;
+    ++node->count;
+}
+
+/*
+ * Splits an overflowing leaf (or inner node, if level < height) into itself
+ * and the preallocated right node, and inserts the separator into the parent,
+ * splitting it as well if necessary. New nodes are taken from spare_nodes.
+ */
+static void split(btree_t *tree, btree_path_t *path, size_t level, void *node,
+                  void **spare_nodes) {
+    while (1) {
+        void *right = *spare_nodes++;
+        const char *separator;
+        if (level == tree->height) {
+            btree_leaf_t *leaf = (btree_leaf_t *) node;
+            btree_leaf_t *right_leaf = (btree_leaf_t *) right;
+            size_t left_count = leaf->count / 2;
+            right_leaf->count = leaf->count - left_count;
+            memcpy(right_leaf->data.bytes, leaf_elem(tree, leaf, left_count),
+                   right_leaf->count * tree->elem_size);
+            leaf->count = left_count;
+            right_leaf->next = leaf->next;
+            leaf->next = right_leaf;
+            separator = right_leaf->data.bytes;
+        } else {
+            btree_inner_t *inner = (btree_inner_t *) node;
+            btree_inner_t *right_inner = (btree_inner_t *) right;
+            size_t mid = inner->count / 2;
+            right_inner->count = inner->count - mid - 1;
+            memcpy(inner_key(tree, right_inner, 0),
+                   inner_key(tree, inner, mid + 1),
+                   right_inner->count * tree->elem_size);
+            memcpy(right_inner->children, &inner->children[mid + 1],
+                   (right_inner->count + 1) * sizeof(void *));
+            inner->count = mid;
+            /* the key at mid is moved up, it stays readable until then */
+            separator = inner_key(tree, inner, mid);
+        }
+
+        if (level == 0) {
+            btree_inner_t *new_root = (btree_inner_t *) *spare_nodes;
+            new_root->count = 1;
+            new_root->children[0] = node;
+            new_root->children[1] = right;
+            memcpy(inner_key(tree, new_root, 0), separator, tree->elem_size);
+            tree->root = new_root;
+            ++tree->height;
+            return;
+        }
+
+        --level;
+        node = path->nodes[level];
+        inner_insert(tree, (btree_inner_t *) node, path->indices[level],
+                     separator, right);
+        if (((btree_inner_t *) node)->count <= tree->inner_capacity) {
+            return;
+        }
+    }
+}
+
+/*
+ * Allocates all nodes that will be needed to insert an element into the full
+ * leaf, so that the insertion cannot fail halfway through.
+ */
+static int alloc_split_nodes(const btree_t *tree, const btree_path_t *path,
+                             void **spare_nodes, size_t *out_count) {
+    size_t level = tree->height;
+    size_t i;
+    *out_count = 0;
+    while (1) {
+        spare_nodes[(*out_count)++] = node_alloc(level == tree->height
+                                                         ? tree->leaf_bytes
+                                                         : tree->inner_bytes);
+        if (level == 0) {
+            /* new root */
+            spare_nodes[(*out_count)++] = node_alloc(tree->inner_bytes);
+            break;
+        }
+        --level;
+        if (path->nodes[level]->count < tree->inner_capacity) {
+            break;
+        }
+    }
+    for (i = 0; i < *out_count; ++i) {
+        if (!spare_nodes[i]) {
+            for (i = 0; i < *out_count; ++i) {
+                node_free(spare_nodes[i]);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void *avs_btree_insert__(void **tree_, const void *value) {
+    btree_t *tree = get_tree(tree_);
+    void *spare_nodes[MAX_HEIGHT + 2];
+    size_t spare_count = 0;
+    btree_path_t path;
+    btree_leaf_t *leaf;
+    size_t index;
+
+    if (!tree->root && !create_root_leaf(tree)) {
+        return NULL;
+    }
+    leaf = find_leaf(tree, value, &path);
+    index = search(tree, leaf->data.bytes, leaf->count, value, 0);
+    if (index < leaf->count
+            && !tree->cmp(leaf_elem(tree, leaf, index), value)) {
+        return leaf_elem(tree, leaf, index);
+    }
+    if (leaf->count == tree->leaf_capacity
+            && alloc_split_nodes(tree, &path, spare_nodes, &spare_count)) {
+        return NULL;
+    }
+
+    memmove(leaf_elem(tree, leaf, index + 1), leaf_elem(tree, leaf, index),
+            (leaf->count - index) * tree->elem_size);
+    memcpy(leaf_elem(tree, leaf, index), value, tree->elem_size);
+    ++leaf->count;
+    ++tree->size;
+
+    if (leaf->count > tree->leaf_capacity) {
+        size_t left_count = leaf->count / 2;
+        split(tree, &path, tree->height, leaf, spare_nodes);
+        if (index >= left_count) {
+            return leaf_elem(tree, leaf->next, index - left_count);
+        }
+    }
+    return leaf_elem(tree, leaf, index);
+}
+
+static void leaf_rebalance(btree_t *tree, btree_inner_t *parent,
+                           size_t index) {
+    const size_t min_count = tree->leaf_capacity / 2;
+    btree_leaf_t *leaf = (btree_leaf_t *) parent->children[index];
+    btree_leaf_t *left =
+            index > 0 ? (btree_leaf_t *) parent->children[index - 1] : NULL;
+    btree_leaf_t *right = index < parent->count
+            ? (btree_leaf_t *) parent->children[index + 1]
+            : NULL;
+
+    if (left && left->count > min_count) {
+        memmove(leaf_elem(tree, leaf, 1), leaf->data.bytes,
+                leaf->count * tree->elem_size);
+        memcpy(leaf->data.bytes, leaf_elem(tree, left, left->count - 1),
+               tree->elem_size);
+        --left->count;
+        ++leaf->count;
+        memcpy(inner_key(tree, parent, index - 1), leaf->data.bytes,
+               tree->elem_size);
+    } else if (right && right->count > min_count) {
+        memcpy(leaf_elem(tree, leaf, leaf->count), right->data.bytes,
+               tree->elem_size);
+        ++leaf->count;
+        --right->count;
+        memmove(right->data.bytes, leaf_elem(tree, right, 1),
+                right->count * tree->elem_size);
+        memcpy(inner_key(tree, parent, index), right->data.bytes,
+               tree->elem_size);
+    } else {
+        /* merge with a sibling, always into the left one */
+        if (!right) {
+            right = leaf;
+            leaf = left;
+            --index;
+        }
+        memcpy(leaf_elem(tree, leaf, leaf->count), right->data.bytes,
+               right->count * tree->elem_size);
+        leaf->count += right->count;
+        leaf->next = right->next;
+        node_free(right);
+        --parent->count;
+        memmove(inner_key(tree, parent, index),
+                inner_key(tree, parent, index + 1),
+                (parent->count - index) * tree->elem_size);
+        memmove(&parent->children[index + 1], &parent->children[index + 2],
+                (parent->count - index) * sizeof(void *));
+    }
+}
+
+static void inner_rebalance(btree_t *tree, btree_inner_t *parent,
+                            size_t index) {
+    const size_t min_count = tree->inner_capacity / 2;
+    btree_inner_t *node = (btree_inner_t *) parent->children[index];
+    btree_inner_t *left =
+            index > 0 ? (btree_inner_t *) parent->children[index - 1] : NULL;
+    btree_inner_t *right = index < parent->count
+            ? (btree_inner_t *) parent->children[index + 1]
+            : NULL;
+
+    if (left && left->count > min_count) {
+        /* rotate right through the separator */
+        memmove(inner_key(tree, node, 1), inner_key(tree, node, 0),
+                node->count * tree->elem_size);
+        memmove(&node->children[1], &node->children[0],
+                (node->count + 1) * sizeof(void *));
+        memcpy(inner_key(tree, node, 0), inner_key(tree, parent, index - 1),
+               tree->elem_size);
+        node->children[0] = left->children[left->count];
+        ++node->count;
+        --left->count;
+        memcpy(inner_key(tree, parent, index - 1),
+               inner_key(tree, left, left->count), tree->elem_size);
+    } else if (right && right->count > min_count) {
+        /* rotate left through the separator */
+        memcpy(inner_key(tree, node, node->count),
+               inner_key(tree, parent, index), tree->elem_size);
+        node->children[node->count + 1] = right->children[0];
+        ++node->count;
+        memcpy(inner_key(tree, parent, index), inner_key(tree, right, 0),
+               tree->elem_size);
+        --right->count;
+        memmove(inner_key(tree, right, 0), inner_key(tree, right, 1),
+                right->count * tree->elem_size);
+        memmove(&right->children[0], &right->children[1],
+                (right->count + 1) * sizeof(void *));
+    } else {
+        /* merge with a sibling and the separator, into the left one */
+        if (!right) {
+            right = node;
+            node = left;
+            --index;
+        }
+        memcpy(inner_key(tree, node, node->count),
+               inner_key(tree, parent, index), tree->elem_size);
+        memcpy(inner_key(tree, node, node->count + 1),
+               inner_key(tree, right, 0), right->count * tree->elem_size);
+        memcpy(&node->children[node->count + 1], right->children,
+               (right->count + 1) * sizeof(void *));
+        node->count += right->count + 1;
+        node_free(right);
+        --parent->count;
+        memmove(inner_key(tree, parent, index),
+                inner_key(tree, parent, index + 1),
+                (parent->count - index) * tree->elem_size);
+        memmove(&parent->children[index + 1], &parent->children[index + 2],
+                (parent->count - index) * sizeof(void *));
+    }
+}
+
+int avs_btree_erase__(void **tree_, const void *value) {
+    btree_t *tree = get_tree(tree_);
+    btree_path_t path;
+    btree_leaf_t *leaf;
+    size_t index;
+    size_t level;
+
+    if (!tree->root) {
+        return -1;
+    }
+    leaf = find_leaf(tree, value, &path);
+    index = search(tree, leaf->data.bytes, leaf->count, value, 0);
+    if (index >= leaf->count
+            || tree->cmp(leaf_elem(tree, leaf, index), value)) {
+        return -1;
+    }
+
+    --leaf->count;
+    --tree->size;
+    memmove(leaf_elem(tree, leaf, index), leaf_elem(tree, leaf, index + 1),
+            (leaf->count - index) * tree->elem_size);
+
+    if (tree->height == 0) {
+        if (!leaf->count) {
+            avs_btree_clear__(tree_);
+        }
+        return 0;
+    }
+    if (leaf->count >= tree->leaf_capacity / 2) {
+        return 0;
+    }
+
+    level = tree->height - 1;
+    leaf_rebalance(tree, path.nodes[level], path.indices[level]);
+    while (level > 0
+           && path.nodes[level]->count < tree->inner_capacity / 2) {
+        --level;
+        inner_rebalance(tree, path.nodes[level], path.indices[level]);
+    }
+    if (level == 0 && !path.nodes[0]->count) {
+        tree->root = path.nodes[0]->children[0];
+        --tree->height;
+        node_free(path.nodes[0]);
+    }
+    return 0;
+}
+
+void *avs_btree_iter_begin__(avs_btree_iter_t *iter, void **tree_) {
+    btree_t *tree = get_tree(tree_);
+    if (!(iter->leaf = tree->head)) {
+        return NULL;
+    }
+    iter->elem = tree->head->data.bytes;
+    iter->end = leaf_elem(tree, tree->head, tree->head->count);
+    iter->elem_size = tree->elem_size;
+    return iter->elem;
+}
+
+void *avs_btree_iter_begin_from__(avs_btree_iter_t *iter, void **tree_,
+                                  const void *value) {
+    btree_t *tree = get_tree(tree_);
+    btree_leaf_t *leaf;
+    size_t index;
+    if (!tree->root) {
+        iter->leaf = NULL;
+        return NULL;
+    }
+    leaf = find_leaf(tree, value, NULL);
+    index = search(tree, leaf->data.bytes, leaf->count, value, 0);
+    if (index == leaf->count) {
+        if (!(leaf = leaf->next)) {
+            iter->leaf = NULL;
+            return NULL;
+        }
+        index = 0;
+    }
+    iter->leaf = leaf;
+    iter->elem = leaf_elem(tree, leaf, index);
+    iter->end = leaf_elem(tree, leaf, leaf->count);
+    iter->elem_size = tree->elem_size;
+    return iter->elem;
+}
+
+#ifdef AVS_UNIT_TESTING
+#include "test/test_btree.c"
+#endif
@@ -0,0 +1,311 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avsystem/commons/unit/test.h>
+
+static int int_comparator(const void *a, const void *b) {
+    int left = *(const int *) a;
+    int right = *(const int *) b;
+    return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+typedef struct {
+    int key;
+    char payload[200];
+} big_elem_t;
+
+static int big_elem_comparator(const void *a, const void *b) {
+    return int_comparator(&((const big_elem_t *) a)->key,
+                          &((const big_elem_t *) b)->key);
+}
+
+/*
+ * Verifies the invariants of a subtree, with all elements within
+ * [lower, upper), where NULL bounds are unbounded. Returns the number of
+ * elements in the subtree; *leaf_ptr is advanced over visited leaves to check
+ * the leaf links.
+ */
+static size_t assert_subtree_valid(btree_t *tree, void *node, size_t height,
+                                   int is_root, const void *lower,
+                                   const void *upper,
+                                   btree_leaf_t **leaf_ptr) {
+    size_t count = 0;
+    size_t i;
+    AVS_UNIT_ASSERT_EQUAL((uintptr_t) node % CACHE_LINE_SIZE, 0);
+    if (height == 0) {
+        btree_leaf_t *leaf = (btree_leaf_t *) node;
+        AVS_UNIT_ASSERT_TRUE(leaf == *leaf_ptr);
+        *leaf_ptr = leaf->next;
+        AVS_UNIT_ASSERT_TRUE(leaf->count > 0);
+        AVS_UNIT_ASSERT_TRUE(leaf->count <= tree->leaf_capacity);
+        if (!is_root) {
+            AVS_UNIT_ASSERT_TRUE(leaf->count >= tree->leaf_capacity / 2);
+        }
+        for (i = 0; i < leaf->count; ++i) {
+            const char *elem = leaf_elem(tree, leaf, i);
+            if (i > 0) {
+                AVS_UNIT_ASSERT_TRUE(tree->cmp(elem - tree->elem_size, elem)
+                                     < 0);
+            }
+            AVS_UNIT_ASSERT_TRUE(!lower || tree->cmp(lower, elem) <= 0);
+            AVS_UNIT_ASSERT_TRUE(!upper || tree->cmp(elem, upper) < 0);
+        }
+        return leaf->count;
+    } else {
+        btree_inner_t *inner = (btree_inner_t *) node;
+        AVS_UNIT_ASSERT_TRUE(inner->count > 0);
+        AVS_UNIT_ASSERT_TRUE(inner->count <= tree->inner_capacity);
+        if (!is_root) {
+            AVS_UNIT_ASSERT_TRUE(inner->count >= tree->inner_capacity / 2);
+        }
+        for (i = 0; i <= inner->count; ++i) {
+            const void *child_lower =
+                    i > 0 ? inner_key(tree, inner, i - 1) : lower;
+            const void *child_upper =
+                    i < inner->count ? inner_key(tree, inner, i) : upper;
+            count += assert_subtree_valid(tree, inner->children[i], height - 1,
+                                          0, child_lower, child_upper,
+                                          leaf_ptr);
+        }
+        return count;
+    }
+}
+
+static void assert_btree_valid(void **tree_) {
+    btree_t *tree = get_tree(tree_);
+    btree_leaf_t *leaf = tree->head;
+    if (!tree->root) {
+        AVS_UNIT_ASSERT_NULL(tree->head);
+        AVS_UNIT_ASSERT_NULL(tree->first);
+        AVS_UNIT_ASSERT_EQUAL(tree->size, 0);
+        AVS_UNIT_ASSERT_EQUAL(tree->height, 0);
+        return;
+    }
+    AVS_UNIT_ASSERT_TRUE(tree->first == tree->head->data.bytes);
+    AVS_UNIT_ASSERT_EQUAL(assert_subtree_valid(tree, tree->root, tree->height,
+                                               1, NULL, NULL, &leaf),
+                          tree->size);
+    AVS_UNIT_ASSERT_NULL(leaf);
+}
+
+AVS_UNIT_TEST(avs_btree, basic) {
+    AVS_BTREE(int) tree = AVS_BTREE_NEW(int, int_comparator);
+    avs_btree_iter_t iter;
+    int *elem;
+    int value = 42;
+
+    AVS_UNIT_ASSERT_NOT_NULL(tree);
+    AVS_UNIT_ASSERT_EQUAL(AVS_BTREE_SIZE(tree), 0);
+    AVS_UNIT_ASSERT_NULL(AVS_BTREE_FIRST(tree));
+    AVS_UNIT_ASSERT_NULL(AVS_BTREE_LAST(tree));
+    AVS_UNIT_ASSERT_NULL(AVS_BTREE_FIND(tree, &value));
+    AVS_UNIT_ASSERT_NULL(AVS_BTREE_LOWER_BOUND(tree, &value));
+    AVS_UNIT_ASSERT_NULL(AVS_BTREE_UPPER_BOUND(tree, &value));
+    AVS_UNIT_ASSERT_FAILED(AVS_BTREE_ERASE(tree, &value));
+    AVS_BTREE_FOREACH(elem, iter, tree) {
+        AVS_UNIT_ASSERT_TRUE(0);
+    }
+    AVS_BTREE_FOREACH_FROM(elem, iter, tree, &value) {
+        AVS_UNIT_ASSERT_TRUE(0);
+    }
+
+    elem = AVS_BTREE_INSERT(tree, &value);
+    AVS_UNIT_ASSERT_NOT_NULL(elem);
+    AVS_UNIT_ASSERT_EQUAL(*elem, 42);
+    /* inserting an equal element returns the existing one */
+    AVS_UNIT_ASSERT_TRUE(AVS_BTREE_INSERT(tree, &value) == elem);
+    AVS_UNIT_ASSERT_EQUAL(AVS_BTREE_SIZE(tree), 1);
+    AVS_UNIT_ASSERT_TRUE(AVS_BTREE_FIRST(tree) == elem);
+    AVS_UNIT_ASSERT_TRUE(AVS_BTREE_LAST(tree) == elem);
+    AVS_UNIT_ASSERT_TRUE(AVS_BTREE_FIND(tree, &value) == elem);
+
+    AVS_UNIT_ASSERT_SUCCESS(AVS_BTREE_ERASE(tree, &value));
+    AVS_UNIT_ASSERT_FAILED(AVS_BTREE_ERASE(tree, &value));
+    AVS_UNIT_ASSERT_EQUAL(AVS_BTREE_SIZE(tree), 0);
+    AVS_UNIT_ASSERT_NULL(AVS_BTREE_FIRST(tree));
+    assert_btree_valid((void **) tree);
+
+    AVS_BTREE_DELETE(&tree);
+    AVS_UNIT_ASSERT_NULL(tree);
+    /* deleting an already deleted tree, or a NULL pointer, is a no-op */
+    AVS_BTREE_DELETE(&tree);
+    avs_btree_delete__(NULL);
+}
+
+static void test_random_operations(size_t node_bytes) {
+    enum { RANGE = 4000, OPERATIONS = 40000 };
+    static char present[RANGE];
+    AVS_BTREE(int) tree =
+            AVS_BTREE_NEW_WITH_NODE_SIZE(int, int_comparator, node_bytes);
+    avs_btree_iter_t iter;
+    size_t expected_size = 0;
+    int *elem;
+    int i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(tree);
+    memset(present, 0, sizeof(present));
+    srand(0);
+    for (i = 0; i < OPERATIONS; ++i) {
+        int value = rand() % RANGE;
+        /* bias towards insertions in the first half, removals later */
+        if ((rand() % 4 != 0) == (i < OPERATIONS / 2)) {
+            elem = AVS_BTREE_INSERT(tree, &value);
+            AVS_UNIT_ASSERT_NOT_NULL(elem);
+            AVS_UNIT_ASSERT_EQUAL(*elem, value);
+            if (!present[value]) {
+                present[value] = 1;
+                ++expected_size;
+            }
+        } else {
+            AVS_UNIT_ASSERT_EQUAL(AVS_BTREE_ERASE(tree, &value),
+                                  present[value] ? 0 : -1);
+            if (present[value]) {
+                present[value] = 0;
+                --expected_size;
+            }
+        }
+        AVS_UNIT_ASSERT_EQUAL(AVS_BTREE_SIZE(tree), expected_size);
+        if (i % 1000 == 0) {
+            assert_btree_valid((void **) tree);
+        }
+    }
+    assert_btree_valid((void **) tree);
+
+    for (i = 0; i < RANGE; ++i) {
+        int *lower = AVS_BTREE_LOWER_BOUND(tree, &i);
+        int *upper = AVS_BTREE_UPPER_BOUND(tree, &i);
+        int next = i + 1;
+        while (next < RANGE && !present[next]) {
+            ++next;
+        }
+        if (present[i]) {
+            AVS_UNIT_ASSERT_TRUE(AVS_BTREE_FIND(tree, &i) == lower);
+            AVS_UNIT_ASSERT_EQUAL(*lower, i);
+        } else {
+            AVS_UNIT_ASSERT_NULL(AVS_BTREE_FIND(tree, &i));
+            AVS_UNIT_ASSERT_TRUE(next < RANGE ? *lower == next : !lower);
+        }
+        AVS_UNIT_ASSERT_TRUE(next < RANGE ? *upper == next : !upper);
+
+        /* range iteration visits exactly the present values >= i */
+        if (i % 100 == 0) {
+            int expected = i;
+            AVS_BTREE_FOREACH_FROM(elem, iter, tree, &i) {
+                while (!present[expected]) {
+                    ++expected;
+                }
+                AVS_UNIT_ASSERT_EQUAL(*elem, expected);
+                ++expected;
+            }
+            while (expected < RANGE) {
+                AVS_UNIT_ASSERT_FALSE(present[expected++]);
+            }
+        }
+    }
+
+    /* remove everything, checking that the tree shrinks back properly */
+    for (i = 0; i < RANGE; ++i) {
+        AVS_UNIT_ASSERT_EQUAL(AVS_BTREE_ERASE(tree, &i),
+                              present[i] ? 0 : -1);
+    }
+    assert_btree_valid((void **) tree);
+    AVS_UNIT_ASSERT_EQUAL(AVS_BTREE_SIZE(tree), 0);
+
+    AVS_BTREE_DELETE(&tree);
+}
+
+AVS_UNIT_TEST(avs_btree, random_operations_small_nodes) {
+    /* minimum capacity, yielding tall trees */
+    test_random_operations(1);
+}
+
+AVS_UNIT_TEST(avs_btree, random_operations_default_nodes) {
+    test_random_operations(0);
+}
+
+AVS_UNIT_TEST(avs_btree, sequential_and_iteration) {
+    AVS_BTREE(int) tree = AVS_BTREE_NEW(int, int_comparator);
+    avs_btree_iter_t iter;
+    int *elem;
+    int expected = 0;
+    int i;
+
+    /* descending insertion order */
+    for (i = 9999; i >= 0; --i) {
+        AVS_UNIT_ASSERT_NOT_NULL(AVS_BTREE_INSERT(tree, &i));
+    }
+    assert_btree_valid((void **) tree);
+    AVS_UNIT_ASSERT_TRUE(get_tree((void **) tree)->height > 1);
+    AVS_UNIT_ASSERT_EQUAL(*AVS_BTREE_FIRST(tree), 0);
+    AVS_UNIT_ASSERT_EQUAL(*AVS_BTREE_LAST(tree), 9999);
+
+    AVS_BTREE_FOREACH(elem, iter, tree) {
+        AVS_UNIT_ASSERT_EQUAL(*elem, expected++);
+    }
+    AVS_UNIT_ASSERT_EQUAL(expected, 10000);
+
+    i = 10000;
+    AVS_BTREE_FOREACH_FROM(elem, iter, tree, &i) {
+        AVS_UNIT_ASSERT_TRUE(0);
+    }
+
+    AVS_BTREE_CLEAR(tree);
+    AVS_UNIT_ASSERT_EQUAL(AVS_BTREE_SIZE(tree), 0);
+    AVS_UNIT_ASSERT_NULL(AVS_BTREE_FIRST(tree));
+    assert_btree_valid((void **) tree);
+
+    /* the tree is usable after clearing */
+    AVS_UNIT_ASSERT_NOT_NULL(AVS_BTREE_INSERT(tree, &i));
+    AVS_UNIT_ASSERT_EQUAL(*AVS_BTREE_FIRST(tree), 10000);
+
+    AVS_BTREE_DELETE(&tree);
+}
+
+AVS_UNIT_TEST(avs_btree, big_elements) {
+    AVS_BTREE(big_elem_t) tree =
+            AVS_BTREE_NEW(big_elem_t, big_elem_comparator);
+    big_elem_t value;
+    big_elem_t *elem;
+    int i;
+
+    memset(&value, 0, sizeof(value));
+    for (i = 0; i < 100; ++i) {
+        value.key = (i * 37) % 100;
+        value.payload[0] = (char) value.key;
+        AVS_UNIT_ASSERT_NOT_NULL(AVS_BTREE_INSERT(tree, &value));
+    }
+    assert_btree_valid((void **) tree);
+    AVS_UNIT_ASSERT_EQUAL(get_tree((void **) tree)->leaf_capacity,
+                          MIN_NODE_CAPACITY);
+
+    for (i = 0; i < 100; i += 2) {
+        value.key = i;
+        AVS_UNIT_ASSERT_SUCCESS(AVS_BTREE_ERASE(tree, &value));
+    }
+    assert_btree_valid((void **) tree);
+    for (i = 0; i < 100; ++i) {
+        value.key = i;
+        elem = AVS_BTREE_FIND(tree, &value);
+        if (i % 2) {
+            AVS_UNIT_ASSERT_NOT_NULL(elem);
+            AVS_UNIT_ASSERT_EQUAL(elem->payload[0], (char) i);
+        } else {
+            AVS_UNIT_ASSERT_NULL(elem);
+        }
+    }
+
+    AVS_BTREE_DELETE(&tree);
+}
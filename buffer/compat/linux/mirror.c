@@ -0,0 +1,86 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* memfd_create() is a GNU extension */
+#define _GNU_SOURCE
+
+#include <avs_commons_config.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../../src/mirror.h"
+
+#define MODULE_NAME avs_buffer
+#include <x_log_config.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+char *_avs_buffer_mirror_create(size_t *inout_size) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t size;
+    char *mirror;
+    int fd;
+
+    if (page_size <= 0) {
+        LOG(ERROR, "cannot determine page size");
+        return NULL;
+    }
+    size = (*inout_size + (size_t) page_size - 1)
+            / (size_t) page_size * (size_t) page_size;
+    if (!size || size < *inout_size || 2 * size < size) {
+        LOG(ERROR, "invalid mirrored buffer size");
+        return NULL;
+    }
+
+    if ((fd = memfd_create("avs_buffer", MFD_CLOEXEC)) < 0) {
+        LOG(DEBUG, "memfd_create() failed");
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t) size)) {
+        LOG(ERROR, "cannot resize mirrored buffer storage");
+        close(fd);
+        return NULL;
+    }
+
+    /* reserve address space for both copies first, then replace each half
+     * with a shared mapping of the same file */
+    mirror = (char *) mmap(NULL, 2 * size, PROT_NONE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mirror == (char *) MAP_FAILED) {
+        LOG(ERROR, "cannot reserve address space for mirrored buffer");
+        close(fd);
+        return NULL;
+    }
+    if (mmap(mirror, size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+            || mmap(mirror + size, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        LOG(ERROR, "cannot map mirrored buffer storage");
+        munmap(mirror, 2 * size);
+        close(fd);
+        return NULL;
+    }
+
+    /* the mappings keep the file alive */
+    close(fd);
+    *inout_size = size;
+    return mirror;
+}
+
+void _avs_buffer_mirror_free(char *mirror, size_t size) {
+    munmap(mirror, 2 * size);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _AVS_NEED_POSIX_API
+
+#include <avs_commons_config.h>
+
+#include <pthread.h>
+
+#include <avsystem/commons/buffer.h>
+
+#include "../../src/pool.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+static pthread_once_t KEY_ONCE = PTHREAD_ONCE_INIT;
+static pthread_key_t KEY;
+static int KEY_CREATED;
+
+static void release_thread_cache(void *unused) {
+    (void) unused;
+    avs_buffer_pool_thread_cleanup();
+}
+
+static void create_key(void) {
+    KEY_CREATED = !pthread_key_create(&KEY, release_thread_cache);
+}
+
+int _avs_buffer_pool_register_thread_cleanup(void) {
+    /* the destructor is only called if the value is not NULL */
+    if (pthread_once(&KEY_ONCE, create_key) || !KEY_CREATED
+            || pthread_setspecific(KEY, &KEY)) {
+        return -1;
+    }
+    return 0;
+}
@@ -69,6 +69,17 @@ typedef struct avs_buffer_struct avs_buffer_t;
  * Circular byte buffer object type.
  */
 
+/**
+ * A contiguous span of memory inside a buffer, as returned by
+ * @ref avs_buffer_data_segments and @ref avs_buffer_space_segments.
+ */
+typedef struct {
+    /** Pointer to the first byte of the span. */
+    char *data;
+    /** Number of bytes in the span. */
+    size_t size;
+} avs_buffer_segment_t;
+
 /**
  * Allocates a new buffer with a specified size (capacity).
  *
@@ -81,6 +92,57 @@ typedef struct avs_buffer_struct avs_buffer_t;
  */
 int avs_buffer_create(avs_buffer_t **buffer, size_t size);
 
+/**
+ * Allocates a new buffer in <em>ring mode</em>.
+ *
+ * Unlike buffers created with @ref avs_buffer_create, data in a ring buffer is
+ * allowed to wrap around the end of the underlying storage. Appending data
+ * (@ref avs_buffer_append_bytes, @ref avs_buffer_fill_bytes,
+ * @ref avs_buffer_advance_ptr) and consuming it never moves any bytes.
+ *
+ * Wrapped data is accessible without copying through
+ * @ref avs_buffer_data_segments and @ref avs_buffer_space_segments. The
+ * contiguous-view functions (@ref avs_buffer_data and
+ * @ref avs_buffer_raw_insert_ptr) are still available, but they need to
+ * rearrange the data in place if it is wrapped at the time of the call.
+ *
+ * @param buffer Pointer to a variable which will be updated with the newly
+ *               allocated buffer object.
+ *
+ * @param size   Desired capacity of the buffer, in bytes.
+ *
+ * @return 0 for success, or -1 in case of error.
+ */
+int avs_buffer_create_ring(avs_buffer_t **buffer, size_t size);
+
+/**
+ * Allocates a new buffer backed by <em>mirrored</em> memory.
+ *
+ * The underlying storage is mapped twice, back-to-back, into the virtual
+ * address space, so data that wraps around the end of the storage is still
+ * visible as a single contiguous block. As a result, @ref avs_buffer_data and
+ * @ref avs_buffer_raw_insert_ptr never need to move any data, and no operation
+ * on the buffer ever copies data internally.
+ *
+ * This requires <c>memfd_create()</c> and is only available on Linux, when
+ * avs_commons is compiled with <c>WITH_AVS_BUFFER_MIRROR</c>. The storage is
+ * allocated in whole pages, so this variant is best suited for buffers of at
+ * least a few kilobytes.
+ *
+ * If mirrored memory is not available (either at compile time or at runtime),
+ * this function falls back to @ref avs_buffer_create_ring, so the buffer is
+ * always fully functional, but the contiguous-view functions may need to move
+ * data.
+ *
+ * @param buffer Pointer to a variable which will be updated with the newly
+ *               allocated buffer object.
+ *
+ * @param size   Desired capacity of the buffer, in bytes.
+ *
+ * @return 0 for success, or -1 in case of error.
+ */
+int avs_buffer_create_mirrored(avs_buffer_t **buffer, size_t size);
+
 /**
  * Destroys a buffer object, freeing any used resources.
  *
@@ -89,6 +151,52 @@ int avs_buffer_create(avs_buffer_t **buffer, size_t size);
  */
 void avs_buffer_free(avs_buffer_t **buffer);
 
+/**
+ * Statistics of the buffer object allocation pool.
+ *
+ * All counters are global for the whole process and are never reset.
+ */
+typedef struct {
+    /** Number of allocations served from a per-thread cache. */
+    uint64_t hits;
+    /** Number of allocations that had to use the system allocator. */
+    uint64_t misses;
+    /** Number of freed blocks that were put into a per-thread cache. */
+    uint64_t recycled;
+    /** Number of freed blocks that were returned to the system allocator. */
+    uint64_t released;
+} avs_buffer_pool_stats_t;
+
+/**
+ * Retrieves statistics of the buffer object allocation pool.
+ *
+ * When avs_commons is compiled with <c>WITH_AVS_BUFFER_POOL</c>, memory for
+ * buffer objects created with @ref avs_buffer_create,
+ * @ref avs_buffer_create_ring and @ref avs_buffer_create_mirrored is rounded
+ * up to a power-of-two size class (up to 64 KiB) and freed blocks are kept in
+ * a small per-thread cache, so that subsequent allocations of a similar size
+ * do not need to call the system allocator. Blocks cached by a thread may be
+ * reused only by that same thread.
+ *
+ * @param out_stats Structure to fill with the current values of the counters.
+ *
+ * @return 0 for success, or -1 if the pool is not compiled in (in which case
+ *         all counters are set to zero).
+ */
+int avs_buffer_pool_get_stats(avs_buffer_pool_stats_t *out_stats);
+
+/**
+ * Releases all blocks kept in the calling thread's cache of the buffer object
+ * allocation pool back to the system allocator.
+ *
+ * The cache is released automatically when the thread exits, so calling this
+ * function is only necessary to release the memory earlier, e.g. in a
+ * long-lived thread that will not free any more buffer objects. Note that
+ * thread exit handlers do not run for the main thread when the process exits.
+ * It is a no-op if the pool is not compiled in.
+ */
+void avs_buffer_pool_thread_cleanup(void);
+
 /**
  * Clears the buffer, making all its capacity available to data.
  *
@@ -136,6 +244,11 @@ size_t avs_buffer_space_left(avs_buffer_t *buffer);
  * - @ref avs_buffer_append_bytes
  * - @ref avs_buffer_fill_bytes
  * - @ref avs_buffer_raw_insert_ptr
+ * - @ref avs_buffer_space_segments
+ *
+ * For buffers created with @ref avs_buffer_create_ring, calling this function
+ * while the data is wrapped rearranges the buffer contents, which invalidates
+ * pointers previously returned by any of the accessor functions.
  *
  * @param buffer Buffer object to operate on.
  *
@@ -166,6 +279,48 @@ char *avs_buffer_data(avs_buffer_t *buffer);
  */
 char *avs_buffer_raw_insert_ptr(avs_buffer_t *buffer);
 
+/**
+ * Returns the data currently contained in the buffer as (at most) two
+ * contiguous spans, without moving any data.
+ *
+ * The logical contents of the buffer is the concatenation of
+ * <c>out_segments[0]</c> and <c>out_segments[1]</c>. For buffers created with
+ * @ref avs_buffer_create, the data is never split, so at most one segment is
+ * returned. Unused entries are set to <c>{ NULL, 0 }</c>.
+ *
+ * The returned pointers are subject to the same invalidation rules as the
+ * pointer returned by @ref avs_buffer_data.
+ *
+ * @param buffer       Buffer object to operate on.
+ *
+ * @param out_segments Array that will be filled with the data spans.
+ *
+ * @return Number of non-empty segments written to @p out_segments (0, 1 or 2).
+ */
+size_t avs_buffer_data_segments(avs_buffer_t *buffer,
+                                avs_buffer_segment_t out_segments[2]);
+
+/**
+ * Returns the free space in the buffer as (at most) two contiguous spans.
+ *
+ * This is the scatter-gather counterpart of @ref avs_buffer_raw_insert_ptr:
+ * the spans may be filled in order (e.g. using <c>readv()</c>) and then
+ * committed with a single call to @ref avs_buffer_advance_ptr.
+ *
+ * For buffers created with @ref avs_buffer_create_ring, this function never
+ * moves any data. For buffers created with @ref avs_buffer_create, it behaves
+ * like @ref avs_buffer_raw_insert_ptr and always returns a single segment.
+ * Unused entries are set to <c>{ NULL, 0 }</c>.
+ *
+ * @param buffer       Buffer object to operate on.
+ *
+ * @param out_segments Array that will be filled with the free space spans.
+ *
+ * @return Number of non-empty segments written to @p out_segments (0, 1 or 2).
+ */
+size_t avs_buffer_space_segments(avs_buffer_t *buffer,
+                                 avs_buffer_segment_t out_segments[2]);
+
 /**
  * Marks some amount of data as consumed, freeing portion of the available
  * capacity.
@@ -248,6 +403,53 @@ int avs_buffer_advance_ptr(avs_buffer_t *buffer, size_t count);
  */
 int avs_buffer_fill_bytes(avs_buffer_t *buffer, int value, size_t bytes_count);
 
+/**
+ * Usage statistics of buffer objects, useful for sizing buffers.
+ */
+typedef struct {
+    /**
+     * Number of times the data had to be moved within the storage to make it
+     * contiguous or to make room for new data.
+     */
+    uint64_t defragment_calls;
+    /** Total number of bytes moved during these operations. */
+    uint64_t bytes_moved;
+    /** Largest amount of data held at any point in time. */
+    size_t peak_data_size;
+    /**
+     * Number of append operations (@ref avs_buffer_append_bytes,
+     * @ref avs_buffer_fill_bytes, @ref avs_buffer_advance_ptr) that failed
+     * because of insufficient free space.
+     */
+    uint64_t append_failures;
+} avs_buffer_stats_t;
+
+/**
+ * Retrieves usage statistics of a single buffer object, collected since it was
+ * created.
+ *
+ * @param buffer    Buffer object to query.
+ *
+ * @param out_stats Structure to fill with the statistics.
+ *
+ * @return 0 for success, or -1 if avs_commons is compiled without
+ *         <c>WITH_AVS_BUFFER_STATS</c> (in which case all fields are set to
+ *         zero).
+ */
+int avs_buffer_get_stats(avs_buffer_t *buffer, avs_buffer_stats_t *out_stats);
+
+/**
+ * Retrieves usage statistics aggregated over all buffer objects ever created
+ * in the process. <c>peak_data_size</c> is the maximum over all buffers.
+ *
+ * @param out_stats Structure to fill with the statistics.
+ *
+ * @return 0 for success, or -1 if avs_commons is compiled without
+ *         <c>WITH_AVS_BUFFER_STATS</c> (in which case all fields are set to
+ *         zero).
+ */
+int avs_buffer_get_global_stats(avs_buffer_stats_t *out_stats);
+
 #ifdef	__cplusplus
 }
 #endif
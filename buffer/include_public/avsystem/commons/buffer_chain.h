@@ -0,0 +1,171 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_BUFFER_CHAIN_H
+#define AVS_COMMONS_BUFFER_CHAIN_H
+
+#include <stddef.h>
+
+#include <avsystem/commons/defs.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file buffer_chain.h
+ *
+ * Scatter/gather byte buffer, composed of a chain of memory segments.
+ *
+ * Each segment is either a <em>reference</em> to memory owned by the caller
+ * (which is never copied), or an <em>owned</em> copy of data held by the chain
+ * itself. The contents of the chain can be exposed as an array of
+ * @ref avs_iovec_t, which may be passed directly to vectored I/O functions,
+ * such as @ref avs_net_socket_send_v.
+ *
+ * <example>
+ * @code
+ * avs_buffer_chain_t *chain;
+ * avs_buffer_chain_create(&chain);
+ *
+ * // small pieces are copied and coalesced into a single owned segment
+ * avs_buffer_chain_append_copy(chain, "HTTP/1.1 200 OK\r\n", 17);
+ * avs_buffer_chain_append_copy(chain, "\r\n", 2);
+ * // large payload is only referenced
+ * avs_buffer_chain_append_ref(chain, body, body_size);
+ *
+ * const avs_iovec_t *iov;
+ * size_t iov_count = avs_buffer_chain_iovec(chain, &iov);
+ * avs_net_socket_send_v(socket, iov, iov_count);
+ *
+ * avs_buffer_chain_free(&chain);
+ * @endcode
+ * </example>
+ */
+
+struct avs_buffer_chain_struct;
+typedef struct avs_buffer_chain_struct avs_buffer_chain_t;
+/**<
+ * Scatter/gather byte buffer object type.
+ */
+
+/**
+ * Allocates a new, empty buffer chain.
+ *
+ * @param chain Pointer to a variable which will be updated with the newly
+ *              allocated buffer chain object.
+ *
+ * @return 0 for success, or -1 in case of error.
+ */
+int avs_buffer_chain_create(avs_buffer_chain_t **chain);
+
+/**
+ * Destroys a buffer chain object, freeing any owned segments. Memory referenced
+ * by segments added with @ref avs_buffer_chain_append_ref is not touched.
+ *
+ * @param chain Pointer to a variable containing a buffer chain to free. It will
+ *              be reset to <c>NULL</c> afterwards.
+ */
+void avs_buffer_chain_free(avs_buffer_chain_t **chain);
+
+/**
+ * Removes all segments from the chain, freeing owned segment storage.
+ *
+ * @param chain Buffer chain object to operate on.
+ */
+void avs_buffer_chain_reset(avs_buffer_chain_t *chain);
+
+/**
+ * Appends a segment referencing caller-owned memory, without copying it.
+ *
+ * <strong>CAUTION:</strong> The referenced memory must remain valid and
+ * unmodified until the segment is consumed (see
+ * @ref avs_buffer_chain_consume_bytes) or the chain is reset or freed.
+ *
+ * @param chain  Buffer chain object to operate on.
+ *
+ * @param data   Pointer to data to reference.
+ *
+ * @param length Number of bytes to reference.
+ *
+ * @return 0 for success, or -1 in case of error (out of memory).
+ */
+int avs_buffer_chain_append_ref(avs_buffer_chain_t *chain,
+                                const void *data,
+                                size_t length);
+
+/**
+ * Appends a copy of the specified data to the chain.
+ *
+ * Consecutive copies are coalesced into a single segment whenever possible, so
+ * building e.g. a header out of many small pieces does not increase the number
+ * of segments exposed through @ref avs_buffer_chain_iovec.
+ *
+ * @param chain  Buffer chain object to operate on.
+ *
+ * @param data   Pointer to data to copy.
+ *
+ * @param length Number of bytes to copy.
+ *
+ * @return 0 for success, or -1 in case of error (out of memory).
+ */
+int avs_buffer_chain_append_copy(avs_buffer_chain_t *chain,
+                                 const void *data,
+                                 size_t length);
+
+/**
+ * Returns the total amount of data contained in all segments of the chain.
+ *
+ * @param chain Buffer chain object to operate on.
+ *
+ * @return Number of bytes ready to consume in the chain.
+ */
+size_t avs_buffer_chain_data_size(avs_buffer_chain_t *chain);
+
+/**
+ * Exposes the contents of the chain as an array of memory blocks.
+ *
+ * The returned array is owned by the chain and is valid until the next call
+ * to any function that modifies the chain.
+ *
+ * @param chain   Buffer chain object to operate on.
+ *
+ * @param out_iov Pointer to a variable which will be set to point to the array
+ *                of memory blocks.
+ *
+ * @return Number of elements in the array.
+ */
+size_t avs_buffer_chain_iovec(avs_buffer_chain_t *chain,
+                              const avs_iovec_t **out_iov);
+
+/**
+ * Marks some amount of data at the beginning of the chain as consumed, e.g.
+ * after a partial write.
+ *
+ * @param chain       Buffer chain object to operate on.
+ *
+ * @param bytes_count Number of bytes to mark as consumed.
+ *
+ * @return 0 for success, or -1 in case of error (not enough data in chain).
+ */
+int avs_buffer_chain_consume_bytes(avs_buffer_chain_t *chain,
+                                   size_t bytes_count);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* AVS_COMMONS_BUFFER_CHAIN_H */
@@ -21,41 +21,133 @@
 #include <string.h>
 
 #include <avsystem/commons/buffer.h>
+#include <avsystem/commons/defs.h>
+
+#include "counter.h"
+#include "mirror.h"
+#include "pool.h"
 
 #define MODULE_NAME avs_buffer
 #include <x_log_config.h>
 
 VISIBILITY_SOURCE_BEGIN
 
+typedef enum {
+    BUFFER_LINEAR,
+    BUFFER_RING,
+    BUFFER_MIRRORED
+} buffer_mode_t;
+
 struct avs_buffer_struct {
     size_t capacity;
+    buffer_mode_t mode;
+    /* in BUFFER_RING mode, begin == end always means "empty"; one byte of the
+     * storage is kept free to distinguish that from "full"
+     *
+     * in BUFFER_MIRRORED mode, storage is mapped twice back-to-back; begin
+     * always points into the first copy, end may point into the second */
+    char *storage;
+    size_t storage_size;
     char *begin;
     char *end;
+#ifdef WITH_AVS_BUFFER_STATS
+    avs_buffer_stats_t stats;
+#endif // WITH_AVS_BUFFER_STATS
     union {
         char data[1]; /* variable length */
         avs_max_align_t align;
     } data;
 };
 
+#ifdef WITH_AVS_BUFFER_STATS
+static struct {
+    _avs_buffer_counter_t defragment_calls;
+    _avs_buffer_counter_t bytes_moved;
+    _avs_buffer_counter_t peak_data_size;
+    _avs_buffer_counter_t append_failures;
+} GLOBAL_STATS;
+
+static void init_stats(avs_buffer_t *buffer) {
+    memset(&buffer->stats, 0, sizeof(buffer->stats));
+}
+
+static void record_defragment(avs_buffer_t *buffer, size_t bytes_moved) {
+    ++buffer->stats.defragment_calls;
+    buffer->stats.bytes_moved += bytes_moved;
+    _AVS_BUFFER_COUNTER_INC(GLOBAL_STATS.defragment_calls);
+    _AVS_BUFFER_COUNTER_ADD(GLOBAL_STATS.bytes_moved, bytes_moved);
+}
+
+static void record_data_size(avs_buffer_t *buffer) {
+    size_t data_size = avs_buffer_data_size(buffer);
+    if (data_size > buffer->stats.peak_data_size) {
+        buffer->stats.peak_data_size = data_size;
+        _avs_buffer_counter_max(&GLOBAL_STATS.peak_data_size, data_size);
+    }
+}
+
+static void record_append_failure(avs_buffer_t *buffer) {
+    ++buffer->stats.append_failures;
+    _AVS_BUFFER_COUNTER_INC(GLOBAL_STATS.append_failures);
+}
+#else // WITH_AVS_BUFFER_STATS
+#define init_stats(Buffer) ((void) 0)
+#define record_defragment(Buffer, BytesMoved) ((void) 0)
+#define record_data_size(Buffer) ((void) 0)
+#define record_append_failure(Buffer) ((void) 0)
+#endif // WITH_AVS_BUFFER_STATS
+
+static char *storage_end(avs_buffer_t *buffer) {
+    return buffer->storage + buffer->storage_size;
+}
+
+static int is_wrapped(avs_buffer_t *buffer) {
+    return buffer->end < buffer->begin;
+}
+
 size_t avs_buffer_space_left(avs_buffer_t *buffer) {
     return buffer->capacity - avs_buffer_data_size(buffer);
 }
 
 static size_t space_left_without_moving(avs_buffer_t *buffer) {
-    return buffer->capacity - (size_t)(buffer->end - buffer->data.data);
+    switch (buffer->mode) {
+    case BUFFER_RING:
+        /* with the ring, all free space is reachable without moving, but only
+         * the first segment of it is contiguous */
+        if (is_wrapped(buffer) || buffer->begin == buffer->storage) {
+            return avs_buffer_space_left(buffer);
+        }
+        return (size_t)(storage_end(buffer) - buffer->end);
+    case BUFFER_MIRRORED:
+        return avs_buffer_space_left(buffer);
+    default:
+        return buffer->capacity - (size_t)(buffer->end - buffer->storage);
+    }
 }
 
 void avs_buffer_reset(avs_buffer_t *buffer) {
-    buffer->begin = buffer->data.data;
-    buffer->end = buffer->data.data;
+    buffer->begin = buffer->storage;
+    buffer->end = buffer->storage;
 }
 
-int avs_buffer_create(avs_buffer_t **buffer_ptr, size_t capacity) {
+static int create_buffer(avs_buffer_t **buffer_ptr,
+                         size_t capacity,
+                         buffer_mode_t mode) {
+    size_t storage = mode == BUFFER_RING ? capacity + 1 : capacity;
+    if (storage < capacity) {
+        LOG(ERROR, "buffer capacity too large");
+        *buffer_ptr = NULL;
+        return -1;
+    }
     *buffer_ptr = (avs_buffer_t *)
-            malloc(offsetof(avs_buffer_t, data) + capacity);
+            _avs_buffer_pool_alloc(offsetof(avs_buffer_t, data) + storage);
     if (*buffer_ptr) {
         (*buffer_ptr)->capacity = capacity;
+        (*buffer_ptr)->mode = mode;
+        (*buffer_ptr)->storage = (*buffer_ptr)->data.data;
+        (*buffer_ptr)->storage_size = storage;
         avs_buffer_reset(*buffer_ptr);
+        init_stats(*buffer_ptr);
         return 0;
     } else {
         LOG(ERROR, "cannot allocate buffer");
@@ -63,12 +155,63 @@ int avs_buffer_create(avs_buffer_t **buffer_ptr, size_t capacity) {
     }
 }
 
+int avs_buffer_create(avs_buffer_t **buffer_ptr, size_t capacity) {
+    return create_buffer(buffer_ptr, capacity, BUFFER_LINEAR);
+}
+
+int avs_buffer_create_ring(avs_buffer_t **buffer_ptr, size_t capacity) {
+    return create_buffer(buffer_ptr, capacity, BUFFER_RING);
+}
+
+int avs_buffer_create_mirrored(avs_buffer_t **buffer_ptr, size_t capacity) {
+#ifdef WITH_AVS_BUFFER_MIRROR
+    size_t storage_size = capacity;
+    char *storage = _avs_buffer_mirror_create(&storage_size);
+    if (storage) {
+        *buffer_ptr = (avs_buffer_t *)
+                _avs_buffer_pool_alloc(offsetof(avs_buffer_t, data));
+        if (!*buffer_ptr) {
+            LOG(ERROR, "cannot allocate buffer");
+            _avs_buffer_mirror_free(storage, storage_size);
+            return -1;
+        }
+        (*buffer_ptr)->capacity = capacity;
+        (*buffer_ptr)->mode = BUFFER_MIRRORED;
+        (*buffer_ptr)->storage = storage;
+        (*buffer_ptr)->storage_size = storage_size;
+        avs_buffer_reset(*buffer_ptr);
+        init_stats(*buffer_ptr);
+        return 0;
+    }
+    LOG(DEBUG, "mirrored storage not available, falling back to ring buffer");
+#endif // WITH_AVS_BUFFER_MIRROR
+    return avs_buffer_create_ring(buffer_ptr, capacity);
+}
+
+static size_t allocation_size(avs_buffer_t *buffer) {
+    if (buffer->mode == BUFFER_MIRRORED) {
+        return offsetof(avs_buffer_t, data);
+    }
+    return offsetof(avs_buffer_t, data) + buffer->storage_size;
+}
+
 void avs_buffer_free(avs_buffer_t **buffer) {
-    free(*buffer);
+    if (!*buffer) {
+        return;
+    }
+#ifdef WITH_AVS_BUFFER_MIRROR
+    if ((*buffer)->mode == BUFFER_MIRRORED) {
+        _avs_buffer_mirror_free((*buffer)->storage, (*buffer)->storage_size);
+    }
+#endif // WITH_AVS_BUFFER_MIRROR
+    _avs_buffer_pool_free(*buffer, allocation_size(*buffer));
     *buffer = NULL;
 }
 
 size_t avs_buffer_data_size(avs_buffer_t *buffer) {
+    if (is_wrapped(buffer)) {
+        return buffer->storage_size - (size_t)(buffer->begin - buffer->end);
+    }
     return (size_t)(buffer->end - buffer->begin);
 }
 
@@ -76,74 +219,229 @@ size_t avs_buffer_capacity(avs_buffer_t *buffer) {
     return buffer->capacity;
 }
 
-char *avs_buffer_data(avs_buffer_t *buffer) {
-    return buffer->begin;
+static void reverse_bytes(char *begin, char *end) {
+    while (begin < end && begin < --end) {
+        char tmp = *begin;
+        *begin++ = *end;
+        *end = tmp;
+    }
 }
 
 static void defragment_buffer(avs_buffer_t *buffer) {
-    if (buffer->begin != buffer->data.data) {
+    if (buffer->begin != buffer->storage) {
         size_t used = avs_buffer_data_size(buffer);
-        memmove(buffer->data.data, buffer->begin, used);
-        buffer->end = buffer->data.data + used;
-        buffer->begin = buffer->data.data;
+        if (is_wrapped(buffer)) {
+            /* rotate the whole storage left, so that begin lands at its
+             * start - this works in place, without any additional memory */
+            reverse_bytes(buffer->storage, buffer->begin);
+            reverse_bytes(buffer->begin, storage_end(buffer));
+            reverse_bytes(buffer->storage, storage_end(buffer));
+            record_defragment(buffer, buffer->storage_size);
+        } else {
+            memmove(buffer->storage, buffer->begin, used);
+            record_defragment(buffer, used);
+        }
+        buffer->end = buffer->storage + used;
+        buffer->begin = buffer->storage;
+    }
+}
+
+char *avs_buffer_data(avs_buffer_t *buffer) {
+    if (is_wrapped(buffer)) {
+        defragment_buffer(buffer);
     }
+    return buffer->begin;
 }
 
 char *avs_buffer_raw_insert_ptr(avs_buffer_t *buffer) {
-    defragment_buffer(buffer);
+    if (space_left_without_moving(buffer) < avs_buffer_space_left(buffer)) {
+        defragment_buffer(buffer);
+    }
     return buffer->end;
 }
 
+static size_t fill_segments(avs_buffer_segment_t *out_segments,
+                            char *first, size_t first_size,
+                            char *second, size_t second_size) {
+    size_t count = 0;
+    memset(out_segments, 0, 2 * sizeof(*out_segments));
+    if (first_size) {
+        out_segments[count].data = first;
+        out_segments[count].size = first_size;
+        ++count;
+    }
+    if (second_size) {
+        out_segments[count].data = second;
+        out_segments[count].size = second_size;
+        ++count;
+    }
+    return count;
+}
+
+size_t avs_buffer_data_segments(avs_buffer_t *buffer,
+                                avs_buffer_segment_t out_segments[2]) {
+    if (is_wrapped(buffer)) {
+        return fill_segments(out_segments,
+                             buffer->begin,
+                             (size_t)(storage_end(buffer) - buffer->begin),
+                             buffer->storage,
+                             (size_t)(buffer->end - buffer->storage));
+    }
+    return fill_segments(out_segments,
+                         buffer->begin, avs_buffer_data_size(buffer),
+                         NULL, 0);
+}
+
+size_t avs_buffer_space_segments(avs_buffer_t *buffer,
+                                 avs_buffer_segment_t out_segments[2]) {
+    size_t space_left = avs_buffer_space_left(buffer);
+    size_t first_size;
+    if (buffer->mode != BUFFER_RING) {
+        return fill_segments(out_segments,
+                             avs_buffer_raw_insert_ptr(buffer), space_left,
+                             NULL, 0);
+    }
+    first_size = AVS_MIN(space_left,
+                         (size_t)(storage_end(buffer) - buffer->end));
+    return fill_segments(out_segments,
+                         buffer->end, first_size,
+                         buffer->storage, space_left - first_size);
+}
+
+static void advance_ring_ptr(avs_buffer_t *buffer, char **ptr, size_t n) {
+    size_t until_end = (size_t)(storage_end(buffer) - *ptr);
+    if (n >= until_end) {
+        *ptr = buffer->storage + (n - until_end);
+    } else {
+        *ptr += n;
+    }
+}
+
 int avs_buffer_consume_bytes(avs_buffer_t *buffer, size_t bytes_count) {
     if (bytes_count > avs_buffer_data_size(buffer)) {
         LOG(ERROR, "not enough data");
         return -1;
     }
-    buffer->begin += bytes_count;
+    if (buffer->mode == BUFFER_RING) {
+        advance_ring_ptr(buffer, &buffer->begin, bytes_count);
+        if (buffer->begin == buffer->end) {
+            /* empty - rewind to make subsequent writes contiguous */
+            avs_buffer_reset(buffer);
+        }
+    } else {
+        buffer->begin += bytes_count;
+        if (buffer->mode == BUFFER_MIRRORED
+                && buffer->begin >= storage_end(buffer)) {
+            /* move both pointers to the first copy of the mapping */
+            buffer->begin -= buffer->storage_size;
+            buffer->end -= buffer->storage_size;
+        }
+    }
 
     return 0;
 }
 
+static void ring_append(avs_buffer_t *buffer,
+                        const void *data,
+                        int value,
+                        size_t data_length) {
+    avs_buffer_segment_t segments[2];
+    size_t segment_count = avs_buffer_space_segments(buffer, segments);
+    size_t i;
+    for (i = 0; i < segment_count && data_length > 0; ++i) {
+        size_t chunk = AVS_MIN(data_length, segments[i].size);
+        if (data) {
+            memcpy(segments[i].data, data, chunk);
+            data = (const char *) data + chunk;
+        } else {
+            memset(segments[i].data, value, chunk);
+        }
+        advance_ring_ptr(buffer, &buffer->end, chunk);
+        data_length -= chunk;
+    }
+}
+
 int avs_buffer_append_bytes(avs_buffer_t *buffer,
                             const void *data,
                             size_t data_length) {
     if (data_length > avs_buffer_space_left(buffer)) {
         LOG(ERROR, "buffer too small");
+        record_append_failure(buffer);
         return -1;
+    } else if (buffer->mode == BUFFER_RING) {
+        if (data_length) {
+            ring_append(buffer, data, 0, data_length);
+        }
     } else {
         if (data_length > space_left_without_moving(buffer)) {
             defragment_buffer(buffer);
         }
         memcpy(buffer->end, data, data_length);
         buffer->end += data_length;
-        return 0;
     }
+    record_data_size(buffer);
+    return 0;
 }
 
 int avs_buffer_advance_ptr(avs_buffer_t *buffer, size_t n) {
     if (n > avs_buffer_space_left(buffer)) {
         LOG(ERROR, "position out of bounds");
+        record_append_failure(buffer);
         return -1;
+    } else if (buffer->mode == BUFFER_RING) {
+        advance_ring_ptr(buffer, &buffer->end, n);
     } else {
         if (n > space_left_without_moving(buffer)) {
             defragment_buffer(buffer);
         }
         buffer->end += n;
-        return 0;
     }
+    record_data_size(buffer);
+    return 0;
 }
 
 int avs_buffer_fill_bytes(avs_buffer_t *buffer, int value, size_t bytes_count) {
     if (bytes_count > avs_buffer_space_left(buffer)) {
+        record_append_failure(buffer);
         return -1;
+    } else if (buffer->mode == BUFFER_RING) {
+        ring_append(buffer, NULL, value, bytes_count);
     } else {
         if (bytes_count > space_left_without_moving(buffer)) {
             defragment_buffer(buffer);
         }
         memset(buffer->end, value, bytes_count);
         buffer->end += bytes_count;
-        return 0;
     }
+    record_data_size(buffer);
+    return 0;
+}
+
+int avs_buffer_get_stats(avs_buffer_t *buffer, avs_buffer_stats_t *out_stats) {
+#ifdef WITH_AVS_BUFFER_STATS
+    *out_stats = buffer->stats;
+    return 0;
+#else
+    (void) buffer;
+    memset(out_stats, 0, sizeof(*out_stats));
+    return -1;
+#endif // WITH_AVS_BUFFER_STATS
+}
+
+int avs_buffer_get_global_stats(avs_buffer_stats_t *out_stats) {
+#ifdef WITH_AVS_BUFFER_STATS
+    out_stats->defragment_calls =
+            _AVS_BUFFER_COUNTER_GET(GLOBAL_STATS.defragment_calls);
+    out_stats->bytes_moved = _AVS_BUFFER_COUNTER_GET(GLOBAL_STATS.bytes_moved);
+    out_stats->peak_data_size =
+            (size_t) _AVS_BUFFER_COUNTER_GET(GLOBAL_STATS.peak_data_size);
+    out_stats->append_failures =
+            _AVS_BUFFER_COUNTER_GET(GLOBAL_STATS.append_failures);
+    return 0;
+#else
+    memset(out_stats, 0, sizeof(*out_stats));
+    return -1;
+#endif // WITH_AVS_BUFFER_STATS
 }
 
 #ifdef AVS_UNIT_TESTING
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_config.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avsystem/commons/buffer_chain.h>
+
+#define MODULE_NAME avs_buffer
+#include <x_log_config.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+/* minimum size of storage allocated for owned segments at once */
+#define OWNED_BLOCK_MIN_CAPACITY 512
+
+#define INITIAL_IOV_CAPACITY 8
+
+typedef struct owned_block_struct {
+    struct owned_block_struct *next;
+    size_t capacity;
+    size_t used;
+    union {
+        char data[1]; /* variable length */
+        avs_max_align_t align;
+    } data;
+} owned_block_t;
+
+struct avs_buffer_chain_struct {
+    avs_iovec_t *iov;
+    size_t iov_capacity;
+    /* segments in range [iov_first, iov_end) are the actual contents */
+    size_t iov_first;
+    size_t iov_end;
+    size_t data_size;
+    /* most recently allocated first - only the head block is ever appended */
+    owned_block_t *blocks;
+    /* nonzero if the last segment lies at the end of the head block's used
+     * space, so that it can be extended by subsequent copies */
+    int last_extendable;
+};
+
+int avs_buffer_chain_create(avs_buffer_chain_t **chain_ptr) {
+    *chain_ptr = (avs_buffer_chain_t *) calloc(1, sizeof(**chain_ptr));
+    if (!*chain_ptr) {
+        LOG(ERROR, "cannot allocate buffer chain");
+        return -1;
+    }
+    return 0;
+}
+
+void avs_buffer_chain_reset(avs_buffer_chain_t *chain) {
+    while (chain->blocks) {
+        owned_block_t *next = chain->blocks->next;
+        free(chain->blocks);
+        chain->blocks = next;
+    }
+    chain->iov_first = 0;
+    chain->iov_end = 0;
+    chain->data_size = 0;
+    chain->last_extendable = 0;
+}
+
+void avs_buffer_chain_free(avs_buffer_chain_t **chain) {
+    if (*chain) {
+        avs_buffer_chain_reset(*chain);
+        free((*chain)->iov);
+        free(*chain);
+        *chain = NULL;
+    }
+}
+
+static avs_iovec_t *push_segment(avs_buffer_chain_t *chain) {
+    if (chain->iov_end == chain->iov_capacity) {
+        if (chain->iov_first > 0) {
+            memmove(chain->iov, chain->iov + chain->iov_first,
+                    (chain->iov_end - chain->iov_first) * sizeof(*chain->iov));
+            chain->iov_end -= chain->iov_first;
+            chain->iov_first = 0;
+        } else {
+            size_t new_capacity = chain->iov_capacity
+                    ? 2 * chain->iov_capacity : INITIAL_IOV_CAPACITY;
+            avs_iovec_t *new_iov;
+            if (new_capacity < chain->iov_capacity
+                    || new_capacity > SIZE_MAX / sizeof(*chain->iov)
+                    || !(new_iov = (avs_iovec_t *) realloc(
+                            chain->iov, new_capacity * sizeof(*chain->iov)))) {
+                LOG(ERROR, "cannot grow buffer chain");
+                return NULL;
+            }
+            chain->iov = new_iov;
+            chain->iov_capacity = new_capacity;
+        }
+    }
+    return &chain->iov[chain->iov_end++];
+}
+
+int avs_buffer_chain_append_ref(avs_buffer_chain_t *chain,
+                                const void *data,
+                                size_t length) {
+    avs_iovec_t *segment;
+    if (!length) {
+        return 0;
+    }
+    if (!(segment = push_segment(chain))) {
+        return -1;
+    }
+    segment->base = data;
+    segment->length = length;
+    chain->data_size += length;
+    chain->last_extendable = 0;
+    return 0;
+}
+
+static owned_block_t *get_block_for_copy(avs_buffer_chain_t *chain,
+                                         size_t length) {
+    owned_block_t *block = chain->blocks;
+    size_t capacity;
+    if (block && block->capacity - block->used >= length) {
+        return block;
+    }
+    capacity = length > OWNED_BLOCK_MIN_CAPACITY ? length
+                                                 : OWNED_BLOCK_MIN_CAPACITY;
+    if (capacity > SIZE_MAX - offsetof(owned_block_t, data)
+            || !(block = (owned_block_t *) malloc(
+                    offsetof(owned_block_t, data) + capacity))) {
+        LOG(ERROR, "cannot allocate buffer chain segment");
+        return NULL;
+    }
+    block->next = chain->blocks;
+    block->capacity = capacity;
+    block->used = 0;
+    chain->blocks = block;
+    chain->last_extendable = 0;
+    return block;
+}
+
+int avs_buffer_chain_append_copy(avs_buffer_chain_t *chain,
+                                 const void *data,
+                                 size_t length) {
+    owned_block_t *block;
+    char *target;
+    if (!length) {
+        return 0;
+    }
+    if (!(block = get_block_for_copy(chain, length))) {
+        return -1;
+    }
+    target = block->data.data + block->used;
+    if (chain->last_extendable) {
+        chain->iov[chain->iov_end - 1].length += length;
+    } else {
+        avs_iovec_t *segment = push_segment(chain);
+        if (!segment) {
+            return -1;
+        }
+        segment->base = target;
+        segment->length = length;
+    }
+    memcpy(target, data, length);
+    block->used += length;
+    chain->data_size += length;
+    chain->last_extendable = 1;
+    return 0;
+}
+
+size_t avs_buffer_chain_data_size(avs_buffer_chain_t *chain) {
+    return chain->data_size;
+}
+
+size_t avs_buffer_chain_iovec(avs_buffer_chain_t *chain,
+                              const avs_iovec_t **out_iov) {
+    *out_iov = chain->iov + chain->iov_first;
+    return chain->iov_end - chain->iov_first;
+}
+
+int avs_buffer_chain_consume_bytes(avs_buffer_chain_t *chain,
+                                   size_t bytes_count) {
+    if (bytes_count > chain->data_size) {
+        LOG(ERROR, "not enough data");
+        return -1;
+    }
+    if (bytes_count == chain->data_size) {
+        avs_buffer_chain_reset(chain);
+        return 0;
+    }
+    chain->data_size -= bytes_count;
+    while (bytes_count > 0) {
+        avs_iovec_t *segment = &chain->iov[chain->iov_first];
+        if (bytes_count < segment->length) {
+            segment->base = (const char *) segment->base + bytes_count;
+            segment->length -= bytes_count;
+            break;
+        }
+        bytes_count -= segment->length;
+        ++chain->iov_first;
+    }
+    return 0;
+}
+
+#ifdef AVS_UNIT_TESTING
+#include "test/test_buffer_chain.c"
+#endif
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_BUFFER_COUNTER_H
+#define AVS_COMMONS_BUFFER_COUNTER_H
+
+#include <stdint.h>
+
+#ifdef HAVE_C11_STDATOMIC
+#include <stdatomic.h>
+#endif // HAVE_C11_STDATOMIC
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+/* process-wide statistics counters, updated from arbitrary threads */
+
+#ifdef HAVE_C11_STDATOMIC
+
+typedef atomic_uint_fast64_t _avs_buffer_counter_t;
+
+#define _AVS_BUFFER_COUNTER_ADD(Counter, Value)                         \
+        ((void) atomic_fetch_add_explicit(&(Counter), (Value),          \
+                                          memory_order_relaxed))
+#define _AVS_BUFFER_COUNTER_GET(Counter) \
+        ((uint64_t) atomic_load_explicit(&(Counter), memory_order_relaxed))
+
+static inline void _avs_buffer_counter_max(_avs_buffer_counter_t *counter,
+                                           uint64_t value) {
+    uint_fast64_t current = atomic_load_explicit(counter,
+                                                 memory_order_relaxed);
+    while (current < value
+            && !atomic_compare_exchange_weak_explicit(counter, &current,
+                                                      value,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+    }
+}
+
+#else // HAVE_C11_STDATOMIC
+
+/* without atomics, the counters are only approximate in multi-threaded use */
+typedef volatile uint64_t _avs_buffer_counter_t;
+
+#define _AVS_BUFFER_COUNTER_ADD(Counter, Value) ((void) ((Counter) += (Value)))
+#define _AVS_BUFFER_COUNTER_GET(Counter) ((uint64_t) (Counter))
+
+static inline void _avs_buffer_counter_max(_avs_buffer_counter_t *counter,
+                                           uint64_t value) {
+    if (*counter < value) {
+        *counter = value;
+    }
+}
+
+#endif // HAVE_C11_STDATOMIC
+
+#define _AVS_BUFFER_COUNTER_INC(Counter) _AVS_BUFFER_COUNTER_ADD(Counter, 1)
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* AVS_COMMONS_BUFFER_COUNTER_H */
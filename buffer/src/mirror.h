@@ -0,0 +1,55 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_BUFFER_MIRROR_H
+#define AVS_COMMONS_BUFFER_MIRROR_H
+
+#include <stddef.h>
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+#ifdef WITH_AVS_BUFFER_MIRROR
+
+/**
+ * Maps a block of memory twice, back-to-back, so that a byte at offset
+ * <c>i</c> and a byte at offset <c>i + *inout_size</c> refer to the same
+ * physical storage.
+ *
+ * @param inout_size On input, the minimum required size of the block. On
+ *                   output, the actual size of a single mapping, rounded up
+ *                   to the system page size.
+ *
+ * @return Pointer to the start of a <c>2 * *inout_size</c> bytes long
+ *         mapping, or NULL in case of error (e.g. if the running kernel does
+ *         not support the required facilities).
+ */
+char *_avs_buffer_mirror_create(size_t *inout_size);
+
+/**
+ * Releases a mapping created with @ref _avs_buffer_mirror_create.
+ *
+ * @param mirror Pointer returned from @ref _avs_buffer_mirror_create.
+ *
+ * @param size   Size of a single mapping, as returned from
+ *               @ref _avs_buffer_mirror_create.
+ */
+void _avs_buffer_mirror_free(char *mirror, size_t size);
+
+#endif // WITH_AVS_BUFFER_MIRROR
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* AVS_COMMONS_BUFFER_MIRROR_H */
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <avsystem/commons/buffer.h>
+
+#include "counter.h"
+#include "pool.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+#ifdef WITH_AVS_BUFFER_POOL
+
+/* size classes are powers of two, from 64 B to 64 KiB; larger blocks always
+ * go directly to the system allocator */
+#define MIN_CLASS_SHIFT 6
+#define NUM_CLASSES 11
+
+/* each thread caches at most this many bytes worth of blocks in every size
+ * class, but always at least MIN_CACHED_BLOCKS blocks */
+#define CLASS_CACHE_BYTES (128 * 1024)
+#define MIN_CACHED_BLOCKS 2
+
+typedef struct free_block_struct {
+    struct free_block_struct *next;
+} free_block_t;
+
+typedef struct {
+    free_block_t *head;
+    size_t count;
+} thread_cache_t;
+
+/* the caches are strictly per-thread, so pushing and popping never needs any
+ * locking nor atomic operations */
+static AVS_THREAD_LOCAL thread_cache_t THREAD_CACHE[NUM_CLASSES];
+
+/* set once the cache is registered to be released on thread exit */
+static AVS_THREAD_LOCAL int THREAD_CACHE_REGISTERED;
+
+static struct {
+    _avs_buffer_counter_t hits;
+    _avs_buffer_counter_t misses;
+    _avs_buffer_counter_t recycled;
+    _avs_buffer_counter_t released;
+} POOL_STATS;
+
+static int size_class(size_t size) {
+    int cls = 0;
+    while (((size_t) 1 << (cls + MIN_CLASS_SHIFT)) < size) {
+        if (++cls >= NUM_CLASSES) {
+            return -1;
+        }
+    }
+    return cls;
+}
+
+static size_t class_block_size(int cls) {
+    return (size_t) 1 << (cls + MIN_CLASS_SHIFT);
+}
+
+static size_t class_cache_limit(int cls) {
+    size_t limit = CLASS_CACHE_BYTES / class_block_size(cls);
+    return limit < MIN_CACHED_BLOCKS ? MIN_CACHED_BLOCKS : limit;
+}
+
+static int thread_cache_registered(void) {
+    if (!THREAD_CACHE_REGISTERED) {
+        THREAD_CACHE_REGISTERED = !_avs_buffer_pool_register_thread_cleanup();
+    }
+    return THREAD_CACHE_REGISTERED;
+}
+
+void *_avs_buffer_pool_alloc(size_t size) {
+    int cls = size_class(size);
+    if (cls >= 0) {
+        thread_cache_t *cache = &THREAD_CACHE[cls];
+        if (cache->head) {
+            free_block_t *block = cache->head;
+            cache->head = block->next;
+            --cache->count;
+            _AVS_BUFFER_COUNTER_INC(POOL_STATS.hits);
+            return block;
+        }
+        /* allocate the whole class size, so that the block may be reused for
+         * any other request from the same class */
+        size = class_block_size(cls);
+    }
+    _AVS_BUFFER_COUNTER_INC(POOL_STATS.misses);
+    return malloc(size);
+}
+
+void _avs_buffer_pool_free(void *block, size_t size) {
+    int cls;
+    if (!block) {
+        return;
+    }
+    cls = size_class(size);
+    if (cls >= 0 && THREAD_CACHE[cls].count < class_cache_limit(cls)
+            && thread_cache_registered()) {
+        thread_cache_t *cache = &THREAD_CACHE[cls];
+        free_block_t *entry = (free_block_t *) block;
+        entry->next = cache->head;
+        cache->head = entry;
+        ++cache->count;
+        _AVS_BUFFER_COUNTER_INC(POOL_STATS.recycled);
+        return;
+    }
+    _AVS_BUFFER_COUNTER_INC(POOL_STATS.released);
+    free(block);
+}
+
+int avs_buffer_pool_get_stats(avs_buffer_pool_stats_t *out_stats) {
+    out_stats->hits = _AVS_BUFFER_COUNTER_GET(POOL_STATS.hits);
+    out_stats->misses = _AVS_BUFFER_COUNTER_GET(POOL_STATS.misses);
+    out_stats->recycled = _AVS_BUFFER_COUNTER_GET(POOL_STATS.recycled);
+    out_stats->released = _AVS_BUFFER_COUNTER_GET(POOL_STATS.released);
+    return 0;
+}
+
+void avs_buffer_pool_thread_cleanup(void) {
+    int cls;
+    for (cls = 0; cls < NUM_CLASSES; ++cls) {
+        thread_cache_t *cache = &THREAD_CACHE[cls];
+        while (cache->head) {
+            free_block_t *block = cache->head;
+            cache->head = block->next;
+            _AVS_BUFFER_COUNTER_INC(POOL_STATS.released);
+            free(block);
+        }
+        cache->count = 0;
+    }
+    /* blocks freed later, e.g. by other thread exit handlers, register the
+     * cleanup again */
+    THREAD_CACHE_REGISTERED = 0;
+}
+
+#else // WITH_AVS_BUFFER_POOL
+
+int avs_buffer_pool_get_stats(avs_buffer_pool_stats_t *out_stats) {
+    memset(out_stats, 0, sizeof(*out_stats));
+    return -1;
+}
+
+void avs_buffer_pool_thread_cleanup(void) {
+}
+
+#endif // WITH_AVS_BUFFER_POOL
+
+#ifdef AVS_UNIT_TESTING
+#include "test/test_pool.c"
+#endif
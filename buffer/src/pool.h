@@ -0,0 +1,65 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_BUFFER_POOL_H
+#define AVS_COMMONS_BUFFER_POOL_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+#ifdef WITH_AVS_BUFFER_POOL
+
+/**
+ * Allocates a block of at least @p size bytes, preferably from the calling
+ * thread's cache of blocks of the matching size class.
+ *
+ * @return Pointer to the allocated block, or NULL in case of error.
+ */
+void *_avs_buffer_pool_alloc(size_t size);
+
+/**
+ * Returns a block allocated with @ref _avs_buffer_pool_alloc to the calling
+ * thread's cache, or to the system allocator if the cache is full.
+ *
+ * @param block Block to release. NULL is ignored.
+ *
+ * @param size  The same value that was passed to
+ *              @ref _avs_buffer_pool_alloc when allocating @p block.
+ */
+void _avs_buffer_pool_free(void *block, size_t size);
+
+/**
+ * Makes sure that @ref avs_buffer_pool_thread_cleanup is called automatically
+ * when the calling thread exits. Called before the first block is put into
+ * the calling thread's cache.
+ *
+ * @return 0 on success, negative value in case of error, in which case blocks
+ *         shall not be cached by the calling thread.
+ */
+int _avs_buffer_pool_register_thread_cleanup(void);
+
+#else // WITH_AVS_BUFFER_POOL
+
+#define _avs_buffer_pool_alloc(Size) malloc(Size)
+#define _avs_buffer_pool_free(Block, Size) ((void) (Size), free(Block))
+
+#endif // WITH_AVS_BUFFER_POOL
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* AVS_COMMONS_BUFFER_POOL_H */
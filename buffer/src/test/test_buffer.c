@@ -219,3 +219,160 @@ AVS_UNIT_TEST(byte_buffer, fill_bytes) {
 
     avs_buffer_free(&buffer);
 }
+
+AVS_UNIT_TEST(byte_buffer, ring_wraps_without_moving) {
+    static const size_t BUFFER_SIZE = 8;
+    avs_buffer_t *buffer;
+    avs_buffer_segment_t segments[2];
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_create_ring(&buffer, BUFFER_SIZE));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_append_bytes(buffer, "abcdef", 6));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_consume_bytes(buffer, 4));
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_space_left(buffer), 6);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_append_bytes(buffer, "ghijkl", 6));
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_data_size(buffer), 8);
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_space_left(buffer), 0);
+    AVS_UNIT_ASSERT_FAILED(avs_buffer_append_bytes(buffer, "m", 1));
+
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_data_segments(buffer, segments), 2);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(segments[0].data, "efghi",
+                                      segments[0].size);
+    AVS_UNIT_ASSERT_EQUAL(segments[0].size + segments[1].size, 8);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(segments[1].data,
+                                      &"efghijkl"[segments[0].size],
+                                      segments[1].size);
+    AVS_UNIT_ASSERT_TRUE(segments[1].data == buffer->data.data);
+
+    avs_buffer_free(&buffer);
+}
+
+AVS_UNIT_TEST(byte_buffer, ring_space_segments) {
+    static const size_t BUFFER_SIZE = 8;
+    avs_buffer_t *buffer;
+    avs_buffer_segment_t segments[2];
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_create_ring(&buffer, BUFFER_SIZE));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_fill_bytes(buffer, 'x', 6));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_consume_bytes(buffer, 5));
+
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_space_segments(buffer, segments), 2);
+    AVS_UNIT_ASSERT_EQUAL(segments[0].size + segments[1].size, 7);
+    memset(segments[0].data, 'y', segments[0].size);
+    memset(segments[1].data, 'z', segments[1].size);
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_advance_ptr(buffer, 7));
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_data_size(buffer), 8);
+
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_space_segments(buffer, segments), 0);
+    AVS_UNIT_ASSERT_NULL(segments[0].data);
+    AVS_UNIT_ASSERT_NULL(segments[1].data);
+
+    avs_buffer_free(&buffer);
+}
+
+AVS_UNIT_TEST(byte_buffer, ring_contiguous_view) {
+    static const size_t BUFFER_SIZE = 8;
+    avs_buffer_t *buffer;
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_create_ring(&buffer, BUFFER_SIZE));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_append_bytes(buffer, "0123456", 7));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_consume_bytes(buffer, 5));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_append_bytes(buffer, "789abc", 6));
+    AVS_UNIT_ASSERT_TRUE(buffer->end < buffer->begin);
+
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(avs_buffer_data(buffer), "56789abc", 8);
+    AVS_UNIT_ASSERT_TRUE(buffer->begin == buffer->data.data);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_consume_bytes(buffer, 6));
+    AVS_UNIT_ASSERT_TRUE(avs_buffer_raw_insert_ptr(buffer) == buffer->end);
+    memcpy(avs_buffer_raw_insert_ptr(buffer), "defghi", 6);
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_advance_ptr(buffer, 6));
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(avs_buffer_data(buffer), "bcdefghi", 8);
+
+    avs_buffer_free(&buffer);
+}
+
+AVS_UNIT_TEST(byte_buffer, ring_consume_all_rewinds) {
+    static const size_t BUFFER_SIZE = 4;
+    avs_buffer_t *buffer;
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_create_ring(&buffer, BUFFER_SIZE));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_fill_bytes(buffer, 0, 3));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_consume_bytes(buffer, 3));
+    AVS_UNIT_ASSERT_TRUE(buffer->begin == buffer->data.data);
+    AVS_UNIT_ASSERT_TRUE(buffer->end == buffer->data.data);
+    AVS_UNIT_ASSERT_FAILED(avs_buffer_consume_bytes(buffer, 1));
+
+    avs_buffer_free(&buffer);
+}
+
+AVS_UNIT_TEST(byte_buffer, mirrored_contiguous_across_wrap) {
+    static const size_t BUFFER_SIZE = 64;
+    static const size_t CHUNK_SIZE = 48;
+    avs_buffer_t *buffer;
+    char chunk[48];
+    size_t total = 0;
+    size_t i;
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_create_mirrored(&buffer, BUFFER_SIZE));
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_capacity(buffer), BUFFER_SIZE);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_fill_bytes(buffer, 0, 1));
+    while (total < 3 * buffer->storage_size) {
+        char *insert_ptr = avs_buffer_raw_insert_ptr(buffer);
+        const char *data_ptr = avs_buffer_data(buffer);
+        for (i = 0; i < CHUNK_SIZE; ++i) {
+            chunk[i] = (char) (total + i);
+        }
+        if (buffer->mode == BUFFER_MIRRORED) {
+            AVS_UNIT_ASSERT_TRUE(insert_ptr == buffer->end);
+            AVS_UNIT_ASSERT_TRUE(data_ptr < storage_end(buffer));
+        }
+        AVS_UNIT_ASSERT_SUCCESS(avs_buffer_append_bytes(buffer,
+                                                        chunk, CHUNK_SIZE));
+        AVS_UNIT_ASSERT_SUCCESS(avs_buffer_consume_bytes(buffer, 1));
+        AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(avs_buffer_data(buffer),
+                                          chunk, CHUNK_SIZE);
+        AVS_UNIT_ASSERT_SUCCESS(avs_buffer_consume_bytes(buffer,
+                                                         CHUNK_SIZE - 1));
+        AVS_UNIT_ASSERT_EQUAL(avs_buffer_data_size(buffer), 1);
+        total += CHUNK_SIZE;
+    }
+
+    avs_buffer_free(&buffer);
+}
+
+#ifdef WITH_AVS_BUFFER_STATS
+AVS_UNIT_TEST(byte_buffer, stats) {
+    avs_buffer_t *buffer;
+    avs_buffer_stats_t stats;
+    avs_buffer_stats_t global_before;
+    avs_buffer_stats_t global_after;
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_get_global_stats(&global_before));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_create(&buffer, 8));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_append_bytes(buffer, "abcdef", 6));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_consume_bytes(buffer, 4));
+    /* needs the remaining 2 bytes to be moved to the beginning */
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_append_bytes(buffer, "ghijk", 5));
+    AVS_UNIT_ASSERT_FAILED(avs_buffer_append_bytes(buffer, "lm", 2));
+    AVS_UNIT_ASSERT_FAILED(avs_buffer_fill_bytes(buffer, 0, 2));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_get_stats(buffer, &stats));
+    AVS_UNIT_ASSERT_EQUAL(stats.defragment_calls, 1);
+    AVS_UNIT_ASSERT_EQUAL(stats.bytes_moved, 2);
+    AVS_UNIT_ASSERT_EQUAL(stats.peak_data_size, 7);
+    AVS_UNIT_ASSERT_EQUAL(stats.append_failures, 2);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_get_global_stats(&global_after));
+    AVS_UNIT_ASSERT_EQUAL(global_after.defragment_calls
+                                  - global_before.defragment_calls, 1);
+    AVS_UNIT_ASSERT_EQUAL(global_after.bytes_moved
+                                  - global_before.bytes_moved, 2);
+    AVS_UNIT_ASSERT_TRUE(global_after.peak_data_size >= 7);
+    AVS_UNIT_ASSERT_EQUAL(global_after.append_failures
+                                  - global_before.append_failures, 2);
+
+    avs_buffer_free(&buffer);
+}
+#endif // WITH_AVS_BUFFER_STATS
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <avsystem/commons/unit/test.h>
+#include <avsystem/commons/buffer_chain.h>
+
+static void assert_chain_contents(avs_buffer_chain_t *chain,
+                                  const char *expected) {
+    const avs_iovec_t *iov;
+    size_t iov_count = avs_buffer_chain_iovec(chain, &iov);
+    size_t offset = 0;
+    size_t i;
+    for (i = 0; i < iov_count; ++i) {
+        AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(iov[i].base, expected + offset,
+                                          iov[i].length);
+        offset += iov[i].length;
+    }
+    AVS_UNIT_ASSERT_EQUAL(offset, strlen(expected));
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_chain_data_size(chain), offset);
+}
+
+AVS_UNIT_TEST(buffer_chain, empty) {
+    avs_buffer_chain_t *chain;
+    const avs_iovec_t *iov;
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_create(&chain));
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_chain_iovec(chain, &iov), 0);
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_chain_data_size(chain), 0);
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_copy(chain, NULL, 0));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_ref(chain, NULL, 0));
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_chain_iovec(chain, &iov), 0);
+    avs_buffer_chain_free(&chain);
+    AVS_UNIT_ASSERT_NULL(chain);
+}
+
+AVS_UNIT_TEST(buffer_chain, refs_are_not_copied) {
+    static const char HEADER[] = "header";
+    static const char BODY[] = "body";
+    avs_buffer_chain_t *chain;
+    const avs_iovec_t *iov;
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_create(&chain));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_ref(chain, HEADER, 6));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_ref(chain, BODY, 4));
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_chain_iovec(chain, &iov), 2);
+    AVS_UNIT_ASSERT_TRUE(iov[0].base == HEADER);
+    AVS_UNIT_ASSERT_TRUE(iov[1].base == BODY);
+    assert_chain_contents(chain, "headerbody");
+    avs_buffer_chain_free(&chain);
+}
+
+AVS_UNIT_TEST(buffer_chain, copies_are_coalesced) {
+    static const char BODY[] = "body";
+    avs_buffer_chain_t *chain;
+    const avs_iovec_t *iov;
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_create(&chain));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_copy(chain, "he", 2));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_copy(chain, "ad", 2));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_copy(chain, "er", 2));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_ref(chain, BODY, 4));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_copy(chain, "trailer", 7));
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_chain_iovec(chain, &iov), 3);
+    AVS_UNIT_ASSERT_EQUAL(iov[0].length, 6);
+    assert_chain_contents(chain, "headerbodytrailer");
+    avs_buffer_chain_free(&chain);
+}
+
+AVS_UNIT_TEST(buffer_chain, large_copies) {
+    char data[3 * OWNED_BLOCK_MIN_CAPACITY];
+    avs_buffer_chain_t *chain;
+    const avs_iovec_t *iov;
+    size_t i;
+    for (i = 0; i < sizeof(data); ++i) {
+        data[i] = (char) i;
+    }
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_create(&chain));
+    for (i = 0; i < sizeof(data); i += 100) {
+        AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_copy(
+                chain, data + i, AVS_MIN((size_t) 100, sizeof(data) - i)));
+    }
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_copy(chain, data,
+                                                         sizeof(data)));
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_chain_data_size(chain), 2 * sizeof(data));
+    {
+        size_t offset = 0;
+        size_t iov_count = avs_buffer_chain_iovec(chain, &iov);
+        for (i = 0; i < iov_count; ++i) {
+            size_t j;
+            for (j = 0; j < iov[i].length; ++j) {
+                AVS_UNIT_ASSERT_EQUAL(((const char *) iov[i].base)[j],
+                                      data[(offset + j) % sizeof(data)]);
+            }
+            offset += iov[i].length;
+        }
+    }
+    avs_buffer_chain_free(&chain);
+}
+
+AVS_UNIT_TEST(buffer_chain, consume) {
+    static const char BODY[] = "body";
+    avs_buffer_chain_t *chain;
+    const avs_iovec_t *iov;
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_create(&chain));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_copy(chain, "header", 6));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_ref(chain, BODY, 4));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_copy(chain, "trailer", 7));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_consume_bytes(chain, 4));
+    assert_chain_contents(chain, "erbodytrailer");
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_consume_bytes(chain, 7));
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_chain_iovec(chain, &iov), 1);
+    assert_chain_contents(chain, "railer");
+    AVS_UNIT_ASSERT_FAILED(avs_buffer_chain_consume_bytes(chain, 7));
+
+    /* appending copy after partial consumption still coalesces */
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_copy(chain, "!", 1));
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_chain_iovec(chain, &iov), 1);
+    assert_chain_contents(chain, "railer!");
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_consume_bytes(chain, 7));
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_chain_iovec(chain, &iov), 0);
+    AVS_UNIT_ASSERT_NULL(chain->blocks);
+    avs_buffer_chain_free(&chain);
+}
+
+AVS_UNIT_TEST(buffer_chain, many_segments) {
+    static const char DATA[] = "0123456789";
+    avs_buffer_chain_t *chain;
+    const avs_iovec_t *iov;
+    size_t i;
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_create(&chain));
+    for (i = 0; i < 100; ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_append_ref(chain,
+                                                            &DATA[i % 10], 1));
+        if (i % 10 == 9) {
+            AVS_UNIT_ASSERT_SUCCESS(avs_buffer_chain_consume_bytes(chain, 5));
+        }
+    }
+    AVS_UNIT_ASSERT_EQUAL(avs_buffer_chain_iovec(chain, &iov), 50);
+    assert_chain_contents(chain, "0123456789012345678901234567890123456789"
+                                 "0123456789");
+    avs_buffer_chain_free(&chain);
+}
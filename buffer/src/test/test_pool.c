@@ -0,0 +1,160 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+
+#include <avsystem/commons/defs.h>
+#include <avsystem/commons/unit/test.h>
+
+/* returned by threads that completed successfully */
+static int THREAD_SUCCEEDED;
+
+#ifdef WITH_AVS_BUFFER_POOL
+
+AVS_UNIT_TEST(buffer_pool, freed_buffer_is_reused) {
+    avs_buffer_pool_stats_t before;
+    avs_buffer_pool_stats_t after;
+    avs_buffer_t *buffer;
+    void *first_block;
+
+    avs_buffer_pool_thread_cleanup();
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_pool_get_stats(&before));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_create(&buffer, 1000));
+    first_block = buffer;
+    avs_buffer_free(&buffer);
+
+    /* different capacity, but the same size class */
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_create_ring(&buffer, 1500));
+    AVS_UNIT_ASSERT_TRUE((void *) buffer == first_block);
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_append_bytes(buffer, "data", 4));
+    avs_buffer_free(&buffer);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_pool_get_stats(&after));
+    AVS_UNIT_ASSERT_EQUAL(after.misses - before.misses, 1);
+    AVS_UNIT_ASSERT_EQUAL(after.hits - before.hits, 1);
+    AVS_UNIT_ASSERT_EQUAL(after.recycled - before.recycled, 2);
+    AVS_UNIT_ASSERT_EQUAL(after.released - before.released, 0);
+
+    avs_buffer_pool_thread_cleanup();
+}
+
+AVS_UNIT_TEST(buffer_pool, large_buffers_bypass_cache) {
+    avs_buffer_pool_stats_t before;
+    avs_buffer_pool_stats_t after;
+    avs_buffer_t *buffer;
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_pool_get_stats(&before));
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_create(&buffer, 1024 * 1024));
+    avs_buffer_free(&buffer);
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_pool_get_stats(&after));
+
+    AVS_UNIT_ASSERT_EQUAL(after.misses - before.misses, 1);
+    AVS_UNIT_ASSERT_EQUAL(after.hits - before.hits, 0);
+    AVS_UNIT_ASSERT_EQUAL(after.recycled - before.recycled, 0);
+    AVS_UNIT_ASSERT_EQUAL(after.released - before.released, 1);
+}
+
+AVS_UNIT_TEST(buffer_pool, cache_is_bounded) {
+    avs_buffer_pool_stats_t before;
+    avs_buffer_pool_stats_t after;
+    avs_buffer_t *buffers[MIN_CACHED_BLOCKS + 1];
+    size_t i;
+
+    avs_buffer_pool_thread_cleanup();
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_pool_get_stats(&before));
+    for (i = 0; i < AVS_ARRAY_SIZE(buffers); ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(avs_buffer_create(&buffers[i], 60000));
+    }
+    for (i = 0; i < AVS_ARRAY_SIZE(buffers); ++i) {
+        avs_buffer_free(&buffers[i]);
+    }
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_pool_get_stats(&after));
+
+    AVS_UNIT_ASSERT_EQUAL(after.misses - before.misses,
+                          AVS_ARRAY_SIZE(buffers));
+    AVS_UNIT_ASSERT_EQUAL(after.recycled - before.recycled,
+                          MIN_CACHED_BLOCKS);
+    AVS_UNIT_ASSERT_EQUAL(after.released - before.released, 1);
+
+    avs_buffer_pool_thread_cleanup();
+}
+
+static void *use_buffers_in_thread(void *arg) {
+    avs_buffer_t *buffers[2];
+    size_t i;
+    (void) arg;
+    for (i = 0; i < AVS_ARRAY_SIZE(buffers); ++i) {
+        if (avs_buffer_create(&buffers[i], 1000)) {
+            return NULL;
+        }
+    }
+    for (i = 0; i < AVS_ARRAY_SIZE(buffers); ++i) {
+        avs_buffer_free(&buffers[i]);
+    }
+    return arg;
+}
+
+AVS_UNIT_TEST(buffer_pool, released_on_thread_exit) {
+    avs_buffer_pool_stats_t before;
+    avs_buffer_pool_stats_t after;
+    pthread_t thread;
+    void *result = NULL;
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_pool_get_stats(&before));
+    AVS_UNIT_ASSERT_SUCCESS(pthread_create(&thread, NULL,
+                                           use_buffers_in_thread,
+                                           &THREAD_SUCCEEDED));
+    AVS_UNIT_ASSERT_SUCCESS(pthread_join(thread, &result));
+    AVS_UNIT_ASSERT_TRUE(result == &THREAD_SUCCEEDED);
+    AVS_UNIT_ASSERT_SUCCESS(avs_buffer_pool_get_stats(&after));
+
+    AVS_UNIT_ASSERT_EQUAL(after.recycled - before.recycled, 2);
+    AVS_UNIT_ASSERT_EQUAL(after.released - before.released, 2);
+}
+
+#else // WITH_AVS_BUFFER_POOL
+
+static void *use_buffer_in_thread(void *arg) {
+    avs_buffer_t *buffer;
+    if (avs_buffer_create(&buffer, 1000)) {
+        return NULL;
+    }
+    avs_buffer_free(&buffer);
+    avs_buffer_pool_thread_cleanup();
+    return arg;
+}
+
+AVS_UNIT_TEST(buffer_pool, not_compiled_in) {
+    avs_buffer_pool_stats_t stats;
+    pthread_t thread;
+    void *result = NULL;
+
+    AVS_UNIT_ASSERT_SUCCESS(pthread_create(&thread, NULL,
+                                           use_buffer_in_thread,
+                                           &THREAD_SUCCEEDED));
+    AVS_UNIT_ASSERT_SUCCESS(pthread_join(thread, &result));
+    AVS_UNIT_ASSERT_TRUE(result == &THREAD_SUCCEEDED);
+
+    memset(&stats, 0xFF, sizeof(stats));
+    AVS_UNIT_ASSERT_FAILED(avs_buffer_pool_get_stats(&stats));
+    AVS_UNIT_ASSERT_EQUAL(stats.hits, 0);
+    AVS_UNIT_ASSERT_EQUAL(stats.misses, 0);
+    AVS_UNIT_ASSERT_EQUAL(stats.recycled, 0);
+    AVS_UNIT_ASSERT_EQUAL(stats.released, 0);
+}
+
+#endif // WITH_AVS_BUFFER_POOL
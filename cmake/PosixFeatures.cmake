@@ -73,6 +73,7 @@ check_symbol_exists("ntohs" "arpa/inet.h" HAVE_NTOHS)
 check_symbol_exists("htonl" "arpa/inet.h" HAVE_HTONL)
 check_symbol_exists("htonl" "arpa/inet.h" HAVE_HTONL)
 check_symbol_exists("recvmsg" "sys/socket.h" HAVE_RECVMSG)
+check_symbol_exists("sendmsg" "sys/socket.h" HAVE_SENDMSG)
 check_symbol_exists("close" "unistd.h" HAVE_CLOSE)
 
 # When _POSIX_C_SOURCE is defined, but none of _BSD_SOURCE, _SVID_SOURCE and
@@ -18,7 +18,7 @@
 
 #include <avsystem/commons/buffer.h>
 #include <avsystem/commons/defs.h>
-#include <avsystem/commons/list.h>
+#include <avsystem/commons/dlist.h>
 #include <avsystem/commons/time.h>
 #include <avsystem/commons/utils.h>
 
@@ -38,7 +38,7 @@ typedef struct endpoint {
 } endpoint_t;
 
 struct coap_msg_cache {
-    AVS_LIST(endpoint_t) endpoints; // sorted by id
+    AVS_DLIST(endpoint_t) endpoints;
 
     // priority queue of cache_entry_t, sorted by expiration_time
     avs_buffer_t *buffer;
@@ -83,7 +83,7 @@ coap_msg_cache_t *_avs_coap_msg_cache_create(size_t capacity) {
 void _avs_coap_msg_cache_release(coap_msg_cache_t **cache_ptr) {
     if (cache_ptr && *cache_ptr) {
         avs_buffer_free(&(*cache_ptr)->buffer);
-        AVS_LIST_CLEAR(&(*cache_ptr)->endpoints);
+        AVS_DLIST_CLEAR(&(*cache_ptr)->endpoints);
         free(*cache_ptr);
         *cache_ptr = NULL;
     }
@@ -92,20 +92,20 @@ void _avs_coap_msg_cache_release(coap_msg_cache_t **cache_ptr) {
 static endpoint_t *cache_endpoint_add_ref(coap_msg_cache_t *cache,
                                           const char *remote_addr,
                                           const char *remote_port) {
-    AVS_LIST(endpoint_t) *ep_ptr;
-    AVS_LIST_FOREACH_PTR(ep_ptr, &cache->endpoints) {
-        if (!strcmp(remote_addr, (*ep_ptr)->addr)
-                && !strcmp(remote_port, (*ep_ptr)->port)) {
-            ++(*ep_ptr)->refcount;
-            return *ep_ptr;
+    AVS_DLIST(endpoint_t) ep;
+    AVS_DLIST_FOREACH(ep, cache->endpoints) {
+        if (!strcmp(remote_addr, ep->addr) && !strcmp(remote_port, ep->port)) {
+            ++ep->refcount;
+            return ep;
         }
     }
 
-    AVS_LIST(endpoint_t) new_ep = AVS_LIST_NEW_ELEMENT(endpoint_t);
+    AVS_DLIST(endpoint_t) new_ep = AVS_DLIST_NEW_ELEMENT(endpoint_t);
     if (!new_ep) {
         LOG(DEBUG, "out of memory");
         return NULL;
     }
+    AVS_DLIST_PUSH_FRONT(&cache->endpoints, new_ep);
 
     if (avs_simple_snprintf(new_ep->addr, sizeof(new_ep->addr), "%s",
                             remote_addr) < 0
@@ -114,12 +114,11 @@ static endpoint_t *cache_endpoint_add_ref(coap_msg_cache_t *cache,
         LOG(WARNING, "endpoint address or port too long: addr = %s, "
                      "port = %s",
             remote_addr, remote_port);
-        AVS_LIST_DELETE(&new_ep);
+        AVS_DLIST_DELETE(&cache->endpoints, new_ep);
         return NULL;
     }
 
     new_ep->refcount = 1;
-    AVS_LIST_INSERT(&cache->endpoints, new_ep);
 
     LOG(TRACE, "added cache endpoint: %s:%s", new_ep->addr, new_ep->port);
     return new_ep;
@@ -128,11 +127,9 @@ static endpoint_t *cache_endpoint_add_ref(coap_msg_cache_t *cache,
 static void cache_endpoint_del_ref(coap_msg_cache_t *cache,
                                    endpoint_t *endpoint) {
     if (--endpoint->refcount == 0) {
-        AVS_LIST(endpoint_t) *ep_ptr = (AVS_LIST(endpoint_t) *)
-                AVS_LIST_FIND_PTR(&cache->endpoints, endpoint);
-        LOG(TRACE, "removed cache endpoint: %s:%s", (*ep_ptr)->addr,
-            (*ep_ptr)->port);
-        AVS_LIST_DELETE(ep_ptr);
+        LOG(TRACE, "removed cache endpoint: %s:%s", endpoint->addr,
+            endpoint->port);
+        AVS_DLIST_DELETE(&cache->endpoints, endpoint);
     }
 }
 
@@ -251,9 +248,10 @@ static void cache_free_bytes(coap_msg_cache_t *cache,
             entry = entry_next(entry)) {
         assert(entry_valid(cache, entry));
 
-        LOG(TRACE, "msg_cache: dropping msg (id = %u) to make room for"
-                   " a new one (size = %zu)",
-            entry_id(entry), bytes_required);
+        LOG_RATELIMITED(TRACE, 10, 1000,
+                        "msg_cache: dropping msg (id = %u) to make room for"
+                        " a new one (size = %zu)",
+                        entry_id(entry), bytes_required);
         cache_endpoint_del_ref(cache, entry->endpoint);
         bytes_free += entry_size(entry);
     }
@@ -378,8 +376,8 @@ void _avs_coap_msg_cache_debug_print(const coap_msg_cache_t *cache) {
         avs_buffer_data_size(cache->buffer),
         avs_buffer_capacity(cache->buffer));
 
-    AVS_LIST(endpoint_t) ep;
-    AVS_LIST_FOREACH(ep, cache->endpoints) {
+    AVS_DLIST(endpoint_t) ep;
+    AVS_DLIST_FOREACH(ep, cache->endpoints) {
         LOG(DEBUG, "endpoint: refcount %u, addr %s, port %s", ep->refcount,
             ep->addr, ep->port);
     }
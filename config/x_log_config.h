@@ -18,6 +18,10 @@
 #undef LOG
 #endif
 
+#ifdef LOG_RATELIMITED
+#undef LOG_RATELIMITED
+#endif
+
 #ifdef WITH_INTERNAL_LOGS
 
 #ifdef WITH_INTERNAL_TRACE
@@ -26,9 +30,15 @@
 
 #include <avsystem/commons/log.h>
 #define LOG(...) avs_log(MODULE_NAME, __VA_ARGS__)
+#ifdef WITH_AVS_UTILS
+#define LOG_RATELIMITED(...) AVS_LOG_RATELIMITED(MODULE_NAME, __VA_ARGS__)
+#else // WITH_AVS_UTILS
+#define LOG_RATELIMITED(Level, Burst, PeriodMs, ...) LOG(Level, __VA_ARGS__)
+#endif // WITH_AVS_UTILS
 
 #else
 
 #define LOG(...) ((void) 0)
+#define LOG_RATELIMITED(...) ((void) 0)
 
 #endif
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_HASHMAP_H
+#define AVS_COMMONS_HASHMAP_H
+
+#include <stddef.h>
+
+#include <avsystem/commons/defs.h>
+
+/**
+ * @file hashmap.h
+ *
+ * Generic hash map, implemented as an open-addressing hash table in the style
+ * of SwissTable.
+ *
+ * Elements are stored by value in a flat slot array. A separate array of
+ * one-byte control values, holding 7 bits of each element's hash, allows
+ * probing a whole group of slots (16 with SSE2, 8 otherwise) at once, so most
+ * lookups call the equality function only for the matching element.
+ *
+ * Just like with @ref AVS_RBTREE, elements are compared as a whole - the "key"
+ * is whatever part of the element the hash and equality functions look at.
+ * Lookups take a pointer to an element-typed value with the key fields filled
+ * in.
+ *
+ * Element pointers are invalidated by any operation that inserts elements
+ * (as it may rehash the table); removal of other elements does not invalidate
+ * them. Iteration order is unspecified.
+ *
+ * <example>
+ * @code
+ * typedef struct {
+ *     int key;
+ *     const char *value;
+ * } entry_t;
+ *
+ * static size_t entry_hash(const void *entry) {
+ *     return (size_t) ((const entry_t *) entry)->key;
+ * }
+ *
+ * static int entry_equal(const void *a, const void *b) {
+ *     return ((const entry_t *) a)->key == ((const entry_t *) b)->key;
+ * }
+ *
+ * AVS_HASHMAP(entry_t) map = AVS_HASHMAP_NEW(entry_t, entry_hash,
+ *                                            entry_equal);
+ * entry_t entry = { 42, "foo" };
+ * AVS_HASHMAP_INSERT(map, &entry);
+ *
+ * entry_t query = { 42, NULL };
+ * entry_t *found = AVS_HASHMAP_FIND(map, &query);
+ * assert(found && !strcmp(found->value, "foo"));
+ *
+ * AVS_HASHMAP_DELETE(&map);
+ * @endcode
+ * </example>
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Hash function type. The result does not need to be well-distributed -
+ * it is mixed internally, so e.g. an integer key may be returned as-is.
+ *
+ * Elements that compare equal MUST have identical hashes.
+ */
+typedef size_t (*avs_hashmap_hash_func_t)(const void *elem);
+
+/**
+ * Equality function type.
+ *
+ * @returns Non-zero if @p a and @p b are equal, 0 otherwise.
+ */
+typedef int (*avs_hashmap_equal_func_t)(const void *a, const void *b);
+
+/**
+ * Helper hash function for arbitrary byte sequences (FNV-1a), to be used in
+ * user-supplied @ref avs_hashmap_hash_func_t implementations.
+ */
+size_t avs_hashmap_hash_bytes(const void *data, size_t size);
+
+/**
+ * Helper hash function for null-terminated strings. Equivalent to
+ * <c>avs_hashmap_hash_bytes(str, strlen(str))</c>.
+ */
+size_t avs_hashmap_hash_string(const char *str);
+
+/* Internal functions. Use macros defined below instead. */
+void **avs_hashmap_new__(size_t elem_size,
+                         avs_hashmap_hash_func_t hash,
+                         avs_hashmap_equal_func_t equal);
+void avs_hashmap_delete__(void ***map_ptr);
+void avs_hashmap_clear__(void **map);
+size_t avs_hashmap_size__(void **map);
+int avs_hashmap_reserve__(void **map, size_t count);
+void *avs_hashmap_find__(void **map, const void *value);
+void *avs_hashmap_insert__(void **map, const void *value);
+int avs_hashmap_erase__(void **map, const void *value);
+void avs_hashmap_delete_elem__(void **map, void *elem);
+void *avs_hashmap_first__(void **map);
+void *avs_hashmap_elem_next__(void **map, const void *elem);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#define _AVS_HASHMAP_TYPECHECK(first_ptr_type, second_ptr_type) \
+    ((void) (sizeof((first_ptr_type) < (second_ptr_type))))
+
+#ifdef __cplusplus
+template <typename T>
+static inline T *AVS_HASHMAP_CALL_WITH_ELEM_CAST__(void *(*func)(void **),
+                                                   T **map) {
+    return (T *) func((void **) map);
+}
+
+template <typename Func, typename T, typename Arg>
+static inline T *AVS_HASHMAP_CALL_WITH_ELEM_CAST__(const Func &func,
+                                                   T **map, const Arg &arg) {
+    return (T *) func((void **) map, arg);
+}
+#else
+#define AVS_HASHMAP_CALL_WITH_ELEM_CAST__(func, ...) \
+    ((AVS_TYPEOF_PTR(*(AVS_VARARG0(__VA_ARGS__)))) \
+        func((void **) __VA_ARGS__))
+#endif
+
+/**
+ * Hash map type for a given element type.
+ */
+#define AVS_HASHMAP(type) type**
+
+/**
+ * Creates an empty hash map with elements of given @p type.
+ *
+ * @param type  Type of elements stored in the map.
+ * @param hash  Hash function, see @ref avs_hashmap_hash_func_t.
+ * @param equal Equality function, see @ref avs_hashmap_equal_func_t.
+ *
+ * @returns Created map object on success, NULL in case of error.
+ */
+#define AVS_HASHMAP_NEW(type, hash, equal) \
+    ((AVS_HASHMAP(type)) avs_hashmap_new__(sizeof(type), (hash), (equal)))
+
+/**
+ * Releases the map and all its elements, and sets <c>*map_ptr</c> to NULL.
+ *
+ * To free resources owned by the elements, iterate over them with
+ * @ref AVS_HASHMAP_FOREACH first.
+ */
+#define AVS_HASHMAP_DELETE(map_ptr) avs_hashmap_delete__((void ***) (map_ptr))
+
+/**
+ * Removes all elements from the map. Allocated capacity is retained.
+ */
+#define AVS_HASHMAP_CLEAR(map) avs_hashmap_clear__((void **) (map))
+
+/**
+ * @returns Number of elements stored in the map. Complexity: O(1).
+ */
+#define AVS_HASHMAP_SIZE(map) avs_hashmap_size__((void **) (map))
+
+/**
+ * Makes sure that at least @p count elements can be stored in the map without
+ * rehashing.
+ *
+ * @returns 0 on success, negative value in case of memory allocation failure
+ *          or if the table for @p count elements would not fit in size_t.
+ */
+#define AVS_HASHMAP_RESERVE(map, count) \
+    avs_hashmap_reserve__((void **) (map), (count))
+
+/**
+ * Finds an element equal to @p val_ptr in @p map.
+ *
+ * Complexity: O(1) on average.
+ *
+ * @returns Found element pointer, or NULL if the map does not contain such
+ *          element.
+ */
+#define AVS_HASHMAP_FIND(map, val_ptr) \
+    (_AVS_HASHMAP_TYPECHECK(*(map), (val_ptr)), \
+     AVS_HASHMAP_CALL_WITH_ELEM_CAST__(avs_hashmap_find__, (map), (val_ptr)))
+
+/**
+ * Inserts a copy of the value pointed to by @p val_ptr into the map, if an
+ * equal element does not yet exist in it.
+ *
+ * Complexity: amortized O(1) on average.
+ *
+ * @returns:
+ * - pointer to the inserted element on success,
+ * - a pointer to the equal element if one already existed in the map,
+ * - NULL in case of memory allocation failure.
+ */
+#define AVS_HASHMAP_INSERT(map, val_ptr) \
+    (_AVS_HASHMAP_TYPECHECK(*(map), (val_ptr)), \
+     AVS_HASHMAP_CALL_WITH_ELEM_CAST__(avs_hashmap_insert__, (map), \
+                                       (val_ptr)))
+
+/**
+ * Removes the element equal to @p val_ptr from the map, if it exists.
+ *
+ * @returns 0 if the element has been removed, or a negative value if the map
+ *          does not contain such element.
+ */
+#define AVS_HASHMAP_ERASE(map, val_ptr) \
+    (_AVS_HASHMAP_TYPECHECK(*(map), (val_ptr)), \
+     avs_hashmap_erase__((void **) (map), (val_ptr)))
+
+/**
+ * Removes the element pointed to by <c>*elem_ptr</c> from the map, and sets
+ * <c>*elem_ptr</c> to NULL. Complexity: O(1).
+ *
+ * NOTE: when <c>*elem_ptr</c> does not point to an element of @p map, the
+ * behavior is undefined.
+ */
+#define AVS_HASHMAP_DELETE_ELEM(map, elem_ptr) \
+    do { \
+        _AVS_HASHMAP_TYPECHECK(*(map), *(elem_ptr)); \
+        avs_hashmap_delete_elem__((void **) (map), *(elem_ptr)); \
+        *(elem_ptr) = NULL; \
+    } while (0)
+
+/**
+ * @returns An arbitrary element of @p map, being the first one in iteration
+ *          order, or NULL if the map is empty.
+ */
+#define AVS_HASHMAP_FIRST(map) \
+    AVS_HASHMAP_CALL_WITH_ELEM_CAST__(avs_hashmap_first__, (map))
+
+/**
+ * @returns The element following @p elem in iteration order, or NULL if
+ *          there is none.
+ */
+#define AVS_HASHMAP_ELEM_NEXT(map, elem) \
+    AVS_HASHMAP_CALL_WITH_ELEM_CAST__(avs_hashmap_elem_next__, (map), (elem))
+
+/**
+ * Convenience macro for iterating over all elements of @p map, in unspecified
+ * order.
+ *
+ * Removal never moves elements, so the current element may be removed during
+ * iteration using <c>AVS_HASHMAP_ERASE(map, it)</c>. Inserting elements during
+ * iteration is not allowed.
+ */
+#define AVS_HASHMAP_FOREACH(it, map) \
+    for (_AVS_HASHMAP_TYPECHECK(*(map), (it)), \
+            (it) = AVS_HASHMAP_FIRST(map); \
+            (it); \
+            (it) = AVS_HASHMAP_ELEM_NEXT((map), (it)))
+
+#endif /* AVS_COMMONS_HASHMAP_H */
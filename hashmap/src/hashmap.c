@@ -0,0 +1,435 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_config.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <avsystem/commons/hashmap.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+/*
+ * Table layout (SwissTable-style):
+ *
+ * - ctrl: capacity + GROUP_WIDTH control bytes; for each slot, either
+ *   CTRL_EMPTY, CTRL_DELETED (tombstone) or the 7 lowest bits of the element
+ *   hash ("H2") if the slot is full. The first GROUP_WIDTH bytes are mirrored
+ *   after the end, so that a group can be loaded at any slot index without
+ *   wrapping around,
+ *
+ * - slots: capacity elements.
+ *
+ * Capacity is either 0 or a power of two not less than GROUP_WIDTH. Lookups
+ * start at the slot indicated by the remaining hash bits ("H1") and probe
+ * whole groups of control bytes at a time, quadratically.
+ */
+
+typedef int8_t ctrl_t;
+
+#define CTRL_EMPTY ((ctrl_t) -128)
+#define CTRL_DELETED ((ctrl_t) -2)
+
+#define IS_FULL(Ctrl) ((Ctrl) >= 0)
+
+#define H1(Hash) ((Hash) >> 7)
+#define H2(Hash) ((ctrl_t) ((Hash) & 0x7F))
+
+#ifdef __SSE2__
+
+#define GROUP_WIDTH 16
+
+typedef __m128i group_t;
+/* one bit per slot */
+typedef uint32_t bitmask_t;
+#define BITMASK_SHIFT 0
+
+static inline group_t group_load(const ctrl_t *ctrl) {
+    return _mm_loadu_si128((const __m128i *) (const void *) ctrl);
+}
+
+static inline bitmask_t group_match(group_t group, ctrl_t h2) {
+    return (bitmask_t) _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_set1_epi8((char) h2), group));
+}
+
+static inline bitmask_t group_match_empty(group_t group) {
+    return group_match(group, CTRL_EMPTY);
+}
+
+static inline bitmask_t group_match_empty_or_deleted(group_t group) {
+    /* both special values, and only them, have the most significant bit set */
+    return (bitmask_t) _mm_movemask_epi8(group);
+}
+
+#else /* __SSE2__ */
+
+/* portable SWAR implementation, operating on 8 control bytes at once */
+
+#define GROUP_WIDTH 8
+
+typedef uint64_t group_t;
+/* one bit per slot, at the most significant bit of the corresponding byte */
+typedef uint64_t bitmask_t;
+#define BITMASK_SHIFT 3
+
+#define GROUP_LSBS UINT64_C(0x0101010101010101)
+#define GROUP_MSBS UINT64_C(0x8080808080808080)
+
+static inline group_t group_load(const ctrl_t *ctrl) {
+    group_t group = 0;
+    size_t i;
+    for (i = 0; i < GROUP_WIDTH; ++i) {
+        group |= (group_t) (uint8_t) ctrl[i] << (8 * i);
+    }
+    return group;
+}
+
+static inline bitmask_t group_match(group_t group, ctrl_t h2) {
+    /* may yield false positives, but only for bytes following a true match;
+     * these are filtered out by the equality check */
+    group_t x = group ^ (GROUP_LSBS * (uint8_t) h2);
+    return (x - GROUP_LSBS) & ~x & GROUP_MSBS;
+}
+
+static inline bitmask_t group_match_empty(group_t group) {
+    /* CTRL_EMPTY is the only value with bit 7 set and bit 1 unset */
+    return group & (~group << 6) & GROUP_MSBS;
+}
+
+static inline bitmask_t group_match_empty_or_deleted(group_t group) {
+    return group & GROUP_MSBS;
+}
+
+#endif /* __SSE2__ */
+
+static inline size_t bitmask_lowest(bitmask_t mask) {
+    assert(mask);
+#ifdef __GNUC__
+    return (size_t) __builtin_ctzll(mask) >> BITMASK_SHIFT;
+#else
+    {
+        size_t result = 0;
+        while (!(mask & 1)) {
+            mask >>= 1;
+            ++result;
+        }
+        return result >> BITMASK_SHIFT;
+    }
+#endif
+}
+
+typedef struct {
+    size_t elem_size;
+    avs_hashmap_hash_func_t hash;
+    avs_hashmap_equal_func_t equal;
+    size_t capacity;
+    size_t size;
+    /* number of empty slots that can still be filled before rehashing; slots
+     * occupied by tombstones are not counted */
+    size_t growth_left;
+    /* beginning of the single allocated block that also holds slots */
+    ctrl_t *ctrl;
+    /* the map object points here */
+    void *slots;
+} hashmap_desc_t;
+
+static hashmap_desc_t *get_desc(void **map) {
+    assert(map && "NULL map pointer");
+    return (hashmap_desc_t *) (intptr_t)
+            ((char *) map - offsetof(hashmap_desc_t, slots));
+}
+
+static size_t mix_hash(size_t hash) {
+    uint64_t mixed = (uint64_t) hash * UINT64_C(0x9E3779B97F4A7C15);
+    return (size_t) (mixed ^ (mixed >> 32));
+}
+
+static size_t max_load(size_t capacity) {
+    /* maximum load factor: 7/8 */
+    return capacity - capacity / 8;
+}
+
+/* returns 0 if the capacity would not fit in size_t */
+static size_t capacity_for(size_t count) {
+    size_t capacity = GROUP_WIDTH;
+    while (max_load(capacity) < count) {
+        if (capacity > SIZE_MAX / 2) {
+            return 0;
+        }
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+static char *slot_at(const hashmap_desc_t *desc, size_t index) {
+    return (char *) desc->slots + index * desc->elem_size;
+}
+
+static void set_ctrl(hashmap_desc_t *desc, size_t index, ctrl_t value) {
+    desc->ctrl[index] = value;
+    if (index < GROUP_WIDTH) {
+        desc->ctrl[desc->capacity + index] = value;
+    }
+}
+
+/* returns capacity if not found */
+static size_t find_index(const hashmap_desc_t *desc, const void *value,
+                         size_t hash) {
+    size_t mask = desc->capacity - 1;
+    size_t offset;
+    size_t step = 0;
+    if (!desc->capacity) {
+        return 0;
+    }
+    offset = H1(hash) & mask;
+    for (;;) {
+        group_t group = group_load(desc->ctrl + offset);
+        bitmask_t match = group_match(group, H2(hash));
+        while (match) {
+            size_t index = (offset + bitmask_lowest(match)) & mask;
+            if (desc->equal(slot_at(desc, index), value)) {
+                return index;
+            }
+            match &= match - 1;
+        }
+        if (group_match_empty(group)) {
+            return desc->capacity;
+        }
+        step += GROUP_WIDTH;
+        offset = (offset + step) & mask;
+    }
+}
+
+static size_t find_insert_index(const hashmap_desc_t *desc, size_t hash) {
+    size_t mask = desc->capacity - 1;
+    size_t offset = H1(hash) & mask;
+    size_t step = 0;
+    for (;;) {
+        bitmask_t match =
+                group_match_empty_or_deleted(group_load(desc->ctrl + offset));
+        if (match) {
+            return (offset + bitmask_lowest(match)) & mask;
+        }
+        step += GROUP_WIDTH;
+        offset = (offset + step) & mask;
+    }
+}
+
+static size_t ctrl_bytes(size_t capacity) {
+    /* rounded up so that the slots are properly aligned */
+    size_t size = capacity + GROUP_WIDTH;
+    return (size + sizeof(avs_max_align_t) - 1) / sizeof(avs_max_align_t)
+           * sizeof(avs_max_align_t);
+}
+
+static int rehash(hashmap_desc_t *desc, size_t new_capacity) {
+    hashmap_desc_t old = *desc;
+    size_t i;
+    ctrl_t *block;
+    /* ctrl_bytes() adds less than GROUP_WIDTH + sizeof(avs_max_align_t) */
+    if (!new_capacity
+            || new_capacity > (SIZE_MAX - GROUP_WIDTH - sizeof(avs_max_align_t))
+                                      / (desc->elem_size + 1)) {
+        return -1;
+    }
+    block = (ctrl_t *) malloc(ctrl_bytes(new_capacity)
+                              + new_capacity * desc->elem_size);
+    if (!block) {
+        return -1;
+    }
+    memset(block, (uint8_t) CTRL_EMPTY, new_capacity + GROUP_WIDTH);
+    desc->ctrl = block;
+    desc->slots = (char *) block + ctrl_bytes(new_capacity);
+    desc->capacity = new_capacity;
+    desc->growth_left = max_load(new_capacity) - desc->size;
+    for (i = 0; i < old.capacity; ++i) {
+        if (IS_FULL(old.ctrl[i])) {
+            const char *elem = slot_at(&old, i);
+            size_t hash = mix_hash(desc->hash(elem));
+            size_t index = find_insert_index(desc, hash);
+            set_ctrl(desc, index, H2(hash));
+            memcpy(slot_at(desc, index), elem, desc->elem_size);
+        }
+    }
+    free(old.ctrl);
+    return 0;
+}
+
+size_t avs_hashmap_hash_bytes(const void *data, size_t size) {
+    /* 64-bit FNV-1a */
+    const uint8_t *bytes = (const uint8_t *) data;
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    size_t i;
+    for (i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return (size_t) hash;
+}
+
+size_t avs_hashmap_hash_string(const char *str) {
+    return avs_hashmap_hash_bytes(str, strlen(str));
+}
+
+void **avs_hashmap_new__(size_t elem_size,
+                         avs_hashmap_hash_func_t hash,
+                         avs_hashmap_equal_func_t equal) {
+    hashmap_desc_t *desc;
+    assert(elem_size > 0);
+    assert(hash);
+    assert(equal);
+    desc = (hashmap_desc_t *) calloc(1, sizeof(hashmap_desc_t));
+    if (!desc) {
+        return NULL;
+    }
+    desc->elem_size = elem_size;
+    desc->hash = hash;
+    desc->equal = equal;
+    return &desc->slots;
+}
+
+void avs_hashmap_delete__(void ***map_ptr) {
+    hashmap_desc_t *desc;
+    if (!map_ptr || !*map_ptr) {
+        return;
+    }
+    desc = get_desc(*map_ptr);
+    free(desc->ctrl);
+    free(desc);
+    *map_ptr = NULL;
+}
+
+void avs_hashmap_clear__(void **map) {
+    hashmap_desc_t *desc = get_desc(map);
+    if (desc->capacity) {
+        memset(desc->ctrl, (uint8_t) CTRL_EMPTY,
+               desc->capacity + GROUP_WIDTH);
+    }
+    desc->size = 0;
+    desc->growth_left = max_load(desc->capacity);
+}
+
+size_t avs_hashmap_size__(void **map) {
+    return get_desc(map)->size;
+}
+
+int avs_hashmap_reserve__(void **map, size_t count) {
+    hashmap_desc_t *desc = get_desc(map);
+    size_t new_capacity;
+    if (count <= desc->size + desc->growth_left) {
+        return 0;
+    }
+    new_capacity = capacity_for(count);
+    if (new_capacity < desc->capacity) {
+        /* not enough room only because of tombstones */
+        new_capacity = desc->capacity;
+    }
+    return rehash(desc, new_capacity);
+}
+
+void *avs_hashmap_find__(void **map, const void *value) {
+    hashmap_desc_t *desc = get_desc(map);
+    size_t index = find_index(desc, value, mix_hash(desc->hash(value)));
+    return index < desc->capacity ? slot_at(desc, index) : NULL;
+}
+
+void *avs_hashmap_insert__(void **map, const void *value) {
+    hashmap_desc_t *desc = get_desc(map);
+    size_t hash = mix_hash(desc->hash(value));
+    size_t index = find_index(desc, value, hash);
+    if (index < desc->capacity) {
+        return slot_at(desc, index);
+    }
+    if (desc->capacity) {
+        index = find_insert_index(desc, hash);
+    }
+    if (!desc->capacity
+            || (desc->ctrl[index] == CTRL_EMPTY && !desc->growth_left)) {
+        size_t new_capacity = capacity_for(desc->size + 1);
+        if (new_capacity <= desc->capacity) {
+            /* the table is mostly tombstones - rehash in place, but make sure
+             * not to do that all over again with the next insertion */
+            new_capacity = desc->size + 1 > desc->capacity / 2
+                                   ? desc->capacity * 2
+                                   : desc->capacity;
+        }
+        if (rehash(desc, new_capacity)) {
+            return NULL;
+        }
+        index = find_insert_index(desc, hash);
+    }
+    if (desc->ctrl[index] == CTRL_EMPTY) {
+        --desc->growth_left;
+    }
+    set_ctrl(desc, index, H2(hash));
+    memcpy(slot_at(desc, index), value, desc->elem_size);
+    ++desc->size;
+    return slot_at(desc, index);
+}
+
+void avs_hashmap_delete_elem__(void **map, void *elem) {
+    hashmap_desc_t *desc = get_desc(map);
+    size_t offset = (size_t) ((char *) elem - (char *) desc->slots);
+    size_t index = offset / desc->elem_size;
+    assert(offset % desc->elem_size == 0);
+    assert(index < desc->capacity);
+    assert(IS_FULL(desc->ctrl[index]));
+    set_ctrl(desc, index, CTRL_DELETED);
+    --desc->size;
+}
+
+int avs_hashmap_erase__(void **map, const void *value) {
+    void *elem = avs_hashmap_find__(map, value);
+    if (!elem) {
+        return -1;
+    }
+    avs_hashmap_delete_elem__(map, elem);
+    return 0;
+}
+
+static void *first_full_from(hashmap_desc_t *desc, size_t index) {
+    for (; index < desc->capacity; ++index) {
+        if (IS_FULL(desc->ctrl[index])) {
+            return slot_at(desc, index);
+        }
+    }
+    return NULL;
+}
+
+void *avs_hashmap_first__(void **map) {
+    return first_full_from(get_desc(map), 0);
+}
+
+void *avs_hashmap_elem_next__(void **map, const void *elem) {
+    hashmap_desc_t *desc = get_desc(map);
+    size_t index =
+            (size_t) ((const char *) elem - (char *) desc->slots)
+            / desc->elem_size;
+    assert(index < desc->capacity);
+    return first_full_from(desc, index + 1);
+}
+
+#ifdef AVS_UNIT_TESTING
+#include "test/test_hashmap.c"
+#endif
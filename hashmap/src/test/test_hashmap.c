@@ -0,0 +1,179 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avsystem/commons/unit/test.h>
+
+typedef struct {
+    int key;
+    int value;
+} hashmap_entry_t;
+
+static size_t entry_hash(const void *entry) {
+    return (size_t) ((const hashmap_entry_t *) entry)->key;
+}
+
+/* deliberately terrible hash function, to exercise collision handling */
+static size_t colliding_hash(const void *entry) {
+    return (size_t) (((const hashmap_entry_t *) entry)->key % 3);
+}
+
+static int entry_equal(const void *a, const void *b) {
+    return ((const hashmap_entry_t *) a)->key
+           == ((const hashmap_entry_t *) b)->key;
+}
+
+AVS_UNIT_TEST(avs_hashmap, insert_find_erase) {
+    AVS_HASHMAP(hashmap_entry_t) map =
+            AVS_HASHMAP_NEW(hashmap_entry_t, entry_hash, entry_equal);
+    hashmap_entry_t entry = { 0, 0 };
+    hashmap_entry_t *elem;
+
+    AVS_UNIT_ASSERT_NOT_NULL(map);
+    AVS_UNIT_ASSERT_EQUAL(AVS_HASHMAP_SIZE(map), 0);
+    AVS_UNIT_ASSERT_NULL(AVS_HASHMAP_FIND(map, &entry));
+    AVS_UNIT_ASSERT_NULL(AVS_HASHMAP_FIRST(map));
+    AVS_UNIT_ASSERT_FAILED(AVS_HASHMAP_ERASE(map, &entry));
+
+    entry.key = 42;
+    entry.value = 1;
+    elem = AVS_HASHMAP_INSERT(map, &entry);
+    AVS_UNIT_ASSERT_NOT_NULL(elem);
+    AVS_UNIT_ASSERT_EQUAL(elem->value, 1);
+
+    /* inserting an equal element returns the existing one */
+    entry.value = 2;
+    AVS_UNIT_ASSERT_TRUE(AVS_HASHMAP_INSERT(map, &entry) == elem);
+    AVS_UNIT_ASSERT_EQUAL(elem->value, 1);
+    AVS_UNIT_ASSERT_EQUAL(AVS_HASHMAP_SIZE(map), 1);
+
+    entry.value = 0;
+    AVS_UNIT_ASSERT_TRUE(AVS_HASHMAP_FIND(map, &entry) == elem);
+    entry.key = 43;
+    AVS_UNIT_ASSERT_NULL(AVS_HASHMAP_FIND(map, &entry));
+
+    AVS_HASHMAP_DELETE_ELEM(map, &elem);
+    AVS_UNIT_ASSERT_NULL(elem);
+    AVS_UNIT_ASSERT_EQUAL(AVS_HASHMAP_SIZE(map), 0);
+    entry.key = 42;
+    AVS_UNIT_ASSERT_NULL(AVS_HASHMAP_FIND(map, &entry));
+
+    AVS_HASHMAP_DELETE(&map);
+    AVS_UNIT_ASSERT_NULL(map);
+}
+
+static void test_many_elements(avs_hashmap_hash_func_t hash, int count) {
+    AVS_HASHMAP(hashmap_entry_t) map =
+            AVS_HASHMAP_NEW(hashmap_entry_t, hash, entry_equal);
+    hashmap_entry_t entry;
+    hashmap_entry_t *elem;
+    int visited = 0;
+    int round;
+    int i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(map);
+    /* repeated insertions and removals also exercise tombstone handling */
+    for (round = 0; round < 3; ++round) {
+        for (i = 0; i < count; ++i) {
+            entry.key = i;
+            entry.value = i * 2;
+            AVS_UNIT_ASSERT_NOT_NULL(AVS_HASHMAP_INSERT(map, &entry));
+        }
+        AVS_UNIT_ASSERT_EQUAL(AVS_HASHMAP_SIZE(map), (size_t) count);
+        for (i = 0; i < count; i += 2) {
+            entry.key = i;
+            AVS_UNIT_ASSERT_SUCCESS(AVS_HASHMAP_ERASE(map, &entry));
+        }
+        for (i = 0; i < count; ++i) {
+            entry.key = i;
+            elem = AVS_HASHMAP_FIND(map, &entry);
+            if (i % 2) {
+                AVS_UNIT_ASSERT_NOT_NULL(elem);
+                AVS_UNIT_ASSERT_EQUAL(elem->value, i * 2);
+            } else {
+                AVS_UNIT_ASSERT_NULL(elem);
+            }
+        }
+    }
+
+    AVS_HASHMAP_FOREACH(elem, map) {
+        AVS_UNIT_ASSERT_EQUAL(elem->key % 2, 1);
+        ++visited;
+        /* removing the current element during iteration is allowed */
+        AVS_UNIT_ASSERT_SUCCESS(AVS_HASHMAP_ERASE(map, elem));
+    }
+    AVS_UNIT_ASSERT_EQUAL(visited, count / 2);
+    AVS_UNIT_ASSERT_EQUAL(AVS_HASHMAP_SIZE(map), 0);
+
+    AVS_HASHMAP_DELETE(&map);
+}
+
+AVS_UNIT_TEST(avs_hashmap, many_elements) {
+    test_many_elements(entry_hash, 10000);
+}
+
+AVS_UNIT_TEST(avs_hashmap, colliding_hashes) {
+    test_many_elements(colliding_hash, 300);
+}
+
+AVS_UNIT_TEST(avs_hashmap, reserve_and_clear) {
+    AVS_HASHMAP(hashmap_entry_t) map =
+            AVS_HASHMAP_NEW(hashmap_entry_t, entry_hash, entry_equal);
+    hashmap_entry_t entry = { 0, 0 };
+    hashmap_entry_t *first;
+    int i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(map);
+    AVS_UNIT_ASSERT_SUCCESS(AVS_HASHMAP_RESERVE(map, 100));
+    first = AVS_HASHMAP_INSERT(map, &entry);
+    AVS_UNIT_ASSERT_NOT_NULL(first);
+    /* no rehashing happens within reserved capacity */
+    for (i = 1; i < 100; ++i) {
+        entry.key = i;
+        AVS_UNIT_ASSERT_NOT_NULL(AVS_HASHMAP_INSERT(map, &entry));
+    }
+    entry.key = 0;
+    AVS_UNIT_ASSERT_TRUE(AVS_HASHMAP_FIND(map, &entry) == first);
+
+    AVS_HASHMAP_CLEAR(map);
+    AVS_UNIT_ASSERT_EQUAL(AVS_HASHMAP_SIZE(map), 0);
+    AVS_UNIT_ASSERT_NULL(AVS_HASHMAP_FIND(map, &entry));
+    AVS_UNIT_ASSERT_NULL(AVS_HASHMAP_FIRST(map));
+
+    AVS_HASHMAP_DELETE(&map);
+}
+
+AVS_UNIT_TEST(avs_hashmap, reserve_overflow) {
+    AVS_HASHMAP(hashmap_entry_t) map =
+            AVS_HASHMAP_NEW(hashmap_entry_t, entry_hash, entry_equal);
+    hashmap_entry_t entry = { 0, 0 };
+
+    AVS_UNIT_ASSERT_NOT_NULL(map);
+    AVS_UNIT_ASSERT_FAILED(AVS_HASHMAP_RESERVE(map, SIZE_MAX));
+    AVS_UNIT_ASSERT_FAILED(
+            AVS_HASHMAP_RESERVE(map, SIZE_MAX / sizeof(hashmap_entry_t)));
+    /* the map is still usable after a failed reservation */
+    AVS_UNIT_ASSERT_NOT_NULL(AVS_HASHMAP_INSERT(map, &entry));
+    AVS_UNIT_ASSERT_EQUAL(AVS_HASHMAP_SIZE(map), 1);
+
+    AVS_HASHMAP_DELETE(&map);
+}
+
+AVS_UNIT_TEST(avs_hashmap, hash_helpers) {
+    AVS_UNIT_ASSERT_EQUAL(avs_hashmap_hash_string("foobar"),
+                          avs_hashmap_hash_bytes("foobar", 6));
+    AVS_UNIT_ASSERT_NOT_EQUAL(avs_hashmap_hash_string("foobar"),
+                              avs_hashmap_hash_string("foobaz"));
+}
@@ -18,6 +18,7 @@
 
 #include <string.h>
 
+#include <avsystem/commons/stream/netbuf.h>
 #include <avsystem/commons/utils.h>
 
 #include "chunked.h"
@@ -31,15 +32,26 @@ static int http_send_single_chunk(http_stream_t *stream,
                                   const void *buffer,
                                   size_t buffer_length) {
     char size_buf[UINT_STR_BUF_SIZE(unsigned long)];
+    avs_iovec_t iov[3];
     int result;
     LOG(TRACE, "http_send_single_chunk, buffer_length == %lu",
         (unsigned long) buffer_length);
-    result = (avs_simple_snprintf(size_buf, sizeof(size_buf), "%lX\r\n",
-                                  (unsigned long) buffer_length) < 0
-            || avs_stream_write(stream->backend, size_buf, strlen(size_buf))
-            || avs_stream_write(stream->backend, buffer, buffer_length)
-            || avs_stream_write(stream->backend, "\r\n", 2)
-            || avs_stream_finish_message(stream->backend)) ? -1 : 0;
+    if (avs_simple_snprintf(size_buf, sizeof(size_buf), "%lX\r\n",
+                            (unsigned long) buffer_length) < 0) {
+        result = -1;
+    } else {
+        /* the payload is handed over to the socket together with the size
+         * line and the trailer, without copying it into the output buffer */
+        iov[0].base = size_buf;
+        iov[0].length = strlen(size_buf);
+        iov[1].base = buffer;
+        iov[1].length = buffer_length;
+        iov[2].base = "\r\n";
+        iov[2].length = 2;
+        result = (avs_stream_netbuf_write_v(stream->backend,
+                                            iov, AVS_ARRAY_SIZE(iov))
+                || avs_stream_finish_message(stream->backend)) ? -1 : 0;
+    }
     _avs_http_maybe_schedule_retry_after_send(stream, result);
     LOG(TRACE, "result == %d", result);
     return result;
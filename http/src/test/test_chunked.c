@@ -58,4 +58,30 @@ AVS_UNIT_TEST(http, send_chunk) {
     avs_stream_cleanup(&stream.backend);
 }
 
+AVS_UNIT_TEST(http, send_chunk_after_buffered_data) {
+    const char *input_buffer = "data that does not fit in the buffer";
+    const char *expected_output =
+            "buffered"
+            "24\r\n"
+            "data that does not fit in the buffer"
+            "\r\n";
+    avs_net_abstract_socket_t *socket = NULL;
+    http_stream_t stream = EMPTY_HTTP_STREAM_INITIALIZER;
+    avs_unit_mocksock_create(&socket);
+    avs_unit_mocksock_expect_connect(socket, "cv", "02");
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_connect(socket, "cv", "02"));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_netbuf_create(&stream.backend,
+                                                     socket, 0, 16));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(stream.backend, "buffered", 8));
+    /* buffered data is sent together with the whole chunk */
+    avs_unit_mocksock_expect_output(socket,
+                                    expected_output, strlen(expected_output));
+    AVS_UNIT_ASSERT_SUCCESS(http_send_single_chunk(&stream, input_buffer,
+                                                   strlen(input_buffer)));
+    avs_unit_mocksock_assert_io_clean(socket);
+    avs_net_socket_close(socket);
+    avs_unit_mocksock_expect_shutdown(socket);
+    avs_stream_cleanup(&stream.backend);
+}
+
 #pragma GCC diagnostic pop
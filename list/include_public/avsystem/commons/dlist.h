@@ -0,0 +1,299 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_DLIST_H
+#define AVS_COMMONS_DLIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <avsystem/commons/defs.h>
+#include <avsystem/commons/list.h>
+
+/**
+ * @file dlist.h
+ *
+ * Doubly linked list.
+ *
+ * This is a counterpart of @ref AVS_LIST that trades one additional pointer per
+ * element for O(1) appending at the end, O(1) removal of an element given only
+ * a pointer to it, and reverse iteration.
+ *
+ * Just like @ref AVS_LIST, the links are stored in a header placed immediately
+ * before the element data, so the element pointer is a pointer to user data,
+ * and a <c>NULL</c> pointer is a valid, empty list. Elements are allocated
+ * using @ref AVS_LIST_CONFIG_ALLOC and freed with @ref AVS_LIST_CONFIG_FREE.
+ *
+ * Internally, <c>prev</c> of the first element points to the last one, which
+ * allows finding the tail in constant time without a separate list head
+ * structure. For that reason, elements can only be linked and unlinked using
+ * the macros defined here, which need access to the list variable.
+ *
+ * <example>
+ * @code
+ * AVS_DLIST(int) list = NULL;
+ * int *element;
+ *
+ * *AVS_DLIST_PUSH_BACK(&list, AVS_DLIST_NEW_ELEMENT(int)) = 1;
+ * *AVS_DLIST_PUSH_BACK(&list, AVS_DLIST_NEW_ELEMENT(int)) = 2;
+ * *AVS_DLIST_PUSH_FRONT(&list, AVS_DLIST_NEW_ELEMENT(int)) = 0;
+ *
+ * AVS_DLIST_FOREACH_REVERSE(element, list) {
+ *     printf("%d\n", *element); // prints 2, 1, 0
+ * }
+ *
+ * AVS_DLIST_CLEAR(&list);
+ * @endcode
+ * </example>
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Links stored before each element data.
+ */
+struct avs_dlist_links_struct__ {
+    void *next;
+    void *prev;
+};
+
+/**
+ * Structure definition for padding helper macro.
+ */
+struct avs_dlist_space_for_links_helper_struct__ {
+    struct avs_dlist_links_struct__ links;
+    avs_max_align_t value;
+};
+
+/**
+ * Padding helper macro - counterpart of @ref AVS_LIST_SPACE_FOR_NEXT__ that
+ * accounts for both links.
+ */
+#define AVS_DLIST_SPACE_FOR_LINKS__ \
+offsetof(struct avs_dlist_space_for_links_helper_struct__, value)
+
+/**
+ * Doubly linked list type for a given element type.
+ *
+ * This is simply an alias for a pointer type. Please note that the value of
+ * <c>NULL</c> is a valid, empty list.
+ *
+ * @param element_type Type of the list element.
+ */
+#define AVS_DLIST(element_type) element_type*
+
+/**
+ * @name Internal functions
+ *
+ * Use macros defined below instead.
+ */
+/**@{*/
+void *avs_dlist_adjust_allocated_ptr__(void *allocated);
+void *avs_dlist_insert__(void *element, void **list_ptr, void *before);
+void *avs_dlist_unlink__(void *element, void **list_ptr);
+size_t avs_dlist_size__(const void *list);
+
+static inline struct avs_dlist_links_struct__ *
+avs_dlist_links__(const void *element) {
+    return AVS_APPLY_OFFSET(struct avs_dlist_links_struct__, element,
+                            -(ptrdiff_t) AVS_DLIST_SPACE_FOR_LINKS__);
+}
+
+static inline void *avs_dlist_next__(void *element) {
+    return avs_dlist_links__(element)->next;
+}
+
+static inline void *avs_dlist_prev__(void *element, const void *list) {
+    return element == list ? NULL : avs_dlist_links__(element)->prev;
+}
+
+static inline void *avs_dlist_last__(void *list) {
+    return list ? avs_dlist_links__(list)->prev : NULL;
+}
+/**@}*/
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+/**
+ * Allocates a new, unlinked list element with an arbitrary size.
+ *
+ * @param size Number of bytes to allocate for user data.
+ *
+ * @return Newly allocated list element, as <c>void *</c>.
+ */
+#define AVS_DLIST_NEW_BUFFER(size) \
+(avs_dlist_adjust_allocated_ptr__( \
+        AVS_LIST_CONFIG_ALLOC(AVS_DLIST_SPACE_FOR_LINKS__ + (size))))
+
+/**
+ * Allocates a new, unlinked list element of a given type.
+ *
+ * @param type Type of user data to allocate.
+ *
+ * @return Newly allocated list element, as <c>type *</c>.
+ */
+#define AVS_DLIST_NEW_ELEMENT(type) \
+((type *) AVS_DLIST_NEW_BUFFER(sizeof(type)))
+
+/**
+ * Returns the element following @p element, or <c>NULL</c> if it is the last
+ * one. Complexity: O(1).
+ */
+#define AVS_DLIST_NEXT(element) \
+AVS_CALL_WITH_CAST(0, avs_dlist_next__, (element))
+
+/**
+ * Returns the element preceding @p element on @p list, or <c>NULL</c> if it is
+ * the first one. Complexity: O(1).
+ */
+#define AVS_DLIST_PREV(list, element) \
+AVS_CALL_WITH_CAST(0, avs_dlist_prev__, (element), (list))
+
+/**
+ * Returns the first element of @p list, or <c>NULL</c> if it is empty.
+ */
+#define AVS_DLIST_FIRST(list) (list)
+
+/**
+ * Returns the last element of @p list, or <c>NULL</c> if it is empty.
+ * Complexity: O(1).
+ */
+#define AVS_DLIST_LAST(list) AVS_CALL_WITH_CAST(0, avs_dlist_last__, (list))
+
+/**
+ * Iterates over consecutive elements of @p list, from first to last.
+ *
+ * @param element Iterator variable of element pointer type.
+ *
+ * @param list    The list to iterate over.
+ */
+#define AVS_DLIST_FOREACH(element, list) \
+for ((element) = (list); (element); (element) = AVS_DLIST_NEXT(element))
+
+/**
+ * Iterates over consecutive elements of @p list, from last to first.
+ *
+ * @param element Iterator variable of element pointer type.
+ *
+ * @param list    The list to iterate over.
+ */
+#define AVS_DLIST_FOREACH_REVERSE(element, list) \
+for ((element) = AVS_DLIST_LAST(list); \
+     (element); \
+     (element) = AVS_DLIST_PREV((list), (element)))
+
+/**
+ * A for-each loop that allows unlinking or deleting the current element during
+ * iteration.
+ *
+ * @param element Iterator variable of element pointer type.
+ *
+ * @param helper  Helper variable of element pointer type, used internally by
+ *                the iteration algorithm. <strong>It shall not be modified by
+ *                user code.</strong>
+ *
+ * @param list    The list to iterate over.
+ */
+#define AVS_DLIST_DELETABLE_FOREACH(element, helper, list) \
+for ((element) = (list); \
+     (element) && ((helper) = AVS_DLIST_NEXT(element), 1); \
+     (element) = (helper))
+
+/**
+ * Inserts an unlinked @p element before @p before on the list.
+ *
+ * Complexity: O(1).
+ *
+ * @param list_ptr Pointer to a list variable.
+ *
+ * @param before   Element of <c>*list_ptr</c> before which to insert
+ *                 @p element. If <c>NULL</c>, @p element is inserted at the
+ *                 end of the list.
+ *
+ * @param element  Element to insert. It MUST NOT be linked to any list.
+ *
+ * @return The inserted element.
+ */
+#define AVS_DLIST_INSERT_BEFORE(list_ptr, before, element) \
+AVS_CALL_WITH_CAST(0, avs_dlist_insert__, (element), \
+                   (void **) (intptr_t) (list_ptr), (before))
+
+/**
+ * Inserts an unlinked @p element at the end of the list. Complexity: O(1).
+ *
+ * @return The inserted element.
+ */
+#define AVS_DLIST_PUSH_BACK(list_ptr, element) \
+AVS_DLIST_INSERT_BEFORE((list_ptr), (void *) NULL, (element))
+
+/**
+ * Inserts an unlinked @p element at the beginning of the list.
+ * Complexity: O(1).
+ *
+ * @return The inserted element.
+ */
+#define AVS_DLIST_PUSH_FRONT(list_ptr, element) \
+AVS_DLIST_INSERT_BEFORE((list_ptr), *(list_ptr), (element))
+
+/**
+ * Unlinks @p element from the list, without freeing it. Complexity: O(1).
+ *
+ * @param list_ptr Pointer to a list variable.
+ *
+ * @param element  Element to unlink. It MUST be an element of
+ *                 <c>*list_ptr</c>.
+ *
+ * @return The unlinked element.
+ */
+#define AVS_DLIST_UNLINK(list_ptr, element) \
+AVS_CALL_WITH_CAST(0, avs_dlist_unlink__, (element), \
+                   (void **) (intptr_t) (list_ptr))
+
+/**
+ * Unlinks @p element from the list and frees it. Complexity: O(1).
+ *
+ * @param list_ptr Pointer to a list variable.
+ *
+ * @param element  Element to delete. It MUST be an element of
+ *                 <c>*list_ptr</c>.
+ */
+#define AVS_DLIST_DELETE(list_ptr, element) \
+AVS_LIST_CONFIG_FREE( \
+        ((char *) (intptr_t) AVS_DLIST_UNLINK((list_ptr), (element))) \
+        - AVS_DLIST_SPACE_FOR_LINKS__)
+
+/**
+ * Deallocates all list elements.
+ *
+ * Just like @ref AVS_LIST_CLEAR, it can be followed by a block of code that
+ * will be executed before freeing each element; the element about to be freed
+ * is <c>*list_ptr</c>.
+ *
+ * @param list_ptr Pointer to a list variable.
+ */
+#define AVS_DLIST_CLEAR(list_ptr) \
+for (; *(list_ptr); AVS_DLIST_DELETE((list_ptr), *(list_ptr)))
+
+/**
+ * Returns the number of elements on the list. Complexity: O(n).
+ */
+#define AVS_DLIST_SIZE(list) avs_dlist_size__(list)
+
+#endif /* AVS_COMMONS_DLIST_H */
@@ -184,6 +184,55 @@ typedef int (*avs_list_comparator_func_t)(const void *a,
                                           const void *b,
                                           size_t element_size);
 
+/**
+ * Arena allocator for list elements.
+ *
+ * Elements allocated with @ref AVS_LIST_NEW_BUFFER_IN or
+ * @ref AVS_LIST_NEW_ELEMENT_IN are carved out of large, contiguous chunks owned
+ * by the arena, and are all released at once by @ref avs_list_arena_reset or
+ * @ref avs_list_arena_delete, in time proportional to the number of chunks
+ * rather than the number of elements.
+ *
+ * Such elements can be used with all list operations, except that they
+ * <strong>MUST NOT</strong> be passed to @ref AVS_LIST_DELETE or
+ * @ref AVS_LIST_CLEAR. To discard a list allocated in an arena, simply forget
+ * it (e.g. assign <c>NULL</c> to the list variable) and reset the arena.
+ *
+ * The arena is not thread-safe.
+ */
+typedef struct avs_list_arena_struct avs_list_arena_t;
+
+/**
+ * Creates an empty list element arena.
+ *
+ * @param chunk_size Size of memory chunks that will be allocated from the
+ *                   system heap as needed. Elements larger than that are given
+ *                   dedicated chunks. If 0, a default value of 4 KiB is used.
+ *
+ * @return Created arena, or <c>NULL</c> in case of memory allocation failure
+ *         or if @p chunk_size is too large to be allocated.
+ */
+avs_list_arena_t *avs_list_arena_new(size_t chunk_size);
+
+/**
+ * Releases all elements allocated from the arena, making it ready for reuse.
+ *
+ * The oldest regular chunk is retained, so that an arena used for repeated
+ * short-lived lists of similar size does not hit the system allocator in steady
+ * state. Dedicated chunks of oversized elements are always released.
+ *
+ * @param arena Arena to reset.
+ */
+void avs_list_arena_reset(avs_list_arena_t *arena);
+
+/**
+ * Releases all elements allocated from the arena and the arena itself, and
+ * sets <c>*arena_ptr</c> to <c>NULL</c>.
+ *
+ * @param arena_ptr Pointer to a variable holding the arena to destroy.
+ */
+void avs_list_arena_delete(avs_list_arena_t **arena_ptr);
+
 /**
  * @name Internal functions
  *
@@ -196,6 +245,7 @@ typedef int (*avs_list_comparator_func_t)(const void *a,
  */
 /**@{*/
 void *avs_list_adjust_allocated_ptr__(void *allocated);
+void *avs_list_arena_alloc__(avs_list_arena_t *arena, size_t size);
 void *avs_list_nth__(void *list, size_t n);
 void **avs_list_nth_ptr__(void **list_ptr, size_t n);
 void **avs_list_find_ptr__(void **list_ptr, void *element);
@@ -512,6 +562,37 @@ AVS_CALL_WITH_CAST(1, avs_list_append_ptr__, (list_ptr))
 #define AVS_LIST_NEW_ELEMENT(type) \
 ((type *) AVS_LIST_NEW_BUFFER(sizeof(type)))
 
+/**
+ * Allocates a new list element with an arbitrary size from an arena.
+ *
+ * Works like @ref AVS_LIST_NEW_BUFFER, but memory is taken from @p arena
+ * instead of @ref AVS_LIST_CONFIG_ALLOC. The element is zero-initialized.
+ *
+ * @param arena Arena to allocate from (see @ref avs_list_arena_t).
+ *
+ * @param size  Number of bytes to allocate for user data.
+ *
+ * @return Newly allocated list element, as <c>void *</c>.
+ */
+#define AVS_LIST_NEW_BUFFER_IN(arena, size) \
+(avs_list_adjust_allocated_ptr__( \
+        avs_list_arena_alloc__((arena), AVS_LIST_SPACE_FOR_NEXT__ + (size))))
+
+/**
+ * Allocates a new list element of a given type from an arena.
+ *
+ * It is semantically equivalent to
+ * <c>AVS_LIST_NEW_BUFFER_IN(arena, sizeof(type))</c>.
+ *
+ * @param arena Arena to allocate from (see @ref avs_list_arena_t).
+ *
+ * @param type  Type of user data to allocate.
+ *
+ * @return Newly allocated list element, as <c>type *</c>.
+ */
+#define AVS_LIST_NEW_ELEMENT_IN(arena, type) \
+((type *) AVS_LIST_NEW_BUFFER_IN((arena), sizeof(type)))
+
 /**
  * Inserts an element or a list into the list.
  *
@@ -745,7 +826,10 @@ for (; *(first_element_ptr); AVS_LIST_DELETE(first_element_ptr))
  * Sorts the list elements, ascending by the ordering enforced by the specified
  * comparator.
  *
- * The sorting is performed using the recursive merge sort algorithm.
+ * The sorting is performed using a non-recursive, bottom-up natural merge sort
+ * algorithm, which takes advantage of already sorted runs of elements. It runs
+ * in O(n log r) time, where r is the number of such runs (O(n) for lists that
+ * are already sorted), and uses O(1) additional memory.
  *
  * The sort is guaranteed to be stable - in case of elements that compare equal,
  * their relative order is preserved.
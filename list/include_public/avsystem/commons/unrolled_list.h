@@ -0,0 +1,277 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_UNROLLED_LIST_H
+#define AVS_COMMONS_UNROLLED_LIST_H
+
+#include <stddef.h>
+
+#include <avsystem/commons/defs.h>
+
+/**
+ * @file unrolled_list.h
+ *
+ * Unrolled (chunked) list - a FIFO-oriented sequence container that stores
+ * elements in fixed-size arrays ("chunks") linked together.
+ *
+ * Compared to @ref AVS_LIST, it performs one allocation per chunk instead of
+ * one per element, and consecutive elements are adjacent in memory, which
+ * makes iteration much more cache-friendly. Compared to @ref AVS_VECTOR, it
+ * never moves elements, so element pointers stay valid until the element is
+ * removed, and removing elements from the front is O(1).
+ *
+ * Supported operations are appending at the back, removing from the front and
+ * forward iteration.
+ *
+ * <example>
+ * @code
+ * AVS_UNROLLED_LIST(int) queue = AVS_UNROLLED_LIST_NEW(int);
+ * avs_unrolled_list_iter_t iter;
+ * int value = 42;
+ * int *element;
+ *
+ * AVS_UNROLLED_LIST_PUSH_BACK(queue, &value);
+ * AVS_UNROLLED_LIST_FOREACH(element, iter, queue) {
+ *     printf("%d\n", *element);
+ * }
+ * while (AVS_UNROLLED_LIST_FRONT(queue)) {
+ *     AVS_UNROLLED_LIST_POP_FRONT(queue);
+ * }
+ * AVS_UNROLLED_LIST_DELETE(&queue);
+ * @endcode
+ * </example>
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Internal chunk structure. Do not use directly. */
+typedef struct avs_unrolled_list_chunk_struct__ {
+    struct avs_unrolled_list_chunk_struct__ *next;
+    /* range of live elements */
+    char *begin;
+    char *end;
+    union {
+        char bytes[1]; /* variable length */
+        avs_max_align_t align;
+    } data;
+} avs_unrolled_list_chunk_t__;
+
+/**
+ * Iterator state for @ref AVS_UNROLLED_LIST_FOREACH. Its fields are internal.
+ */
+typedef struct {
+    avs_unrolled_list_chunk_t__ *chunk;
+    char *elem;
+    size_t elem_size;
+} avs_unrolled_list_iter_t;
+
+/* Internal functions. Use macros defined below instead. */
+void **avs_unrolled_list_new__(size_t elem_size, size_t chunk_capacity);
+void avs_unrolled_list_delete__(void ***list_ptr);
+void avs_unrolled_list_clear__(void **list);
+size_t avs_unrolled_list_size__(void **list);
+void *avs_unrolled_list_back__(void **list);
+void *avs_unrolled_list_emplace_back__(void **list);
+void *avs_unrolled_list_push_back__(void **list, const void *elem);
+void avs_unrolled_list_pop_front__(void **list);
+void *avs_unrolled_list_iter_begin__(avs_unrolled_list_iter_t *iter,
+                                     void **list);
+
+static inline void *
+avs_unrolled_list_iter_next__(avs_unrolled_list_iter_t *iter) {
+    iter->elem += iter->elem_size;
+    if (iter->elem == iter->chunk->end) {
+        if (!(iter->chunk = iter->chunk->next)) {
+            return NULL;
+        }
+        iter->elem = iter->chunk->begin;
+    }
+    return iter->elem;
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+/**
+ * Unrolled list type for a given element type.
+ *
+ * The list object is a pointer to a variable that holds a pointer to the first
+ * element, or NULL if the list is empty - see @ref AVS_UNROLLED_LIST_FRONT.
+ */
+#define AVS_UNROLLED_LIST(type) type**
+
+/**
+ * Default size of a single chunk's element storage, in bytes, used by
+ * @ref AVS_UNROLLED_LIST_NEW.
+ */
+#define AVS_UNROLLED_LIST_DEFAULT_CHUNK_BYTES 512
+
+/**
+ * Creates an empty unrolled list with elements of given @p type.
+ *
+ * Chunks hold as many elements as fit in
+ * @ref AVS_UNROLLED_LIST_DEFAULT_CHUNK_BYTES, but no fewer than 4.
+ *
+ * @returns Created list object on success, NULL in case of error.
+ */
+#define AVS_UNROLLED_LIST_NEW(type) \
+    ((AVS_UNROLLED_LIST(type)) avs_unrolled_list_new__(sizeof(type), 0))
+
+/**
+ * Creates an empty unrolled list with elements of given @p type, storing
+ * @p chunk_capacity elements per chunk.
+ *
+ * @returns Created list object on success, NULL in case of error, including
+ *          when the size of a single chunk would not fit in size_t.
+ */
+#define AVS_UNROLLED_LIST_NEW_WITH_CHUNK(type, chunk_capacity) \
+    ((AVS_UNROLLED_LIST(type)) avs_unrolled_list_new__(sizeof(type), \
+                                                      (chunk_capacity)))
+
+/**
+ * Releases the list and all its elements, and sets <c>*list_ptr</c> to NULL.
+ *
+ * @param list_ptr Pointer to the list object.
+ */
+#define AVS_UNROLLED_LIST_DELETE(list_ptr) \
+    avs_unrolled_list_delete__((void ***) (list_ptr))
+
+/**
+ * Removes all elements from the list. Complexity: O(number of chunks).
+ */
+#define AVS_UNROLLED_LIST_CLEAR(list) avs_unrolled_list_clear__((void **) (list))
+
+/**
+ * @returns Number of elements on the list. Complexity: O(1).
+ */
+#define AVS_UNROLLED_LIST_SIZE(list) avs_unrolled_list_size__((void **) (list))
+
+/**
+ * @returns Pointer to the first element on the list, or NULL if it is empty.
+ *          Complexity: O(1).
+ */
+#define AVS_UNROLLED_LIST_FRONT(list) (*(list))
+
+#ifdef __cplusplus
+template <typename T>
+static inline T *avs_unrolled_list_back_impl__(AVS_UNROLLED_LIST(T) list) {
+    return (T *) avs_unrolled_list_back__((void **) list);
+}
+
+template <typename T>
+static inline T *
+avs_unrolled_list_emplace_back_impl__(AVS_UNROLLED_LIST(T) list) {
+    return (T *) avs_unrolled_list_emplace_back__((void **) list);
+}
+
+template <typename T>
+static inline T *avs_unrolled_list_push_back_impl__(AVS_UNROLLED_LIST(T) list,
+                                                    const T *elem) {
+    return (T *) avs_unrolled_list_push_back__((void **) list, elem);
+}
+
+template <typename T>
+static inline T *
+avs_unrolled_list_iter_begin_impl__(avs_unrolled_list_iter_t *iter,
+                                    AVS_UNROLLED_LIST(T) list) {
+    return (T *) avs_unrolled_list_iter_begin__(iter, (void **) list);
+}
+
+template <typename T>
+static inline T *avs_unrolled_list_iter_next_impl__(
+        avs_unrolled_list_iter_t *iter, T *) {
+    return (T *) avs_unrolled_list_iter_next__(iter);
+}
+
+#define AVS_UNROLLED_LIST_BACK(list) (avs_unrolled_list_back_impl__((list)))
+#define AVS_UNROLLED_LIST_EMPLACE_BACK(list) \
+    (avs_unrolled_list_emplace_back_impl__((list)))
+#define AVS_UNROLLED_LIST_PUSH_BACK(list, elem_ptr) \
+    (avs_unrolled_list_push_back_impl__((list), (elem_ptr)))
+#define AVS_UNROLLED_LIST_ITER_BEGIN__(iter, list) \
+    (avs_unrolled_list_iter_begin_impl__(&(iter), (list)))
+#define AVS_UNROLLED_LIST_ITER_NEXT__(iter, elem) \
+    (avs_unrolled_list_iter_next_impl__(&(iter), (elem)))
+#else
+/**
+ * @returns Pointer to the last element on the list, or NULL if it is empty.
+ *          Complexity: O(1).
+ */
+#define AVS_UNROLLED_LIST_BACK(list) \
+    ((AVS_TYPEOF_PTR(*(list))) avs_unrolled_list_back__((void **) (list)))
+
+/**
+ * Appends a new, zero-initialized element at the end of the list.
+ *
+ * Complexity: O(1). Pointers to other elements remain valid.
+ *
+ * @returns Pointer to the new element, or NULL in case of memory allocation
+ *          failure.
+ */
+#define AVS_UNROLLED_LIST_EMPLACE_BACK(list) \
+    ((AVS_TYPEOF_PTR(*(list))) avs_unrolled_list_emplace_back__( \
+            (void **) (list)))
+
+/**
+ * Appends a copy of the element pointed to by @p elem_ptr at the end of the
+ * list.
+ *
+ * Complexity: O(1). Pointers to other elements remain valid.
+ *
+ * @returns Pointer to the new element, or NULL in case of memory allocation
+ *          failure.
+ */
+#define AVS_UNROLLED_LIST_PUSH_BACK(list, elem_ptr) \
+    ((void) sizeof(*(list) == (elem_ptr)), \
+     (AVS_TYPEOF_PTR(*(list))) avs_unrolled_list_push_back__( \
+             (void **) (list), (elem_ptr)))
+
+#define AVS_UNROLLED_LIST_ITER_BEGIN__(iter, list) \
+    ((AVS_TYPEOF_PTR(*(list))) avs_unrolled_list_iter_begin__( \
+            &(iter), (void **) (list)))
+#define AVS_UNROLLED_LIST_ITER_NEXT__(iter, elem) \
+    ((AVS_TYPEOF_PTR(elem)) avs_unrolled_list_iter_next__(&(iter)))
+#endif
+
+/**
+ * Removes the first element from the list. The list MUST NOT be empty.
+ *
+ * Complexity: O(1). Pointers to other elements remain valid.
+ */
+#define AVS_UNROLLED_LIST_POP_FRONT(list) \
+    avs_unrolled_list_pop_front__((void **) (list))
+
+/**
+ * Iterates over consecutive elements of the list.
+ *
+ * The list MUST NOT be modified during iteration, except for appending
+ * elements, which will also be visited.
+ *
+ * @param elem Iterator variable of element pointer type.
+ *
+ * @param iter Helper variable of type @ref avs_unrolled_list_iter_t.
+ *
+ * @param list The list to iterate over.
+ */
+#define AVS_UNROLLED_LIST_FOREACH(elem, iter, list) \
+    for ((elem) = AVS_UNROLLED_LIST_ITER_BEGIN__(iter, list); \
+         (elem); \
+         (elem) = AVS_UNROLLED_LIST_ITER_NEXT__(iter, elem))
+
+#endif /* AVS_COMMONS_UNROLLED_LIST_H */
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_config.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avsystem/commons/defs.h>
+#include <avsystem/commons/list.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+#define DEFAULT_CHUNK_SIZE 4096
+
+typedef struct {
+    char pad;
+    avs_max_align_t value;
+} alignment_helper_t;
+
+#define MAX_ALIGNMENT offsetof(alignment_helper_t, value)
+
+typedef struct arena_chunk_struct {
+    struct arena_chunk_struct *next;
+    size_t size;
+    union {
+        char bytes[1]; /* variable length */
+        avs_max_align_t align;
+    } data;
+} arena_chunk_t;
+
+struct avs_list_arena_struct {
+    size_t chunk_size;
+    /* most recently allocated chunk first; allocations are served from the
+     * head chunk */
+    arena_chunk_t *chunks;
+    size_t head_used;
+};
+
+/* largest size that can be rounded up without overflow, and still fits in
+ * a chunk together with the chunk header */
+#define MAX_ALIGNED_SIZE \
+        ((SIZE_MAX - offsetof(arena_chunk_t, data)) / MAX_ALIGNMENT \
+         * MAX_ALIGNMENT)
+
+static size_t align_size(size_t size) {
+    return (size + MAX_ALIGNMENT - 1) / MAX_ALIGNMENT * MAX_ALIGNMENT;
+}
+
+static arena_chunk_t *new_chunk(size_t size) {
+    arena_chunk_t *chunk;
+    if (size > MAX_ALIGNED_SIZE) {
+        return NULL;
+    }
+    chunk = (arena_chunk_t *) malloc(offsetof(arena_chunk_t, data) + size);
+    if (chunk) {
+        chunk->next = NULL;
+        chunk->size = size;
+    }
+    return chunk;
+}
+
+static void free_chunks(arena_chunk_t *chunk) {
+    while (chunk) {
+        arena_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+avs_list_arena_t *avs_list_arena_new(size_t chunk_size) {
+    avs_list_arena_t *arena;
+    if (chunk_size > MAX_ALIGNED_SIZE) {
+        return NULL;
+    }
+    arena = (avs_list_arena_t *) calloc(1, sizeof(avs_list_arena_t));
+    if (arena) {
+        arena->chunk_size = align_size(chunk_size ? chunk_size
+                                                  : DEFAULT_CHUNK_SIZE);
+    }
+    return arena;
+}
+
+void *avs_list_arena_alloc__(avs_list_arena_t *arena, size_t size) {
+    char *result;
+    if (size > MAX_ALIGNED_SIZE) {
+        return NULL;
+    }
+    size = align_size(size);
+    if (!arena->chunks || arena->chunks->size - arena->head_used < size) {
+        if (size > arena->chunk_size) {
+            /* oversized element: give it a dedicated chunk, placed behind the
+             * head so that the space left in the head chunk is not wasted */
+            arena_chunk_t *chunk = new_chunk(size);
+            if (!chunk) {
+                return NULL;
+            }
+            if (arena->chunks) {
+                chunk->next = arena->chunks->next;
+                arena->chunks->next = chunk;
+            } else {
+                arena->chunks = chunk;
+                arena->head_used = size;
+            }
+            memset(chunk->data.bytes, 0, size);
+            return chunk->data.bytes;
+        } else {
+            arena_chunk_t *chunk = new_chunk(arena->chunk_size);
+            if (!chunk) {
+                return NULL;
+            }
+            chunk->next = arena->chunks;
+            arena->chunks = chunk;
+            arena->head_used = 0;
+        }
+    }
+    result = arena->chunks->data.bytes + arena->head_used;
+    arena->head_used += size;
+    memset(result, 0, size);
+    return result;
+}
+
+void avs_list_arena_reset(avs_list_arena_t *arena) {
+    arena_chunk_t *kept = NULL;
+    arena_chunk_t *chunk;
+    if (!arena) {
+        return;
+    }
+    /* keep the oldest normal-sized chunk; dedicated oversized ones are never
+     * reused, so all of them are released */
+    chunk = arena->chunks;
+    while (chunk) {
+        arena_chunk_t *next = chunk->next;
+        if (chunk->size == arena->chunk_size) {
+            free(kept);
+            kept = chunk;
+        } else {
+            free(chunk);
+        }
+        chunk = next;
+    }
+    if (kept) {
+        kept->next = NULL;
+    }
+    arena->chunks = kept;
+    arena->head_used = 0;
+}
+
+void avs_list_arena_delete(avs_list_arena_t **arena_ptr) {
+    if (!arena_ptr || !*arena_ptr) {
+        return;
+    }
+    free_chunks((*arena_ptr)->chunks);
+    free(*arena_ptr);
+    *arena_ptr = NULL;
+}
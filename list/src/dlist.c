@@ -0,0 +1,97 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_config.h>
+
+#include <assert.h>
+
+#include <avsystem/commons/dlist.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+#define LINKS(element) avs_dlist_links__(element)
+
+void *avs_dlist_adjust_allocated_ptr__(void *allocated) {
+    if (allocated) {
+        void *element = (char *) allocated + AVS_DLIST_SPACE_FOR_LINKS__;
+        /* the allocator is only required to zero the first pointer */
+        LINKS(element)->next = NULL;
+        LINKS(element)->prev = NULL;
+        return element;
+    } else {
+        return NULL;
+    }
+}
+
+void *avs_dlist_insert__(void *element, void **list_ptr, void *before) {
+    void *first = *list_ptr;
+    if (!element) {
+        return NULL;
+    }
+    if (!first) {
+        assert(!before);
+        LINKS(element)->next = NULL;
+        LINKS(element)->prev = element;
+        *list_ptr = element;
+    } else if (!before) {
+        void *last = LINKS(first)->prev;
+        LINKS(last)->next = element;
+        LINKS(element)->next = NULL;
+        LINKS(element)->prev = last;
+        LINKS(first)->prev = element;
+    } else {
+        void *prev = LINKS(before)->prev;
+        LINKS(element)->next = before;
+        LINKS(element)->prev = prev;
+        LINKS(before)->prev = element;
+        if (before == first) {
+            *list_ptr = element;
+        } else {
+            LINKS(prev)->next = element;
+        }
+    }
+    return element;
+}
+
+void *avs_dlist_unlink__(void *element, void **list_ptr) {
+    void *first = *list_ptr;
+    void *next = LINKS(element)->next;
+    void *prev = LINKS(element)->prev;
+    assert(first);
+    if (element == first) {
+        *list_ptr = next;
+    } else {
+        LINKS(prev)->next = next;
+    }
+    if (next) {
+        LINKS(next)->prev = prev;
+    } else if (element != first) {
+        /* removing the last element - update the tail pointer */
+        LINKS(first)->prev = prev;
+    }
+    LINKS(element)->next = NULL;
+    LINKS(element)->prev = NULL;
+    return element;
+}
+
+size_t avs_dlist_size__(const void *list) {
+    size_t retval = 0;
+    while (list) {
+        ++retval;
+        list = LINKS(list)->next;
+    }
+    return retval;
+}
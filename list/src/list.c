@@ -122,31 +122,98 @@ size_t avs_list_size__(const void *list) {
     return retval;
 }
 
-static void half_list(void *list, void **part2_ptr) {
-    size_t length = AVS_LIST_SIZE(list);
-    length /= 2;
-    while (--length) {
-        list = AVS_LIST_NEXT(list);
+/* merges two sorted lists; elements of a go first in case of equality */
+static void *merge_lists(void *a, void *b,
+                         avs_list_comparator_func_t comparator,
+                         size_t element_size) {
+    AVS_LIST(void) result = NULL;
+    AVS_LIST(void) *tail_ptr = &result;
+    while (a && b) {
+        if (comparator(a, b, element_size) <= 0) {
+            *tail_ptr = a;
+            a = AVS_LIST_NEXT(a);
+        } else {
+            *tail_ptr = b;
+            b = AVS_LIST_NEXT(b);
+        }
+        tail_ptr = AVS_LIST_NEXT_PTR(tail_ptr);
     }
-    *part2_ptr = AVS_LIST_NEXT(list);
-    AVS_LIST_NEXT(list) = NULL;
+    *tail_ptr = a ? a : b;
+    return result;
 }
 
+/* detaches the longest sorted prefix of *list_ptr; strictly descending
+ * prefixes are reversed, which keeps the sort stable */
+static void *take_run(void **list_ptr,
+                      avs_list_comparator_func_t comparator,
+                      size_t element_size) {
+    AVS_LIST(void) run = *list_ptr;
+    AVS_LIST(void) last = run;
+    AVS_LIST(void) next = AVS_LIST_NEXT(run);
+    if (next && comparator(last, next, element_size) > 0) {
+        /* descending run: build it reversed */
+        AVS_LIST_NEXT(run) = NULL;
+        do {
+            AVS_LIST(void) after = AVS_LIST_NEXT(next);
+            AVS_LIST_NEXT(next) = run;
+            run = next;
+            next = after;
+        } while (next && comparator(run, next, element_size) > 0);
+        *list_ptr = next;
+        return run;
+    }
+    while (next && comparator(last, next, element_size) <= 0) {
+        last = next;
+        next = AVS_LIST_NEXT(next);
+    }
+    AVS_LIST_NEXT(last) = NULL;
+    *list_ptr = next;
+    return run;
+}
+
+/* maximum number of pending runs; slot i holds a merge of up to 2^i runs, so
+ * this is enough for any list that fits in memory */
+#define MAX_PENDING_RUNS (sizeof(size_t) * 8)
+
 void avs_list_sort__(void **list_ptr,
                      avs_list_comparator_func_t comparator,
                      size_t element_size) {
-    AVS_LIST(void) part1 = NULL;
-    AVS_LIST(void) part2 = NULL;
+    AVS_LIST(void) pending[MAX_PENDING_RUNS];
+    AVS_LIST(void) rest;
+    AVS_LIST(void) result = NULL;
+    size_t num_pending = 0;
+    size_t i;
     if (!list_ptr || !*list_ptr || !AVS_LIST_NEXT(*list_ptr)) {
         /* zero or one element */
         return;
     }
-    part1 = *list_ptr;
-    half_list(part1, &part2);
-    avs_list_sort__(&part1, comparator, element_size);
-    avs_list_sort__(&part2, comparator, element_size);
-    avs_list_merge__(&part1, &part2, comparator, element_size);
-    *list_ptr = part1;
+    /* Bottom-up natural merge sort: the list is consumed as a sequence of
+     * already sorted runs, which are merged like in binary addition - slot i
+     * of pending is either empty or contains a merge of 2^i runs. Runs in
+     * higher slots always precede those in lower ones in the original list,
+     * so merging them in that order keeps the sort stable. */
+    rest = *list_ptr;
+    while (rest) {
+        AVS_LIST(void) carry = take_run(&rest, comparator, element_size);
+        for (i = 0; i < num_pending && pending[i]; ++i) {
+            carry = merge_lists(pending[i], carry, comparator, element_size);
+            pending[i] = NULL;
+        }
+        if (i == MAX_PENDING_RUNS) {
+            /* cannot happen with realistic memory sizes; keep the merged
+             * list in the last slot */
+            --i;
+        } else if (i == num_pending) {
+            ++num_pending;
+        }
+        pending[i] = carry;
+    }
+    for (i = 0; i < num_pending; ++i) {
+        if (pending[i]) {
+            result = merge_lists(pending[i], result, comparator, element_size);
+        }
+    }
+    *list_ptr = result;
 }
 
 int avs_list_is_cyclic__(const void *list) {
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_config.h>
+
+#include <string.h>
+
+#include <avsystem/commons/unit/test.h>
+
+#include <avsystem/commons/dlist.h>
+
+static void assert_dlist_contents(AVS_DLIST(int) list,
+                                  const int *expected, size_t count) {
+    int *element;
+    size_t i = 0;
+    AVS_UNIT_ASSERT_EQUAL(AVS_DLIST_SIZE(list), count);
+    AVS_DLIST_FOREACH(element, list) {
+        AVS_UNIT_ASSERT_EQUAL(*element, expected[i++]);
+    }
+    AVS_UNIT_ASSERT_EQUAL(i, count);
+    AVS_DLIST_FOREACH_REVERSE(element, list) {
+        AVS_UNIT_ASSERT_EQUAL(*element, expected[--i]);
+    }
+    AVS_UNIT_ASSERT_EQUAL(i, 0);
+    if (count) {
+        AVS_UNIT_ASSERT_EQUAL(*AVS_DLIST_FIRST(list), expected[0]);
+        AVS_UNIT_ASSERT_EQUAL(*AVS_DLIST_LAST(list), expected[count - 1]);
+    } else {
+        AVS_UNIT_ASSERT_NULL(AVS_DLIST_LAST(list));
+    }
+}
+
+AVS_UNIT_TEST(dlist, push_and_iterate) {
+    static const int EXPECTED[] = { 0, 1, 2, 3 };
+    AVS_DLIST(int) list = NULL;
+    int *element;
+
+    assert_dlist_contents(list, NULL, 0);
+    AVS_UNIT_ASSERT_NOT_NULL((element = AVS_DLIST_NEW_ELEMENT(int)));
+    *element = 1;
+    AVS_UNIT_ASSERT_TRUE(AVS_DLIST_PUSH_BACK(&list, element) == element);
+    *AVS_DLIST_PUSH_BACK(&list, AVS_DLIST_NEW_ELEMENT(int)) = 3;
+    *AVS_DLIST_PUSH_FRONT(&list, AVS_DLIST_NEW_ELEMENT(int)) = 0;
+    *AVS_DLIST_INSERT_BEFORE(&list, AVS_DLIST_LAST(list),
+                             AVS_DLIST_NEW_ELEMENT(int)) = 2;
+    assert_dlist_contents(list, EXPECTED, 4);
+
+    AVS_UNIT_ASSERT_NULL(AVS_DLIST_PREV(list, list));
+    AVS_UNIT_ASSERT_NULL(AVS_DLIST_NEXT(AVS_DLIST_LAST(list)));
+    AVS_UNIT_ASSERT_EQUAL(*AVS_DLIST_PREV(list, AVS_DLIST_NEXT(list)), 0);
+
+    AVS_DLIST_CLEAR(&list);
+    AVS_UNIT_ASSERT_NULL(list);
+}
+
+AVS_UNIT_TEST(dlist, unlink_and_delete) {
+    static const int AFTER_MIDDLE[] = { 0, 1, 3, 4 };
+    static const int AFTER_FIRST[] = { 1, 3, 4 };
+    static const int AFTER_LAST[] = { 1, 3 };
+    static const int AFTER_READD[] = { 1, 3, 0 };
+    AVS_DLIST(int) list = NULL;
+    int *element;
+    int *helper;
+    int *unlinked;
+    int i;
+
+    for (i = 0; i < 5; ++i) {
+        *AVS_DLIST_PUSH_BACK(&list, AVS_DLIST_NEW_ELEMENT(int)) = i;
+    }
+    AVS_DLIST_DELETABLE_FOREACH(element, helper, list) {
+        if (*element == 2) {
+            AVS_DLIST_DELETE(&list, element);
+        }
+    }
+    assert_dlist_contents(list, AFTER_MIDDLE, 4);
+
+    unlinked = AVS_DLIST_UNLINK(&list, list);
+    AVS_UNIT_ASSERT_EQUAL(*unlinked, 0);
+    assert_dlist_contents(list, AFTER_FIRST, 3);
+
+    AVS_DLIST_DELETE(&list, AVS_DLIST_LAST(list));
+    assert_dlist_contents(list, AFTER_LAST, 2);
+
+    /* unlinked elements can be inserted again */
+    AVS_DLIST_PUSH_BACK(&list, unlinked);
+    assert_dlist_contents(list, AFTER_READD, 3);
+
+    AVS_DLIST_DELETABLE_FOREACH(element, helper, list) {
+        AVS_DLIST_DELETE(&list, element);
+    }
+    assert_dlist_contents(list, NULL, 0);
+}
+
+AVS_UNIT_TEST(dlist, allocator_not_zeroing_links) {
+    static const int EXPECTED[] = { 0, 1 };
+    AVS_DLIST(int) list = NULL;
+    size_t i;
+
+    for (i = 0; i < AVS_ARRAY_SIZE(EXPECTED); ++i) {
+        void *allocated = AVS_LIST_CONFIG_ALLOC(AVS_DLIST_SPACE_FOR_LINKS__
+                                                + sizeof(int));
+        int *element;
+        AVS_UNIT_ASSERT_NOT_NULL(allocated);
+        memset(allocated, 0xAA, AVS_DLIST_SPACE_FOR_LINKS__ + sizeof(int));
+        element = (int *) avs_dlist_adjust_allocated_ptr__(allocated);
+        *element = EXPECTED[i];
+        AVS_DLIST_PUSH_BACK(&list, element);
+    }
+    assert_dlist_contents(list, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+    AVS_DLIST_CLEAR(&list);
+}
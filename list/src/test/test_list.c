@@ -16,6 +16,7 @@
 
 #include <avs_commons_config.h>
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -246,6 +247,43 @@ AVS_UNIT_TEST(list, sort_empty) {
     AVS_LIST_SORT(&empty_list, test_elem_comparator);
 }
 
+AVS_UNIT_TEST(list, sort_runs_stable) {
+    AVS_LIST(test_elem_t) list = NULL;
+    AVS_LIST(test_elem_t) *append_ptr = &list;
+    AVS_LIST(test_elem_t) element = NULL;
+    const test_elem_t *prev = NULL;
+    size_t i;
+
+    /* ascending, strictly descending and constant runs of varying length,
+     * with many equal values to verify stability */
+    for (i = 0; i < 1000; ++i) {
+        AVS_UNIT_ASSERT_NOT_NULL((element = AVS_LIST_NEW_ELEMENT(test_elem_t)));
+        element->orig_position = i;
+        switch ((i / 37) % 3) {
+        case 0: element->value = (int) (i % 37) % 10; break;
+        case 1: element->value = 40 - (int) (i % 37); break;
+        case 2: element->value = 5; break;
+        }
+        AVS_LIST_INSERT(append_ptr, element);
+        append_ptr = AVS_LIST_NEXT_PTR(append_ptr);
+    }
+
+    AVS_LIST_SORT(&list, test_elem_comparator);
+
+    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(list), 1000);
+    AVS_LIST_FOREACH(element, list) {
+        if (prev) {
+            AVS_UNIT_ASSERT_TRUE(prev->value <= element->value);
+            if (prev->value == element->value) {
+                AVS_UNIT_ASSERT_TRUE(prev->orig_position
+                                     < element->orig_position);
+            }
+        }
+        prev = element;
+    }
+    AVS_LIST_CLEAR(&list);
+}
+
 AVS_UNIT_TEST(list, is_cyclic) {
     int *elem = NULL;
     AVS_LIST(int) list = NULL;
@@ -421,3 +459,83 @@ AVS_UNIT_TEST(list, merge_when_one_list_is_empty) {
     AVS_LIST_CLEAR(&first);
     AVS_LIST_CLEAR(&second);
 }
+
+typedef struct {
+    char pad;
+    avs_max_align_t value;
+} arena_alignment_helper_t;
+
+AVS_UNIT_TEST(list, arena) {
+    avs_list_arena_t *arena = avs_list_arena_new(128);
+    AVS_LIST(test_elem_t) list = NULL;
+    AVS_LIST(test_elem_t) it;
+    AVS_LIST(char) big;
+    int round;
+    int i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(arena);
+    for (round = 0; round < 3; ++round) {
+        /* enough elements to span multiple chunks */
+        for (i = 0; i < 50; ++i) {
+            AVS_LIST(test_elem_t) elem =
+                    AVS_LIST_NEW_ELEMENT_IN(arena, test_elem_t);
+            AVS_UNIT_ASSERT_NOT_NULL(elem);
+            AVS_UNIT_ASSERT_NULL(AVS_LIST_NEXT(elem));
+            AVS_UNIT_ASSERT_EQUAL(elem->value, 0);
+            AVS_UNIT_ASSERT_EQUAL(
+                    (uintptr_t) elem
+                            % offsetof(arena_alignment_helper_t, value),
+                    0);
+            elem->value = i;
+            AVS_LIST_APPEND(&list, elem);
+        }
+        big = (AVS_LIST(char)) AVS_LIST_NEW_BUFFER_IN(arena, 1000);
+        AVS_UNIT_ASSERT_NOT_NULL(big);
+        AVS_UNIT_ASSERT_NULL(AVS_LIST_NEXT(big));
+        memset(big, 'x', 1000);
+
+        AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(list), 50);
+        i = 0;
+        AVS_LIST_FOREACH(it, list) {
+            AVS_UNIT_ASSERT_EQUAL(it->value, i++);
+        }
+
+        list = NULL;
+        avs_list_arena_reset(arena);
+    }
+    avs_list_arena_delete(&arena);
+    AVS_UNIT_ASSERT_NULL(arena);
+}
+
+AVS_UNIT_TEST(list, arena_reset_after_oversized_first) {
+    avs_list_arena_t *arena = avs_list_arena_new(128);
+    int round;
+    int i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(arena);
+    for (round = 0; round < 3; ++round) {
+        /* dedicated chunk first, regular chunks allocated afterwards */
+        AVS_LIST(char) big =
+                (AVS_LIST(char)) AVS_LIST_NEW_BUFFER_IN(arena, 1000);
+        AVS_UNIT_ASSERT_NOT_NULL(big);
+        memset(big, 'x', 1000);
+        for (i = 0; i < 20; ++i) {
+            AVS_LIST(test_elem_t) elem =
+                    AVS_LIST_NEW_ELEMENT_IN(arena, test_elem_t);
+            AVS_UNIT_ASSERT_NOT_NULL(elem);
+            AVS_UNIT_ASSERT_EQUAL(elem->value, 0);
+            elem->value = i;
+        }
+        avs_list_arena_reset(arena);
+    }
+    avs_list_arena_delete(&arena);
+}
+
+AVS_UNIT_TEST(list, arena_size_overflow) {
+    avs_list_arena_t *arena;
+    AVS_UNIT_ASSERT_NULL(avs_list_arena_new(SIZE_MAX));
+    arena = avs_list_arena_new(0);
+    AVS_UNIT_ASSERT_NOT_NULL(arena);
+    AVS_UNIT_ASSERT_NULL(avs_list_arena_alloc__(arena, SIZE_MAX));
+    avs_list_arena_delete(&arena);
+}
@@ -431,3 +431,47 @@ AVS_UNIT_TEST(list, merge_when_one_list_is_empty) {
     AVS_LIST_CLEAR(&first);
     AVS_LIST_CLEAR(&second);
 }
+
+#include <avsystem/commons/dlist.h>
+
+AVS_UNIT_TEST(dlist, basic) {
+    AVS_DLIST(int) list = NULL;
+    int *element;
+    int *helper;
+    int i;
+    for (i = 0; i < 4; ++i) {
+        *AVS_DLIST_PUSH_BACK(&list, AVS_DLIST_NEW_ELEMENT(int)) = i;
+    }
+    AVS_DLIST_FOREACH_REVERSE(element, list) {
+        AVS_UNIT_ASSERT_EQUAL(*element, --i);
+    }
+    AVS_DLIST_DELETABLE_FOREACH(element, helper, list) {
+        if (*element % 2) {
+            AVS_DLIST_DELETE(&list, element);
+        }
+    }
+    AVS_UNIT_ASSERT_EQUAL(AVS_DLIST_SIZE(list), 2);
+    AVS_UNIT_ASSERT_EQUAL(*AVS_DLIST_LAST(list), 2);
+    AVS_DLIST_CLEAR(&list);
+}
+
+#include <avsystem/commons/unrolled_list.h>
+
+AVS_UNIT_TEST(unrolled_list, basic) {
+    AVS_UNROLLED_LIST(int) list = AVS_UNROLLED_LIST_NEW_WITH_CHUNK(int, 4);
+    avs_unrolled_list_iter_t iter;
+    int *element;
+    int i;
+    for (i = 0; i < 10; ++i) {
+        AVS_UNIT_ASSERT_NOT_NULL(AVS_UNROLLED_LIST_PUSH_BACK(list, &i));
+    }
+    *AVS_UNROLLED_LIST_EMPLACE_BACK(list) = 10;
+    AVS_UNIT_ASSERT_EQUAL(*AVS_UNROLLED_LIST_BACK(list), 10);
+    i = 0;
+    AVS_UNROLLED_LIST_FOREACH(element, iter, list) {
+        AVS_UNIT_ASSERT_EQUAL(*element, i++);
+    }
+    AVS_UNROLLED_LIST_POP_FRONT(list);
+    AVS_UNIT_ASSERT_EQUAL(*AVS_UNROLLED_LIST_FRONT(list), 1);
+    AVS_UNROLLED_LIST_DELETE(&list);
+}
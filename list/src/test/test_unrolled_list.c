@@ -0,0 +1,89 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_config.h>
+
+#include <stdint.h>
+
+#include <avsystem/commons/unit/test.h>
+
+#include <avsystem/commons/unrolled_list.h>
+
+AVS_UNIT_TEST(unrolled_list, push_iterate_pop) {
+    AVS_UNROLLED_LIST(int) list = AVS_UNROLLED_LIST_NEW_WITH_CHUNK(int, 4);
+    avs_unrolled_list_iter_t iter;
+    int *first_ptr = NULL;
+    int *element;
+    int expected;
+    int i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(list);
+    AVS_UNIT_ASSERT_NULL(AVS_UNROLLED_LIST_FRONT(list));
+    AVS_UNIT_ASSERT_NULL(AVS_UNROLLED_LIST_BACK(list));
+    AVS_UNROLLED_LIST_FOREACH(element, iter, list) {
+        AVS_UNIT_ASSERT_TRUE(0);
+    }
+
+    for (i = 0; i < 10; ++i) {
+        element = AVS_UNROLLED_LIST_PUSH_BACK(list, &i);
+        AVS_UNIT_ASSERT_NOT_NULL(element);
+        AVS_UNIT_ASSERT_EQUAL(*element, i);
+        AVS_UNIT_ASSERT_TRUE(AVS_UNROLLED_LIST_BACK(list) == element);
+        if (!first_ptr) {
+            first_ptr = element;
+        }
+    }
+    AVS_UNIT_ASSERT_EQUAL(AVS_UNROLLED_LIST_SIZE(list), 10);
+    /* elements never move */
+    AVS_UNIT_ASSERT_TRUE(AVS_UNROLLED_LIST_FRONT(list) == first_ptr);
+
+    expected = 0;
+    AVS_UNROLLED_LIST_FOREACH(element, iter, list) {
+        AVS_UNIT_ASSERT_EQUAL(*element, expected++);
+    }
+    AVS_UNIT_ASSERT_EQUAL(expected, 10);
+
+    /* pop across chunk boundaries, interleaved with pushes */
+    expected = 0;
+    for (i = 10; i < 29; ++i) {
+        AVS_UNIT_ASSERT_EQUAL(*AVS_UNROLLED_LIST_FRONT(list), expected++);
+        AVS_UNROLLED_LIST_POP_FRONT(list);
+        if (i % 2) {
+            element = AVS_UNROLLED_LIST_EMPLACE_BACK(list);
+            AVS_UNIT_ASSERT_NOT_NULL(element);
+            AVS_UNIT_ASSERT_EQUAL(*element, 0);
+            *element = 10 + (i - 10) / 2;
+        }
+    }
+    AVS_UNIT_ASSERT_EQUAL(AVS_UNROLLED_LIST_SIZE(list), 0);
+    AVS_UNIT_ASSERT_NULL(AVS_UNROLLED_LIST_FRONT(list));
+
+    for (i = 0; i < 5; ++i) {
+        AVS_UNIT_ASSERT_NOT_NULL(AVS_UNROLLED_LIST_PUSH_BACK(list, &i));
+    }
+    AVS_UNROLLED_LIST_CLEAR(list);
+    AVS_UNIT_ASSERT_EQUAL(AVS_UNROLLED_LIST_SIZE(list), 0);
+    AVS_UNIT_ASSERT_NULL(AVS_UNROLLED_LIST_FRONT(list));
+
+    AVS_UNROLLED_LIST_DELETE(&list);
+    AVS_UNIT_ASSERT_NULL(list);
+}
+
+AVS_UNIT_TEST(unrolled_list, chunk_size_overflow) {
+    AVS_UNIT_ASSERT_NULL(AVS_UNROLLED_LIST_NEW_WITH_CHUNK(int, SIZE_MAX));
+    AVS_UNIT_ASSERT_NULL(
+            AVS_UNROLLED_LIST_NEW_WITH_CHUNK(int, SIZE_MAX / sizeof(int)));
+}
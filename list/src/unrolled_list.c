@@ -0,0 +1,185 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_config.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avsystem/commons/unrolled_list.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+typedef avs_unrolled_list_chunk_t__ chunk_t;
+
+typedef struct {
+    size_t elem_size;
+    size_t chunk_capacity;
+    size_t size;
+    /* all chunks between head and tail contain at least one element */
+    chunk_t *head;
+    chunk_t *tail;
+    /* most recently emptied chunk, kept to avoid allocator round-trips in
+     * queue-like usage */
+    chunk_t *spare;
+    /* pointer to the first element; the list object points here */
+    void *front;
+} unrolled_list_desc_t;
+
+#define MIN_CHUNK_CAPACITY 4
+
+static unrolled_list_desc_t *get_desc(void **list) {
+    assert(list && "NULL list pointer");
+    return (unrolled_list_desc_t *) (intptr_t)
+            ((char *) list - offsetof(unrolled_list_desc_t, front));
+}
+
+static char *chunk_storage_end(unrolled_list_desc_t *desc, chunk_t *chunk) {
+    return chunk->data.bytes + desc->chunk_capacity * desc->elem_size;
+}
+
+void **avs_unrolled_list_new__(size_t elem_size, size_t chunk_capacity) {
+    unrolled_list_desc_t *desc;
+    assert(elem_size > 0);
+    if (!chunk_capacity) {
+        chunk_capacity = AVS_UNROLLED_LIST_DEFAULT_CHUNK_BYTES / elem_size;
+        if (chunk_capacity < MIN_CHUNK_CAPACITY) {
+            chunk_capacity = MIN_CHUNK_CAPACITY;
+        }
+    }
+    if (chunk_capacity > (SIZE_MAX - offsetof(chunk_t, data)) / elem_size) {
+        return NULL;
+    }
+    desc = (unrolled_list_desc_t *) calloc(1, sizeof(unrolled_list_desc_t));
+    if (!desc) {
+        return NULL;
+    }
+    desc->elem_size = elem_size;
+    desc->chunk_capacity = chunk_capacity;
+    return &desc->front;
+}
+
+void avs_unrolled_list_clear__(void **list) {
+    unrolled_list_desc_t *desc = get_desc(list);
+    chunk_t *chunk = desc->head;
+    while (chunk) {
+        chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(desc->spare);
+    desc->head = NULL;
+    desc->tail = NULL;
+    desc->spare = NULL;
+    desc->front = NULL;
+    desc->size = 0;
+}
+
+void avs_unrolled_list_delete__(void ***list_ptr) {
+    if (!list_ptr || !*list_ptr) {
+        return;
+    }
+    avs_unrolled_list_clear__(*list_ptr);
+    free(get_desc(*list_ptr));
+    *list_ptr = NULL;
+}
+
+size_t avs_unrolled_list_size__(void **list) {
+    return get_desc(list)->size;
+}
+
+void *avs_unrolled_list_back__(void **list) {
+    unrolled_list_desc_t *desc = get_desc(list);
+    return desc->tail ? desc->tail->end - desc->elem_size : NULL;
+}
+
+static chunk_t *new_chunk(unrolled_list_desc_t *desc) {
+    chunk_t *chunk = desc->spare;
+    if (chunk) {
+        desc->spare = NULL;
+    } else {
+        chunk = (chunk_t *) malloc(offsetof(chunk_t, data)
+                                   + desc->chunk_capacity * desc->elem_size);
+        if (!chunk) {
+            return NULL;
+        }
+    }
+    chunk->next = NULL;
+    chunk->begin = chunk->data.bytes;
+    chunk->end = chunk->data.bytes;
+    return chunk;
+}
+
+void *avs_unrolled_list_emplace_back__(void **list) {
+    unrolled_list_desc_t *desc = get_desc(list);
+    char *elem;
+    if (!desc->tail || desc->tail->end == chunk_storage_end(desc, desc->tail)) {
+        chunk_t *chunk = new_chunk(desc);
+        if (!chunk) {
+            return NULL;
+        }
+        if (desc->tail) {
+            desc->tail->next = chunk;
+        } else {
+            desc->head = chunk;
+        }
+        desc->tail = chunk;
+    }
+    elem = desc->tail->end;
+    desc->tail->end += desc->elem_size;
+    memset(elem, 0, desc->elem_size);
+    if (!desc->front) {
+        desc->front = elem;
+    }
+    ++desc->size;
+    return elem;
+}
+
+void *avs_unrolled_list_push_back__(void **list, const void *elem) {
+    void *result = avs_unrolled_list_emplace_back__(list);
+    if (result) {
+        memcpy(result, elem, get_desc(list)->elem_size);
+    }
+    return result;
+}
+
+void avs_unrolled_list_pop_front__(void **list) {
+    unrolled_list_desc_t *desc = get_desc(list);
+    chunk_t *head = desc->head;
+    assert(head && "pop from an empty list");
+    head->begin += desc->elem_size;
+    --desc->size;
+    if (head->begin == head->end) {
+        desc->head = head->next;
+        if (!desc->head) {
+            desc->tail = NULL;
+        }
+        free(desc->spare);
+        desc->spare = head;
+    }
+    desc->front = desc->head ? desc->head->begin : NULL;
+}
+
+void *avs_unrolled_list_iter_begin__(avs_unrolled_list_iter_t *iter,
+                                     void **list) {
+    unrolled_list_desc_t *desc = get_desc(list);
+    iter->chunk = desc->head;
+    iter->elem = desc->head ? desc->head->begin : NULL;
+    iter->elem_size = desc->elem_size;
+    return iter->elem;
+}
@@ -0,0 +1,363 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _AVS_NEED_POSIX_API
+
+#include <avs_commons_config.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/async.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+#define MODULE_NAME_SIZE 64
+
+/*
+ * The queue is a bounded multi-producer ring in the style of Dmitry Vyukov's
+ * MPMC queue. Each record carries a sequence number: a record at index
+ * (pos % capacity) may be filled by the producer that claimed position pos if
+ * its sequence is equal to pos, and consumed by the writer if it is equal to
+ * pos + 1. After consuming, the writer sets it to pos + capacity, making the
+ * record available for the next lap.
+ *
+ * Producers claim positions with a CAS on enqueue_pos, so they never wait for
+ * each other except when the queue is full. The writer thread is woken up
+ * through a condition variable only if it is actually waiting.
+ */
+typedef struct {
+    atomic_size_t sequence;
+    avs_log_level_t level;
+    char module[MODULE_NAME_SIZE];
+    char message[_AVS_LOG_MAX_LINE_LENGTH];
+} async_record_t;
+
+typedef struct {
+    async_record_t *records;
+    size_t mask;
+    avs_log_async_policy_t policy;
+    atomic_size_t enqueue_pos;
+    /* only accessed by the writer thread */
+    size_t dequeue_pos;
+    /* number of records passed to the handler so far */
+    atomic_size_t handled;
+    atomic_int writer_waiting;
+    /* number of threads waiting for handled to change */
+    atomic_int progress_waiters;
+    atomic_int stopping;
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+    pthread_cond_t progress;
+    pthread_t writer;
+} async_queue_t;
+
+/*
+ * QUEUE is only changed by avs_log_async_start() and avs_log_async_stop().
+ * Threads that use it register in ACTIVE_USERS first and check ENABLED
+ * afterwards; avs_log_async_stop() clears ENABLED and waits for ACTIVE_USERS
+ * to drop to zero before stopping the writer thread and freeing the queue.
+ */
+static async_queue_t *QUEUE;
+static atomic_int ENABLED;
+static atomic_size_t ACTIVE_USERS;
+static atomic_uint_fast64_t DROPPED;
+
+static void wake_writer(async_queue_t *queue) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&queue->writer_waiting, memory_order_relaxed)) {
+        pthread_mutex_lock(&queue->mutex);
+        pthread_cond_signal(&queue->wakeup);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+}
+
+static void notify_progress(async_queue_t *queue) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&queue->progress_waiters,
+                             memory_order_relaxed)) {
+        pthread_mutex_lock(&queue->mutex);
+        pthread_cond_broadcast(&queue->progress);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+}
+
+static async_record_t *record_at(async_queue_t *queue, size_t pos) {
+    return &queue->records[pos & queue->mask];
+}
+
+static int record_ready(async_queue_t *queue) {
+    return atomic_load_explicit(
+                   &record_at(queue, queue->dequeue_pos)->sequence,
+                   memory_order_acquire)
+           == queue->dequeue_pos + 1;
+}
+
+/*
+ * Positions and sequence numbers wrap around, so they are compared by the sign
+ * of their difference.
+ */
+static ptrdiff_t pos_diff(size_t a, size_t b) {
+    return (ptrdiff_t) (a - b);
+}
+
+static int queue_full(async_queue_t *queue) {
+    size_t pos = atomic_load_explicit(&queue->enqueue_pos,
+                                      memory_order_relaxed);
+    return pos_diff(atomic_load_explicit(&record_at(queue, pos)->sequence,
+                                         memory_order_acquire),
+                    pos)
+           < 0;
+}
+
+/*
+ * Waits until handled changes from the given value, or the queue is no
+ * longer full if handled_value is not given.
+ */
+static void wait_for_progress(async_queue_t *queue,
+                              const size_t *handled_value) {
+    pthread_mutex_lock(&queue->mutex);
+    atomic_fetch_add(&queue->progress_waiters, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (handled_value
+            ? atomic_load(&queue->handled) == *handled_value
+            : queue_full(queue)) {
+        pthread_cond_wait(&queue->progress, &queue->mutex);
+    }
+    atomic_fetch_sub(&queue->progress_waiters, 1);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+/* returns the number of records passed to the handler */
+static size_t drain(async_queue_t *queue) {
+    size_t count = 0;
+    while (record_ready(queue)) {
+        async_record_t *record = record_at(queue, queue->dequeue_pos);
+        _avs_log_call_handler(record->level, record->module, record->message);
+        atomic_store_explicit(&record->sequence,
+                              queue->dequeue_pos + queue->mask + 1,
+                              memory_order_release);
+        ++queue->dequeue_pos;
+        ++count;
+    }
+    if (count) {
+        atomic_store(&queue->handled, queue->dequeue_pos);
+        notify_progress(queue);
+    }
+    return count;
+}
+
+static void *writer_thread(void *queue_) {
+    async_queue_t *queue = (async_queue_t *) queue_;
+    while (1) {
+        if (drain(queue)) {
+            continue;
+        }
+        if (atomic_load(&queue->stopping)) {
+            /* all producers are done at this point */
+            drain(queue);
+            return NULL;
+        }
+        pthread_mutex_lock(&queue->mutex);
+        atomic_store(&queue->writer_waiting, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!record_ready(queue) && !atomic_load(&queue->stopping)) {
+            pthread_cond_wait(&queue->wakeup, &queue->mutex);
+        }
+        atomic_store(&queue->writer_waiting, 0);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+}
+
+static async_queue_t *acquire_queue(void) {
+    atomic_fetch_add(&ACTIVE_USERS, 1);
+    if (!atomic_load(&ENABLED)
+            || pthread_equal(pthread_self(), QUEUE->writer)) {
+        atomic_fetch_sub(&ACTIVE_USERS, 1);
+        return NULL;
+    }
+    return QUEUE;
+}
+
+static void release_queue(void) {
+    atomic_fetch_sub(&ACTIVE_USERS, 1);
+}
+
+int _avs_log_async_push(avs_log_level_t level,
+                        const char *module,
+                        const char *message) {
+    async_queue_t *queue = acquire_queue();
+    async_record_t *record;
+    size_t pos;
+
+    if (!queue) {
+        return -1;
+    }
+    pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    while (1) {
+        ptrdiff_t diff;
+        record = record_at(queue, pos);
+        diff = pos_diff(atomic_load_explicit(&record->sequence,
+                                             memory_order_acquire),
+                        pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                        &queue->enqueue_pos, &pos, pos + 1,
+                        memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* the record from the previous lap is not consumed yet */
+            if (queue->policy == AVS_LOG_ASYNC_DROP) {
+                atomic_fetch_add_explicit(&DROPPED, 1, memory_order_relaxed);
+                release_queue();
+                return 0;
+            }
+            wake_writer(queue);
+            wait_for_progress(queue, NULL);
+            pos = atomic_load_explicit(&queue->enqueue_pos,
+                                       memory_order_relaxed);
+        } else {
+            /* another producer claimed this position */
+            pos = atomic_load_explicit(&queue->enqueue_pos,
+                                       memory_order_relaxed);
+        }
+    }
+
+    record->level = level;
+    strncpy(record->module, module, sizeof(record->module) - 1);
+    record->module[sizeof(record->module) - 1] = '\0';
+    strcpy(record->message, message);
+    atomic_store_explicit(&record->sequence, pos + 1, memory_order_release);
+    wake_writer(queue);
+    release_queue();
+    return 0;
+}
+
+static void queue_free(async_queue_t *queue) {
+    pthread_cond_destroy(&queue->progress);
+    pthread_cond_destroy(&queue->wakeup);
+    pthread_mutex_destroy(&queue->mutex);
+    free(queue->records);
+    free(queue);
+}
+
+int avs_log_async_start(size_t queue_length, avs_log_async_policy_t policy) {
+    async_queue_t *queue;
+    size_t capacity = 2;
+    size_t i;
+
+    if (QUEUE) {
+        return -1;
+    }
+    while (capacity < queue_length) {
+        if (capacity > SIZE_MAX / 2) {
+            return -1;
+        }
+        capacity *= 2;
+    }
+    queue = (async_queue_t *) calloc(1, sizeof(async_queue_t));
+    if (!queue) {
+        return -1;
+    }
+    queue->records = (async_record_t *) calloc(capacity,
+                                               sizeof(async_record_t));
+    if (!queue->records) {
+        free(queue);
+        return -1;
+    }
+    for (i = 0; i < capacity; ++i) {
+        atomic_init(&queue->records[i].sequence, i);
+    }
+    queue->mask = capacity - 1;
+    queue->policy = policy;
+    atomic_init(&queue->enqueue_pos, 0);
+    atomic_init(&queue->handled, 0);
+    atomic_init(&queue->writer_waiting, 0);
+    atomic_init(&queue->progress_waiters, 0);
+    atomic_init(&queue->stopping, 0);
+    if (pthread_mutex_init(&queue->mutex, NULL)) {
+        goto free_records;
+    }
+    if (pthread_cond_init(&queue->wakeup, NULL)) {
+        goto destroy_mutex;
+    }
+    if (pthread_cond_init(&queue->progress, NULL)) {
+        goto destroy_wakeup;
+    }
+    if (pthread_create(&queue->writer, NULL, writer_thread, queue)) {
+        goto destroy_progress;
+    }
+
+    QUEUE = queue;
+    atomic_store(&DROPPED, 0);
+    atomic_store(&ENABLED, 1);
+    return 0;
+
+destroy_progress:
+    pthread_cond_destroy(&queue->progress);
+destroy_wakeup:
+    pthread_cond_destroy(&queue->wakeup);
+destroy_mutex:
+    pthread_mutex_destroy(&queue->mutex);
+free_records:
+    free(queue->records);
+    free(queue);
+    return -1;
+}
+
+void avs_log_async_flush(void) {
+    async_queue_t *queue = acquire_queue();
+    size_t target;
+    size_t handled;
+    if (!queue) {
+        return;
+    }
+    target = atomic_load(&queue->enqueue_pos);
+    wake_writer(queue);
+    while (pos_diff(handled = atomic_load(&queue->handled), target) < 0) {
+        wait_for_progress(queue, &handled);
+    }
+    release_queue();
+}
+
+void avs_log_async_stop(void) {
+    async_queue_t *queue = QUEUE;
+    if (!queue) {
+        return;
+    }
+    atomic_store(&ENABLED, 0);
+    /* threads that are still pushing records rely on the writer thread */
+    while (atomic_load(&ACTIVE_USERS)) {
+        sched_yield();
+    }
+    pthread_mutex_lock(&queue->mutex);
+    atomic_store(&queue->stopping, 1);
+    pthread_cond_signal(&queue->wakeup);
+    pthread_mutex_unlock(&queue->mutex);
+    pthread_join(queue->writer, NULL);
+    QUEUE = NULL;
+    queue_free(queue);
+}
+
+uint64_t avs_log_async_dropped(void) {
+    return (uint64_t) atomic_load_explicit(&DROPPED, memory_order_relaxed);
+}
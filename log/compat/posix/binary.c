@@ -0,0 +1,716 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _AVS_NEED_POSIX_API
+
+#include <avs_commons_config.h>
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/binary.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+#define MIN_BUFFER_SIZE 256
+
+/* longest supported conversion specification, including the '%' */
+#define MAX_CONVERSION_LENGTH 31
+
+/* maximum number of arguments of a message logged in the binary mode */
+#define MAX_CACHED_CONVERSIONS 16
+
+/* number of per-thread signature cache entries; MUST be a power of two */
+#define SIGNATURE_CACHE_SIZE 32
+
+/*
+ * Types in which the arguments are stored. Signed and unsigned variants of the
+ * same type have the same representation, so only one of them is used.
+ */
+typedef enum {
+    ARG_NONE,
+    ARG_INT,
+    ARG_LONG,
+    ARG_LLONG,
+    ARG_INTMAX,
+    ARG_SIZE,
+    ARG_PTRDIFF,
+    ARG_DOUBLE,
+    ARG_LDOUBLE,
+    ARG_STRING,
+    ARG_POINTER
+} arg_type_t;
+
+/* what is needed to store the arguments of a single conversion */
+typedef struct {
+    arg_type_t type;
+    /* number of int arguments consumed by '*' width and precision */
+    int stars;
+    /* precision given as '*' - always the last of the star arguments */
+    int star_precision;
+    /* literal precision, or -1 if not specified */
+    int precision;
+} arg_desc_t;
+
+typedef struct {
+    /* nullbyte-terminated copy of the conversion specification */
+    char spec[MAX_CONVERSION_LENGTH + 1];
+    arg_desc_t arg;
+} conversion_t;
+
+/*
+ * Argument descriptions of a format string, cached so that the format string
+ * does not need to be parsed each time a message is recorded.
+ */
+typedef struct {
+    const char *format;
+    /* number of conversions that consume arguments, or -1 if the format
+     * string is not supported */
+    int count;
+    arg_desc_t args[MAX_CACHED_CONVERSIONS];
+} signature_t;
+
+/*
+ * Each record consists of a record_header_t followed by the values of
+ * arguments, in the order in which they are consumed by the format string.
+ * Strings are stored as their size_t length followed by the characters and a
+ * terminating nullbyte. Nothing in the buffer is aligned, so all values are
+ * accessed with memcpy().
+ */
+typedef struct {
+    const char *module;
+    const char *file;
+    const char *format;
+    int64_t timestamp_ns;
+    size_t size;
+    unsigned line;
+    avs_log_level_t level;
+} record_header_t;
+
+typedef struct {
+    char *data;
+    size_t size;
+    size_t used;
+    int draining;
+    signature_t signatures[SIGNATURE_CACHE_SIZE];
+} thread_buffer_t;
+
+/* 0 if the binary mode is disabled */
+static volatile size_t BUFFER_SIZE;
+
+static AVS_THREAD_LOCAL thread_buffer_t *THREAD_BUFFER;
+static AVS_THREAD_LOCAL int64_t CURRENT_TIMESTAMP_NS = -1;
+
+/* only used to drain and free the buffers of exiting threads */
+static pthread_once_t KEY_ONCE = PTHREAD_ONCE_INIT;
+static pthread_key_t KEY;
+static int KEY_CREATED;
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/*
+ * Parses the conversion specification starting with the '%' character pointed
+ * to by fmt. Returns a pointer to the character following it, or NULL if the
+ * conversion is not supported.
+ */
+static const char *parse_conversion(const char *fmt, conversion_t *conv) {
+    const char *start = fmt++;
+    enum {
+        LEN_NONE, LEN_H, LEN_L, LEN_LL, LEN_J, LEN_Z, LEN_T, LEN_BIG_L
+    } length = LEN_NONE;
+    size_t spec_length;
+
+    conv->arg.stars = 0;
+    conv->arg.star_precision = 0;
+    conv->arg.precision = -1;
+    while (*fmt && strchr("-+ #0", *fmt)) {
+        ++fmt;
+    }
+    if (*fmt == '*') {
+        ++conv->arg.stars;
+        ++fmt;
+    } else {
+        while (is_digit(*fmt)) {
+            ++fmt;
+        }
+    }
+    if (*fmt == '.') {
+        ++fmt;
+        if (*fmt == '*') {
+            ++conv->arg.stars;
+            conv->arg.star_precision = 1;
+            ++fmt;
+        } else {
+            conv->arg.precision = 0;
+            while (is_digit(*fmt)) {
+                if (conv->arg.precision < _AVS_LOG_MAX_LINE_LENGTH) {
+                    conv->arg.precision = 10 * conv->arg.precision + (*fmt - '0');
+                }
+                ++fmt;
+            }
+        }
+    }
+
+    switch (*fmt) {
+    case 'h':
+        length = LEN_H;
+        if (*++fmt == 'h') {
+            ++fmt;
+        }
+        break;
+    case 'l':
+        length = LEN_L;
+        if (*++fmt == 'l') {
+            length = LEN_LL;
+            ++fmt;
+        }
+        break;
+    case 'j':
+        length = LEN_J;
+        ++fmt;
+        break;
+    case 'z':
+        length = LEN_Z;
+        ++fmt;
+        break;
+    case 't':
+        length = LEN_T;
+        ++fmt;
+        break;
+    case 'L':
+        length = LEN_BIG_L;
+        ++fmt;
+        break;
+    default:
+        break;
+    }
+
+    switch (*fmt) {
+    case 'd':
+    case 'i':
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+        switch (length) {
+        case LEN_NONE:
+        case LEN_H:
+            conv->arg.type = ARG_INT;
+            break;
+        case LEN_L:
+            conv->arg.type = ARG_LONG;
+            break;
+        case LEN_LL:
+            conv->arg.type = ARG_LLONG;
+            break;
+        case LEN_J:
+            conv->arg.type = ARG_INTMAX;
+            break;
+        case LEN_Z:
+            conv->arg.type = ARG_SIZE;
+            break;
+        case LEN_T:
+            conv->arg.type = ARG_PTRDIFF;
+            break;
+        default:
+            return NULL;
+        }
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        if (length == LEN_NONE || length == LEN_L) {
+            conv->arg.type = ARG_DOUBLE;
+        } else if (length == LEN_BIG_L) {
+            conv->arg.type = ARG_LDOUBLE;
+        } else {
+            return NULL;
+        }
+        break;
+    case 'c':
+        conv->arg.type = ARG_INT;
+        break;
+    case 's':
+        conv->arg.type = ARG_STRING;
+        break;
+    case 'p':
+        conv->arg.type = ARG_POINTER;
+        break;
+    case '%':
+        if (fmt != start + 1) {
+            return NULL;
+        }
+        conv->arg.type = ARG_NONE;
+        break;
+    default:
+        return NULL;
+    }
+    if ((*fmt == 'c' || *fmt == 's' || *fmt == 'p') && length != LEN_NONE) {
+        return NULL;
+    }
+
+    ++fmt;
+    spec_length = (size_t) (fmt - start);
+    if (spec_length > MAX_CONVERSION_LENGTH) {
+        return NULL;
+    }
+    memcpy(conv->spec, start, spec_length);
+    conv->spec[spec_length] = '\0';
+    return fmt;
+}
+
+typedef struct {
+    char *ptr;
+    char *end;
+} writer_t;
+
+static int write_bytes(writer_t *writer, const void *data, size_t size) {
+    if ((size_t) (writer->end - writer->ptr) < size) {
+        return -1;
+    }
+    memcpy(writer->ptr, data, size);
+    writer->ptr += size;
+    return 0;
+}
+
+static int write_string(writer_t *writer, const char *value, int precision) {
+    size_t limit = _AVS_LOG_MAX_LINE_LENGTH - 1;
+    size_t length = 0;
+    if (!value) {
+        value = "(null)";
+    }
+    if (precision >= 0 && (size_t) precision < limit) {
+        limit = (size_t) precision;
+    }
+    /* precision may be used to print strings that are not terminated */
+    while (length < limit && value[length]) {
+        ++length;
+    }
+    if (write_bytes(writer, &length, sizeof(length))
+            || write_bytes(writer, value, length)
+            || write_bytes(writer, "", 1)) {
+        return -1;
+    }
+    return 0;
+}
+
+static int write_arg(writer_t *writer, const arg_desc_t *arg, va_list *ap) {
+    int precision = arg->precision;
+    int i;
+    for (i = 0; i < arg->stars; ++i) {
+        int value = va_arg(*ap, int);
+        if (arg->star_precision && i == arg->stars - 1) {
+            precision = value;
+        }
+        if (write_bytes(writer, &value, sizeof(value))) {
+            return -1;
+        }
+    }
+
+    switch (arg->type) {
+    case ARG_NONE:
+        return 0;
+    case ARG_INT: {
+        int value = va_arg(*ap, int);
+        return write_bytes(writer, &value, sizeof(value));
+    }
+    case ARG_LONG: {
+        long value = va_arg(*ap, long);
+        return write_bytes(writer, &value, sizeof(value));
+    }
+    case ARG_LLONG: {
+        long long value = va_arg(*ap, long long);
+        return write_bytes(writer, &value, sizeof(value));
+    }
+    case ARG_INTMAX: {
+        intmax_t value = va_arg(*ap, intmax_t);
+        return write_bytes(writer, &value, sizeof(value));
+    }
+    case ARG_SIZE: {
+        size_t value = va_arg(*ap, size_t);
+        return write_bytes(writer, &value, sizeof(value));
+    }
+    case ARG_PTRDIFF: {
+        ptrdiff_t value = va_arg(*ap, ptrdiff_t);
+        return write_bytes(writer, &value, sizeof(value));
+    }
+    case ARG_DOUBLE: {
+        double value = va_arg(*ap, double);
+        return write_bytes(writer, &value, sizeof(value));
+    }
+    case ARG_LDOUBLE: {
+        long double value = va_arg(*ap, long double);
+        return write_bytes(writer, &value, sizeof(value));
+    }
+    case ARG_STRING:
+        return write_string(writer, va_arg(*ap, const char *), precision);
+    case ARG_POINTER: {
+        void *value = va_arg(*ap, void *);
+        return write_bytes(writer, &value, sizeof(value));
+    }
+    }
+    return -1;
+}
+
+static void parse_signature(signature_t *signature, const char *format) {
+    const char *fmt = format;
+    signature->format = format;
+    signature->count = 0;
+    while ((fmt = strchr(fmt, '%'))) {
+        conversion_t conv;
+        if (!(fmt = parse_conversion(fmt, &conv))
+                || (conv.arg.type != ARG_NONE
+                        && signature->count >= MAX_CACHED_CONVERSIONS)) {
+            signature->count = -1;
+            return;
+        }
+        if (conv.arg.type != ARG_NONE) {
+            signature->args[signature->count++] = conv.arg;
+        }
+    }
+}
+
+static const signature_t *get_signature(thread_buffer_t *buffer,
+                                        const char *format) {
+    uintptr_t hash = (uintptr_t) format;
+    signature_t *signature;
+    hash ^= hash >> 7;
+    signature = &buffer->signatures[hash & (SIGNATURE_CACHE_SIZE - 1)];
+    if (signature->format != format) {
+        parse_signature(signature, format);
+    }
+    return signature;
+}
+
+static int64_t now_ns(void) {
+    struct timespec now;
+    if (clock_gettime(CLOCK_REALTIME, &now)) {
+        return -1;
+    }
+    return (int64_t) now.tv_sec * 1000000000 + (int64_t) now.tv_nsec;
+}
+
+typedef enum {
+    RECORD_OK = 0,
+    RECORD_NO_SPACE = -1,
+    RECORD_UNSUPPORTED = -2
+} record_result_t;
+
+static record_result_t write_record(thread_buffer_t *buffer,
+                                    avs_log_level_t level,
+                                    const char *module,
+                                    const char *file,
+                                    unsigned line,
+                                    const char *format,
+                                    va_list ap) {
+    const signature_t *signature = get_signature(buffer, format);
+    char *record = buffer->data + buffer->used;
+    record_header_t header;
+    writer_t writer;
+    record_result_t result = RECORD_OK;
+    va_list aq;
+    int i;
+
+    if (signature->count < 0) {
+        return RECORD_UNSUPPORTED;
+    }
+    if (buffer->size - buffer->used < sizeof(header)) {
+        return RECORD_NO_SPACE;
+    }
+    writer.ptr = record + sizeof(header);
+    writer.end = buffer->data + buffer->size;
+
+    va_copy(aq, ap);
+    for (i = 0; !result && i < signature->count; ++i) {
+        if (write_arg(&writer, &signature->args[i], &aq)) {
+            result = RECORD_NO_SPACE;
+        }
+    }
+    va_end(aq);
+    if (result) {
+        return result;
+    }
+
+    header.module = module;
+    header.file = file;
+    header.format = format;
+    header.timestamp_ns = now_ns();
+    header.size = (size_t) (writer.ptr - record);
+    header.line = line;
+    header.level = level;
+    memcpy(record, &header, sizeof(header));
+    buffer->used += header.size;
+    return RECORD_OK;
+}
+
+static void read_bytes(const char **args, void *out, size_t size) {
+    memcpy(out, *args, size);
+    *args += size;
+}
+
+#define FORMAT_ARG(Out, Size, Conv, Stars, Value) \
+        ((Conv)->arg.stars == 0 \
+                ? snprintf((Out), (Size), (Conv)->spec, (Value)) \
+                : (Conv)->arg.stars == 1 \
+                        ? snprintf((Out), (Size), (Conv)->spec, (Stars)[0], \
+                                   (Value)) \
+                        : snprintf((Out), (Size), (Conv)->spec, (Stars)[0], \
+                                   (Stars)[1], (Value)))
+
+#define READ_AND_FORMAT_ARG(Type, Out, Size, Conv, Stars, Args) \
+        do { \
+            Type value__; \
+            read_bytes((Args), &value__, sizeof(value__)); \
+            return FORMAT_ARG((Out), (Size), (Conv), (Stars), value__); \
+        } while (0)
+
+static int format_arg(char *out,
+                      size_t size,
+                      const conversion_t *conv,
+                      const char **args) {
+    int stars[2] = { 0, 0 };
+    int i;
+    for (i = 0; i < conv->arg.stars; ++i) {
+        read_bytes(args, &stars[i], sizeof(stars[i]));
+    }
+
+    switch (conv->arg.type) {
+    case ARG_NONE:
+        return snprintf(out, size, "%%");
+    case ARG_INT:
+        READ_AND_FORMAT_ARG(int, out, size, conv, stars, args);
+    case ARG_LONG:
+        READ_AND_FORMAT_ARG(long, out, size, conv, stars, args);
+    case ARG_LLONG:
+        READ_AND_FORMAT_ARG(long long, out, size, conv, stars, args);
+    case ARG_INTMAX:
+        READ_AND_FORMAT_ARG(intmax_t, out, size, conv, stars, args);
+    case ARG_SIZE:
+        READ_AND_FORMAT_ARG(size_t, out, size, conv, stars, args);
+    case ARG_PTRDIFF:
+        READ_AND_FORMAT_ARG(ptrdiff_t, out, size, conv, stars, args);
+    case ARG_DOUBLE:
+        READ_AND_FORMAT_ARG(double, out, size, conv, stars, args);
+    case ARG_LDOUBLE:
+        READ_AND_FORMAT_ARG(long double, out, size, conv, stars, args);
+    case ARG_STRING: {
+        size_t length;
+        const char *value;
+        read_bytes(args, &length, sizeof(length));
+        value = *args;
+        *args += length + 1;
+        return FORMAT_ARG(out, size, conv, stars, value);
+    }
+    case ARG_POINTER:
+        READ_AND_FORMAT_ARG(void *, out, size, conv, stars, args);
+    }
+    return -1;
+}
+
+/*
+ * Formats the message body into out, truncating it like vsnprintf() would.
+ * Returns the number of characters written, not including the nullbyte.
+ */
+static size_t format_body(char *out,
+                          size_t out_size,
+                          const char *format,
+                          const char *args) {
+    size_t out_left;
+    size_t written = 0;
+    if (!out_size) {
+        return 0;
+    }
+    out_left = out_size - 1;
+    while (*format && written < out_left) {
+        const char *next = strchr(format, '%');
+        size_t literal_length = next ? (size_t) (next - format)
+                                     : strlen(format);
+        int result;
+        conversion_t conv;
+
+        if (literal_length) {
+            if (literal_length > out_left - written) {
+                literal_length = out_left - written;
+            }
+            memcpy(out + written, format, literal_length);
+            written += literal_length;
+            format += literal_length;
+            continue;
+        }
+        /* the format has already been validated while recording */
+        format = parse_conversion(format, &conv);
+        result = format_arg(out + written, out_left - written + 1, &conv,
+                            &args);
+        if (result < 0) {
+            break;
+        }
+        written += AVS_MIN((size_t) result, out_left - written);
+    }
+    out[written] = '\0';
+    return written;
+}
+
+static void drain_record(const record_header_t *header, const char *args) {
+    char log_buf[_AVS_LOG_MAX_LINE_LENGTH];
+    size_t log_buf_left = sizeof(log_buf) - 1;
+    char *log_buf_ptr = _avs_log_write_prefix(log_buf, &log_buf_left,
+                                              header->level, header->module,
+                                              header->file, header->line);
+    if (!log_buf_ptr) {
+        return;
+    }
+    /* mimic avs_log_internal_forced_v__() formatting with vsnprintf() */
+    log_buf_ptr += format_body(log_buf_ptr, log_buf_left, header->format,
+                               args);
+    *log_buf_ptr = '\0';
+
+    CURRENT_TIMESTAMP_NS = header->timestamp_ns;
+    _avs_log_dispatch(header->level, header->module, log_buf);
+    CURRENT_TIMESTAMP_NS = -1;
+}
+
+static void drain(thread_buffer_t *buffer) {
+    size_t pos = 0;
+    buffer->draining = 1;
+    while (pos < buffer->used) {
+        record_header_t header;
+        memcpy(&header, buffer->data + pos, sizeof(header));
+        drain_record(&header, buffer->data + pos + sizeof(header));
+        pos += header.size;
+    }
+    buffer->used = 0;
+    buffer->draining = 0;
+}
+
+static void release_buffer(void *buffer_) {
+    thread_buffer_t *buffer = (thread_buffer_t *) buffer_;
+    drain(buffer);
+    THREAD_BUFFER = NULL;
+    free(buffer);
+}
+
+static void release_thread_buffer(void) {
+    thread_buffer_t *buffer = THREAD_BUFFER;
+    if (buffer && !buffer->draining) {
+        pthread_setspecific(KEY, NULL);
+        release_buffer(buffer);
+    }
+}
+
+/*
+ * Thread-specific data destructors are not called for the thread that calls
+ * exit(), which is usually the main one, so its buffer is drained here.
+ */
+static void drain_at_exit(void) {
+    avs_log_binary_stop();
+}
+
+static void create_key(void) {
+    KEY_CREATED = !pthread_key_create(&KEY, release_buffer)
+                  && !atexit(drain_at_exit);
+}
+
+static thread_buffer_t *get_thread_buffer(size_t size) {
+    thread_buffer_t *buffer = THREAD_BUFFER;
+    if (buffer && (buffer->size == size || buffer->draining)) {
+        return buffer;
+    }
+    /* the binary mode has been restarted with a different buffer size */
+    release_thread_buffer();
+
+    buffer = (thread_buffer_t *) malloc(sizeof(thread_buffer_t) + size);
+    if (!buffer) {
+        return NULL;
+    }
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->data = (char *) (buffer + 1);
+    buffer->size = size;
+    if (pthread_setspecific(KEY, buffer)) {
+        free(buffer);
+        return NULL;
+    }
+    THREAD_BUFFER = buffer;
+    return buffer;
+}
+
+int _avs_log_binary_record(avs_log_level_t level,
+                           const char *module,
+                           const char *file,
+                           unsigned line,
+                           const char *format,
+                           va_list ap) {
+    size_t size = BUFFER_SIZE;
+    thread_buffer_t *buffer;
+    record_result_t result;
+
+    if (!size) {
+        /* keep the order of messages recorded before disabling the mode */
+        release_thread_buffer();
+        return -1;
+    }
+    if (!(buffer = get_thread_buffer(size)) || buffer->draining) {
+        return -1;
+    }
+    result = write_record(buffer, level, module, file, line, format, ap);
+    if (result == RECORD_NO_SPACE && buffer->used) {
+        drain(buffer);
+        result = write_record(buffer, level, module, file, line, format, ap);
+    }
+    if (result) {
+        /* preserve the order of messages */
+        drain(buffer);
+        return -1;
+    }
+    return 0;
+}
+
+int avs_log_binary_start(size_t buffer_size) {
+    if (buffer_size < MIN_BUFFER_SIZE
+            || pthread_once(&KEY_ONCE, create_key) || !KEY_CREATED) {
+        return -1;
+    }
+    BUFFER_SIZE = buffer_size;
+    return 0;
+}
+
+void avs_log_binary_flush(void) {
+    thread_buffer_t *buffer = THREAD_BUFFER;
+    if (buffer && !buffer->draining) {
+        drain(buffer);
+    }
+}
+
+void avs_log_binary_stop(void) {
+    BUFFER_SIZE = 0;
+    release_thread_buffer();
+}
+
+int64_t avs_log_binary_timestamp_ns(void) {
+    return CURRENT_TIMESTAMP_NS;
+}
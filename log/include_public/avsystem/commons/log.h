@@ -18,9 +18,15 @@
 #define	AVS_COMMONS_LOG_H
 
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include <avsystem/commons/defs.h>
 
+#if defined(AVS_COMMONS_HAVE_C11_STDATOMIC) && !defined(__cplusplus)
+#include <stdatomic.h>
+#endif
+
 #ifdef	__cplusplus
 extern "C" {
 #endif
@@ -110,16 +116,204 @@ void avs_log_set_handler(avs_log_handler_t *log_handler);
 
 /**
  * Resets the logging system to default settings and frees all resources that
- * may be used by it.
+ * may be used by it. This includes disabling the asynchronous and binary
+ * logging modes.
  */
 void avs_log_reset(void);
 
+/**
+ * Behavior of the asynchronous logging mode when the message queue is full.
+ */
+typedef enum {
+    /**
+     * The message is discarded, and counted in @ref avs_log_async_dropped.
+     */
+    AVS_LOG_ASYNC_DROP,
+    /**
+     * The logging thread waits until the writer thread makes space in the
+     * queue.
+     */
+    AVS_LOG_ASYNC_BLOCK
+} avs_log_async_policy_t;
+
+/**
+ * Enables the asynchronous logging mode.
+ *
+ * In this mode, log messages are still formatted by the thread that logs them,
+ * but instead of being passed to the log handler directly, they are pushed
+ * into a bounded, lock-free multi-producer queue. A dedicated writer thread
+ * drains the queue in batches and calls the log handler for each message, in
+ * the order in which they were queued. This way, a slow handler (e.g. one
+ * writing to a terminal or to syslog) does not stall threads that log
+ * messages.
+ *
+ * Messages logged from within the log handler itself are passed to it
+ * synchronously.
+ *
+ * @param queue_length Maximum number of messages waiting in the queue. It is
+ *                     rounded up to the nearest power of two.
+ *
+ * @param policy       Behavior when the queue is full.
+ *
+ * @return 0 on success, negative value if avs_commons is compiled without
+ *         <c>WITH_AVS_LOG_ASYNC</c>, if the asynchronous mode is already
+ *         enabled, or in case of an error.
+ */
+int avs_log_async_start(size_t queue_length, avs_log_async_policy_t policy);
+
+/**
+ * Waits until all messages queued before the call are passed to the log
+ * handler. Does nothing if the asynchronous mode is not enabled.
+ *
+ * MUST NOT be called from within the log handler.
+ */
+void avs_log_async_flush(void);
+
+/**
+ * Disables the asynchronous logging mode. All queued messages are passed to the
+ * log handler before the writer thread exits. Other threads may log messages
+ * concurrently - they will be passed to the handler synchronously when the
+ * function returns.
+ *
+ * MUST NOT be called from within the log handler, nor concurrently with
+ * @ref avs_log_async_start.
+ */
+void avs_log_async_stop(void);
+
+/**
+ * @returns Number of messages discarded because the queue was full, since the
+ *          asynchronous mode was last enabled.
+ */
+uint64_t avs_log_async_dropped(void);
+
+/**
+ * Enables the binary (deferred formatting) logging mode.
+ *
+ * In this mode, messages that pass the log level check are not formatted when
+ * they are logged. Instead, the format string pointer, source location, time
+ * and raw values of the arguments are appended to a buffer owned by the
+ * logging thread, which costs little more than copying the arguments. The
+ * messages are formatted and passed to the log handler (or the asynchronous
+ * logging queue, see @ref avs_log_async_start) in the order in which they were
+ * logged when the buffer is drained, i.e.:
+ * - when it is full,
+ * - when @ref avs_log_binary_flush or @ref avs_log_binary_stop is called by
+ *   the owning thread,
+ * - when the owning thread logs a message after the binary mode is disabled,
+ * - when the owning thread exits or calls <c>exit()</c>. In the latter case,
+ *   the buffer is drained and the binary mode is disabled by an
+ *   <c>atexit()</c> handler registered by the first call to this function, so
+ *   the log handler MUST remain usable until then.
+ *
+ * Values of <c>%s</c> arguments are copied, but the format string, module name
+ * and source file name are only referenced, so they MUST be valid until the
+ * message is drained. Additionally, the argument types parsed from a format
+ * string are cached by its address, so format strings MUST NOT change either.
+ * Both requirements are always met by string literals.
+ *
+ * Messages with more than 16 arguments or with conversions other than the ones
+ * defined by C99 for <c>int</c>, <c>long</c>, <c>long long</c>,
+ * <c>intmax_t</c>, <c>size_t</c>, <c>ptrdiff_t</c>, <c>double</c>,
+ * <c>long double</c>, <c>char *</c> and <c>void *</c> values (e.g. <c>%n</c>
+ * or <c>%ls</c>), as well as messages logged from within the log handler while
+ * a buffer is being drained, are formatted and passed to the handler
+ * immediately.
+ *
+ * @param buffer_size Size of the buffer allocated by each logging thread, in
+ *                    bytes. It MUST be at least 256.
+ *
+ * @return 0 on success, negative value if avs_commons is compiled without
+ *         <c>WITH_AVS_LOG_BINARY</c>, or in case of an error.
+ */
+int avs_log_binary_start(size_t buffer_size);
+
+/**
+ * Formats all messages stored in the calling thread's binary log buffer and
+ * passes them to the log handler. Does nothing if the buffer is empty.
+ */
+void avs_log_binary_flush(void);
+
+/**
+ * Disables the binary logging mode, and drains the calling thread's binary log
+ * buffer. Buffers of other threads are drained when they log another message
+ * or exit, or call @ref avs_log_binary_flush.
+ */
+void avs_log_binary_stop(void);
+
+/**
+ * @returns When called from within the log handler for a message that has been
+ *          stored in the binary logging mode - time at which the message was
+ *          logged, as the number of nanoseconds since the Unix epoch
+ *          (<c>CLOCK_REALTIME</c>). Otherwise (including when the handler is
+ *          called by the asynchronous logging mode writer thread) -1.
+ */
+int64_t avs_log_binary_timestamp_ns(void);
+
 /**
  * @name Logging subsystem internals
  */
 /**@{*/
 int avs_log_should_log__(avs_log_level_t level, const char *module);
 
+/*
+ * Per-call-site cache of the effective log level of a module. The level is
+ * stored in the lowest AVS_LOG_LEVEL_CACHE_BITS__ bits, and the value of
+ * avs_log_level_generation__ at the time it was looked up - in the remaining
+ * ones, so that both are always read together. The generation is bumped
+ * whenever any log level changes, which invalidates all cached levels.
+ * A zero-initialized cache is never valid, as the generation is never 0.
+ *
+ * The generation is bumped with release semantics and checked with acquire
+ * semantics. Without C11 atomics (and in C++, where <stdatomic.h> is not
+ * available), plain volatile accesses are used instead, and log levels MUST NOT
+ * be changed concurrently with logging.
+ */
+#if defined(AVS_COMMONS_HAVE_C11_STDATOMIC) && !defined(__cplusplus)
+typedef atomic_uint avs_log_level_cache_t__;
+
+extern atomic_uint avs_log_level_generation__;
+
+#define AVS_LOG_LOAD_LEVEL_CACHE__(Cache) \
+    atomic_load_explicit((Cache), memory_order_relaxed)
+#define AVS_LOG_LOAD_LEVEL_GENERATION__() \
+    atomic_load_explicit(&avs_log_level_generation__, memory_order_acquire)
+#else
+typedef volatile unsigned avs_log_level_cache_t__;
+
+extern volatile unsigned avs_log_level_generation__;
+
+#define AVS_LOG_LOAD_LEVEL_CACHE__(Cache) (*(Cache))
+#define AVS_LOG_LOAD_LEVEL_GENERATION__() avs_log_level_generation__
+#endif
+
+#define AVS_LOG_LEVEL_CACHE_BITS__ 3
+
+int avs_log_should_log_refresh__(avs_log_level_t level,
+                                 const char *module,
+                                 avs_log_level_cache_t__ *cache);
+
+static inline int
+avs_log_should_log_cached__(avs_log_level_t level,
+                            const char *module,
+                            avs_log_level_cache_t__ *cache) {
+    unsigned cached = AVS_LOG_LOAD_LEVEL_CACHE__(cache);
+    if ((cached >> AVS_LOG_LEVEL_CACHE_BITS__)
+            == AVS_LOG_LOAD_LEVEL_GENERATION__()) {
+        return (unsigned) level
+               >= (cached & ((1u << AVS_LOG_LEVEL_CACHE_BITS__) - 1u));
+    }
+    return avs_log_should_log_refresh__(level, module, cache);
+}
+
+/*
+ * Evaluate arguments of log messages that are not going to be logged. These
+ * have external linkage, so that log statements do not refer to any identifiers
+ * with internal linkage.
+ */
+void avs_log_discard_l__(const char *msg, ...);
+
+void avs_log_discard_v__(const char *msg, va_list ap);
+
 void avs_log_internal_forced_v__(avs_log_level_t level,
                                  const char *module,
                                  const char *file,
@@ -148,16 +342,115 @@ void avs_log_internal_l__(avs_log_level_t level,
                           const char *msg, ...)
         AVS_F_PRINTF(5, 6);
 
+#if defined(__GNUC__) && !defined(AVS_LOG_NO_LEVEL_CACHE)
+/*
+ * Each call site gets its own static level cache, so that checking whether
+ * a disabled message shall be logged costs a single load and compare. A GNU
+ * statement expression is necessary to declare it, as log statements may be
+ * used as expressions. C99 does not allow static objects in inline functions
+ * with external linkage, so AVS_LOG_NO_LEVEL_CACHE selects the uncached path.
+ */
+#define AVS_LOG_SHOULD_LOG__(Level, ModuleStr) \
+        (__extension__ ({ \
+            static avs_log_level_cache_t__ avs_log_level_cache__; \
+            avs_log_should_log_cached__(Level, ModuleStr, \
+                                        &avs_log_level_cache__); \
+        }))
+
+#define AVS_LOG_IMPL__(Level, Variant, ModuleStr, ...) \
+        (AVS_LOG_SHOULD_LOG__(Level, ModuleStr) \
+                ? avs_log_internal_forced_##Variant##__( \
+                        Level, ModuleStr, __FILE__, __LINE__, __VA_ARGS__) \
+                : avs_log_discard_##Variant##__(__VA_ARGS__))
+#else
+#define AVS_LOG_SHOULD_LOG__(Level, ModuleStr) \
+        avs_log_should_log__(Level, ModuleStr)
+
 #define AVS_LOG_IMPL__(Level, Variant, ModuleStr, ...) \
         avs_log_internal_##Variant##__(Level, ModuleStr, __FILE__, __LINE__, \
                                        __VA_ARGS__)
+#endif
 
 #define AVS_LOG_LAZY_IMPL__(Level, Variant, ModuleStr, ...) \
-        (avs_log_should_log__(Level, ModuleStr) \
+        (AVS_LOG_SHOULD_LOG__(Level, ModuleStr) \
                 ? avs_log_internal_forced_##Variant##__( \
                         Level, ModuleStr, __FILE__, __LINE__, __VA_ARGS__) \
                 : (void) 0)
 
+/*
+ * Per-call-site state of AVS_LOG_RATELIMITED and AVS_LOG_SAMPLED. Each rate
+ * limit has its own spinlock, so that unrelated call sites never contend.
+ * C++ code sees the same layout through plain volatile fields.
+ */
+#if defined(AVS_COMMONS_HAVE_C11_STDATOMIC) && !defined(__cplusplus)
+typedef struct {
+    atomic_uint lock;
+    int64_t last_refill_ms;
+    unsigned tokens;
+    unsigned long suppressed;
+} avs_log_ratelimit_t__;
+
+typedef struct {
+    atomic_ulong count;
+} avs_log_sample_t__;
+#else
+typedef struct {
+    volatile unsigned lock;
+    int64_t last_refill_ms;
+    unsigned tokens;
+    unsigned long suppressed;
+} avs_log_ratelimit_t__;
+
+typedef struct {
+    volatile unsigned long count;
+} avs_log_sample_t__;
+#endif
+
+#ifdef AVS_COMMONS_WITH_AVS_UTILS
+int avs_log_ratelimit__(avs_log_ratelimit_t__ *limit,
+                        unsigned burst,
+                        unsigned period_ms,
+                        avs_log_level_t level,
+                        const char *module,
+                        const char *file,
+                        unsigned line);
+#endif // AVS_COMMONS_WITH_AVS_UTILS
+
+int avs_log_sample__(avs_log_sample_t__ *limit, unsigned every);
+
+/*
+ * The limit is only checked for messages that pass the level check, so that
+ * disabled messages are as cheap as with avs_log. Check is an expression that
+ * may refer to the call site's limit state as avs_log_limit__.
+ */
+#define AVS_LOG_LIMITED_IMPL__(Level, ModuleStr, LimitType, Check, ...) \
+        do { \
+            static avs_log_level_cache_t__ avs_log_level_cache__; \
+            static LimitType avs_log_limit__; \
+            if (avs_log_should_log_cached__(Level, ModuleStr, \
+                                            &avs_log_level_cache__) \
+                    && (Check)) { \
+                avs_log_internal_forced_l__(Level, ModuleStr, __FILE__, \
+                                            __LINE__, __VA_ARGS__); \
+            } \
+        } while (0)
+
+#define AVS_LOG_LIMITED_DISABLED__(ModuleStr, LimitType, Check, ...) \
+        do { \
+            (void) sizeof(avs_log_discard_l__(__VA_ARGS__), 0); \
+        } while (0)
+
+#define AVS_LOG_LIMITED__TRACE(...) \
+        AVS_LOG_LIMITED_IMPL__(AVS_LOG_TRACE, __VA_ARGS__)
+#define AVS_LOG_LIMITED__DEBUG(...) \
+        AVS_LOG_LIMITED_IMPL__(AVS_LOG_DEBUG, __VA_ARGS__)
+#define AVS_LOG_LIMITED__INFO(...) \
+        AVS_LOG_LIMITED_IMPL__(AVS_LOG_INFO, __VA_ARGS__)
+#define AVS_LOG_LIMITED__WARNING(...) \
+        AVS_LOG_LIMITED_IMPL__(AVS_LOG_WARNING, __VA_ARGS__)
+#define AVS_LOG_LIMITED__ERROR(...) \
+        AVS_LOG_LIMITED_IMPL__(AVS_LOG_ERROR, __VA_ARGS__)
+
 #define AVS_LOG__TRACE(...)   AVS_LOG_IMPL__(AVS_LOG_TRACE, __VA_ARGS__)
 #define AVS_LOG__DEBUG(...)   AVS_LOG_IMPL__(AVS_LOG_DEBUG, __VA_ARGS__)
 #define AVS_LOG__INFO(...)    AVS_LOG_IMPL__(AVS_LOG_INFO, __VA_ARGS__)
@@ -178,6 +471,8 @@ void avs_log_internal_l__(avs_log_level_t level,
 #undef AVS_LOG__LAZY_TRACE
 #define AVS_LOG__LAZY_TRACE(...) \
         ((void) sizeof(AVS_LOG_LAZY_IMPL__(AVS_LOG_TRACE, __VA_ARGS__), 0))
+#undef AVS_LOG_LIMITED__TRACE
+#define AVS_LOG_LIMITED__TRACE(...) AVS_LOG_LIMITED_DISABLED__(__VA_ARGS__)
 #endif
 
 /* disable compiling-in DEBUG messages */
@@ -188,6 +483,8 @@ void avs_log_internal_l__(avs_log_level_t level,
 #undef AVS_LOG__LAZY_DEBUG
 #define AVS_LOG__LAZY_DEBUG(...) \
         ((void) sizeof(AVS_LOG_LAZY_IMPL__(AVS_LOG_DEBUG, __VA_ARGS__), 0))
+#undef AVS_LOG_LIMITED__DEBUG
+#define AVS_LOG_LIMITED__DEBUG(...) AVS_LOG_LIMITED_DISABLED__(__VA_ARGS__)
 #endif
 
 int avs_log_set_level__(const char *module, avs_log_level_t level);
@@ -207,6 +504,14 @@ int avs_log_set_level__(const char *module, avs_log_level_t level);
  *               <c>LAZY_INFO</c>) - in that case the log message arguments will
  *               not be evaluated if the current log level is lower than the
  *               currently set for the specified module.
+ *
+ * NOTE: When compiled with GCC or Clang, each call site declares a static
+ * object that caches the module's log level. Such objects are not allowed in
+ * inline functions with external linkage (C99 6.7.4p3), so translation units
+ * that log from such functions MUST define <c>AVS_LOG_NO_LEVEL_CACHE</c> before
+ * including this header. This disables the cache for the whole translation
+ * unit. @ref AVS_LOG_RATELIMITED and @ref AVS_LOG_SAMPLED always keep static
+ * state and cannot be used in such functions at all.
  */
 #define avs_log(Module, Level, ...) \
         AVS_LOG__##Level(l, AVS_QUOTE_MACRO(Module), __VA_ARGS__)
@@ -263,6 +568,72 @@ int avs_log_set_level__(const char *module, avs_log_level_t level);
 #define avs_log_lazy_v(Module, Level, ...) \
         avs_log_v(Module, LAZY_##Level, __VA_ARGS__)
 
+/**
+ * Works like @ref avs_log, but limits the rate of messages logged from this
+ * particular call site using a token bucket: at most @p Burst messages may be
+ * logged at once, and the bucket is refilled at the rate of @p Burst messages
+ * per @p PeriodMs milliseconds. Messages over the limit are dropped.
+ *
+ * Before the next message that is logged after some have been dropped, a
+ * "N similar messages suppressed" line is logged with the same level, module
+ * and source location.
+ *
+ * Message arguments are not evaluated unless the message is logged. The macro
+ * may only be used as a statement.
+ *
+ * NOTE: If avs_commons is built without C11 atomics support, the rate limit
+ * state is not protected against concurrent access, and rate-limited messages
+ * shall not be logged from the same call site in multiple threads at once.
+ *
+ * NOTE: This macro is only available if avs_commons is built with the avs_utils
+ * module, as it uses @ref avs_time_monotonic_now.
+ *
+ * @param Module   Name of the module that generates the message, given as a
+ *                 raw token.
+ *
+ * @param Level    Log level, specified as a name of @ref avs_log_level_t
+ *                 (other than <c>QUIET</c>) with the leading <c>AVS_LOG_</c>
+ *                 omitted.
+ *
+ * @param Burst    Maximum number of messages logged at once.
+ *
+ * @param PeriodMs Time, in milliseconds, after which an empty bucket is filled
+ *                 up again.
+ */
+#ifdef AVS_COMMONS_WITH_AVS_UTILS
+#define AVS_LOG_RATELIMITED(Module, Level, Burst, PeriodMs, ...) \
+        AVS_LOG_LIMITED__##Level(AVS_QUOTE_MACRO(Module), \
+                                 avs_log_ratelimit_t__, \
+                                 avs_log_ratelimit__(&avs_log_limit__, \
+                                                     (Burst), (PeriodMs), \
+                                                     AVS_LOG_##Level, \
+                                                     AVS_QUOTE_MACRO(Module), \
+                                                     __FILE__, __LINE__), \
+                                 __VA_ARGS__)
+#endif // AVS_COMMONS_WITH_AVS_UTILS
+
+/**
+ * Works like @ref avs_log, but only logs every @p Every -th message passed to
+ * this particular call site, starting with the first one.
+ *
+ * Message arguments are not evaluated unless the message is logged. The macro
+ * may only be used as a statement. The same note as for
+ * @ref AVS_LOG_RATELIMITED applies to builds without C11 atomics.
+ *
+ * @param Module Name of the module that generates the message, given as a raw
+ *               token.
+ *
+ * @param Level  Log level, specified as a name of @ref avs_log_level_t (other
+ *               than <c>QUIET</c>) with the leading <c>AVS_LOG_</c> omitted.
+ *
+ * @param Every  Sampling interval; 0 and 1 mean that all messages are logged.
+ */
+#define AVS_LOG_SAMPLED(Module, Level, Every, ...) \
+        AVS_LOG_LIMITED__##Level(AVS_QUOTE_MACRO(Module), \
+                                 avs_log_sample_t__, \
+                                 avs_log_sample__(&avs_log_limit__, (Every)), \
+                                 __VA_ARGS__)
+
 /**
  * Sets the logging level for a given module. Messages with lower level than the
  * one set will not be passed to the log writer.
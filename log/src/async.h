@@ -0,0 +1,55 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_LOG_ASYNC_H
+#define AVS_COMMONS_LOG_ASYNC_H
+
+#include <avsystem/commons/log.h>
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+#define _AVS_LOG_MAX_LINE_LENGTH 512
+
+/**
+ * Passes a formatted message to the currently set log handler.
+ */
+void _avs_log_call_handler(avs_log_level_t level,
+                           const char *module,
+                           const char *message);
+
+#ifdef WITH_AVS_LOG_ASYNC
+
+/**
+ * Pushes a formatted message into the asynchronous logging queue.
+ *
+ * @return 0 if the message has been queued, or discarded according to the
+ *         overflow policy; negative value if the asynchronous mode is not
+ *         enabled or the message is logged from the writer thread, in which
+ *         case the caller shall pass it to the log handler by itself.
+ */
+int _avs_log_async_push(avs_log_level_t level,
+                        const char *module,
+                        const char *message);
+
+#else // WITH_AVS_LOG_ASYNC
+
+#define _avs_log_async_push(Level, Module, Message) (-1)
+
+#endif // WITH_AVS_LOG_ASYNC
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* AVS_COMMONS_LOG_ASYNC_H */
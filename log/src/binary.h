@@ -0,0 +1,82 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_LOG_BINARY_H
+#define AVS_COMMONS_LOG_BINARY_H
+
+#include <stdarg.h>
+
+#include <avsystem/commons/log.h>
+
+#include "async.h"
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+/**
+ * Writes the "LEVEL [module] [file:line]: " message prefix into @p log_buf.
+ *
+ * @param log_buf      Buffer to write to.
+ *
+ * @param log_buf_left Pointer to the number of characters available in the
+ *                     buffer, not including the terminating nullbyte. It is
+ *                     decreased by the length of the prefix.
+ *
+ * @return Pointer to where the message body shall be written, or NULL in case
+ *         of an error.
+ */
+char *_avs_log_write_prefix(char *log_buf,
+                            size_t *log_buf_left,
+                            avs_log_level_t level,
+                            const char *module,
+                            const char *file,
+                            unsigned line);
+
+/**
+ * Passes a formatted message to the asynchronous logging queue, or directly to
+ * the log handler if the asynchronous mode is not enabled.
+ */
+void _avs_log_dispatch(avs_log_level_t level,
+                       const char *module,
+                       const char *message);
+
+#ifdef WITH_AVS_LOG_BINARY
+
+/**
+ * Stores the log message in the calling thread's binary log buffer, without
+ * formatting it. @p ap is not modified.
+ *
+ * @return 0 if the message has been recorded; negative value if the binary
+ *         mode is not enabled, the format string uses conversions that are not
+ *         supported in the binary mode, or the message is logged from within
+ *         the log handler while the buffer is being drained - in which case the
+ *         caller shall format the message by itself.
+ */
+int _avs_log_binary_record(avs_log_level_t level,
+                           const char *module,
+                           const char *file,
+                           unsigned line,
+                           const char *format,
+                           va_list ap);
+
+#else // WITH_AVS_LOG_BINARY
+
+#define _avs_log_binary_record(Level, Module, File, Line, Format, Ap) (-1)
+
+#endif // WITH_AVS_LOG_BINARY
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* AVS_COMMONS_LOG_BINARY_H */
@@ -15,16 +15,30 @@
  */
 #include <avs_commons_config.h>
 
+#include <limits.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-#include <avsystem/commons/list.h>
+#ifdef HAVE_C11_STDATOMIC
+#include <stdatomic.h>
+#endif // HAVE_C11_STDATOMIC
+
+#ifdef HAVE_SCHED_YIELD
+#include <sched.h>
+#endif // HAVE_SCHED_YIELD
+
 #include <avsystem/commons/log.h>
+#ifdef WITH_AVS_UTILS
+#include <avsystem/commons/time.h>
+#endif // WITH_AVS_UTILS
 
-VISIBILITY_SOURCE_BEGIN
+#include "async.h"
+#include "binary.h"
 
-#define MAX_LOG_LINE_LENGTH 512
+VISIBILITY_SOURCE_BEGIN
 
 static void default_log_handler(avs_log_level_t level,
                                 const char *module,
@@ -40,52 +54,283 @@ void avs_log_set_handler(avs_log_handler_t *log_handler) {
     HANDLER = log_handler;
 }
 
-static volatile avs_log_level_t DEFAULT_LEVEL = AVS_LOG_INFO;
+void _avs_log_call_handler(avs_log_level_t level,
+                           const char *module,
+                           const char *message) {
+    HANDLER(level, module, message);
+}
 
 typedef struct {
-    volatile avs_log_level_t level;
-    char module[1];
+    avs_log_level_t level;
+    const char *module;
 } module_level_t;
 
-static AVS_LIST(module_level_t) MODULE_LEVELS = NULL;
+/*
+ * Per-module levels are kept in an immutable array sorted by module name,
+ * allocated in a single block together with the names. Setting a level
+ * publishes a modified copy, so lookups never see a table in an inconsistent
+ * state and do not need to take any locks.
+ */
+typedef struct {
+    size_t size;
+    module_level_t entries[1];
+} module_level_table_t;
+
+#ifdef HAVE_C11_STDATOMIC
+
+/*
+ * A table that has been replaced is freed after a grace period, i.e. once all
+ * lookups that could have seen it are finished. Each lookup registers in one
+ * of two reader counters, selected by READERS_EPOCH. The writer flips the
+ * epoch and waits for the counter of the previous one to drop to zero twice,
+ * which covers lookups that read the epoch before the first flip but
+ * registered after it. Lookups that register after the writer has checked
+ * their counter are guaranteed to see the new table.
+ */
+static atomic_int DEFAULT_LEVEL = AVS_LOG_INFO;
+static atomic_uintptr_t MODULE_LEVELS;
+static atomic_uint READERS_EPOCH;
+static atomic_size_t READERS[2];
+static atomic_flag WRITER_LOCK = ATOMIC_FLAG_INIT;
+
+static unsigned read_lock(void) {
+    unsigned slot = atomic_load(&READERS_EPOCH) & 1u;
+    atomic_fetch_add(&READERS[slot], 1);
+    return slot;
+}
+
+static void read_unlock(unsigned slot) {
+    atomic_fetch_sub(&READERS[slot], 1);
+}
+
+static const module_level_table_t *current_levels(void) {
+    return (const module_level_table_t *) atomic_load(&MODULE_LEVELS);
+}
+
+#ifdef HAVE_SCHED_YIELD
+#define spin_pause() ((void) sched_yield())
+#else // HAVE_SCHED_YIELD
+#define spin_pause() ((void) 0)
+#endif // HAVE_SCHED_YIELD
+
+static void write_lock(void) {
+    /* level changes are rare, and the lock is never held for long */
+    while (atomic_flag_test_and_set(&WRITER_LOCK)) {
+        spin_pause();
+    }
+}
+
+static void write_unlock(void) {
+    atomic_flag_clear(&WRITER_LOCK);
+}
+
+/* MUST be called with the writer lock held */
+static void replace_levels(module_level_table_t *table) {
+    module_level_table_t *old = (module_level_table_t *) atomic_exchange(
+            &MODULE_LEVELS, (uintptr_t) table);
+    int i;
+    for (i = 0; i < 2; ++i) {
+        unsigned slot = atomic_fetch_add(&READERS_EPOCH, 1) & 1u;
+        while (atomic_load(&READERS[slot])) {
+            spin_pause();
+        }
+    }
+    free(old);
+}
+
+#else // HAVE_C11_STDATOMIC
+
+/* without C11 atomics, levels MUST NOT be changed concurrently with logging */
+static volatile avs_log_level_t DEFAULT_LEVEL = AVS_LOG_INFO;
+static module_level_table_t *volatile MODULE_LEVELS;
+
+#define read_lock() 0u
+#define read_unlock(Slot) ((void) (Slot))
+#define current_levels() ((const module_level_table_t *) MODULE_LEVELS)
+#define write_lock() ((void) 0)
+#define write_unlock() ((void) 0)
+
+static void replace_levels(module_level_table_t *table) {
+    module_level_table_t *old = MODULE_LEVELS;
+    MODULE_LEVELS = table;
+    free(old);
+}
+
+#endif // HAVE_C11_STDATOMIC
+
+#define MAX_LEVEL_GENERATION (UINT_MAX >> AVS_LOG_LEVEL_CACHE_BITS__)
+
+AVS_STATIC_ASSERT(AVS_LOG_QUIET < (1 << AVS_LOG_LEVEL_CACHE_BITS__),
+                  log_levels_fit_in_level_cache);
+
+static unsigned next_generation(unsigned generation) {
+    return generation < MAX_LEVEL_GENERATION ? generation + 1 : 1;
+}
+
+#ifdef HAVE_C11_STDATOMIC
+atomic_uint avs_log_level_generation__ = 1;
+
+#define load_generation() \
+        atomic_load_explicit(&avs_log_level_generation__, memory_order_acquire)
+#define store_level_cache(Cache, Value) \
+        atomic_store_explicit((Cache), (Value), memory_order_relaxed)
+
+/*
+ * MUST be called after the level change is stored, so that a concurrent
+ * lookup that misses the change caches its result with a stale generation.
+ */
+static void invalidate_level_caches(void) {
+    unsigned generation = atomic_load_explicit(&avs_log_level_generation__,
+                                               memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(
+            &avs_log_level_generation__, &generation,
+            next_generation(generation), memory_order_release,
+            memory_order_relaxed)) {
+    }
+}
+#else // HAVE_C11_STDATOMIC
+volatile unsigned avs_log_level_generation__ = 1;
+
+#define load_generation() avs_log_level_generation__
+#define store_level_cache(Cache, Value) ((void) (*(Cache) = (Value)))
+
+static void invalidate_level_caches(void) {
+    avs_log_level_generation__ = next_generation(avs_log_level_generation__);
+}
+#endif // HAVE_C11_STDATOMIC
 
 void avs_log_reset(void) {
-    AVS_LIST_CLEAR(&MODULE_LEVELS);
+    avs_log_binary_stop();
+    avs_log_async_stop();
+    write_lock();
+    replace_levels(NULL);
+    write_unlock();
     avs_log_set_handler(default_log_handler);
     avs_log_set_default_level(AVS_LOG_INFO);
 }
 
-static volatile avs_log_level_t *level_for(const char *module, int create) {
+/*
+ * Returns the index of the entry for the module, or the index at which it
+ * would need to be inserted if there is none; *out_found is set accordingly.
+ */
+static size_t find_level(const module_level_table_t *table,
+                         const char *module,
+                         int *out_found) {
+    size_t low = 0;
+    size_t high = table ? table->size : 0;
+    *out_found = 0;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int cmp = strcmp(table->entries[mid].module, module);
+        if (cmp == 0) {
+            *out_found = 1;
+            return mid;
+        } else if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static avs_log_level_t level_for(const char *module) {
+    avs_log_level_t level = (avs_log_level_t) DEFAULT_LEVEL;
     if (module) {
-        AVS_LIST(module_level_t) *entry_ptr;
-        int cmp = 1;
-        AVS_LIST_FOREACH_PTR(entry_ptr, &MODULE_LEVELS) {
-            cmp = strcmp((*entry_ptr)->module, module);
-            if (cmp >= 0) {
-                break;
-            }
+        unsigned slot = read_lock();
+        const module_level_table_t *table = current_levels();
+        int found;
+        size_t index = find_level(table, module, &found);
+        if (found) {
+            level = table->entries[index].level;
         }
-        if (cmp == 0) {
-            return &(*entry_ptr)->level;
-        } else if (create) {
-            size_t module_size = strlen(module);
-            module_level_t *new_entry = (module_level_t*)
-                    AVS_LIST_NEW_BUFFER(offsetof(module_level_t, module) + module_size + 1);
-            if (!new_entry) {
-                return NULL;
+        read_unlock(slot);
+    }
+    return level;
+}
+
+/*
+ * Creates a copy of the table with the level for the module set, or inserted
+ * at the given index if the module is not present in the table.
+ */
+static module_level_table_t *
+copy_levels_with(const module_level_table_t *table,
+                 size_t index,
+                 int found,
+                 const char *module,
+                 avs_log_level_t level) {
+    size_t old_size = table ? table->size : 0;
+    size_t new_size = found ? old_size : old_size + 1;
+    size_t names_size = 0;
+    module_level_table_t *result;
+    char *names;
+    size_t i;
+
+    for (i = 0; i < old_size; ++i) {
+        names_size += strlen(table->entries[i].module) + 1;
+    }
+    if (!found) {
+        names_size += strlen(module) + 1;
+    }
+    result = (module_level_table_t *) malloc(
+            offsetof(module_level_table_t, entries)
+            + new_size * sizeof(module_level_t) + names_size);
+    if (!result) {
+        return NULL;
+    }
+    result->size = new_size;
+    names = (char *) &result->entries[new_size];
+    for (i = 0; i < new_size; ++i) {
+        const module_level_t *source;
+        size_t name_size;
+        if (i == index && !found) {
+            result->entries[i].level = level;
+            result->entries[i].module = module;
+        } else {
+            source = &table->entries[i > index && !found ? i - 1 : i];
+            result->entries[i] = *source;
+            if (i == index) {
+                result->entries[i].level = level;
             }
-            new_entry->level = DEFAULT_LEVEL;
-            memcpy(new_entry->module, module, module_size);
-            new_entry->module[module_size] = '\0';
-            AVS_LIST_INSERT(entry_ptr, new_entry);
-            return &new_entry->level;
         }
+        name_size = strlen(result->entries[i].module) + 1;
+        memcpy(names, result->entries[i].module, name_size);
+        result->entries[i].module = names;
+        names += name_size;
+    }
+    return result;
+}
+
+static int set_module_level(const char *module, avs_log_level_t level) {
+    const module_level_table_t *table;
+    module_level_table_t *new_table;
+    size_t index;
+    int found;
+
+    write_lock();
+    table = current_levels();
+    index = find_level(table, module, &found);
+    new_table = copy_levels_with(table, index, found, module, level);
+    if (new_table) {
+        replace_levels(new_table);
     }
-    return &DEFAULT_LEVEL;
+    write_unlock();
+    return new_table ? 0 : -1;
 }
 
 int avs_log_should_log__(avs_log_level_t level, const char *module) {
-    return level >= AVS_LOG_QUIET || level >= *level_for(module, 0);
+    return level >= AVS_LOG_QUIET || level >= level_for(module);
+}
+
+int avs_log_should_log_refresh__(avs_log_level_t level,
+                                 const char *module,
+                                 avs_log_level_cache_t__ *cache) {
+    /* the generation needs to be read before the level */
+    unsigned generation = load_generation();
+    avs_log_level_t module_level = level_for(module);
+    store_level_cache(cache, (generation << AVS_LOG_LEVEL_CACHE_BITS__)
+                                     | (unsigned) module_level);
+    return level >= AVS_LOG_QUIET || level >= module_level;
 }
 
 static const char *level_as_string(avs_log_level_t level) {
@@ -105,27 +350,53 @@ static const char *level_as_string(avs_log_level_t level) {
     }
 }
 
+char *_avs_log_write_prefix(char *log_buf,
+                            size_t *log_buf_left,
+                            avs_log_level_t level,
+                            const char *module,
+                            const char *file,
+                            unsigned line) {
+    int pfresult = snprintf(log_buf, *log_buf_left, "%s [%s] [%s:%u]: ",
+                            level_as_string(level), module, file, line);
+    if (pfresult < 0) {
+        // it's hard to imagine why snprintf() above might fail,
+        // but well, let's be compliant and check it
+        return NULL;
+    }
+    if ((size_t) pfresult > *log_buf_left) {
+        pfresult = (int) *log_buf_left;
+    }
+    *log_buf_left -= (size_t) pfresult;
+    return log_buf + pfresult;
+}
+
+void _avs_log_dispatch(avs_log_level_t level,
+                       const char *module,
+                       const char *message) {
+    if (_avs_log_async_push(level, module, message)) {
+        HANDLER(level, module, message);
+    }
+}
+
 void avs_log_internal_forced_v__(avs_log_level_t level,
                                  const char *module,
                                  const char *file,
                                  unsigned line,
                                  const char *msg,
                                  va_list ap) {
-    char log_buf[MAX_LOG_LINE_LENGTH];
-    char *log_buf_ptr = log_buf;
+    char log_buf[_AVS_LOG_MAX_LINE_LENGTH];
+    char *log_buf_ptr;
     size_t log_buf_left = sizeof(log_buf) - 1;
-    int pfresult = snprintf(log_buf_ptr, log_buf_left, "%s [%s] [%s:%u]: ",
-                            level_as_string(level), module, file, line);
-    if (pfresult < 0) {
-        // it's hard to imagine why snprintf() above might fail,
-        // but well, let's be compliant and check it
+    int pfresult;
+
+    if (!_avs_log_binary_record(level, module, file, line, msg, ap)) {
         return;
     }
-    if ((size_t) pfresult > log_buf_left) {
-        pfresult = (int) log_buf_left;
+    log_buf_ptr = _avs_log_write_prefix(log_buf, &log_buf_left,
+                                        level, module, file, line);
+    if (!log_buf_ptr) {
+        return;
     }
-    log_buf_ptr += pfresult;
-    log_buf_left -= (size_t) pfresult;
     if (log_buf_left) {
         pfresult = vsnprintf(log_buf_ptr, log_buf_left, msg, ap);
         if (pfresult < 0) {
@@ -138,7 +409,7 @@ void avs_log_internal_forced_v__(avs_log_level_t level,
         log_buf_ptr += pfresult;
     }
     *log_buf_ptr = '\0';
-    HANDLER(level, module, log_buf);
+    _avs_log_dispatch(level, module, log_buf);
 }
 
 void avs_log_internal_v__(avs_log_level_t level,
@@ -152,6 +423,15 @@ void avs_log_internal_v__(avs_log_level_t level,
     }
 }
 
+void avs_log_discard_l__(const char *msg, ...) {
+    (void) msg;
+}
+
+void avs_log_discard_v__(const char *msg, va_list ap) {
+    (void) msg;
+    (void) ap;
+}
+
 void avs_log_internal_forced_l__(avs_log_level_t level,
                                  const char *module,
                                  const char *file,
@@ -176,9 +456,107 @@ void avs_log_internal_l__(avs_log_level_t level,
     }
 }
 
+#ifdef HAVE_C11_STDATOMIC
+#define sample_count_next(Limit) \
+        atomic_fetch_add_explicit(&(Limit)->count, 1, memory_order_relaxed)
+#else // HAVE_C11_STDATOMIC
+#define sample_count_next(Limit) ((Limit)->count++)
+#endif // HAVE_C11_STDATOMIC
+
+int avs_log_sample__(avs_log_sample_t__ *limit, unsigned every) {
+    unsigned long count = sample_count_next(limit);
+    return every <= 1 || count % every == 0;
+}
+
+#ifdef WITH_AVS_UTILS
+#ifdef HAVE_C11_STDATOMIC
+static void ratelimit_lock(avs_log_ratelimit_t__ *limit) {
+    unsigned expected = 0;
+    /* only held for a few instructions */
+    while (!atomic_compare_exchange_weak_explicit(&limit->lock, &expected, 1,
+                                                  memory_order_acquire,
+                                                  memory_order_relaxed)) {
+        expected = 0;
+        spin_pause();
+    }
+}
+
+static void ratelimit_unlock(avs_log_ratelimit_t__ *limit) {
+    atomic_store_explicit(&limit->lock, 0, memory_order_release);
+}
+#else // HAVE_C11_STDATOMIC
+#define ratelimit_lock(Limit) ((void) (Limit))
+#define ratelimit_unlock(Limit) ((void) (Limit))
+#endif // HAVE_C11_STDATOMIC
+
+/*
+ * Refills the bucket with as many whole tokens as have accumulated since the
+ * last refill, then takes one if available. The bucket of a call site that has
+ * not logged anything yet is full.
+ */
+static int take_token(avs_log_ratelimit_t__ *limit,
+                      unsigned burst,
+                      unsigned period_ms,
+                      int64_t now_ms) {
+    int64_t elapsed_ms = now_ms - limit->last_refill_ms;
+    if (!limit->last_refill_ms || elapsed_ms >= (int64_t) period_ms) {
+        limit->tokens = burst;
+        limit->last_refill_ms = now_ms;
+    } else if (elapsed_ms > 0) {
+        /* elapsed_ms < period_ms, so this is less than burst */
+        unsigned added = (unsigned) (elapsed_ms * burst / period_ms);
+        if (added) {
+            limit->tokens = limit->tokens + added < burst
+                                    ? limit->tokens + added
+                                    : burst;
+            limit->last_refill_ms += (int64_t) added * period_ms / burst;
+        }
+    }
+    if (!limit->tokens) {
+        return 0;
+    }
+    --limit->tokens;
+    return 1;
+}
+
+int avs_log_ratelimit__(avs_log_ratelimit_t__ *limit,
+                        unsigned burst,
+                        unsigned period_ms,
+                        avs_log_level_t level,
+                        const char *module,
+                        const char *file,
+                        unsigned line) {
+    int64_t now_ms;
+    unsigned long suppressed = 0;
+    int result;
+
+    if (avs_time_monotonic_to_scalar(&now_ms, AVS_TIME_MS,
+                                     avs_time_monotonic_now())) {
+        /* better to flood the log than to lose messages for good */
+        return 1;
+    }
+    ratelimit_lock(limit);
+    result = take_token(limit, burst, period_ms, now_ms);
+    if (result) {
+        suppressed = limit->suppressed;
+        limit->suppressed = 0;
+    } else {
+        ++limit->suppressed;
+    }
+    ratelimit_unlock(limit);
+    if (suppressed) {
+        avs_log_internal_forced_l__(level, module, file, line,
+                                    "%lu similar messages suppressed",
+                                    suppressed);
+    }
+    return result;
+}
+#endif // WITH_AVS_UTILS
+
 int avs_log_set_level__(const char *module, avs_log_level_t level) {
-    volatile avs_log_level_t *level_ptr = level_for(module, 1);
-    if (!level_ptr) {
+    if (!module) {
+        DEFAULT_LEVEL = level;
+    } else if (set_module_level(module, level)) {
         if (AVS_LOG_ERROR >= DEFAULT_LEVEL) {
             avs_log_internal_forced_l__(
                     AVS_LOG_ERROR, "avs_log", __FILE__, __LINE__,
@@ -186,10 +564,55 @@ int avs_log_set_level__(const char *module, avs_log_level_t level) {
         }
         return -1;
     }
-    *level_ptr = level;
+    invalidate_level_caches();
     return 0;
 }
 
+#ifndef WITH_AVS_LOG_ASYNC
+int avs_log_async_start(size_t queue_length, avs_log_async_policy_t policy) {
+    (void) queue_length;
+    (void) policy;
+    return -1;
+}
+
+void avs_log_async_flush(void) {
+}
+
+void avs_log_async_stop(void) {
+}
+
+uint64_t avs_log_async_dropped(void) {
+    return 0;
+}
+#endif // WITH_AVS_LOG_ASYNC
+
+#ifndef WITH_AVS_LOG_BINARY
+int avs_log_binary_start(size_t buffer_size) {
+    (void) buffer_size;
+    return -1;
+}
+
+void avs_log_binary_flush(void) {
+}
+
+void avs_log_binary_stop(void) {
+}
+
+int64_t avs_log_binary_timestamp_ns(void) {
+    return -1;
+}
+#endif // WITH_AVS_LOG_BINARY
+
 #ifdef AVS_UNIT_TESTING
 #include "test/test_log.c"
+#include "test/test_ratelimit.c"
+#ifdef HAVE_C11_STDATOMIC
+#include "test/test_levels.c"
+#endif // HAVE_C11_STDATOMIC
+#ifdef WITH_AVS_LOG_ASYNC
+#include "test/test_async.c"
+#endif // WITH_AVS_LOG_ASYNC
+#ifdef WITH_AVS_LOG_BINARY
+#include "test/test_binary.c"
+#endif // WITH_AVS_LOG_BINARY
 #endif
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <avsystem/commons/unit/test.h>
+#include <avsystem/commons/log.h>
+
+#define ASYNC_THREADS 4
+#define ASYNC_MESSAGES_PER_THREAD 1000
+#define ASYNC_MAX_RECORDS (ASYNC_THREADS * ASYNC_MESSAGES_PER_THREAD)
+
+/*
+ * The handler is called from the writer thread, so it only collects the
+ * messages; they are checked in the test thread afterwards.
+ */
+typedef struct {
+    pthread_t thread;
+    int producer;
+    int index;
+} async_collected_t;
+
+static async_collected_t COLLECTED[ASYNC_MAX_RECORDS];
+static atomic_size_t COLLECTED_COUNT;
+static atomic_int HANDLER_ENTERED;
+static atomic_int HANDLER_GATE_OPEN;
+static atomic_int RECURSION_DEPTH;
+
+static void collecting_handler(avs_log_level_t level,
+                               const char *module,
+                               const char *message) {
+    size_t i = atomic_load(&COLLECTED_COUNT);
+    const char *text = strstr(message, "]: ");
+    (void) level;
+    (void) module;
+
+    atomic_store(&HANDLER_ENTERED, 1);
+    while (!atomic_load(&HANDLER_GATE_OPEN)) {
+        sched_yield();
+    }
+    if (i < ASYNC_MAX_RECORDS) {
+        COLLECTED[i].thread = pthread_self();
+        if (!text || sscanf(text, "]: %d %d", &COLLECTED[i].producer,
+                            &COLLECTED[i].index) != 2) {
+            COLLECTED[i].producer = -1;
+            COLLECTED[i].index = -1;
+        }
+    }
+    atomic_store(&COLLECTED_COUNT, i + 1);
+}
+
+static void recursive_handler(avs_log_level_t level,
+                              const char *module,
+                              const char *message) {
+    if (atomic_fetch_add(&RECURSION_DEPTH, 1) == 0) {
+        avs_log(async_test, INFO, "%d %d", -2, -2);
+    }
+    atomic_fetch_sub(&RECURSION_DEPTH, 1);
+    collecting_handler(level, module, message);
+}
+
+static void async_setup(avs_log_handler_t *handler) {
+    reset_everything();
+    avs_log_set_handler(handler);
+    atomic_store(&COLLECTED_COUNT, 0);
+    atomic_store(&HANDLER_ENTERED, 0);
+    atomic_store(&HANDLER_GATE_OPEN, 1);
+    atomic_store(&RECURSION_DEPTH, 0);
+}
+
+static void *async_producer(void *producer_) {
+    int producer = *(const int *) producer_;
+    int i;
+    for (i = 0; i < ASYNC_MESSAGES_PER_THREAD; ++i) {
+        avs_log(async_test, INFO, "%d %d", producer, i);
+    }
+    return NULL;
+}
+
+AVS_UNIT_TEST(log_async, in_order_after_flush) {
+    int i;
+    async_setup(collecting_handler);
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_async_start(16, AVS_LOG_ASYNC_BLOCK));
+    AVS_UNIT_ASSERT_FAILED(avs_log_async_start(16, AVS_LOG_ASYNC_BLOCK));
+
+    for (i = 0; i < 100; ++i) {
+        avs_log(async_test, INFO, "%d %d", 0, i);
+    }
+    avs_log_async_flush();
+
+    AVS_UNIT_ASSERT_EQUAL(atomic_load(&COLLECTED_COUNT), 100);
+    for (i = 0; i < 100; ++i) {
+        AVS_UNIT_ASSERT_FALSE(pthread_equal(COLLECTED[i].thread,
+                                            pthread_self()));
+        AVS_UNIT_ASSERT_EQUAL(COLLECTED[i].producer, 0);
+        AVS_UNIT_ASSERT_EQUAL(COLLECTED[i].index, i);
+    }
+    AVS_UNIT_ASSERT_EQUAL(avs_log_async_dropped(), 0);
+
+    avs_log_async_stop();
+    /* messages are handled synchronously again */
+    avs_log(async_test, INFO, "%d %d", 0, 100);
+    AVS_UNIT_ASSERT_EQUAL(atomic_load(&COLLECTED_COUNT), 101);
+    AVS_UNIT_ASSERT_TRUE(pthread_equal(COLLECTED[100].thread, pthread_self()));
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log_async, multiple_producers_block) {
+    pthread_t threads[ASYNC_THREADS];
+    int producers[ASYNC_THREADS];
+    int next_index[ASYNC_THREADS] = { 0 };
+    size_t i;
+
+    async_setup(collecting_handler);
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_async_start(8, AVS_LOG_ASYNC_BLOCK));
+    for (i = 0; i < ASYNC_THREADS; ++i) {
+        producers[i] = (int) i;
+        AVS_UNIT_ASSERT_SUCCESS(pthread_create(&threads[i], NULL,
+                                               async_producer, &producers[i]));
+    }
+    for (i = 0; i < ASYNC_THREADS; ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(pthread_join(threads[i], NULL));
+    }
+    avs_log_async_flush();
+
+    AVS_UNIT_ASSERT_EQUAL(atomic_load(&COLLECTED_COUNT), ASYNC_MAX_RECORDS);
+    AVS_UNIT_ASSERT_EQUAL(avs_log_async_dropped(), 0);
+    /* messages from each producer are handled in order */
+    for (i = 0; i < ASYNC_MAX_RECORDS; ++i) {
+        int producer = COLLECTED[i].producer;
+        AVS_UNIT_ASSERT_TRUE(producer >= 0 && producer < ASYNC_THREADS);
+        AVS_UNIT_ASSERT_EQUAL(COLLECTED[i].index, next_index[producer]);
+        ++next_index[producer];
+    }
+
+    avs_log_async_stop();
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log_async, drop_when_full) {
+    int i;
+    async_setup(collecting_handler);
+    atomic_store(&HANDLER_GATE_OPEN, 0);
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_async_start(4, AVS_LOG_ASYNC_DROP));
+
+    /* the writer thread takes the first message and stalls in the handler */
+    avs_log(async_test, INFO, "%d %d", 0, 0);
+    while (!atomic_load(&HANDLER_ENTERED)) {
+        sched_yield();
+    }
+    /* the record being handled is not released yet, so 3 more fit */
+    for (i = 1; i < 11; ++i) {
+        avs_log(async_test, INFO, "%d %d", 0, i);
+    }
+    AVS_UNIT_ASSERT_EQUAL(avs_log_async_dropped(), 7);
+
+    atomic_store(&HANDLER_GATE_OPEN, 1);
+    avs_log_async_flush();
+    AVS_UNIT_ASSERT_EQUAL(atomic_load(&COLLECTED_COUNT), 4);
+    for (i = 0; i < 4; ++i) {
+        AVS_UNIT_ASSERT_EQUAL(COLLECTED[i].index, i);
+    }
+
+    avs_log_async_stop();
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log_async, stop_drains_queue) {
+    int i;
+    async_setup(collecting_handler);
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_async_start(64, AVS_LOG_ASYNC_BLOCK));
+    for (i = 0; i < 50; ++i) {
+        avs_log(async_test, INFO, "%d %d", 0, i);
+    }
+    avs_log_async_stop();
+    AVS_UNIT_ASSERT_EQUAL(atomic_load(&COLLECTED_COUNT), 50);
+
+    /* the queue can be started again */
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_async_start(64, AVS_LOG_ASYNC_BLOCK));
+    avs_log(async_test, INFO, "%d %d", 0, 50);
+    /* avs_log_reset() stops the asynchronous mode as well */
+    avs_log_reset();
+    AVS_UNIT_ASSERT_EQUAL(atomic_load(&COLLECTED_COUNT), 51);
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log_async, log_from_handler) {
+    async_setup(recursive_handler);
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_async_start(4, AVS_LOG_ASYNC_BLOCK));
+    avs_log(async_test, INFO, "%d %d", 0, 0);
+    avs_log_async_flush();
+
+    /* the nested message is handled synchronously by the writer thread */
+    AVS_UNIT_ASSERT_EQUAL(atomic_load(&COLLECTED_COUNT), 2);
+    AVS_UNIT_ASSERT_EQUAL(COLLECTED[0].index, -2);
+    AVS_UNIT_ASSERT_EQUAL(COLLECTED[1].index, 0);
+    AVS_UNIT_ASSERT_TRUE(pthread_equal(COLLECTED[0].thread,
+                                       COLLECTED[1].thread));
+
+    avs_log_async_stop();
+    reset_everything();
+}
@@ -0,0 +1,266 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <avsystem/commons/unit/test.h>
+#include <avsystem/commons/log.h>
+
+#define BINARY_MAX_RECORDS 64
+
+static char BINARY_MESSAGES[BINARY_MAX_RECORDS][512];
+static int64_t BINARY_TIMESTAMPS[BINARY_MAX_RECORDS];
+static size_t BINARY_COUNT;
+static int BINARY_LOG_FROM_HANDLER;
+
+static void binary_handler(avs_log_level_t level,
+                           const char *module,
+                           const char *message) {
+    const char *body = strstr(message, "]: ");
+    (void) level;
+    (void) module;
+    AVS_UNIT_ASSERT_NOT_NULL(body);
+    AVS_UNIT_ASSERT_TRUE(BINARY_COUNT < BINARY_MAX_RECORDS);
+    strcpy(BINARY_MESSAGES[BINARY_COUNT], body + 3);
+    BINARY_TIMESTAMPS[BINARY_COUNT] = avs_log_binary_timestamp_ns();
+    ++BINARY_COUNT;
+    if (BINARY_LOG_FROM_HANDLER) {
+        BINARY_LOG_FROM_HANDLER = 0;
+        avs_log(binary_test, INFO, "from handler");
+    }
+}
+
+static void binary_setup(size_t buffer_size) {
+    reset_everything();
+    avs_log_set_handler(binary_handler);
+    BINARY_COUNT = 0;
+    BINARY_LOG_FROM_HANDLER = 0;
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_binary_start(buffer_size));
+}
+
+AVS_UNIT_TEST(log_binary, deferred_formatting) {
+    char expected[512];
+    char not_terminated[4] = { 'a', 'b', 'c', 'd' };
+    int local;
+
+    binary_setup(4096);
+    avs_log(binary_test, INFO, "plain");
+    avs_log(binary_test, DEBUG, "not recorded");
+    avs_log(binary_test, ERROR,
+            "%d %i %u %5ld %-5lld| %hd %hhu %zu %jd %td %x %#o %c %%",
+            -1, 2, 3u, 4L, -5LL, (short) 6, (unsigned char) 7, (size_t) 8,
+            (intmax_t) -9, (ptrdiff_t) 10, 0xabu, 8u, 'z');
+    avs_log(binary_test, INFO, "%.3f %e %10.2g %Lf %*d %-*.*f|",
+            3.14159, 1e10, 0.5, (long double) 1.5, 4, 7, 8, 3, 2.0);
+    avs_log(binary_test, INFO, "%s %.*s %-6s| %.2s %p",
+            "str", 2, not_terminated, "ab", "xyz", (void *) &local);
+    AVS_UNIT_ASSERT_EQUAL(BINARY_COUNT, 0);
+
+    avs_log_binary_flush();
+    AVS_UNIT_ASSERT_EQUAL(BINARY_COUNT, 4);
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[0], "plain");
+    snprintf(expected, sizeof(expected),
+             "%d %i %u %5ld %-5lld| %hd %hhu %zu %jd %td %x %#o %c %%",
+             -1, 2, 3u, 4L, -5LL, (short) 6, (unsigned char) 7, (size_t) 8,
+             (intmax_t) -9, (ptrdiff_t) 10, 0xabu, 8u, 'z');
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[1], expected);
+    snprintf(expected, sizeof(expected), "%.3f %e %10.2g %Lf %*d %-*.*f|",
+             3.14159, 1e10, 0.5, (long double) 1.5, 4, 7, 8, 3, 2.0);
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[2], expected);
+    snprintf(expected, sizeof(expected), "%s %.*s %-6s| %.2s %p",
+             "str", 2, not_terminated, "ab", "xyz", (void *) &local);
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[3], expected);
+
+    /* timestamps are taken when logging, and visible in the handler */
+    AVS_UNIT_ASSERT_TRUE(BINARY_TIMESTAMPS[0] > 0);
+    AVS_UNIT_ASSERT_TRUE(BINARY_TIMESTAMPS[3] >= BINARY_TIMESTAMPS[0]);
+    AVS_UNIT_ASSERT_EQUAL(avs_log_binary_timestamp_ns(), -1);
+
+    reset_everything();
+}
+
+static void log_long_message(void) {
+    char message[600];
+    memset(message, 'x', sizeof(message) - 1);
+    message[sizeof(message) - 1] = '\0';
+    avs_log(binary_test, WARNING, "%s", message);
+}
+
+AVS_UNIT_TEST(log_binary, full_message) {
+    binary_setup(4096);
+    reset_expected();
+    avs_log_set_handler(mock_handler);
+    ASSERT_LOG(binary_test, WARNING, "WARNING [binary_test] [" __FILE__ ":%d]: Hello, world!", __LINE__ + 1);
+    avs_log(binary_test, WARNING, "Hello, %s!", "world");
+    avs_log_binary_flush();
+    ASSERT_LOG_CLEAN;
+
+    /* messages are truncated the same way as in the regular mode */
+    avs_log_set_handler(binary_handler);
+    log_long_message();
+    avs_log_binary_stop();
+    log_long_message();
+    AVS_UNIT_ASSERT_EQUAL(BINARY_COUNT, 2);
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[0], BINARY_MESSAGES[1]);
+    AVS_UNIT_ASSERT_TRUE(BINARY_TIMESTAMPS[0] > 0);
+    AVS_UNIT_ASSERT_EQUAL(BINARY_TIMESTAMPS[1], -1);
+
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log_binary, strings_are_copied) {
+    char buf[16];
+    binary_setup(4096);
+    strcpy(buf, "before");
+    avs_log(binary_test, INFO, "%s", buf);
+    strcpy(buf, "after");
+    avs_log_binary_flush();
+    AVS_UNIT_ASSERT_EQUAL(BINARY_COUNT, 1);
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[0], "before");
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log_binary, drained_when_full) {
+    char expected[32];
+    char long_string[300];
+    size_t i;
+    binary_setup(256);
+    for (i = 0; i < 32; ++i) {
+        avs_log(binary_test, INFO, "message %u", (unsigned) i);
+    }
+    AVS_UNIT_ASSERT_TRUE(BINARY_COUNT > 0);
+    AVS_UNIT_ASSERT_TRUE(BINARY_COUNT < 32);
+    avs_log_binary_stop();
+    AVS_UNIT_ASSERT_EQUAL(BINARY_COUNT, 32);
+    for (i = 0; i < 32; ++i) {
+        snprintf(expected, sizeof(expected), "message %u", (unsigned) i);
+        AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[i], expected);
+    }
+
+    /* records that do not fit in an empty buffer are logged immediately */
+    memset(long_string, 'y', sizeof(long_string) - 1);
+    long_string[sizeof(long_string) - 1] = '\0';
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_binary_start(256));
+    avs_log(binary_test, INFO, "%s", "short");
+    avs_log(binary_test, INFO, "%s", long_string);
+    AVS_UNIT_ASSERT_EQUAL(BINARY_COUNT, 34);
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[32], "short");
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[33], long_string);
+
+    AVS_UNIT_ASSERT_FAILED(avs_log_binary_start(255));
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log_binary, unsupported_conversions) {
+    binary_setup(4096);
+    avs_log(binary_test, INFO, "recorded");
+    avs_log(binary_test, INFO, "wide %lc", (wint_t) L'w');
+    /* previously recorded messages are handled first */
+    AVS_UNIT_ASSERT_EQUAL(BINARY_COUNT, 2);
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[0], "recorded");
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[1], "wide w");
+    AVS_UNIT_ASSERT_EQUAL(BINARY_TIMESTAMPS[1], -1);
+
+    /* too many arguments */
+    avs_log(binary_test, INFO, "%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d",
+            1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7);
+    AVS_UNIT_ASSERT_EQUAL(BINARY_COUNT, 3);
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[2], "12345678901234567");
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log_binary, log_from_handler) {
+    binary_setup(4096);
+    avs_log(binary_test, INFO, "first");
+    avs_log(binary_test, INFO, "second");
+    BINARY_LOG_FROM_HANDLER = 1;
+    avs_log_binary_flush();
+    AVS_UNIT_ASSERT_EQUAL(BINARY_COUNT, 3);
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[0], "first");
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[1], "from handler");
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[2], "second");
+    reset_everything();
+}
+
+static void *binary_thread(void *arg) {
+    (void) arg;
+    avs_log(binary_test, INFO, "from thread");
+    return NULL;
+}
+
+AVS_UNIT_TEST(log_binary, drained_on_thread_exit) {
+    pthread_t thread;
+    binary_setup(4096);
+    AVS_UNIT_ASSERT_SUCCESS(pthread_create(&thread, NULL, binary_thread, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(pthread_join(thread, NULL));
+    AVS_UNIT_ASSERT_EQUAL(BINARY_COUNT, 1);
+    AVS_UNIT_ASSERT_EQUAL_STRING(BINARY_MESSAGES[0], "from thread");
+    reset_everything();
+}
+
+static int EXIT_PIPE_FD = -1;
+
+static void exit_pipe_handler(avs_log_level_t level,
+                              const char *module,
+                              const char *message) {
+    const char *body = strstr(message, "]: ");
+    (void) level;
+    (void) module;
+    if (body && write(EXIT_PIPE_FD, body + 3, strlen(body + 3)) < 0) {
+        abort();
+    }
+}
+
+AVS_UNIT_TEST(log_binary, drained_on_exit) {
+    int fds[2];
+    char received[64];
+    ssize_t received_size;
+    int status;
+    pid_t pid;
+
+    reset_everything();
+    AVS_UNIT_ASSERT_SUCCESS(pipe(fds));
+    fflush(NULL);
+    pid = fork();
+    AVS_UNIT_ASSERT_TRUE(pid >= 0);
+    if (!pid) {
+        close(fds[0]);
+        EXIT_PIPE_FD = fds[1];
+        avs_log_set_handler(exit_pipe_handler);
+        if (avs_log_binary_start(4096)) {
+            _exit(1);
+        }
+        avs_log(binary_test, INFO, "before exit");
+        exit(0);
+    }
+    close(fds[1]);
+    received_size = read(fds[0], received, sizeof(received) - 1);
+    close(fds[0]);
+    AVS_UNIT_ASSERT_EQUAL(waitpid(pid, &status, 0), pid);
+    AVS_UNIT_ASSERT_TRUE(WIFEXITED(status));
+    AVS_UNIT_ASSERT_EQUAL(WEXITSTATUS(status), 0);
+    AVS_UNIT_ASSERT_TRUE(received_size > 0);
+    received[received_size] = '\0';
+    AVS_UNIT_ASSERT_EQUAL_STRING(received, "before exit");
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include <avsystem/commons/unit/test.h>
+#include <avsystem/commons/log.h>
+
+AVS_UNIT_TEST(log_levels, sorted_table) {
+    static const char *const MODULES[] = { "m", "c", "x", "a", "p", "c" };
+    const module_level_table_t *table;
+    size_t i;
+
+    reset_everything();
+    for (i = 0; i < sizeof(MODULES) / sizeof(MODULES[0]); ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(
+                avs_log_set_level__(MODULES[i], (avs_log_level_t) (i % 5)));
+    }
+    table = current_levels();
+    AVS_UNIT_ASSERT_EQUAL(table->size, 5);
+    for (i = 1; i < table->size; ++i) {
+        AVS_UNIT_ASSERT_TRUE(strcmp(table->entries[i - 1].module,
+                                    table->entries[i].module) < 0);
+    }
+    AVS_UNIT_ASSERT_EQUAL(level_for("a"), AVS_LOG_WARNING);
+    AVS_UNIT_ASSERT_EQUAL(level_for("c"), AVS_LOG_TRACE);
+    AVS_UNIT_ASSERT_EQUAL(level_for("m"), AVS_LOG_TRACE);
+    AVS_UNIT_ASSERT_EQUAL(level_for("p"), AVS_LOG_ERROR);
+    AVS_UNIT_ASSERT_EQUAL(level_for("x"), AVS_LOG_INFO);
+    AVS_UNIT_ASSERT_EQUAL(level_for("b"), AVS_LOG_INFO);
+    avs_log_set_default_level(AVS_LOG_DEBUG);
+    AVS_UNIT_ASSERT_EQUAL(level_for("b"), AVS_LOG_DEBUG);
+    AVS_UNIT_ASSERT_EQUAL(level_for("x"), AVS_LOG_INFO);
+
+    reset_everything();
+    AVS_UNIT_ASSERT_NULL(current_levels());
+}
+
+#define LEVELS_READERS 4
+#define LEVELS_MODULES 16
+#define LEVELS_ITERATIONS 2000
+
+static atomic_int LEVELS_STOP;
+
+static void levels_module_name(char *buf, size_t size, int index) {
+    snprintf(buf, size, "module_%d", index);
+}
+
+static void *levels_reader(void *invalid_) {
+    atomic_int *invalid = (atomic_int *) invalid_;
+    char name[32];
+    int i = 0;
+    while (!atomic_load(&LEVELS_STOP)) {
+        avs_log_level_t level;
+        levels_module_name(name, sizeof(name), i++ % LEVELS_MODULES);
+        level = level_for(name);
+        /* module levels are only ever set to either DEBUG or ERROR */
+        if (level != AVS_LOG_INFO && level != AVS_LOG_DEBUG
+                && level != AVS_LOG_ERROR) {
+            atomic_store(invalid, 1);
+        }
+    }
+    return NULL;
+}
+
+AVS_UNIT_TEST(log_levels, concurrent_changes) {
+    pthread_t readers[LEVELS_READERS];
+    atomic_int invalid;
+    char name[32];
+    int i;
+
+    reset_everything();
+    atomic_init(&invalid, 0);
+    atomic_store(&LEVELS_STOP, 0);
+    for (i = 0; i < LEVELS_READERS; ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(pthread_create(&readers[i], NULL,
+                                               levels_reader, &invalid));
+    }
+    for (i = 0; i < LEVELS_ITERATIONS; ++i) {
+        levels_module_name(name, sizeof(name), i % LEVELS_MODULES);
+        AVS_UNIT_ASSERT_SUCCESS(avs_log_set_level__(
+                name, i % 2 ? AVS_LOG_DEBUG : AVS_LOG_ERROR));
+        if (i % 500 == 499) {
+            /* also exercise removing all entries */
+            reset_everything();
+        }
+    }
+    atomic_store(&LEVELS_STOP, 1);
+    for (i = 0; i < LEVELS_READERS; ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(pthread_join(readers[i], NULL));
+    }
+    AVS_UNIT_ASSERT_FALSE(atomic_load(&invalid));
+    reset_everything();
+}
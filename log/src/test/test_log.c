@@ -59,7 +59,7 @@ AVS_UNIT_GLOBAL_INIT(verbose) {
     (void) verbose;
     AVS_UNIT_ASSERT_TRUE(HANDLER == default_log_handler);
     AVS_UNIT_ASSERT_EQUAL(DEFAULT_LEVEL, AVS_LOG_INFO);
-    AVS_UNIT_ASSERT_TRUE(MODULE_LEVELS == NULL);
+    AVS_UNIT_ASSERT_NULL(current_levels());
     reset_everything();
 }
 
@@ -196,3 +196,57 @@ AVS_UNIT_TEST(log, lazy_log) {
     ASSERT_LOG_CLEAN;
     reset_everything();
 }
+
+static int EVALUATED_ARGUMENTS;
+
+static int count_evaluation(void) {
+    return ++EVALUATED_ARGUMENTS;
+}
+
+enum { CACHED_CALL_SITE_LINE = __LINE__ + 2 };
+static void log_at_cached_call_site(void) {
+    avs_log(cached_module, DEBUG, "Testing DEBUG %d", count_evaluation());
+}
+
+AVS_UNIT_TEST(log, level_cache) {
+    unsigned generation = avs_log_level_generation__;
+
+    /* level is looked up and cached; arguments are evaluated anyway */
+    EVALUATED_ARGUMENTS = 0;
+    log_at_cached_call_site();
+    log_at_cached_call_site();
+    AVS_UNIT_ASSERT_EQUAL(EVALUATED_ARGUMENTS, 2);
+
+    /* changing any level invalidates the cache */
+    avs_log_set_level(cached_module, AVS_LOG_DEBUG);
+    AVS_UNIT_ASSERT_NOT_EQUAL(avs_log_level_generation__, generation);
+    ASSERT_LOG(cached_module, DEBUG,
+               "DEBUG [cached_module] [" __FILE__ ":%d]: Testing DEBUG 3",
+               CACHED_CALL_SITE_LINE);
+    log_at_cached_call_site();
+    ASSERT_LOG_CLEAN;
+
+    avs_log_set_default_level(AVS_LOG_ERROR);
+    ASSERT_LOG(cached_module, DEBUG,
+               "DEBUG [cached_module] [" __FILE__ ":%d]: Testing DEBUG 4",
+               CACHED_CALL_SITE_LINE);
+    log_at_cached_call_site();
+    ASSERT_LOG_CLEAN;
+
+    /* and so does a reset */
+    reset_everything();
+    log_at_cached_call_site();
+    ASSERT_LOG_CLEAN;
+
+    /* generation wraps around, skipping 0 */
+    avs_log_level_generation__ = MAX_LEVEL_GENERATION;
+    avs_log_set_level(cached_module, AVS_LOG_DEBUG);
+    AVS_UNIT_ASSERT_EQUAL(avs_log_level_generation__, 1);
+    ASSERT_LOG(cached_module, DEBUG,
+               "DEBUG [cached_module] [" __FILE__ ":%d]: Testing DEBUG 6",
+               CACHED_CALL_SITE_LINE);
+    log_at_cached_call_site();
+
+    ASSERT_LOG_CLEAN;
+    reset_everything();
+}
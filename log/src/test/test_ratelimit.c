@@ -0,0 +1,117 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <avsystem/commons/unit/test.h>
+#include <avsystem/commons/log.h>
+
+#ifdef WITH_AVS_UTILS
+AVS_UNIT_TEST(log_ratelimit, token_bucket) {
+    avs_log_ratelimit_t__ limit;
+    int i;
+    memset(&limit, 0, sizeof(limit));
+
+    /* the bucket is initially full */
+    for (i = 0; i < 3; ++i) {
+        AVS_UNIT_ASSERT_TRUE(take_token(&limit, 3, 1000, 5000));
+    }
+    AVS_UNIT_ASSERT_FALSE(take_token(&limit, 3, 1000, 5000));
+
+    /* one token per 333.(3) ms */
+    AVS_UNIT_ASSERT_FALSE(take_token(&limit, 3, 1000, 5333));
+    AVS_UNIT_ASSERT_TRUE(take_token(&limit, 3, 1000, 5334));
+    AVS_UNIT_ASSERT_FALSE(take_token(&limit, 3, 1000, 5334));
+    AVS_UNIT_ASSERT_TRUE(take_token(&limit, 3, 1000, 6000));
+    AVS_UNIT_ASSERT_TRUE(take_token(&limit, 3, 1000, 6000));
+    AVS_UNIT_ASSERT_FALSE(take_token(&limit, 3, 1000, 6000));
+
+    /* the bucket does not hold more than the burst size */
+    for (i = 0; i < 3; ++i) {
+        AVS_UNIT_ASSERT_TRUE(take_token(&limit, 3, 1000, 60000));
+    }
+    AVS_UNIT_ASSERT_FALSE(take_token(&limit, 3, 1000, 60000));
+}
+
+static void log_ratelimited(int i, int expect_logged) {
+    static const char FORMAT[] = "INFO [test] [" __FILE__ ":%d]: message %d";
+    if (expect_logged) {
+        ASSERT_LOG(test, INFO, FORMAT, __LINE__ + 2, i);
+    }
+    AVS_LOG_RATELIMITED(test, INFO, 2, 3600000, "message %d", i);
+}
+
+AVS_UNIT_TEST(log_ratelimit, ratelimited) {
+    int evaluated = 0;
+    int i;
+
+    reset_everything();
+    for (i = 0; i < 10; ++i) {
+        log_ratelimited(i, i < 2);
+    }
+    ASSERT_LOG_CLEAN;
+
+    /* arguments of disabled messages are not evaluated */
+    AVS_LOG_RATELIMITED(test, DEBUG, 2, 1000, "%d", ++evaluated);
+    AVS_UNIT_ASSERT_EQUAL(evaluated, 0);
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log_ratelimit, summary) {
+    avs_log_ratelimit_t__ limit;
+    int i;
+    memset(&limit, 0, sizeof(limit));
+
+    reset_everything();
+    AVS_UNIT_ASSERT_TRUE(avs_log_ratelimit__(&limit, 1, 1000, AVS_LOG_WARNING,
+                                             "test", "file.c", 42));
+    for (i = 0; i < 5; ++i) {
+        AVS_UNIT_ASSERT_FALSE(avs_log_ratelimit__(
+                &limit, 1, 1000, AVS_LOG_WARNING, "test", "file.c", 42));
+    }
+    AVS_UNIT_ASSERT_EQUAL(limit.suppressed, 5);
+
+    /* pretend that the period has passed */
+    limit.last_refill_ms -= 1000;
+    ASSERT_LOG(test, WARNING,
+               "WARNING [test] [file.c:42]: 5 similar messages suppressed");
+    AVS_UNIT_ASSERT_TRUE(avs_log_ratelimit__(&limit, 1, 1000, AVS_LOG_WARNING,
+                                             "test", "file.c", 42));
+    ASSERT_LOG_CLEAN;
+    AVS_UNIT_ASSERT_EQUAL(limit.suppressed, 0);
+    reset_everything();
+}
+
+#endif // WITH_AVS_UTILS
+
+AVS_UNIT_TEST(log_ratelimit, sampled) {
+    static const char FORMAT[] = "INFO [test] [" __FILE__ ":%d]: message %d";
+    int evaluated = 0;
+    int i;
+
+    reset_everything();
+    for (i = 0; i < 10; ++i) {
+        if (i % 4 == 0) {
+            ASSERT_LOG(test, INFO, FORMAT, __LINE__ + 3, i);
+        }
+        /* arguments of dropped messages are not evaluated */
+        AVS_LOG_SAMPLED(test, INFO, 4, "message %d", (++evaluated, i));
+        ASSERT_LOG_CLEAN;
+    }
+    AVS_UNIT_ASSERT_EQUAL(evaluated, 3);
+    reset_everything();
+}
@@ -253,6 +253,11 @@ static int connect_net(avs_net_abstract_socket_t *net_socket,
 static int send_net(avs_net_abstract_socket_t *net_socket,
                     const void* buffer,
                     size_t buffer_length);
+#ifdef HAVE_SENDMSG
+static int send_v_net(avs_net_abstract_socket_t *net_socket,
+                      const avs_iovec_t *iov,
+                      size_t iov_count);
+#endif // HAVE_SENDMSG
 static int send_to_net(avs_net_abstract_socket_t *socket,
                        const void *buffer,
                        size_t buffer_length,
@@ -322,7 +327,12 @@ static const avs_net_socket_v_table_t net_vtable = {
     local_port_net,
     get_opt_net,
     set_opt_net,
-    errno_net
+    errno_net,
+#ifdef HAVE_SENDMSG
+    send_v_net
+#else
+    NULL
+#endif // HAVE_SENDMSG
 };
 
 typedef struct {
@@ -1096,7 +1106,7 @@ static int send_net(avs_net_abstract_socket_t *net_socket_,
     do {
         ssize_t result;
         if (!wait_until_ready(net_socket->socket, NET_SEND_TIMEOUT, 0, 1, 1)) {
-            LOG(ERROR, "timeout (send)");
+            LOG_RATELIMITED(ERROR, 10, 1000, "timeout (send)");
             net_socket->error_code = ETIMEDOUT;
             return -1;
         }
@@ -1129,6 +1139,116 @@ static int send_net(avs_net_abstract_socket_t *net_socket_,
     }
 }
 
+#ifdef HAVE_SENDMSG
+
+/* number of iovec entries passed to a single sendmsg() call; datagrams
+ * scattered over more entries than that are gathered into a temporary buffer
+ * and sent with send() instead */
+#define NET_SEND_IOV_BATCH 16
+
+static size_t count_nonempty_blocks(const avs_iovec_t *iov, size_t iov_count) {
+    size_t result = 0;
+    size_t i;
+    for (i = 0; i < iov_count; ++i) {
+        if (iov[i].length) {
+            ++result;
+        }
+    }
+    return result;
+}
+
+static size_t fill_msg_iov(struct iovec *out_iov,
+                           const avs_iovec_t **inout_iov,
+                           size_t *inout_iov_count,
+                           size_t *inout_first_offset) {
+    size_t count = 0;
+    size_t offset = *inout_first_offset;
+    while (*inout_iov_count > 0 && count < NET_SEND_IOV_BATCH) {
+        if ((*inout_iov)->length > offset) {
+            out_iov[count].iov_base =
+                    (char *) (intptr_t) (*inout_iov)->base + offset;
+            out_iov[count].iov_len = (*inout_iov)->length - offset;
+            ++count;
+        }
+        offset = 0;
+        ++*inout_iov;
+        --*inout_iov_count;
+    }
+    *inout_first_offset = 0;
+    return count;
+}
+
+static int send_v_net(avs_net_abstract_socket_t *net_socket_,
+                      const avs_iovec_t *iov,
+                      size_t iov_count) {
+    avs_net_socket_t *net_socket = (avs_net_socket_t *) net_socket_;
+    size_t first_offset = 0;
+
+    if (net_socket->type != AVS_NET_TCP_SOCKET
+            && count_nonempty_blocks(iov, iov_count) > NET_SEND_IOV_BATCH) {
+        return _avs_net_socket_send_v_gathered(net_socket_, iov, iov_count);
+    }
+
+    /* send at least one datagram, even if zero-length - hence do..while */
+    do {
+        struct iovec msg_iov[NET_SEND_IOV_BATCH];
+        struct msghdr msg;
+        const avs_iovec_t *batch_iov = iov;
+        size_t batch_offset = first_offset;
+        size_t batch_length = 0;
+        size_t i;
+        ssize_t result;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = msg_iov;
+        msg.msg_iovlen = fill_msg_iov(msg_iov, &iov, &iov_count, &first_offset);
+        for (i = 0; i < (size_t) msg.msg_iovlen; ++i) {
+            batch_length += msg_iov[i].iov_len;
+        }
+
+        if (!wait_until_ready(net_socket->socket, NET_SEND_TIMEOUT, 0, 1, 1)) {
+            LOG_RATELIMITED(ERROR, 10, 1000, "timeout (send)");
+            net_socket->error_code = ETIMEDOUT;
+            return -1;
+        }
+        errno = 0;
+        result = sendmsg(net_socket->socket, &msg, MSG_NOSIGNAL);
+        if (result < 0) {
+            net_socket->error_code = errno;
+            LOG(ERROR, "%d:%s", (int) result, strerror(errno));
+            return -1;
+        } else if (batch_length != 0 && result == 0) {
+            LOG(ERROR, "sendmsg returned 0");
+            net_socket->error_code = EIO;
+            return -1;
+        } else if ((size_t) result < batch_length) {
+            if (net_socket->type != AVS_NET_TCP_SOCKET) {
+                LOG(ERROR, "sending fail (%lu/%lu)",
+                    (unsigned long) result, (unsigned long) batch_length);
+                net_socket->error_code = EIO;
+                return -1;
+            }
+            /* partial write on a stream socket - rewind to the first block
+             * that has not been sent completely */
+            size_t sent = (size_t) result + batch_offset;
+            iov_count += (size_t) (iov - batch_iov);
+            iov = batch_iov;
+            while (sent >= iov->length) {
+                sent -= iov->length;
+                ++iov;
+                --iov_count;
+            }
+            first_offset = sent;
+        }
+    } while (iov_count > 0);
+
+    /* SUCCESS */
+    net_socket->error_code = 0;
+    return 0;
+}
+
+#endif // HAVE_SENDMSG
+
 static int send_to_net(avs_net_abstract_socket_t *net_socket_,
                        const void *buffer,
                        size_t buffer_length,
@@ -619,6 +619,37 @@ int avs_net_socket_send(avs_net_abstract_socket_t *socket,
                         const void *buffer,
                         size_t buffer_length);
 
+/**
+ * Sends data gathered from multiple memory blocks to @p socket, as if they were
+ * concatenated into a single buffer and passed to @ref avs_net_socket_send.
+ *
+ * For sockets that support it natively (e.g. plain TCP and UDP sockets on
+ * POSIX systems, which use <c>sendmsg()</c>), the data is handed to the
+ * operating system in a single call, without copying. For other socket types,
+ * the data is first gathered into a temporary heap buffer.
+ *
+ * @li For TCP sockets: the call may block for an indeterminate amount of time,
+ *     until all passed data is successfully sent.
+ * @li For UDP sockets: all blocks together form a single datagram. If there
+ *     is too much data to fit into a single datagram, the function fails.
+ *     There is no limit on the number of blocks, but if there are more of
+ *     them than can be passed to the operating system at once, they are
+ *     gathered into a temporary heap buffer as well.
+ *
+ * @param socket    Socket object to send data to.
+ * @param iov       Array of memory blocks to send, in order.
+ * @param iov_count Number of elements in @p iov.
+ *
+ * @returns @li 0 if all the data was written,
+ *          @li a negative value in case of error, in which case @p socket
+ *              errno (see @ref avs_net_socket_errno) is set to an appropriate
+ *              value, unless the failure was caused by inability to allocate
+ *              the temporary buffer.
+ */
+int avs_net_socket_send_v(avs_net_abstract_socket_t *socket,
+                          const avs_iovec_t *iov,
+                          size_t iov_count);
+
 /**
  * Sends exactly @p buffer_length bytes from @p buffer to @p host / @p port,
  * using @p socket.
@@ -31,6 +31,9 @@ typedef int (*avs_net_socket_decorate_t)(avs_net_abstract_socket_t *socket,
 typedef int (*avs_net_socket_send_t)(avs_net_abstract_socket_t *socket,
                                      const void *buffer,
                                      size_t buffer_length);
+typedef int (*avs_net_socket_send_v_t)(avs_net_abstract_socket_t *socket,
+                                       const avs_iovec_t *iov,
+                                       size_t iov_count);
 typedef int (*avs_net_socket_send_to_t)(avs_net_abstract_socket_t *socket,
                                         const void *buffer,
                                         size_t buffer_length,
@@ -115,6 +118,9 @@ typedef struct {
     avs_net_socket_get_opt_t get_opt;
     avs_net_socket_set_opt_t set_opt;
     avs_net_socket_errno_t get_errno;
+    /* optional - if NULL, avs_net_socket_send_v() falls back to
+     * gathering the data into a temporary buffer and calling send */
+    avs_net_socket_send_v_t send_v;
 } avs_net_socket_v_table_t;
 
 #ifdef	__cplusplus
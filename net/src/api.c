@@ -18,6 +18,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
 
@@ -226,6 +227,49 @@ int avs_net_socket_send(avs_net_abstract_socket_t *socket,
     return socket->operations->send(socket, buffer, buffer_length);
 }
 
+int _avs_net_socket_send_v_gathered(avs_net_abstract_socket_t *socket,
+                                    const avs_iovec_t *iov,
+                                    size_t iov_count) {
+    size_t total_length = 0;
+    size_t i;
+    char *gathered;
+    int result;
+
+    for (i = 0; i < iov_count; ++i) {
+        if (total_length + iov[i].length < total_length) {
+            LOG(ERROR, "data to send too long");
+            return -1;
+        }
+        total_length += iov[i].length;
+    }
+    if (!(gathered = (char *) malloc(total_length ? total_length : 1))) {
+        LOG(ERROR, "out of memory");
+        return -1;
+    }
+    total_length = 0;
+    for (i = 0; i < iov_count; ++i) {
+        if (iov[i].length) {
+            memcpy(gathered + total_length, iov[i].base, iov[i].length);
+            total_length += iov[i].length;
+        }
+    }
+    result = avs_net_socket_send(socket, gathered, total_length);
+    free(gathered);
+    return result;
+}
+
+int avs_net_socket_send_v(avs_net_abstract_socket_t *socket,
+                          const avs_iovec_t *iov,
+                          size_t iov_count) {
+    if (socket->operations->send_v) {
+        return socket->operations->send_v(socket, iov, iov_count);
+    } else if (iov_count == 1) {
+        return avs_net_socket_send(socket, iov[0].base, iov[0].length);
+    } else {
+        return _avs_net_socket_send_v_gathered(socket, iov, iov_count);
+    }
+}
+
 int avs_net_socket_send_to(avs_net_abstract_socket_t *socket,
                            const void *buffer,
                            size_t buffer_length,
@@ -454,6 +498,26 @@ static int send_debug(avs_net_abstract_socket_t *debug_socket,
     return result;
 }
 
+static int send_v_debug(avs_net_abstract_socket_t *debug_socket,
+                        const avs_iovec_t *iov,
+                        size_t iov_count) {
+    int result = avs_net_socket_send_v(
+            ((avs_net_socket_debug_t *) debug_socket)->socket,
+            iov, iov_count);
+    if (result) {
+        fprintf(communication_log, "\n------SEND-FAILURE------\n");
+    } else {
+        size_t i;
+        fprintf(communication_log, "\n----------SEND----------\n");
+        for (i = 0; i < iov_count; ++i) {
+            fwrite(iov[i].base, 1, iov[i].length, communication_log);
+        }
+        fprintf(communication_log, "\n--------SEND-END--------\n");
+        fflush(communication_log);
+    }
+    return result;
+}
+
 static int send_to_debug(avs_net_abstract_socket_t *debug_socket,
                          const void *buffer,
                          size_t buffer_length,
@@ -714,7 +778,8 @@ static const avs_net_socket_v_table_t debug_vtable = {
     local_port_debug,
     get_opt_debug,
     set_opt_debug,
-    errno_debug
+    errno_debug,
+    send_v_debug
 };
 
 static int create_socket_debug(avs_net_abstract_socket_t **debug_socket,
@@ -769,4 +834,5 @@ int avs_net_socket_create(avs_net_abstract_socket_t **socket,
 
 #ifdef AVS_UNIT_TESTING
 #include "test/starttls.c"
+#include "test/send_v.c"
 #endif
@@ -63,6 +63,14 @@ int _avs_net_create_tcp_socket(avs_net_abstract_socket_t **socket,
 int _avs_net_create_udp_socket(avs_net_abstract_socket_t **socket,
                                const void *socket_configuration);
 
+/**
+ * Sends the blocks using a single @ref avs_net_socket_send call, after copying
+ * them into a temporary heap buffer.
+ */
+int _avs_net_socket_send_v_gathered(avs_net_abstract_socket_t *socket,
+                                    const avs_iovec_t *iov,
+                                    size_t iov_count);
+
 #ifdef WITH_SSL
 int _avs_net_create_ssl_socket(avs_net_abstract_socket_t **socket,
                                const void *socket_configuration);
@@ -504,7 +504,8 @@ static const avs_net_socket_v_table_t ssl_vtable = {
     local_port_ssl,
     get_opt_ssl,
     set_opt_ssl,
-    errno_ssl
+    errno_ssl,
+    NULL
 };
 
 static const avs_net_dtls_handshake_timeouts_t
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_config.h>
+
+#include <avsystem/commons/unit/mocksock.h>
+#include <avsystem/commons/unit/test.h>
+
+AVS_UNIT_TEST(send_v, gathered_fallback) {
+    static const avs_iovec_t iov[] = {
+        { "header", 6 },
+        { "", 0 },
+        { "body", 4 },
+        { "trailer", 7 }
+    };
+    avs_net_abstract_socket_t *socket = NULL;
+    avs_unit_mocksock_create(&socket);
+    avs_unit_mocksock_expect_connect(socket, "localhost", "1234");
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_connect(socket,
+                                                   "localhost", "1234"));
+
+    avs_unit_mocksock_expect_output(socket, "headerbodytrailer", 17);
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send_v(socket, iov,
+                                                  AVS_ARRAY_SIZE(iov)));
+    avs_unit_mocksock_expect_output(socket, "body", 4);
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send_v(socket, &iov[2], 1));
+    avs_unit_mocksock_assert_io_clean(socket);
+    avs_net_socket_cleanup(&socket);
+}
+
+AVS_UNIT_TEST(send_v, udp_single_datagram) {
+    static const avs_iovec_t iov[] = {
+        { "header", 6 },
+        { "body", 4 },
+        { "trailer", 7 }
+    };
+    avs_net_abstract_socket_t *receiver = NULL;
+    avs_net_abstract_socket_t *sender = NULL;
+    char port[16];
+    char buffer[64];
+    size_t received = 0;
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_create(&receiver,
+                                                  AVS_NET_UDP_SOCKET, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(receiver, "127.0.0.1", "0"));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_local_port(receiver, port,
+                                                          sizeof(port)));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_create(&sender,
+                                                  AVS_NET_UDP_SOCKET, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_connect(sender, "127.0.0.1", port));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send_v(sender, iov,
+                                                  AVS_ARRAY_SIZE(iov)));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_receive(receiver, &received,
+                                                   buffer, sizeof(buffer)));
+    AVS_UNIT_ASSERT_EQUAL(received, 17);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buffer, "headerbodytrailer", 17);
+
+    avs_net_socket_cleanup(&sender);
+    avs_net_socket_cleanup(&receiver);
+}
+
+AVS_UNIT_TEST(send_v, udp_many_blocks) {
+    static const char DATA[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    avs_iovec_t iov[sizeof(DATA) - 1];
+    avs_net_abstract_socket_t *receiver = NULL;
+    avs_net_abstract_socket_t *sender = NULL;
+    char port[16];
+    char buffer[64];
+    size_t received = 0;
+    size_t i;
+
+    for (i = 0; i < AVS_ARRAY_SIZE(iov); ++i) {
+        iov[i].base = &DATA[i];
+        iov[i].length = 1;
+    }
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_create(&receiver,
+                                                  AVS_NET_UDP_SOCKET, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(receiver, "127.0.0.1", "0"));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_local_port(receiver, port,
+                                                          sizeof(port)));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_create(&sender,
+                                                  AVS_NET_UDP_SOCKET, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_connect(sender, "127.0.0.1", port));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send_v(sender, iov,
+                                                  AVS_ARRAY_SIZE(iov)));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_receive(receiver, &received,
+                                                   buffer, sizeof(buffer)));
+    AVS_UNIT_ASSERT_EQUAL(received, sizeof(DATA) - 1);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buffer, DATA, sizeof(DATA) - 1);
+
+    avs_net_socket_cleanup(&sender);
+    avs_net_socket_cleanup(&receiver);
+}
@@ -51,6 +51,23 @@ extern "C" {
 typedef int avs_rbtree_element_comparator_t(const void *a,
                                             const void *b);
 
+/**
+ * Slab allocator for RB-tree nodes.
+ *
+ * A pool carves fixed-size nodes out of contiguous slabs, each holding a
+ * configurable number of nodes. Nodes released back to the pool are kept on
+ * a free list and reused by subsequent allocations; memory is returned to the
+ * system only when the pool itself is destroyed.
+ *
+ * A pool may be shared by multiple trees holding elements of the same type
+ * (see @ref AVS_RBTREE_POOL_NEW and @ref AVS_RBTREE_NEW_WITH_POOL). Every
+ * tree using a pool holds a reference to it, and the pool is destroyed when
+ * the last reference is released. Every element of a tree that uses a pool
+ * MUST be allocated from that pool, using @ref AVS_RBTREE_ELEM_NEW_IN or
+ * @ref AVS_RBTREE_ELEM_NEW_BUFFER_IN.
+ */
+typedef struct avs_rbtree_pool_struct avs_rbtree_pool_t;
+
 /** RB-tree type alias.  */
 #define AVS_RBTREE(type) type**
 /** Constant RB-tree type alias.  */
@@ -60,9 +77,24 @@ typedef int avs_rbtree_element_comparator_t(const void *a,
 
 /* Internal functions. Use macros defined above instead. */
 AVS_RBTREE(void) avs_rbtree_new__(avs_rbtree_element_comparator_t *cmp);
+AVS_RBTREE(void) avs_rbtree_new_with_pool__(avs_rbtree_element_comparator_t *cmp,
+                                            avs_rbtree_pool_t *pool,
+                                            size_t elem_size);
+avs_rbtree_pool_t *avs_rbtree_pool_new__(size_t elem_size,
+                                         size_t nodes_per_slab);
 void avs_rbtree_delete__(AVS_RBTREE(void) *tree);
 AVS_RBTREE(void) avs_rbtree_simple_clone__(AVS_RBTREE_CONST(void) tree,
                                            size_t elem_size);
+int avs_rbtree_build_from_array__(AVS_RBTREE(void) tree,
+                                  const void *values,
+                                  size_t count,
+                                  size_t elem_size);
+int avs_rbtree_build_from_list__(AVS_RBTREE(void) tree,
+                                 const void *list,
+                                 size_t next_offset,
+                                 size_t elem_size);
+void avs_rbtree_merge__(AVS_RBTREE(void) dst, AVS_RBTREE(void) src);
+AVS_RBTREE(void) avs_rbtree_split__(AVS_RBTREE(void) tree, const void *value);
 
 size_t avs_rbtree_size__(AVS_RBTREE_CONST(void) tree);
 AVS_RBTREE_ELEM(void) avs_rbtree_lower_bound__(AVS_RBTREE_CONST(void) tree,
@@ -78,8 +110,12 @@ AVS_RBTREE_ELEM(void) avs_rbtree_detach__(AVS_RBTREE(void) tree,
 
 AVS_RBTREE_ELEM(void) avs_rbtree_first__(AVS_RBTREE(void) tree);
 AVS_RBTREE_ELEM(void) avs_rbtree_last__(AVS_RBTREE(void) tree);
+AVS_RBTREE_ELEM(void) avs_rbtree_nth__(AVS_RBTREE_CONST(void) tree, size_t n);
+size_t avs_rbtree_rank__(AVS_RBTREE_CONST(void) tree, const void *elem);
 
 AVS_RBTREE_ELEM(void) avs_rbtree_elem_new_buffer__(size_t elem_size);
+AVS_RBTREE_ELEM(void) avs_rbtree_elem_new_in__(AVS_RBTREE(void) tree,
+                                               size_t elem_size);
 void avs_rbtree_elem_delete__(AVS_RBTREE_ELEM(void) *node);
 
 AVS_RBTREE_ELEM(void) avs_rbtree_elem_next__(AVS_RBTREE_ELEM(void) elem);
@@ -109,6 +145,63 @@ AVS_RBTREE_ELEM(void) avs_rbtree_cleanup_next__(AVS_RBTREE(void) tree);
  */
 #define AVS_RBTREE_NEW(type, cmp) ((AVS_RBTREE(type))avs_rbtree_new__(cmp))
 
+/**
+ * Creates a slab pool for RB-tree nodes holding values of given @p type.
+ *
+ * Complexity: O(m), where:
+ * - m - calloc() complexity.
+ *
+ * @param type           Type of elements stored in the tree nodes.
+ * @param nodes_per_slab Number of nodes carved from a single slab. If 0,
+ *                       slabs of approximately 4 KB are used.
+ *
+ * @returns Created pool on success, NULL in case of error.
+ */
+#define AVS_RBTREE_POOL_NEW(type, nodes_per_slab) \
+    avs_rbtree_pool_new__(sizeof(type), (nodes_per_slab))
+
+/**
+ * Releases the reference to a pool obtained from @ref AVS_RBTREE_POOL_NEW.
+ * The pool, along with all of its slabs, is destroyed once no trees using it
+ * remain.
+ *
+ * NOTE: all detached elements allocated from the pool MUST be freed before the
+ * last reference to it is released.
+ *
+ * Complexity: O(s * f), where:
+ * - s - number of slabs allocated by the pool,
+ * - f - free() complexity.
+ *
+ * @param pool_ptr Pointer to the pool to destroy. *pool_ptr is set to NULL.
+ */
+void avs_rbtree_pool_delete(avs_rbtree_pool_t **pool_ptr);
+
+/**
+ * Creates an RB-tree with elements of given @p type, whose nodes are
+ * allocated from a slab pool instead of individual calloc() calls.
+ *
+ * If @p pool is NULL, a private pool sized for @p type is created for the
+ * tree. @ref AVS_RBTREE_DELETE still visits every node, but only pushes it
+ * onto the pool's free list; the slabs are then released with one free() call
+ * each. Otherwise, the tree takes a reference to @p pool, sharing it with
+ * other trees.
+ *
+ * Elements to be inserted into such tree MUST be allocated with
+ * @ref AVS_RBTREE_ELEM_NEW_IN or @ref AVS_RBTREE_ELEM_NEW_BUFFER_IN.
+ *
+ * Complexity: O(m), where:
+ * - m - calloc() complexity.
+ *
+ * @param type Type of elements stored in the tree nodes.
+ * @param cmp  Pointer to a function that compares two elements.
+ *             See @ref avs_rbtree_element_comparator_t .
+ * @param pool Pool to allocate nodes from, or NULL to use a private one.
+ *
+ * @returns Created RB-tree object on success, NULL in case of error.
+ */
+#define AVS_RBTREE_NEW_WITH_POOL(type, cmp, pool) \
+    ((AVS_RBTREE(type))avs_rbtree_new_with_pool__((cmp), (pool), sizeof(type)))
+
 #ifdef __cplusplus
 template <typename T>
 static inline AVS_RBTREE_ELEM(T)
@@ -164,7 +257,8 @@ AVS_RBTREE_CALL_WITH_CONST_ELEM_CAST__(const Func &func,
  *
  * Complexity: O(n * f), where:
  * - n - number of nodes in @p tree,
- * - f - free() complexity.
+ * - f - free() complexity; O(1) for trees created with
+ *   @ref AVS_RBTREE_NEW_WITH_POOL, whose nodes are returned to the pool.
  *
  * Example usage:
  *
@@ -205,6 +299,12 @@ AVS_RBTREE_CALL_WITH_CONST_ELEM_CAST__(const Func &func,
  * - n - number of nodes in @p tree_ptr,
  * - f - free() complexity.
  *
+ * For trees created with @ref AVS_RBTREE_NEW_WITH_POOL, nodes are returned to
+ * the pool instead of being freed individually, and slabs of a private pool
+ * are released afterwards: O(n + s * f), where s is the number of slabs. The
+ * walk over all nodes is still performed, as the loop body may need to
+ * release resources owned by each element.
+ *
  * Example usage:
  *
  * @code
@@ -273,6 +373,109 @@ avs_rbtree_simple_clone_impl__(AVS_RBTREE_CONST(T) tree) {
                                   sizeof(**(tree))))
 #endif
 
+/**
+ * Fills an empty @p tree with copies of @p count values stored in @p array,
+ * building a balanced tree directly instead of inserting values one by one.
+ *
+ * Values in @p array MUST be sorted in strictly increasing order according to
+ * the comparator of @p tree; if they are not, the operation fails. Nodes are
+ * allocated as if with @ref AVS_RBTREE_ELEM_NEW_IN.
+ *
+ * Complexity: O(n * (m + c)), where:
+ * - n - @p count,
+ * - m - calloc() complexity,
+ * - c - complexity of tree element comparator.
+ *
+ * @param tree  Empty RB-tree object to fill.
+ * @param array Pointer to the first of the values to copy. Its type MUST match
+ *              the element type of @p tree.
+ * @param count Number of values in @p array.
+ *
+ * @returns 0 on success, or a negative value if @p tree is not empty, the
+ *          values are not sorted or memory could not be allocated. In case of
+ *          error, @p tree is left unchanged.
+ */
+#define AVS_RBTREE_BUILD_FROM_ARRAY(tree, array, count) \
+    (_AVS_RB_TYPECHECK(*(tree), (array)), \
+     avs_rbtree_build_from_array__((AVS_RBTREE(void)) (tree), (array), \
+                                   (count), sizeof(**(tree))))
+
+/**
+ * Fills an empty @p tree with copies of all elements of a sorted @p list,
+ * building a balanced tree directly instead of inserting values one by one.
+ *
+ * Works like @ref AVS_RBTREE_BUILD_FROM_ARRAY. Using this macro requires
+ * <c>avsystem/commons/list.h</c> to be included.
+ *
+ * Complexity: O(n * (m + c)), where:
+ * - n - number of elements in @p list,
+ * - m - calloc() complexity,
+ * - c - complexity of tree element comparator.
+ *
+ * @param tree Empty RB-tree object to fill.
+ * @param list AVS_LIST of elements of the same type as the ones of @p tree.
+ *
+ * @returns 0 on success, or a negative value if @p tree is not empty, the
+ *          list is not sorted or memory could not be allocated. In case of
+ *          error, @p tree is left unchanged.
+ */
+#define AVS_RBTREE_BUILD_FROM_LIST(tree, list) \
+    (_AVS_RB_TYPECHECK(*(tree), (list)), \
+     avs_rbtree_build_from_list__((AVS_RBTREE(void)) (tree), (list), \
+                                  AVS_LIST_SPACE_FOR_NEXT__, \
+                                  sizeof(**(tree))))
+
+/**
+ * Moves all elements of @p src into @p dst. Elements of @p src that have an
+ * equivalent element in @p dst are not moved and remain in @p src.
+ *
+ * Both trees are rebuilt from scratch; no memory is allocated or freed. Both
+ * trees MUST use the same pool (or no pool at all) - see
+ * @ref AVS_RBTREE_NEW_WITH_POOL.
+ *
+ * Complexity: O((n + k) * c), where:
+ * - n - number of elements in @p dst,
+ * - k - number of elements in @p src,
+ * - c - complexity of tree element comparator.
+ *
+ * @param dst RB-tree to move elements into.
+ * @param src RB-tree to move elements from.
+ */
+#define AVS_RBTREE_MERGE(dst, src) \
+    (_AVS_RB_TYPECHECK(*(dst), *(src)), \
+     avs_rbtree_merge__((AVS_RBTREE(void)) (dst), (AVS_RBTREE(void)) (src)))
+
+/**
+ * Splits @p tree in two. Elements not less than @p val_ptr are moved into a
+ * newly created tree, which uses the same comparator and pool as @p tree.
+ *
+ * Complexity: O(n * c + m), where:
+ * - n - number of elements in @p tree,
+ * - c - complexity of tree element comparator,
+ * - m - calloc() complexity.
+ *
+ * @param tree    RB-tree to split.
+ * @param val_ptr Pointer to a value to split at.
+ *
+ * @returns Created RB-tree holding the upper part of @p tree on success, NULL
+ *          in case of error - @p tree is left unchanged then.
+ */
+#ifdef __cplusplus
+template <typename T>
+static inline AVS_RBTREE(T)
+avs_rbtree_split_impl__(AVS_RBTREE(T) tree, const void *val_ptr) {
+    return (AVS_RBTREE(T)) avs_rbtree_split__((AVS_RBTREE(void)) tree,
+                                              val_ptr);
+}
+
+#define AVS_RBTREE_SPLIT(tree, val_ptr) \
+    (avs_rbtree_split_impl__((tree), (val_ptr)))
+#else
+#define AVS_RBTREE_SPLIT(tree, val_ptr) \
+    ((AVS_TYPEOF_PTR(*(tree)) *) \
+        avs_rbtree_split__((AVS_RBTREE(void)) (tree), (val_ptr)))
+#endif
+
 /**
  * Complexity: O(1).
  *
@@ -316,6 +519,13 @@ avs_rbtree_simple_clone_impl__(AVS_RBTREE_CONST(T) tree) {
  *
  * </pre>
  *
+ * If the library is compiled with WITH_AVS_RBTREE_COMPACT_NODES, the color is
+ * stored in the lowest bits of the parent pointer instead, reducing the header
+ * to 3 * sizeof(void *) on most platforms. In that configuration, element
+ * values are only guaranteed to be aligned suitably for pointers, integers and
+ * doubles - types with stricter alignment requirements (e.g. long double on
+ * some platforms) shall not be stored directly in such elements.
+ *
  * @param size Number of bytes to allocate for the element content.
  *
  * @returns Pointer to created element on success, NULL in case of error.
@@ -337,6 +547,40 @@ avs_rbtree_simple_clone_impl__(AVS_RBTREE_CONST(T) tree) {
 #define AVS_RBTREE_ELEM_NEW(type) \
     ((AVS_RBTREE_ELEM(type))AVS_RBTREE_ELEM_NEW_BUFFER(sizeof(type)))
 
+/**
+ * Creates a detached element suitable for insertion into @p tree. If @p tree
+ * was created with @ref AVS_RBTREE_NEW_WITH_POOL, the node is taken from its
+ * pool; otherwise, this is equivalent to @ref AVS_RBTREE_ELEM_NEW_BUFFER.
+ *
+ * The element may be freed with @ref AVS_RBTREE_ELEM_DELETE_DETACHED as usual.
+ *
+ * Complexity: O(1) for pool-backed trees when a free node is available,
+ * O(m) otherwise, where:
+ * - m - calloc() complexity.
+ *
+ * @param tree Tree the element is going to be inserted into.
+ * @param size Number of bytes to allocate for the element content. For
+ *             pool-backed trees, it MUST NOT exceed the size of the element
+ *             type the pool was created for.
+ *
+ * @returns Pointer to created element on success, NULL in case of error.
+ */
+#define AVS_RBTREE_ELEM_NEW_BUFFER_IN(tree, size) \
+    avs_rbtree_elem_new_in__((AVS_RBTREE(void))(tree), (size))
+
+/**
+ * Creates a detached element of given @p type, suitable for insertion into
+ * @p tree. See @ref AVS_RBTREE_ELEM_NEW_BUFFER_IN for details.
+ *
+ * @param tree Tree the element is going to be inserted into.
+ * @param type Desired element type.
+ *
+ * @returns Pointer to created element cast to @p type * on success,
+ *          NULL in case of error.
+ */
+#define AVS_RBTREE_ELEM_NEW_IN(tree, type) \
+    ((AVS_RBTREE_ELEM(type))AVS_RBTREE_ELEM_NEW_BUFFER_IN((tree), sizeof(type)))
+
 /**
  * Frees memory associated with given detached RB-tree element.
  *
@@ -369,7 +613,10 @@ avs_rbtree_simple_clone_impl__(AVS_RBTREE_CONST(T) tree) {
  *
  * @returns:
  * - @p elem on success,
- * - a pointer to the equivalent element if one already existed in the tree.
+ * - a pointer to the equivalent element if one already existed in the tree,
+ * - NULL if @p elem was not allocated from the pool used by @p tree (see
+ *   @ref AVS_RBTREE_NEW_WITH_POOL), or was allocated from a pool while
+ *   @p tree does not use one. @p elem is left detached in that case.
  */
 #define AVS_RBTREE_INSERT(tree, elem) \
     (_AVS_RB_TYPECHECK(*(tree), (elem)), \
@@ -530,6 +777,44 @@ avs_rbtree_simple_clone_impl__(AVS_RBTREE_CONST(T) tree) {
 #define AVS_RBTREE_LAST(tree) \
     AVS_RBTREE_CALL_WITH_ELEM_CAST__(avs_rbtree_last__, (tree))
 
+/**
+ * Returns the element at given position in @p tree, in order defined by
+ * @ref avs_rbtree_element_comparator_t .
+ *
+ * Complexity: O(log n) if the library is compiled with
+ * WITH_AVS_RBTREE_ORDER_STATISTICS, which makes every node track the size of
+ * its subtree; O(n) otherwise. n is the number of nodes in @p tree.
+ *
+ * @param tree RB-tree object to operate on.
+ * @param n    Zero-based index of the element to return.
+ *
+ * @returns Pointer to the n-th element, or NULL if @p n is not less than the
+ *          number of elements in @p tree.
+ */
+#define AVS_RBTREE_NTH(tree, n) \
+    AVS_RBTREE_CALL_WITH_CONST_ELEM_CAST__(avs_rbtree_nth__, (tree), (n))
+
+/**
+ * Returns the position of @p elem in @p tree, i.e. the number of elements
+ * that precede it in order defined by @ref avs_rbtree_element_comparator_t .
+ *
+ * Combined with @ref AVS_RBTREE_LOWER_BOUND, it may be used to count
+ * elements less than an arbitrary value.
+ *
+ * Complexity: O(log n) if the library is compiled with
+ * WITH_AVS_RBTREE_ORDER_STATISTICS, O(n) otherwise. n is the number of nodes
+ * in @p tree.
+ *
+ * @param tree RB-tree object to operate on.
+ * @param elem Element attached to @p tree, or NULL.
+ *
+ * @returns Zero-based index of @p elem, or the number of elements in @p tree
+ *          if @p elem is NULL.
+ */
+#define AVS_RBTREE_RANK(tree, elem) \
+    (_AVS_RB_TYPECHECK(*(tree), (elem)), \
+     avs_rbtree_rank__((AVS_RBTREE_CONST(void)) (tree), (elem)))
+
 /** Convenience macro for forward iteration on elements of @p tree. */
 #define AVS_RBTREE_FOREACH(it, tree) \
     for (_AVS_RB_TYPECHECK(*(tree), (it)), \
@@ -18,6 +18,7 @@
 #include <avsystem/commons/rbtree.h>
 
 #include <assert.h>
+#include <stdint.h>
 
 VISIBILITY_SOURCE_BEGIN
 
@@ -27,24 +28,89 @@ enum rb_color {
     BLACK = 0x50DF
 };
 
+#ifdef WITH_AVS_RBTREE_COMPACT_NODES
+/*
+ * In the compact layout, the color is stored in the lowest bits of the parent
+ * pointer, as an offset from DETACHED. Element values are only aligned to the
+ * strictest of pointers, integers and doubles, so that the header does not
+ * need to be padded to the alignment of long double.
+ */
+typedef union {
+    void *ptr;
+    void (*fptr)(void);
+    intmax_t i;
+    double d;
+} rb_value_align_t;
+
+#define RB_COLOR_MASK ((uintptr_t) 3)
+
+struct rb_node {
+    uintptr_t parent_and_color;
+    void *left;
+    void *right;
+#ifdef WITH_AVS_RBTREE_ORDER_STATISTICS
+    /* number of nodes in the subtree rooted at this node */
+    size_t subtree_size;
+#endif
+};
+#else
+typedef avs_max_align_t rb_value_align_t;
+
 struct rb_node {
     enum rb_color color;
     void *parent;
     void *left;
     void *right;
+#ifdef WITH_AVS_RBTREE_ORDER_STATISTICS
+    /* number of nodes in the subtree rooted at this node */
+    size_t subtree_size;
+#endif
 };
+#endif
 
 struct rb_node_space {
     struct rb_node node;
-    avs_max_align_t value;
+    rb_value_align_t value;
 };
 
 struct rb_tree {
     size_t size;
     avs_rbtree_element_comparator_t *cmp;
+    avs_rbtree_pool_t *pool;
     void *root;
 };
 
+typedef struct {
+    char pad;
+    rb_value_align_t value;
+} rb_alignment_helper_t;
+
+struct rb_pool_slab {
+    struct rb_pool_slab *next;
+};
+
+struct rb_pool_slab_space {
+    struct rb_pool_slab header;
+    avs_max_align_t nodes;
+};
+
+/*
+ * Free nodes are linked through the parent field of their headers. Detached
+ * nodes allocated from a pool keep a pointer to that pool in the parent field,
+ * so that they can be returned to it without access to any tree.
+ */
+struct avs_rbtree_pool_struct {
+    size_t elem_size;
+    size_t node_size;
+    size_t nodes_per_slab;
+    size_t nodes_in_use;
+    size_t refs;
+    struct rb_pool_slab *slabs;
+    struct rb_node *free_nodes;
+    char *unused_begin;
+    char *unused_end;
+};
+
 #define _AVS_NODE_SPACE__ \
     offsetof(struct rb_node_space, value)
 
@@ -56,6 +122,13 @@ struct rb_tree {
 #define _AVS_RB_TREE(ptr) \
     AVS_CONTAINER_OF((ptr), struct rb_tree, root)
 
+#define _AVS_RB_POOL_SLAB_SPACE__ \
+    offsetof(struct rb_pool_slab_space, nodes)
+
+#define _AVS_RB_POOL_DEFAULT_SLAB_SIZE 4096
+
+#define _AVS_RB_MAX_ALIGNMENT offsetof(rb_alignment_helper_t, value)
+
 #define _AVS_RB_ALLOC(size) calloc(1, size)
 #define _AVS_RB_DEALLOC(ptr) free(ptr)
 
@@ -75,13 +148,55 @@ struct rb_tree {
 #define _AVS_RB_RIGHT(elem) (*_AVS_RB_RIGHT_PTR(elem))
 #define _AVS_RB_RIGHT_CONST(elem) (*_AVS_RB_RIGHT_PTR_CONST(elem))
 
-#define _AVS_RB_PARENT_PTR(elem) \
-    ((AVS_TYPEOF_PTR(elem)*)&(_AVS_RB_NODE(elem)->parent))
-#define _AVS_RB_PARENT_PTR_CONST(elem) \
-    ((AVS_TYPEOF_PTR(elem) const*)&(_AVS_RB_NODE_CONST(elem)->parent))
+#ifdef WITH_AVS_RBTREE_COMPACT_NODES
+AVS_STATIC_ASSERT(_AVS_RB_MAX_ALIGNMENT > RB_COLOR_MASK,
+                  rb_node_pointers_have_free_low_bits);
+
+static enum rb_color rb_node_get_color(const struct rb_node *node) {
+    return (enum rb_color) (DETACHED
+                            + (int) (node->parent_and_color & RB_COLOR_MASK));
+}
 
-#define _AVS_RB_PARENT(elem) (*_AVS_RB_PARENT_PTR(elem))
-#define _AVS_RB_PARENT_CONST(elem) (*_AVS_RB_PARENT_PTR_CONST(elem))
+static void rb_node_set_color(struct rb_node *node, enum rb_color color) {
+    node->parent_and_color = (node->parent_and_color & ~RB_COLOR_MASK)
+                             | (uintptr_t) (color - DETACHED);
+}
+
+static void *rb_node_get_parent(const struct rb_node *node) {
+    return (void *) (node->parent_and_color & ~RB_COLOR_MASK);
+}
+
+static void rb_node_set_parent(struct rb_node *node, void *parent) {
+    assert(!((uintptr_t) parent & RB_COLOR_MASK));
+    node->parent_and_color = (uintptr_t) parent
+                             | (node->parent_and_color & RB_COLOR_MASK);
+}
+#else
+static enum rb_color rb_node_get_color(const struct rb_node *node) {
+    return node->color;
+}
+
+static void rb_node_set_color(struct rb_node *node, enum rb_color color) {
+    node->color = color;
+}
+
+static void *rb_node_get_parent(const struct rb_node *node) {
+    return node->parent;
+}
+
+static void rb_node_set_parent(struct rb_node *node, void *parent) {
+    node->parent = parent;
+}
+#endif
+
+#define _AVS_RB_PARENT(elem) rb_node_get_parent(_AVS_RB_NODE(elem))
+#define _AVS_RB_PARENT_CONST(elem) rb_node_get_parent(_AVS_RB_NODE_CONST(elem))
+#define _AVS_RB_SET_PARENT(elem, parent) \
+    rb_node_set_parent(_AVS_RB_NODE(elem), (parent))
+
+#define _AVS_RB_COLOR(elem) rb_node_get_color(_AVS_RB_NODE_CONST(elem))
+#define _AVS_RB_SET_COLOR(elem, color) \
+    rb_node_set_color(_AVS_RB_NODE(elem), (color))
 
 enum rb_color _avs_rb_node_color(void *elem);
 
@@ -101,8 +216,8 @@ static int rb_is_cleanup_in_progress(AVS_RBTREE_CONST(void) tree) {
 }
 
 static int rb_is_node_detached(AVS_RBTREE_ELEM(void) elem) {
-    return _AVS_RB_NODE(elem)->color == DETACHED
-        && _AVS_RB_PARENT(elem) == NULL
+    /* parent of a detached node is either NULL or its pool */
+    return _AVS_RB_COLOR(elem) == DETACHED
         && _AVS_RB_LEFT(elem) == NULL
         && _AVS_RB_RIGHT(elem) == NULL;
 }
@@ -122,34 +237,172 @@ static int rb_is_node_owner(AVS_RBTREE(void) tree, AVS_RBTREE_ELEM(void) elem) {
 # define rb_is_node_owner(...) 1
 #endif
 
+#ifdef WITH_AVS_RBTREE_ORDER_STATISTICS
+static size_t rb_subtree_size(AVS_RBTREE_ELEM(const void) elem) {
+    return elem ? _AVS_RB_NODE_CONST(elem)->subtree_size : 0;
+}
+
+static void rb_update_subtree_size(AVS_RBTREE_ELEM(void) elem) {
+    _AVS_RB_NODE(elem)->subtree_size = 1 + rb_subtree_size(_AVS_RB_LEFT(elem))
+                                         + rb_subtree_size(_AVS_RB_RIGHT(elem));
+}
+
+static void rb_adjust_ancestor_sizes(AVS_RBTREE_ELEM(void) parent,
+                                     int increment) {
+    for (; parent; parent = _AVS_RB_PARENT(parent)) {
+        if (increment) {
+            ++_AVS_RB_NODE(parent)->subtree_size;
+        } else {
+            --_AVS_RB_NODE(parent)->subtree_size;
+        }
+    }
+}
+#else
+# define rb_update_subtree_size(elem) ((void) 0)
+# define rb_adjust_ancestor_sizes(parent, increment) ((void) 0)
+#endif
+
 enum rb_color _avs_rb_node_color(AVS_RBTREE_ELEM(void) elem) {
     if (!elem) {
         return BLACK;
     } else {
         /* checking the color of a detached node is pointless, so
          * this function should never be called on one */
-        assert(_AVS_RB_NODE(elem)->color == RED
-                || _AVS_RB_NODE(elem)->color == BLACK);
-        return _AVS_RB_NODE(elem)->color;
+        assert(_AVS_RB_COLOR(elem) == RED
+                || _AVS_RB_COLOR(elem) == BLACK);
+        return _AVS_RB_COLOR(elem);
     }
 }
 
-AVS_RBTREE(void) avs_rbtree_new__(avs_rbtree_element_comparator_t *cmp) {
+avs_rbtree_pool_t *avs_rbtree_pool_new__(size_t elem_size,
+                                         size_t nodes_per_slab) {
+    const size_t align = _AVS_RB_MAX_ALIGNMENT;
+    avs_rbtree_pool_t *pool =
+            (avs_rbtree_pool_t *) _AVS_RB_ALLOC(sizeof(avs_rbtree_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->elem_size = elem_size;
+    pool->node_size =
+            (_AVS_NODE_SPACE__ + elem_size + align - 1) / align * align;
+    if (!nodes_per_slab) {
+        nodes_per_slab = (_AVS_RB_POOL_DEFAULT_SLAB_SIZE
+                          - _AVS_RB_POOL_SLAB_SPACE__) / pool->node_size;
+    }
+    pool->nodes_per_slab = nodes_per_slab ? nodes_per_slab : 1;
+    pool->refs = 1;
+    return pool;
+}
+
+void avs_rbtree_pool_delete(avs_rbtree_pool_t **pool_ptr) {
+    if (!pool_ptr || !*pool_ptr) {
+        return;
+    }
+
+    assert((*pool_ptr)->refs > 0);
+    if (--(*pool_ptr)->refs) {
+        *pool_ptr = NULL;
+        return;
+    }
+
+    /* the last reference should only be released when no nodes are in use */
+    assert(!(*pool_ptr)->nodes_in_use);
+    while ((*pool_ptr)->slabs) {
+        struct rb_pool_slab *slab = (*pool_ptr)->slabs;
+        (*pool_ptr)->slabs = slab->next;
+        _AVS_RB_DEALLOC(slab);
+    }
+    _AVS_RB_DEALLOC(*pool_ptr);
+    *pool_ptr = NULL;
+}
+
+static struct rb_node *rb_pool_alloc(avs_rbtree_pool_t *pool) {
+    struct rb_node *node;
+
+    if (pool->free_nodes) {
+        node = pool->free_nodes;
+        pool->free_nodes = (struct rb_node *) rb_node_get_parent(node);
+    } else {
+        if (pool->unused_begin == pool->unused_end) {
+            const size_t slab_bytes = pool->nodes_per_slab * pool->node_size;
+            struct rb_pool_slab *slab;
+
+            if (slab_bytes / pool->node_size != pool->nodes_per_slab
+                    || slab_bytes > SIZE_MAX - _AVS_RB_POOL_SLAB_SPACE__
+                    || !(slab = (struct rb_pool_slab *) _AVS_RB_ALLOC(
+                            _AVS_RB_POOL_SLAB_SPACE__ + slab_bytes))) {
+                return NULL;
+            }
+            slab->next = pool->slabs;
+            pool->slabs = slab;
+            pool->unused_begin = (char *) slab + _AVS_RB_POOL_SLAB_SPACE__;
+            pool->unused_end = pool->unused_begin + slab_bytes;
+        }
+        node = (struct rb_node *) pool->unused_begin;
+        pool->unused_begin += pool->node_size;
+    }
+
+    memset(node, 0, pool->node_size);
+    ++pool->nodes_in_use;
+    return node;
+}
+
+static void rb_pool_free(avs_rbtree_pool_t *pool, struct rb_node *node) {
+    assert(pool->nodes_in_use > 0);
+    --pool->nodes_in_use;
+    rb_node_set_parent(node, pool->free_nodes);
+    pool->free_nodes = node;
+}
+
+static struct rb_tree *rb_tree_new(avs_rbtree_element_comparator_t *cmp,
+                                   avs_rbtree_pool_t *pool) {
     struct rb_tree *tree = (struct rb_tree*)_AVS_RB_ALLOC(sizeof(struct rb_tree));
     if (!tree) {
         return NULL;
     }
 
     tree->cmp = cmp;
+    tree->pool = pool;
     tree->root = NULL;
 
+    return tree;
+}
+
+AVS_RBTREE(void) avs_rbtree_new__(avs_rbtree_element_comparator_t *cmp) {
+    struct rb_tree *tree = rb_tree_new(cmp, NULL);
+    return tree ? &tree->root : NULL;
+}
+
+AVS_RBTREE(void) avs_rbtree_new_with_pool__(avs_rbtree_element_comparator_t *cmp,
+                                            avs_rbtree_pool_t *pool,
+                                            size_t elem_size) {
+    struct rb_tree *tree;
+
+    if (pool) {
+        assert(elem_size <= pool->elem_size);
+        ++pool->refs;
+    } else if (!(pool = avs_rbtree_pool_new__(elem_size, 0))) {
+        return NULL;
+    }
+
+    if (!(tree = rb_tree_new(cmp, pool))) {
+        avs_rbtree_pool_delete(&pool);
+        return NULL;
+    }
     return &tree->root;
 }
 
 void avs_rbtree_elem_delete__(AVS_RBTREE_ELEM(void) *node_ptr) {
     if (node_ptr && *node_ptr) {
+        struct rb_node *node = _AVS_RB_NODE(*node_ptr);
+
         assert(rb_is_node_detached(*node_ptr));
-        _AVS_RB_DEALLOC(_AVS_RB_NODE(*node_ptr));
+        if (rb_node_get_parent(node)) {
+            rb_pool_free((avs_rbtree_pool_t *) rb_node_get_parent(node), node);
+        } else {
+            _AVS_RB_DEALLOC(node);
+        }
         *node_ptr = NULL;
     }
 }
@@ -163,19 +416,26 @@ void avs_rbtree_delete__(AVS_RBTREE(void) *tree_ptr) {
 
     assert(!**tree_ptr); /* should only be called on empty trees */
     tree = _AVS_RB_TREE(*tree_ptr);
+    avs_rbtree_pool_delete(&tree->pool);
     _AVS_RB_DEALLOC(tree);
     *tree_ptr = NULL;
 }
 
-static void rb_subtree_delete(AVS_RBTREE_ELEM(void) elem) {
+static void rb_subtree_delete(struct rb_tree *tree,
+                              AVS_RBTREE_ELEM(void) elem) {
     if (elem) {
-        rb_subtree_delete(_AVS_RB_LEFT(elem));
-        rb_subtree_delete(_AVS_RB_RIGHT(elem));
-        _AVS_RB_DEALLOC(_AVS_RB_NODE(elem));
+        rb_subtree_delete(tree, _AVS_RB_LEFT(elem));
+        rb_subtree_delete(tree, _AVS_RB_RIGHT(elem));
+        if (tree->pool) {
+            rb_pool_free(tree->pool, _AVS_RB_NODE(elem));
+        } else {
+            _AVS_RB_DEALLOC(_AVS_RB_NODE(elem));
+        }
     }
 }
 
-static AVS_RBTREE_ELEM(void) rb_subtree_clone(AVS_RBTREE_ELEM(void) node,
+static AVS_RBTREE_ELEM(void) rb_subtree_clone(AVS_RBTREE(void) tree,
+                                              AVS_RBTREE_ELEM(void) node,
                                               AVS_RBTREE_ELEM(void) new_parent,
                                               size_t elem_size) {
     if (!node) {
@@ -185,21 +445,22 @@ static AVS_RBTREE_ELEM(void) rb_subtree_clone(AVS_RBTREE_ELEM(void) node,
     AVS_RBTREE_ELEM(void) left = _AVS_RB_LEFT(node);
     AVS_RBTREE_ELEM(void) right = _AVS_RB_RIGHT(node);
 
-    AVS_RBTREE_ELEM(void) clone = AVS_RBTREE_ELEM_NEW_BUFFER(elem_size);
+    AVS_RBTREE_ELEM(void) clone = AVS_RBTREE_ELEM_NEW_BUFFER_IN(tree, elem_size);
     if (!clone) {
         return NULL;
     }
 
     if ((left && !(_AVS_RB_LEFT(clone) =
-                    rb_subtree_clone(left, clone, elem_size)))
+                    rb_subtree_clone(tree, left, clone, elem_size)))
             || (right && !(_AVS_RB_RIGHT(clone) =
-                    rb_subtree_clone(right, clone, elem_size)))) {
-        rb_subtree_delete(clone);
+                    rb_subtree_clone(tree, right, clone, elem_size)))) {
+        rb_subtree_delete(_AVS_RB_TREE(tree), clone);
         return NULL;
     }
 
-    _AVS_RB_NODE(clone)->color = _AVS_RB_NODE(node)->color;
-    _AVS_RB_PARENT(clone) = new_parent;
+    _AVS_RB_SET_COLOR(clone, _AVS_RB_COLOR(node));
+    rb_update_subtree_size(clone);
+    _AVS_RB_SET_PARENT(clone, new_parent);
     memcpy(clone, node, elem_size);
     return clone;
 }
@@ -207,9 +468,17 @@ static AVS_RBTREE_ELEM(void) rb_subtree_clone(AVS_RBTREE_ELEM(void) node,
 AVS_RBTREE(void) avs_rbtree_simple_clone__(AVS_RBTREE_CONST(void) tree,
                                            size_t elem_size) {
     assert(tree);
-    AVS_RBTREE(void) result = avs_rbtree_new__(_AVS_RB_TREE(tree)->cmp);
+    const struct rb_tree *source = _AVS_RB_TREE(tree);
+    AVS_RBTREE(void) result;
+    if (!source->pool) {
+        result = avs_rbtree_new__(source->cmp);
+    } else {
+        result = avs_rbtree_new_with_pool__(source->cmp, source->pool,
+                                            source->pool->elem_size);
+    }
     if (result && *tree) {
-        *result = rb_subtree_clone((AVS_RBTREE_ELEM(void)) (intptr_t) *tree,
+        *result = rb_subtree_clone(result,
+                                   (AVS_RBTREE_ELEM(void)) (intptr_t) *tree,
                                    NULL, elem_size);
         if (!*result) {
             avs_rbtree_delete__(&result);
@@ -233,7 +502,27 @@ AVS_RBTREE_ELEM(void) avs_rbtree_elem_new_buffer__(size_t elem_size) {
         return NULL;
     }
 
-    node->color = DETACHED;
+    rb_node_set_color(node, DETACHED);
+
+    return (char*)node + _AVS_NODE_SPACE__;
+}
+
+AVS_RBTREE_ELEM(void) avs_rbtree_elem_new_in__(AVS_RBTREE(void) tree_,
+                                               size_t elem_size) {
+    avs_rbtree_pool_t *pool;
+    struct rb_node *node;
+
+    assert(tree_);
+    if (!(pool = _AVS_RB_TREE(tree_)->pool)) {
+        return avs_rbtree_elem_new_buffer__(elem_size);
+    }
+
+    if (elem_size > pool->elem_size || !(node = rb_pool_alloc(pool))) {
+        return NULL;
+    }
+
+    rb_node_set_color(node, DETACHED);
+    rb_node_set_parent(node, pool);
 
     return (char*)node + _AVS_NODE_SPACE__;
 }
@@ -392,16 +681,19 @@ static void rb_rotate_left(struct rb_tree *tree,
     assert(pivot);
 
     *own_parent_ptr = pivot;
-    _AVS_RB_PARENT(pivot) = parent;
+    _AVS_RB_SET_PARENT(pivot, parent);
 
     grandchild = _AVS_RB_LEFT(pivot);
     _AVS_RB_LEFT(pivot) = root;
-    _AVS_RB_PARENT(root) = pivot;
+    _AVS_RB_SET_PARENT(root, pivot);
 
     _AVS_RB_RIGHT(root) = grandchild;
     if (grandchild) {
-        _AVS_RB_PARENT(grandchild) = root;
+        _AVS_RB_SET_PARENT(grandchild, root);
     }
+
+    rb_update_subtree_size(root);
+    rb_update_subtree_size(pivot);
 }
 
 /**
@@ -428,16 +720,19 @@ static void rb_rotate_right(struct rb_tree *tree, AVS_RBTREE_ELEM(void) root) {
     assert(pivot);
 
     *own_parent_ptr = pivot;
-    _AVS_RB_PARENT(pivot) = parent;
+    _AVS_RB_SET_PARENT(pivot, parent);
 
     grandchild = _AVS_RB_RIGHT(pivot);
     _AVS_RB_RIGHT(pivot) = root;
-    _AVS_RB_PARENT(root) = pivot;
+    _AVS_RB_SET_PARENT(root, pivot);
 
     _AVS_RB_LEFT(root) = grandchild;
     if (grandchild) {
-        _AVS_RB_PARENT(grandchild) = root;
+        _AVS_RB_SET_PARENT(grandchild, root);
     }
+
+    rb_update_subtree_size(root);
+    rb_update_subtree_size(pivot);
 }
 
 static void rb_insert_fix(struct rb_tree *tree,
@@ -448,11 +743,11 @@ static void rb_insert_fix(struct rb_tree *tree,
 
     /* case 1 */
     if (elem == tree->root) {
-        _AVS_RB_NODE(elem)->color = BLACK;
+        _AVS_RB_SET_COLOR(elem, BLACK);
         return;
     }
 
-    _AVS_RB_NODE(elem)->color = RED;
+    _AVS_RB_SET_COLOR(elem, RED);
 
     /* case 2 */
     parent = _AVS_RB_PARENT(elem);
@@ -466,9 +761,9 @@ static void rb_insert_fix(struct rb_tree *tree,
     uncle = rb_sibling(parent, grandparent);
 
     if (_avs_rb_node_color(uncle) == RED) {
-        _AVS_RB_NODE(parent)->color = BLACK;
-        _AVS_RB_NODE(uncle)->color = BLACK;
-        _AVS_RB_NODE(grandparent)->color = RED;
+        _AVS_RB_SET_COLOR(parent, BLACK);
+        _AVS_RB_SET_COLOR(uncle, BLACK);
+        _AVS_RB_SET_COLOR(grandparent, RED);
         rb_insert_fix(tree, grandparent);
         return;
     }
@@ -488,8 +783,8 @@ static void rb_insert_fix(struct rb_tree *tree,
     parent = _AVS_RB_PARENT(elem);
     assert(grandparent == _AVS_RB_PARENT(parent));
 
-    _AVS_RB_NODE(parent)->color = BLACK;
-    _AVS_RB_NODE(grandparent)->color = RED;
+    _AVS_RB_SET_COLOR(parent, BLACK);
+    _AVS_RB_SET_COLOR(grandparent, RED);
     if (elem == _AVS_RB_LEFT(parent)) {
         rb_rotate_right(tree, grandparent);
     } else {
@@ -509,6 +804,11 @@ AVS_RBTREE_ELEM(void) avs_rbtree_attach__(AVS_RBTREE(void) tree_,
     assert(elem);
     assert(rb_is_node_detached(elem));
 
+    if (_AVS_RB_PARENT(elem) != (void *) tree->pool) {
+        /* element was not allocated from the pool used by the tree */
+        return NULL;
+    }
+
     dst = rb_find_ptr(tree, elem, &parent);
     assert(dst);
 
@@ -517,7 +817,9 @@ AVS_RBTREE_ELEM(void) avs_rbtree_attach__(AVS_RBTREE(void) tree_,
         return *dst;
     } else {
         *dst = elem;
-        _AVS_RB_PARENT(elem) = parent;
+        _AVS_RB_SET_PARENT(elem, parent);
+        rb_update_subtree_size(elem);
+        rb_adjust_ancestor_sizes(parent, 1);
         ++tree->size;
     }
 
@@ -606,6 +908,72 @@ AVS_RBTREE_ELEM(void) avs_rbtree_elem_prev__(AVS_RBTREE_ELEM(void) elem) {
     return parent;
 }
 
+AVS_RBTREE_ELEM(void) avs_rbtree_nth__(AVS_RBTREE_CONST(void) tree,
+                                       size_t n) {
+    AVS_RBTREE_ELEM(void) elem = (AVS_RBTREE_ELEM(void)) (intptr_t) *tree;
+
+    assert(!rb_is_cleanup_in_progress(tree)
+           && "avs_rbtree_nth__ called while tree deletion in progress");
+    if (n >= _AVS_RB_TREE(tree)->size) {
+        return NULL;
+    }
+
+#ifdef WITH_AVS_RBTREE_ORDER_STATISTICS
+    while (elem) {
+        size_t left_size = rb_subtree_size(_AVS_RB_LEFT(elem));
+        if (n == left_size) {
+            break;
+        } else if (n < left_size) {
+            elem = _AVS_RB_LEFT(elem);
+        } else {
+            n -= left_size + 1;
+            elem = _AVS_RB_RIGHT(elem);
+        }
+    }
+#else
+    /* walk from whichever end is closer */
+    if (n < _AVS_RB_TREE(tree)->size / 2) {
+        for (elem = rb_min(elem); n; --n) {
+            elem = avs_rbtree_elem_next__(elem);
+        }
+    } else {
+        for (elem = rb_max(elem), n = _AVS_RB_TREE(tree)->size - 1 - n; n;
+                --n) {
+            elem = avs_rbtree_elem_prev__(elem);
+        }
+    }
+#endif
+    assert(elem);
+    return elem;
+}
+
+size_t avs_rbtree_rank__(AVS_RBTREE_CONST(void) tree, const void *elem_) {
+    AVS_RBTREE_ELEM(void) elem = (AVS_RBTREE_ELEM(void)) (intptr_t) elem_;
+    size_t rank = 0;
+
+    assert(!rb_is_cleanup_in_progress(tree)
+           && "avs_rbtree_rank__ called while tree deletion in progress");
+    if (!elem) {
+        return _AVS_RB_TREE(tree)->size;
+    }
+    assert(!rb_is_node_detached(elem));
+
+#ifdef WITH_AVS_RBTREE_ORDER_STATISTICS
+    rank = rb_subtree_size(_AVS_RB_LEFT(elem));
+    for (; _AVS_RB_PARENT(elem); elem = _AVS_RB_PARENT(elem)) {
+        AVS_RBTREE_ELEM(void) parent = _AVS_RB_PARENT(elem);
+        if (_AVS_RB_RIGHT(parent) == elem) {
+            rank += rb_subtree_size(_AVS_RB_LEFT(parent)) + 1;
+        }
+    }
+#else
+    while ((elem = avs_rbtree_elem_prev__(elem))) {
+        ++rank;
+    }
+#endif
+    return rank;
+}
+
 static void swap(void **a,
                  void **b) {
     void *tmp;
@@ -641,37 +1009,49 @@ static void rb_swap_nodes(struct rb_tree *tree,
     /* simply swapping pointers in case where one node is a parent of
      * another would set parent pointer of the former parent to itself */
     if (_AVS_RB_PARENT(a) == b) {
-        _AVS_RB_PARENT(a) = a;
+        _AVS_RB_SET_PARENT(a, a);
     } else if (_AVS_RB_PARENT(b) == a) {
-        _AVS_RB_PARENT(b) = b;
+        _AVS_RB_SET_PARENT(b, b);
     }
 
     swap(a_parent_ptr, b_parent_ptr);
-    swap(_AVS_RB_PARENT_PTR(a), _AVS_RB_PARENT_PTR(b));
+    {
+        AVS_RBTREE_ELEM(void) a_parent = _AVS_RB_PARENT(a);
+        _AVS_RB_SET_PARENT(a, _AVS_RB_PARENT(b));
+        _AVS_RB_SET_PARENT(b, a_parent);
+    }
 
     swap(_AVS_RB_LEFT_PTR(a), _AVS_RB_LEFT_PTR(b));
     if (_AVS_RB_LEFT(a)) {
         AVS_RBTREE_ELEM(void) left = _AVS_RB_LEFT(a);
-        _AVS_RB_PARENT(left) = a;
+        _AVS_RB_SET_PARENT(left, a);
     }
     if (_AVS_RB_LEFT(b)) {
         AVS_RBTREE_ELEM(void) left = _AVS_RB_LEFT(b);
-        _AVS_RB_PARENT(left) = b;
+        _AVS_RB_SET_PARENT(left, b);
     }
 
     swap(_AVS_RB_RIGHT_PTR(a), _AVS_RB_RIGHT_PTR(b));
     if (_AVS_RB_RIGHT(a)) {
         AVS_RBTREE_ELEM(void) right = _AVS_RB_RIGHT(a);
-        _AVS_RB_PARENT(right) = a;
+        _AVS_RB_SET_PARENT(right, a);
     }
     if (_AVS_RB_RIGHT(b)) {
         AVS_RBTREE_ELEM(void) right = _AVS_RB_RIGHT(b);
-        _AVS_RB_PARENT(right) = b;
+        _AVS_RB_SET_PARENT(right, b);
     }
 
     col = _avs_rb_node_color(a);
-    _AVS_RB_NODE(a)->color = _avs_rb_node_color(b);
-    _AVS_RB_NODE(b)->color = col;
+    _AVS_RB_SET_COLOR(a, _avs_rb_node_color(b));
+    _AVS_RB_SET_COLOR(b, col);
+
+#ifdef WITH_AVS_RBTREE_ORDER_STATISTICS
+    {
+        size_t size = _AVS_RB_NODE(a)->subtree_size;
+        _AVS_RB_NODE(a)->subtree_size = _AVS_RB_NODE(b)->subtree_size;
+        _AVS_RB_NODE(b)->subtree_size = size;
+    }
+#endif
 }
 
 static void rb_detach_fix(struct rb_tree *tree,
@@ -689,8 +1069,8 @@ static void rb_detach_fix(struct rb_tree *tree,
     /* case 2 */
     sibling = rb_sibling(elem, parent);
     if (_avs_rb_node_color(sibling) == RED) {
-        _AVS_RB_NODE(parent)->color = RED;
-        _AVS_RB_NODE(sibling)->color = BLACK;
+        _AVS_RB_SET_COLOR(parent, RED);
+        _AVS_RB_SET_COLOR(sibling, BLACK);
 
         if (elem == _AVS_RB_LEFT(parent)) {
             rb_rotate_left(tree, parent);
@@ -708,7 +1088,7 @@ static void rb_detach_fix(struct rb_tree *tree,
     if (_avs_rb_node_color(parent) == BLACK
             && _avs_rb_node_color(_AVS_RB_LEFT(sibling)) == BLACK
             && _avs_rb_node_color(_AVS_RB_RIGHT(sibling)) == BLACK) {
-        _AVS_RB_NODE(sibling)->color = RED;
+        _AVS_RB_SET_COLOR(sibling, RED);
         rb_detach_fix(tree, parent, _AVS_RB_PARENT(parent));
         return;
     }
@@ -717,8 +1097,8 @@ static void rb_detach_fix(struct rb_tree *tree,
     if (_avs_rb_node_color(parent) == RED
             && _avs_rb_node_color(_AVS_RB_LEFT(sibling)) == BLACK
             && _avs_rb_node_color(_AVS_RB_RIGHT(sibling)) == BLACK) {
-        _AVS_RB_NODE(sibling)->color = RED;
-        _AVS_RB_NODE(parent)->color = BLACK;
+        _AVS_RB_SET_COLOR(sibling, RED);
+        _AVS_RB_SET_COLOR(parent, BLACK);
         return;
     }
 
@@ -727,33 +1107,33 @@ static void rb_detach_fix(struct rb_tree *tree,
             && _avs_rb_node_color(_AVS_RB_RIGHT(sibling)) == BLACK) {
         assert(_avs_rb_node_color(_AVS_RB_LEFT(sibling)) == RED);
 
-        _AVS_RB_NODE(sibling)->color = RED;
-        _AVS_RB_NODE(_AVS_RB_LEFT(sibling))->color = BLACK;
+        _AVS_RB_SET_COLOR(sibling, RED);
+        _AVS_RB_SET_COLOR(_AVS_RB_LEFT(sibling), BLACK);
         rb_rotate_right(tree, sibling);
     } else if (elem == _AVS_RB_RIGHT(parent)
                && _avs_rb_node_color(_AVS_RB_LEFT(sibling)) == BLACK) {
         assert(_avs_rb_node_color(_AVS_RB_RIGHT(sibling)) == RED);
 
-        _AVS_RB_NODE(sibling)->color = RED;
-        _AVS_RB_NODE(_AVS_RB_RIGHT(sibling))->color = BLACK;
+        _AVS_RB_SET_COLOR(sibling, RED);
+        _AVS_RB_SET_COLOR(_AVS_RB_RIGHT(sibling), BLACK);
         rb_rotate_left(tree, sibling);
     }
 
     /* case 6 */
     sibling = rb_sibling(elem, parent);
 
-    _AVS_RB_NODE(sibling)->color = _avs_rb_node_color(parent);
-    _AVS_RB_NODE(parent)->color = BLACK;
+    _AVS_RB_SET_COLOR(sibling, _avs_rb_node_color(parent));
+    _AVS_RB_SET_COLOR(parent, BLACK);
 
     if (elem == _AVS_RB_LEFT(parent)) {
         assert(_AVS_RB_RIGHT(sibling));
 
-        _AVS_RB_NODE(_AVS_RB_RIGHT(sibling))->color = BLACK;
+        _AVS_RB_SET_COLOR(_AVS_RB_RIGHT(sibling), BLACK);
         rb_rotate_left(tree, parent);
     } else {
         assert(_AVS_RB_LEFT(sibling));
 
-        _AVS_RB_NODE(_AVS_RB_LEFT(sibling))->color = BLACK;
+        _AVS_RB_SET_COLOR(_AVS_RB_LEFT(sibling), BLACK);
         rb_rotate_right(tree, parent);
     }
 }
@@ -797,13 +1177,14 @@ AVS_RBTREE_ELEM(void) avs_rbtree_detach__(AVS_RBTREE(void) tree_,
 
     if (child) {
         assert(_AVS_RB_PARENT(child) == elem);
-        _AVS_RB_PARENT(child) = parent;
+        _AVS_RB_SET_PARENT(child, parent);
     }
 
     *rb_own_parent_ptr(tree, elem) = child;
+    rb_adjust_ancestor_sizes(parent, 0);
     elem_color = _avs_rb_node_color(elem);
-    _AVS_RB_NODE(elem)->color = DETACHED;
-    _AVS_RB_PARENT(elem) = NULL;
+    _AVS_RB_SET_COLOR(elem, DETACHED);
+    _AVS_RB_SET_PARENT(elem, tree->pool);
     _AVS_RB_LEFT(elem) = NULL;
     _AVS_RB_RIGHT(elem) = NULL;
     assert(tree->size > 0u);
@@ -816,7 +1197,7 @@ AVS_RBTREE_ELEM(void) avs_rbtree_detach__(AVS_RBTREE(void) tree_,
         if (child) {
             /* if elem is red, child is already black
              * if child is red, we need to repaint it */
-            _AVS_RB_NODE(child)->color = BLACK;
+            _AVS_RB_SET_COLOR(child, BLACK);
         }
 
         return elem;
@@ -829,6 +1210,272 @@ AVS_RBTREE_ELEM(void) avs_rbtree_detach__(AVS_RBTREE(void) tree_,
     return elem;
 }
 
+typedef AVS_RBTREE_ELEM(void) rb_node_source_t(void *state);
+
+struct rb_build_ctx {
+    struct rb_tree *tree;
+    rb_node_source_t *source;
+    void *state;
+    size_t red_depth;
+};
+
+/*
+ * Builds a balanced subtree out of the next @p count nodes returned by the
+ * source. Nodes at red_depth - the only level that may be incomplete - are
+ * red, all the others are black, so every path has the same black height.
+ * Returns NULL for non-zero @p count only if the source failed.
+ */
+static AVS_RBTREE_ELEM(void) rb_build_subtree(struct rb_build_ctx *ctx,
+                                              size_t count,
+                                              size_t depth) {
+    const size_t left_count = count ? (count - 1) / 2 : 0;
+    AVS_RBTREE_ELEM(void) left = NULL;
+    AVS_RBTREE_ELEM(void) node = NULL;
+    AVS_RBTREE_ELEM(void) right = NULL;
+
+    if (!count) {
+        return NULL;
+    }
+
+    if ((left_count && !(left = rb_build_subtree(ctx, left_count, depth + 1)))
+            || !(node = ctx->source(ctx->state))) {
+        rb_subtree_delete(ctx->tree, left);
+        return NULL;
+    }
+
+    _AVS_RB_SET_COLOR(node, (depth == ctx->red_depth) ? RED : BLACK);
+#ifdef WITH_AVS_RBTREE_ORDER_STATISTICS
+    _AVS_RB_NODE(node)->subtree_size = count;
+#endif
+    _AVS_RB_LEFT(node) = left;
+    _AVS_RB_RIGHT(node) = NULL;
+    if (left) {
+        _AVS_RB_SET_PARENT(left, node);
+    }
+
+    if (count - 1 - left_count
+            && !(right = rb_build_subtree(ctx, count - 1 - left_count,
+                                          depth + 1))) {
+        rb_subtree_delete(ctx->tree, node);
+        return NULL;
+    }
+
+    _AVS_RB_RIGHT(node) = right;
+    if (right) {
+        _AVS_RB_SET_PARENT(right, node);
+    }
+    return node;
+}
+
+static int rb_build(struct rb_tree *tree, size_t count,
+                    rb_node_source_t *source, void *state) {
+    struct rb_build_ctx ctx = { tree, source, state, 0 };
+    size_t levels = count + 1;
+
+    assert(!tree->root);
+    while (levels >>= 1) {
+        ++ctx.red_depth;
+    }
+
+    if (count && !(tree->root = rb_build_subtree(&ctx, count, 0))) {
+        return -1;
+    }
+    if (tree->root) {
+        _AVS_RB_SET_PARENT(tree->root, NULL);
+    }
+    tree->size = count;
+    return 0;
+}
+
+typedef struct {
+    struct rb_tree *tree;
+    size_t elem_size;
+    const void *next_value;
+    size_t next_offset;
+    const void *prev_value;
+} rb_value_source_t;
+
+static AVS_RBTREE_ELEM(void) rb_value_source_next(void *state_) {
+    rb_value_source_t *state = (rb_value_source_t *) state_;
+    AVS_RBTREE_ELEM(void) elem =
+            avs_rbtree_elem_new_in__(&state->tree->root, state->elem_size);
+    if (!elem) {
+        return NULL;
+    }
+
+    memcpy(elem, state->next_value, state->elem_size);
+    if (state->prev_value && state->tree->cmp(state->prev_value, elem) >= 0) {
+        avs_rbtree_elem_delete__(&elem);
+        return NULL;
+    }
+
+    state->prev_value = elem;
+    if (state->next_offset) {
+        /* list source - next pointer is stored before the element */
+        state->next_value = *(const void *const *) (const void *)
+                ((const char *) state->next_value - state->next_offset);
+    } else {
+        state->next_value =
+                (const char *) state->next_value + state->elem_size;
+    }
+    return elem;
+}
+
+int avs_rbtree_build_from_array__(AVS_RBTREE(void) tree,
+                                  const void *values,
+                                  size_t count,
+                                  size_t elem_size) {
+    rb_value_source_t state = {
+        _AVS_RB_TREE(tree), elem_size, values, 0, NULL
+    };
+
+    assert(!rb_is_cleanup_in_progress(rb_tree_const(tree))
+           && "avs_rbtree_build_from_array__ called while tree deletion "
+              "in progress");
+    if (*tree) {
+        return -1;
+    }
+    return rb_build(state.tree, count, rb_value_source_next, &state);
+}
+
+int avs_rbtree_build_from_list__(AVS_RBTREE(void) tree,
+                                 const void *list,
+                                 size_t next_offset,
+                                 size_t elem_size) {
+    rb_value_source_t state = {
+        _AVS_RB_TREE(tree), elem_size, list, next_offset, NULL
+    };
+    size_t count = 0;
+
+    assert(!rb_is_cleanup_in_progress(rb_tree_const(tree))
+           && "avs_rbtree_build_from_list__ called while tree deletion "
+              "in progress");
+    if (*tree) {
+        return -1;
+    }
+    while (list) {
+        ++count;
+        list = *(const void *const *) (const void *)
+                ((const char *) list - next_offset);
+    }
+    return rb_build(state.tree, count, rb_value_source_next, &state);
+}
+
+/*
+ * Nodes being moved between trees are chained in order through their left
+ * pointers. avs_rbtree_elem_next__ never reads left pointers of elements it
+ * has already returned, so chaining can be done while iterating.
+ */
+typedef struct {
+    AVS_RBTREE_ELEM(void) head;
+    AVS_RBTREE_ELEM(void) *tail_ptr;
+    size_t count;
+} rb_chain_t;
+
+static void rb_chain_init(rb_chain_t *chain) {
+    chain->head = NULL;
+    chain->tail_ptr = &chain->head;
+    chain->count = 0;
+}
+
+static void rb_chain_append(rb_chain_t *chain, AVS_RBTREE_ELEM(void) elem) {
+    *chain->tail_ptr = elem;
+    chain->tail_ptr = _AVS_RB_LEFT_PTR(elem);
+    ++chain->count;
+}
+
+static AVS_RBTREE_ELEM(void) rb_chain_source_next(void *chain_) {
+    rb_chain_t *chain = (rb_chain_t *) chain_;
+    AVS_RBTREE_ELEM(void) elem = chain->head;
+    assert(elem);
+    chain->head = _AVS_RB_LEFT(elem);
+    return elem;
+}
+
+static void rb_rebuild(struct rb_tree *tree, rb_chain_t *chain) {
+    int result;
+    *chain->tail_ptr = NULL;
+    tree->root = NULL;
+    result = rb_build(tree, chain->count, rb_chain_source_next, chain);
+    assert(!result); /* chain source never fails */
+    (void) result;
+}
+
+void avs_rbtree_merge__(AVS_RBTREE(void) dst_, AVS_RBTREE(void) src_) {
+    struct rb_tree *dst = _AVS_RB_TREE(dst_);
+    struct rb_tree *src = _AVS_RB_TREE(src_);
+    AVS_RBTREE_ELEM(void) dst_elem = avs_rbtree_first__(dst_);
+    AVS_RBTREE_ELEM(void) src_elem = avs_rbtree_first__(src_);
+    rb_chain_t merged;
+    rb_chain_t leftovers;
+
+    assert(dst != src);
+    assert(dst->pool == src->pool
+           && "cannot merge trees that use different pools");
+    assert(!rb_is_cleanup_in_progress(rb_tree_const(dst_))
+           && !rb_is_cleanup_in_progress(rb_tree_const(src_))
+           && "avs_rbtree_merge__ called while tree deletion in progress");
+
+    if (!src_elem) {
+        return;
+    }
+
+    rb_chain_init(&merged);
+    rb_chain_init(&leftovers);
+    while (dst_elem || src_elem) {
+        int diff = !dst_elem ? 1 : !src_elem ? -1 : dst->cmp(dst_elem, src_elem);
+        if (diff <= 0) {
+            AVS_RBTREE_ELEM(void) next = avs_rbtree_elem_next__(dst_elem);
+            rb_chain_append(&merged, dst_elem);
+            dst_elem = next;
+        }
+        if (diff >= 0) {
+            AVS_RBTREE_ELEM(void) next = avs_rbtree_elem_next__(src_elem);
+            rb_chain_append(diff ? &merged : &leftovers, src_elem);
+            src_elem = next;
+        }
+    }
+
+    rb_rebuild(dst, &merged);
+    rb_rebuild(src, &leftovers);
+}
+
+AVS_RBTREE(void) avs_rbtree_split__(AVS_RBTREE(void) tree_,
+                                    const void *value) {
+    struct rb_tree *tree = _AVS_RB_TREE(tree_);
+    AVS_RBTREE(void) result;
+    AVS_RBTREE_ELEM(void) elem;
+    rb_chain_t lower;
+    rb_chain_t upper;
+
+    assert(!rb_is_cleanup_in_progress(rb_tree_const(tree_))
+           && "avs_rbtree_split__ called while tree deletion in progress");
+    assert(value);
+
+    if (tree->pool) {
+        result = avs_rbtree_new_with_pool__(tree->cmp, tree->pool,
+                                            tree->pool->elem_size);
+    } else {
+        result = avs_rbtree_new__(tree->cmp);
+    }
+    if (!result) {
+        return NULL;
+    }
+
+    rb_chain_init(&lower);
+    rb_chain_init(&upper);
+    elem = avs_rbtree_first__(tree_);
+    while (elem) {
+        AVS_RBTREE_ELEM(void) next = avs_rbtree_elem_next__(elem);
+        rb_chain_append(tree->cmp(elem, value) < 0 ? &lower : &upper, elem);
+        elem = next;
+    }
+
+    rb_rebuild(tree, &lower);
+    rb_rebuild(_AVS_RB_TREE(result), &upper);
+    return result;
+}
+
 static AVS_RBTREE_ELEM(void) rb_postorder_first(AVS_RBTREE_ELEM(void) node) {
     while (node) {
         if (_AVS_RB_LEFT(node)) {
@@ -867,9 +1514,9 @@ AVS_RBTREE_ELEM(void) avs_rbtree_cleanup_next__(AVS_RBTREE(void) tree) {
     next = rb_postorder_next(*tree);
     curr_ptr = rb_own_parent_ptr(_AVS_RB_TREE(tree), *tree);
 
-    _AVS_RB_NODE(*tree)->color = DETACHED;
-    _AVS_RB_PARENT(*tree) = NULL;
-    assert(AVS_RBTREE_SIZE(tree) > 0u);
+    _AVS_RB_SET_COLOR(*tree, DETACHED);
+    _AVS_RB_SET_PARENT(*tree, _AVS_RB_TREE(tree)->pool);
+    assert(_AVS_RB_TREE(tree)->size > 0u);
     --_AVS_RB_TREE(tree)->size;
     /* at this point, child nodes should be cleaned up */
     assert(_AVS_RB_LEFT(*tree) == NULL);
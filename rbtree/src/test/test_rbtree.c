@@ -18,6 +18,7 @@
 #include <string.h>
 #include <stdarg.h>
 
+#include <avsystem/commons/list.h>
 #include <avsystem/commons/log.h>
 #include <avsystem/commons/unit/test.h>
 
@@ -100,6 +101,9 @@ static void assert_rb_properties_hold_recursive(void *node,
         ++*out_black_height;
     }
     *out_size = 1 + left_size + right_size;
+#ifdef WITH_AVS_RBTREE_ORDER_STATISTICS
+    AVS_UNIT_ASSERT_EQUAL(_AVS_RB_NODE(node)->subtree_size, *out_size);
+#endif
 }
 
 static void assert_rb_properties_hold(AVS_RBTREE(int) tree_) {
@@ -163,7 +167,7 @@ static void assert_node_equal(int *node,
                               int *right) {
     AVS_UNIT_ASSERT_EQUAL(value, *node);
     AVS_UNIT_ASSERT_EQUAL_STRING(get_color_name(color),
-                                 get_color_name(_AVS_RB_NODE(node)->color));
+                                 get_color_name(_AVS_RB_COLOR(node)));
     AVS_UNIT_ASSERT_TRUE(parent == _AVS_RB_PARENT(node));
     AVS_UNIT_ASSERT_TRUE(left == _AVS_RB_LEFT(node));
     AVS_UNIT_ASSERT_TRUE(right == _AVS_RB_RIGHT(node));
@@ -600,12 +604,12 @@ AVS_UNIT_TEST(rbtree, insert_case2) {
     AVS_UNIT_ASSERT_TRUE(root == _AVS_RB_PARENT(elem));
     AVS_UNIT_ASSERT_NULL(_AVS_RB_LEFT(elem));
     AVS_UNIT_ASSERT_NULL(_AVS_RB_RIGHT(elem));
-    AVS_UNIT_ASSERT_EQUAL(BLACK, _AVS_RB_NODE(root)->color);
+    AVS_UNIT_ASSERT_EQUAL(BLACK, _AVS_RB_COLOR(root));
 
     AVS_UNIT_ASSERT_NULL(_AVS_RB_PARENT(root));
     AVS_UNIT_ASSERT_TRUE(elem == _AVS_RB_LEFT(root));
     AVS_UNIT_ASSERT_NULL(_AVS_RB_RIGHT(root));
-    AVS_UNIT_ASSERT_EQUAL(RED, _AVS_RB_NODE(elem)->color);
+    AVS_UNIT_ASSERT_EQUAL(RED, _AVS_RB_COLOR(elem));
 
     assert_rb_properties_hold(tree);
 
@@ -1014,3 +1018,407 @@ AVS_UNIT_TEST(rbtree, clone_segfault) {
     AVS_UNIT_ASSERT_NULL(AVS_RBTREE_SIMPLE_CLONE(tree));
     AVS_RBTREE_DELETE(&tree);
 }
+
+AVS_UNIT_TEST(rbtree, pool_private) {
+    AVS_RBTREE(int) tree = AVS_RBTREE_NEW_WITH_POOL(int, int_comparator, NULL);
+    AVS_UNIT_ASSERT_NOT_NULL(tree);
+    avs_rbtree_pool_t *pool = _AVS_RB_TREE(tree)->pool;
+    AVS_UNIT_ASSERT_NOT_NULL(pool);
+
+    for (int i = 0; i < 1000; ++i) {
+        AVS_RBTREE_ELEM(int) elem = AVS_RBTREE_ELEM_NEW_IN(tree, int);
+        AVS_UNIT_ASSERT_NOT_NULL(elem);
+        AVS_UNIT_ASSERT_EQUAL(*elem, 0);
+        *elem = (i * 7919) % 1000;
+        AVS_UNIT_ASSERT_TRUE(elem == AVS_RBTREE_INSERT(tree, elem));
+    }
+    assert_rb_properties_hold(tree);
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(tree), 1000);
+    AVS_UNIT_ASSERT_EQUAL(pool->nodes_in_use, 1000);
+    AVS_UNIT_ASSERT_TRUE(pool->slabs && pool->slabs->next);
+
+    int expected = 0;
+    AVS_RBTREE_ELEM(int) it;
+    AVS_RBTREE_FOREACH(it, tree) {
+        AVS_UNIT_ASSERT_EQUAL(*it, expected++);
+    }
+
+    /* freed nodes are reused by subsequent allocations */
+    AVS_RBTREE_ELEM(int) elem = AVS_RBTREE_FIND(tree, INTPTR(500));
+    AVS_RBTREE_ELEM(int) freed = elem;
+    AVS_RBTREE_DELETE_ELEM(tree, &elem);
+    AVS_UNIT_ASSERT_NULL(elem);
+    AVS_UNIT_ASSERT_EQUAL(pool->nodes_in_use, 999);
+    assert_rb_properties_hold(tree);
+
+    elem = AVS_RBTREE_ELEM_NEW_IN(tree, int);
+    AVS_UNIT_ASSERT_TRUE(elem == freed);
+    AVS_UNIT_ASSERT_EQUAL(*elem, 0);
+    *elem = 500;
+    AVS_UNIT_ASSERT_TRUE(elem == AVS_RBTREE_INSERT(tree, elem));
+
+    /* detached pool nodes can be reinserted or freed without the tree */
+    elem = AVS_RBTREE_FIND(tree, INTPTR(42));
+    AVS_RBTREE_DETACH(tree, elem);
+    AVS_UNIT_ASSERT_TRUE(elem == AVS_RBTREE_INSERT(tree, elem));
+    AVS_RBTREE_DETACH(tree, elem);
+    AVS_RBTREE_ELEM_DELETE_DETACHED(&elem);
+    AVS_UNIT_ASSERT_EQUAL(pool->nodes_in_use, 999);
+
+    /* too large for the pool */
+    AVS_UNIT_ASSERT_NULL(AVS_RBTREE_ELEM_NEW_BUFFER_IN(tree, sizeof(int) + 1));
+
+    AVS_RBTREE_DELETE(&tree);
+    AVS_UNIT_ASSERT_NULL(tree);
+}
+
+AVS_UNIT_TEST(rbtree, pool_shared) {
+    avs_rbtree_pool_t *pool = AVS_RBTREE_POOL_NEW(int, 4);
+    AVS_UNIT_ASSERT_NOT_NULL(pool);
+    AVS_RBTREE(int) tree1 = AVS_RBTREE_NEW_WITH_POOL(int, int_comparator, pool);
+    AVS_RBTREE(int) tree2 = AVS_RBTREE_NEW_WITH_POOL(int, int_comparator, pool);
+    AVS_UNIT_ASSERT_NOT_NULL(tree1);
+    AVS_UNIT_ASSERT_NOT_NULL(tree2);
+
+    for (int i = 0; i < 10; ++i) {
+        AVS_RBTREE_ELEM(int) elem = AVS_RBTREE_ELEM_NEW_IN(tree1, int);
+        AVS_UNIT_ASSERT_NOT_NULL(elem);
+        *elem = i;
+        AVS_RBTREE_INSERT(tree1, elem);
+    }
+
+    /* nodes may be moved between trees sharing a pool */
+    AVS_RBTREE_ELEM(int) elem = AVS_RBTREE_FIND(tree1, INTPTR(3));
+    AVS_RBTREE_DETACH(tree1, elem);
+    AVS_RBTREE_INSERT(tree2, elem);
+
+    AVS_RBTREE(int) clone = AVS_RBTREE_SIMPLE_CLONE(tree1);
+    AVS_UNIT_ASSERT_NOT_NULL(clone);
+    AVS_UNIT_ASSERT_TRUE(_AVS_RB_TREE(clone)->pool == pool);
+    assert_rb_properties_hold(clone);
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(clone), 9);
+    AVS_UNIT_ASSERT_EQUAL(pool->nodes_in_use, 19);
+
+    AVS_RBTREE_DELETE(&clone);
+    AVS_RBTREE_DELETE(&tree1);
+    AVS_UNIT_ASSERT_EQUAL(pool->nodes_in_use, 1);
+    AVS_RBTREE_DELETE(&tree2);
+    AVS_UNIT_ASSERT_EQUAL(pool->nodes_in_use, 0);
+    avs_rbtree_pool_delete(&pool);
+    AVS_UNIT_ASSERT_NULL(pool);
+}
+
+AVS_UNIT_TEST(rbtree, pool_foreign_element) {
+    AVS_RBTREE(int) plain = AVS_RBTREE_NEW(int, int_comparator);
+    AVS_RBTREE(int) pooled1 =
+            AVS_RBTREE_NEW_WITH_POOL(int, int_comparator, NULL);
+    AVS_RBTREE(int) pooled2 =
+            AVS_RBTREE_NEW_WITH_POOL(int, int_comparator, NULL);
+    AVS_UNIT_ASSERT_NOT_NULL(plain);
+    AVS_UNIT_ASSERT_NOT_NULL(pooled1);
+    AVS_UNIT_ASSERT_NOT_NULL(pooled2);
+
+    AVS_RBTREE_ELEM(int) heap_elem = AVS_RBTREE_ELEM_NEW(int);
+    AVS_RBTREE_ELEM(int) pool_elem = AVS_RBTREE_ELEM_NEW_IN(pooled1, int);
+    AVS_UNIT_ASSERT_NOT_NULL(heap_elem);
+    AVS_UNIT_ASSERT_NOT_NULL(pool_elem);
+
+    AVS_UNIT_ASSERT_NULL(AVS_RBTREE_INSERT(pooled1, heap_elem));
+    AVS_UNIT_ASSERT_NULL(AVS_RBTREE_INSERT(pooled2, pool_elem));
+    AVS_UNIT_ASSERT_NULL(AVS_RBTREE_INSERT(plain, pool_elem));
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(plain), 0);
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(pooled1), 0);
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(pooled2), 0);
+
+    /* rejected elements are still detached and usable */
+    AVS_UNIT_ASSERT_TRUE(AVS_RBTREE_INSERT(plain, heap_elem) == heap_elem);
+    AVS_UNIT_ASSERT_TRUE(AVS_RBTREE_INSERT(pooled1, pool_elem) == pool_elem);
+
+    AVS_RBTREE_DELETE(&plain);
+    AVS_RBTREE_DELETE(&pooled1);
+    AVS_RBTREE_DELETE(&pooled2);
+}
+
+AVS_UNIT_TEST(rbtree, pool_alloc_failure) {
+    // tree and pool structures are allocated first
+    AVS_RBTREE(int) tree = AVS_RBTREE_NEW_WITH_POOL(int, int_comparator, NULL);
+    AVS_UNIT_ASSERT_NOT_NULL(tree);
+    avs_rbtree_pool_t *pool = _AVS_RB_TREE(tree)->pool;
+
+    // return NULL for the first slab
+    test_rb_alloc_null_countdown = 1;
+    AVS_UNIT_ASSERT_NULL(AVS_RBTREE_ELEM_NEW_IN(tree, int));
+
+    for (size_t i = 0; i < pool->nodes_per_slab; ++i) {
+        AVS_RBTREE_ELEM(int) elem = AVS_RBTREE_ELEM_NEW_IN(tree, int);
+        AVS_UNIT_ASSERT_NOT_NULL(elem);
+        *elem = (int) i;
+        AVS_RBTREE_INSERT(tree, elem);
+    }
+
+    // slab is full, allocating the next one fails
+    test_rb_alloc_null_countdown = 1;
+    AVS_UNIT_ASSERT_NULL(AVS_RBTREE_ELEM_NEW_IN(tree, int));
+
+    AVS_RBTREE_DELETE(&tree);
+}
+
+static void assert_tree_contains_range(AVS_RBTREE(int) tree,
+                                       int first, int step, size_t count) {
+    assert_rb_properties_hold(tree);
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(tree), count);
+
+    int expected = first;
+    AVS_RBTREE_ELEM(int) it;
+    AVS_RBTREE_FOREACH(it, tree) {
+        AVS_UNIT_ASSERT_EQUAL(*it, expected);
+        expected += step;
+    }
+}
+
+AVS_UNIT_TEST(rbtree, build_from_array) {
+    int values[1000];
+    for (int i = 0; i < (int) AVS_ARRAY_SIZE(values); ++i) {
+        values[i] = 2 * i;
+    }
+
+    for (size_t count = 0; count <= AVS_ARRAY_SIZE(values);
+            count += (count < 70 ? 1 : 93)) {
+        AVS_RBTREE(int) tree = AVS_RBTREE_NEW(int, int_comparator);
+        AVS_UNIT_ASSERT_SUCCESS(
+                AVS_RBTREE_BUILD_FROM_ARRAY(tree, values, count));
+        assert_tree_contains_range(tree, 0, 2, count);
+
+        /* tree is fully functional afterwards */
+        AVS_RBTREE_ELEM(int) elem = AVS_RBTREE_ELEM_NEW(int);
+        *elem = 1;
+        AVS_UNIT_ASSERT_TRUE(elem == AVS_RBTREE_INSERT(tree, elem));
+        assert_rb_properties_hold(tree);
+
+        /* only empty trees can be built */
+        AVS_UNIT_ASSERT_FAILED(
+                AVS_RBTREE_BUILD_FROM_ARRAY(tree, values, count));
+        AVS_RBTREE_DELETE(&tree);
+    }
+}
+
+AVS_UNIT_TEST(rbtree, build_from_array_errors) {
+    const int unsorted[] = { 1, 2, 3, 5, 4, 6 };
+    const int duplicates[] = { 1, 2, 2, 3 };
+    AVS_RBTREE(int) tree = AVS_RBTREE_NEW_WITH_POOL(int, int_comparator, NULL);
+
+    AVS_UNIT_ASSERT_FAILED(AVS_RBTREE_BUILD_FROM_ARRAY(
+            tree, unsorted, AVS_ARRAY_SIZE(unsorted)));
+    AVS_UNIT_ASSERT_FAILED(AVS_RBTREE_BUILD_FROM_ARRAY(
+            tree, duplicates, AVS_ARRAY_SIZE(duplicates)));
+    AVS_UNIT_ASSERT_NULL(*tree);
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(tree), 0);
+    AVS_UNIT_ASSERT_EQUAL(_AVS_RB_TREE(tree)->pool->nodes_in_use, 0);
+    AVS_RBTREE_DELETE(&tree);
+
+    tree = AVS_RBTREE_NEW(int, int_comparator);
+    // return NULL for the fourth node
+    test_rb_alloc_null_countdown = 4;
+    AVS_UNIT_ASSERT_FAILED(AVS_RBTREE_BUILD_FROM_ARRAY(
+            tree, unsorted, AVS_ARRAY_SIZE(unsorted)));
+    AVS_UNIT_ASSERT_NULL(*tree);
+    AVS_RBTREE_DELETE(&tree);
+}
+
+AVS_UNIT_TEST(rbtree, build_from_list) {
+    AVS_LIST(int) list = NULL;
+    AVS_LIST(int) *tail = &list;
+    for (int i = 0; i < 100; ++i) {
+        *tail = AVS_LIST_NEW_ELEMENT(int);
+        AVS_UNIT_ASSERT_NOT_NULL(*tail);
+        **tail = 3 * i;
+        tail = AVS_LIST_NEXT_PTR(tail);
+    }
+
+    AVS_RBTREE(int) tree = AVS_RBTREE_NEW_WITH_POOL(int, int_comparator, NULL);
+    AVS_UNIT_ASSERT_SUCCESS(AVS_RBTREE_BUILD_FROM_LIST(tree, list));
+    assert_tree_contains_range(tree, 0, 3, 100);
+    AVS_RBTREE_DELETE(&tree);
+
+    tree = AVS_RBTREE_NEW(int, int_comparator);
+    AVS_UNIT_ASSERT_SUCCESS(AVS_RBTREE_BUILD_FROM_LIST(tree, (int *) NULL));
+    assert_tree_contains_range(tree, 0, 3, 0);
+
+    *AVS_LIST_NTH(list, 50) = 1;
+    AVS_UNIT_ASSERT_FAILED(AVS_RBTREE_BUILD_FROM_LIST(tree, list));
+    AVS_UNIT_ASSERT_NULL(*tree);
+    AVS_RBTREE_DELETE(&tree);
+    AVS_LIST_CLEAR(&list);
+}
+
+AVS_UNIT_TEST(rbtree, merge) {
+    int evens[50];
+    int triples[40];
+    for (int i = 0; i < (int) AVS_ARRAY_SIZE(evens); ++i) {
+        evens[i] = 2 * i;
+    }
+    for (int i = 0; i < (int) AVS_ARRAY_SIZE(triples); ++i) {
+        triples[i] = 3 * i;
+    }
+
+    AVS_RBTREE(int) dst = AVS_RBTREE_NEW(int, int_comparator);
+    AVS_RBTREE(int) src = AVS_RBTREE_NEW(int, int_comparator);
+    AVS_UNIT_ASSERT_SUCCESS(AVS_RBTREE_BUILD_FROM_ARRAY(
+            dst, evens, AVS_ARRAY_SIZE(evens)));
+    AVS_UNIT_ASSERT_SUCCESS(AVS_RBTREE_BUILD_FROM_ARRAY(
+            src, triples, AVS_ARRAY_SIZE(triples)));
+
+    AVS_RBTREE_ELEM(int) dst_zero = AVS_RBTREE_FIND(dst, INTPTR(0));
+    AVS_RBTREE_ELEM(int) src_three = AVS_RBTREE_FIND(src, INTPTR(3));
+    AVS_RBTREE_MERGE(dst, src);
+
+    /* multiples of 6 are present in both trees and stay in src */
+    assert_tree_contains_range(src, 0, 6, 17);
+    assert_rb_properties_hold(dst);
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(dst), 50 + 40 - 17);
+    int prev = -1;
+    AVS_RBTREE_ELEM(int) it;
+    AVS_RBTREE_FOREACH(it, dst) {
+        AVS_UNIT_ASSERT_TRUE(*it > prev);
+        AVS_UNIT_ASSERT_TRUE(*it % 2 == 0 || (*it % 3 == 0 && *it < 120));
+        prev = *it;
+    }
+
+    /* elements are moved, not copied */
+    AVS_UNIT_ASSERT_TRUE(AVS_RBTREE_FIND(dst, INTPTR(0)) == dst_zero);
+    AVS_UNIT_ASSERT_TRUE(AVS_RBTREE_FIND(dst, INTPTR(3)) == src_three);
+
+    /* merging into an empty tree */
+    AVS_RBTREE(int) empty = AVS_RBTREE_NEW(int, int_comparator);
+    AVS_RBTREE_MERGE(empty, src);
+    assert_tree_contains_range(empty, 0, 6, 17);
+    assert_tree_contains_range(src, 0, 6, 0);
+
+    AVS_RBTREE_DELETE(&empty);
+    AVS_RBTREE_DELETE(&src);
+    AVS_RBTREE_DELETE(&dst);
+}
+
+AVS_UNIT_TEST(rbtree, split) {
+    int values[100];
+    for (int i = 0; i < (int) AVS_ARRAY_SIZE(values); ++i) {
+        values[i] = 2 * i;
+    }
+
+    for (int key = -1; key <= 200; key += 7) {
+        AVS_RBTREE(int) tree =
+                AVS_RBTREE_NEW_WITH_POOL(int, int_comparator, NULL);
+        AVS_UNIT_ASSERT_SUCCESS(AVS_RBTREE_BUILD_FROM_ARRAY(
+                tree, values, AVS_ARRAY_SIZE(values)));
+
+        AVS_RBTREE(int) upper = AVS_RBTREE_SPLIT(tree, &key);
+        AVS_UNIT_ASSERT_NOT_NULL(upper);
+        AVS_UNIT_ASSERT_TRUE(_AVS_RB_TREE(upper)->pool
+                             == _AVS_RB_TREE(tree)->pool);
+
+        size_t lower_count = key < 0 ? 0 : (size_t) (key + 1) / 2;
+        if (lower_count > AVS_ARRAY_SIZE(values)) {
+            lower_count = AVS_ARRAY_SIZE(values);
+        }
+        assert_tree_contains_range(tree, 0, 2, lower_count);
+        assert_tree_contains_range(upper, 2 * (int) lower_count, 2,
+                                   AVS_ARRAY_SIZE(values) - lower_count);
+
+        /* the pool outlives the source tree */
+        AVS_RBTREE_DELETE(&tree);
+        AVS_RBTREE_ELEM(int) elem = AVS_RBTREE_ELEM_NEW_IN(upper, int);
+        AVS_UNIT_ASSERT_NOT_NULL(elem);
+        *elem = 1000;
+        AVS_UNIT_ASSERT_TRUE(elem == AVS_RBTREE_INSERT(upper, elem));
+        AVS_RBTREE_DELETE(&upper);
+    }
+}
+
+static void assert_nth_and_rank_consistent(AVS_RBTREE(int) tree) {
+    size_t index = 0;
+    AVS_RBTREE_ELEM(int) it;
+    AVS_RBTREE_FOREACH(it, tree) {
+        AVS_UNIT_ASSERT_TRUE(AVS_RBTREE_NTH(tree, index) == it);
+        AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_RANK(tree, it), index);
+        ++index;
+    }
+    AVS_UNIT_ASSERT_EQUAL(index, AVS_RBTREE_SIZE(tree));
+    AVS_UNIT_ASSERT_NULL(AVS_RBTREE_NTH(tree, index));
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_RANK(tree, AVS_RBTREE_LAST(tree)),
+                          index ? index - 1 : 0);
+}
+
+AVS_UNIT_TEST(rbtree, nth_and_rank) {
+    AVS_RBTREE(int) tree = AVS_RBTREE_NEW(int, int_comparator);
+    assert_nth_and_rank_consistent(tree);
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_RANK(tree, AVS_RBTREE_FIRST(tree)), 0);
+
+    /* churn the tree so that rotations of all kinds happen */
+    for (int i = 0; i < 300; ++i) {
+        AVS_RBTREE_ELEM(int) elem = AVS_RBTREE_ELEM_NEW(int);
+        AVS_UNIT_ASSERT_NOT_NULL(elem);
+        *elem = (i * 37) % 300;
+        AVS_UNIT_ASSERT_TRUE(elem == AVS_RBTREE_INSERT(tree, elem));
+    }
+    assert_rb_properties_hold(tree);
+    assert_nth_and_rank_consistent(tree);
+    for (int i = 0; i < 300; i += 3) {
+        AVS_RBTREE_ELEM(int) elem =
+                AVS_RBTREE_FIND(tree, INTPTR((i * 7) % 300));
+        AVS_RBTREE_DELETE_ELEM(tree, &elem);
+    }
+    assert_rb_properties_hold(tree);
+    assert_nth_and_rank_consistent(tree);
+
+    /* counting elements less than a value */
+    AVS_UNIT_ASSERT_EQUAL(
+            AVS_RBTREE_RANK(tree, AVS_RBTREE_LOWER_BOUND(tree, INTPTR(150))),
+            100);
+    AVS_UNIT_ASSERT_EQUAL(
+            AVS_RBTREE_RANK(tree, AVS_RBTREE_LOWER_BOUND(tree, INTPTR(1000))),
+            AVS_RBTREE_SIZE(tree));
+
+    /* trees created in bulk and their clones are augmented as well */
+    AVS_RBTREE(int) clone = AVS_RBTREE_SIMPLE_CLONE(tree);
+    AVS_UNIT_ASSERT_NOT_NULL(clone);
+    assert_rb_properties_hold(clone);
+    assert_nth_and_rank_consistent(clone);
+    AVS_RBTREE(int) upper = AVS_RBTREE_SPLIT(clone, INTPTR(100));
+    AVS_UNIT_ASSERT_NOT_NULL(upper);
+    assert_rb_properties_hold(upper);
+    assert_nth_and_rank_consistent(upper);
+
+    AVS_RBTREE_DELETE(&upper);
+    AVS_RBTREE_DELETE(&clone);
+    AVS_RBTREE_DELETE(&tree);
+}
+
+#ifdef WITH_AVS_RBTREE_COMPACT_NODES
+AVS_UNIT_TEST(rbtree, compact_node_header) {
+#ifdef WITH_AVS_RBTREE_ORDER_STATISTICS
+    const size_t expected_header_size = 3 * sizeof(void *) + sizeof(size_t);
+#else
+    const size_t expected_header_size = 3 * sizeof(void *);
+#endif
+    if (expected_header_size % sizeof(rb_value_align_t) == 0) {
+        AVS_UNIT_ASSERT_EQUAL(_AVS_NODE_SPACE__, expected_header_size);
+    }
+
+    AVS_RBTREE(int) tree = make_full_3level_tree();
+    AVS_RBTREE_ELEM(int) elem = AVS_RBTREE_FIND(tree, INTPTR(3));
+    AVS_UNIT_ASSERT_NOT_NULL(elem);
+    AVS_UNIT_ASSERT_EQUAL(RED, _AVS_RB_COLOR(elem));
+
+    /* changing the color must not affect the parent and vice versa */
+    AVS_RBTREE_ELEM(int) parent = (AVS_RBTREE_ELEM(int)) _AVS_RB_PARENT(elem);
+    _AVS_RB_SET_COLOR(elem, BLACK);
+    AVS_UNIT_ASSERT_TRUE(parent == _AVS_RB_PARENT(elem));
+    _AVS_RB_SET_PARENT(elem, NULL);
+    AVS_UNIT_ASSERT_EQUAL(BLACK, _AVS_RB_COLOR(elem));
+    _AVS_RB_SET_PARENT(elem, parent);
+    _AVS_RB_SET_COLOR(elem, RED);
+    assert_rb_properties_hold(tree);
+
+    AVS_RBTREE_DELETE(&tree);
+}
+#endif // WITH_AVS_RBTREE_COMPACT_NODES
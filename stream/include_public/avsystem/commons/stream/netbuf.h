@@ -34,6 +34,27 @@ int avs_stream_netbuf_transfer(avs_stream_abstract_t *destination,
 
 int avs_stream_netbuf_out_buffer_left(avs_stream_abstract_t *str);
 
+/**
+ * Writes data gathered from multiple memory blocks to a netbuf stream, as if
+ * they were concatenated and passed to @ref avs_stream_write.
+ *
+ * Data that fits in the output buffer is copied there, as usual. Otherwise,
+ * the data already buffered and the blocks are sent using a single
+ * @ref avs_net_socket_send_v call where possible, without copying the blocks.
+ * The data is not split into separate sends at the block boundaries, so this
+ * is only intended for stream-oriented sockets.
+ *
+ * @param str       netbuf stream to write to.
+ * @param iov       Array of memory blocks to write, in order.
+ * @param iov_count Number of elements in @p iov.
+ *
+ * @returns 0 on success, or a negative value in case of error, including when
+ *          @p str is not a netbuf stream.
+ */
+int avs_stream_netbuf_write_v(avs_stream_abstract_t *str,
+                              const avs_iovec_t *iov,
+                              size_t iov_count);
+
 void avs_stream_netbuf_set_recv_timeout(avs_stream_abstract_t *str,
                                         avs_time_duration_t timeout);
 
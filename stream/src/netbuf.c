@@ -83,6 +83,59 @@ static int buffered_netstream_write_some(avs_stream_abstract_t *stream_,
     }
 }
 
+/* number of blocks, including the buffered data, sent with a single
+ * avs_net_socket_send_v() call by avs_stream_netbuf_write_v() */
+#define NETBUF_SEND_IOV_BATCH 8
+
+static int buffered_netstream_write_v(buffered_netstream_t *stream,
+                                      const avs_iovec_t *iov,
+                                      size_t iov_count) {
+    avs_iovec_t batch[NETBUF_SEND_IOV_BATCH];
+    size_t total_length = 0;
+    size_t i;
+    int result;
+
+    for (i = 0; i < iov_count; ++i) {
+        if (total_length + iov[i].length < total_length) {
+            LOG(ERROR, "data to write too long");
+            return -1;
+        }
+        total_length += iov[i].length;
+    }
+    if (total_length < avs_buffer_space_left(stream->out_buffer)) {
+        for (i = 0; i < iov_count; ++i) {
+            if (avs_buffer_append_bytes(stream->out_buffer,
+                                        iov[i].base, iov[i].length)) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if (!avs_buffer_data_size(stream->out_buffer)) {
+        WRAP_ERRNO(stream, result,
+                   avs_net_socket_send_v(stream->socket, iov, iov_count));
+        return result;
+    }
+    if (iov_count >= NETBUF_SEND_IOV_BATCH) {
+        if ((result = out_buffer_flush(stream))) {
+            return result;
+        }
+        WRAP_ERRNO(stream, result,
+                   avs_net_socket_send_v(stream->socket, iov, iov_count));
+        return result;
+    }
+    /* send the buffered data together with the new blocks */
+    batch[0].base = avs_buffer_data(stream->out_buffer);
+    batch[0].length = avs_buffer_data_size(stream->out_buffer);
+    memcpy(&batch[1], iov, iov_count * sizeof(*iov));
+    WRAP_ERRNO(stream, result,
+               avs_net_socket_send_v(stream->socket, batch, iov_count + 1));
+    if (!result) {
+        avs_buffer_reset(stream->out_buffer);
+    }
+    return result;
+}
+
 static int
 buffered_netstream_nonblock_write_ready(avs_stream_abstract_t *stream_,
                                         size_t *out_ready_capacity_bytes) {
@@ -411,6 +464,18 @@ int avs_stream_netbuf_out_buffer_left(avs_stream_abstract_t *str) {
     return (int) avs_buffer_space_left(stream->out_buffer);
 }
 
+int avs_stream_netbuf_write_v(avs_stream_abstract_t *str,
+                              const avs_iovec_t *iov,
+                              size_t iov_count) {
+    buffered_netstream_t *stream = (buffered_netstream_t *) str;
+    if (stream->vtable != &buffered_netstream_vtable) {
+        LOG(ERROR, "not a buffered_netstream");
+        return -1;
+    }
+    stream->errno_ = 0;
+    return buffered_netstream_write_v(stream, iov, iov_count);
+}
+
 void avs_stream_netbuf_set_recv_timeout(avs_stream_abstract_t *str,
                                         avs_time_duration_t timeout) {
     buffered_netstream_t *stream = (buffered_netstream_t *) str;
@@ -47,6 +47,11 @@ INCLUDE_WHITELIST = {
 }
 
 CONDITIONAL_WHITELIST = {
+    (r'buffer/src/counter', r'stdatomic\.h'),
+    (r'hashmap/src/hashmap', r'emmintrin\.h'),
+    (r'commons/log\.h', r'stdatomic\.h'),
+    (r'log/src/log', r'sched\.h'),
+    (r'log/src/log', r'stdatomic\.h'),
     (r'mbedtls', r'mbedtls/.*'),
     (r'openssl', r'openssl/.*'),
     (r'openssl', r'sys/time\.h'),
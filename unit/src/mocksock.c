@@ -152,7 +152,8 @@ static const avs_net_socket_v_table_t mock_vtable = {
     (avs_net_socket_get_local_port_t) unimplemented,
     mock_get_opt,
     mock_set_opt,
-    mock_errno
+    mock_errno,
+    NULL
 };
 
 static const char *cmd_type_to_string(mocksock_expected_command_type_t type) {
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_FLAT_MAP_H
+#define AVS_COMMONS_FLAT_MAP_H
+
+#include <stddef.h>
+
+#include <avsystem/commons/defs.h>
+#include <avsystem/commons/vector.h>
+
+/**
+ * @file flat_map.h
+ *
+ * Sorted associative container stored in a contiguous @ref AVS_VECTOR.
+ *
+ * The API mirrors @ref AVS_RBTREE, so that the two can be swapped with minimal
+ * code changes, but lookups are binary searches over contiguous memory, which
+ * is much more cache-friendly than traversing separately allocated tree nodes.
+ * Insertion and erasure are O(n), though, so this container is best suited for
+ * read-mostly tables of up to several hundred elements. Large tables can be
+ * built efficiently with @ref AVS_FLAT_MAP_APPEND_UNSORTED followed by
+ * @ref AVS_FLAT_MAP_BUILD.
+ *
+ * Differences from @ref AVS_RBTREE:
+ *
+ * - elements are stored by value, so @ref AVS_FLAT_MAP_INSERT takes a pointer
+ *   to a value to copy instead of a separately allocated element,
+ *
+ * - element pointers are invalidated by any operation that inserts or removes
+ *   elements,
+ *
+ * - @ref AVS_FLAT_MAP_ELEM_NEXT and @ref AVS_FLAT_MAP_ELEM_PREV also take the
+ *   map as an argument.
+ *
+ * The map object is an <c>AVS_VECTOR(type)</c>, so <c>(*map)[i]</c> accesses
+ * the i-th smallest element, and read-only AVS_VECTOR_* operations may be used
+ * on it. Modifying operations other than those declared here MUST NOT be used,
+ * as they could break the ordering.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Internal functions. Use macros defined below instead. */
+void **avs_flat_map_new__(size_t elem_size, avs_vector_comparator_func_t cmp);
+void *avs_flat_map_lower_bound__(void **map, const void *value);
+void *avs_flat_map_upper_bound__(void **map, const void *value);
+void *avs_flat_map_find__(void **map, const void *value);
+void *avs_flat_map_insert__(void **map, const void *value);
+int avs_flat_map_erase__(void **map, const void *value);
+void avs_flat_map_delete_elem__(void **map, void *elem);
+int avs_flat_map_append_unsorted__(void **map, const void *value);
+void avs_flat_map_build__(void **map);
+void *avs_flat_map_elem_next__(void **map, const void *elem);
+void *avs_flat_map_elem_prev__(void **map, const void *elem);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#define _AVS_FLAT_MAP_TYPECHECK(first_ptr_type, second_ptr_type) \
+    ((void) (sizeof((first_ptr_type) < (second_ptr_type))))
+
+#ifdef __cplusplus
+template <typename Func, typename T, typename Arg>
+static inline T *AVS_FLAT_MAP_CALL_WITH_ELEM_CAST__(const Func &func,
+                                                    T **map, const Arg &arg) {
+    return (T *) func((void **) map, arg);
+}
+#else
+#define AVS_FLAT_MAP_CALL_WITH_ELEM_CAST__(func, map, arg) \
+    ((AVS_TYPEOF_PTR(*(map))) func((void **) (map), (arg)))
+#endif
+
+/** Flat map type alias. */
+#define AVS_FLAT_MAP(type) AVS_VECTOR(type)
+
+/**
+ * Creates an empty flat map with elements of given @p type.
+ *
+ * @param type Type of elements stored in the map.
+ * @param cmp  Pointer to a function that compares two elements. The same rules
+ *             apply as for @ref avs_rbtree_element_comparator_t .
+ *
+ * @returns Created map object on success, NULL in case of error.
+ */
+#define AVS_FLAT_MAP_NEW(type, cmp) \
+    ((AVS_FLAT_MAP(type)) avs_flat_map_new__(sizeof(type), (cmp)))
+
+/**
+ * Releases given map and all its elements, and sets <c>*map_ptr</c> to NULL.
+ *
+ * To perform additional operations on each element before releasing the map,
+ * use @ref AVS_FLAT_MAP_CLEAR first.
+ *
+ * @param map_ptr Pointer to the map object to destroy.
+ */
+#define AVS_FLAT_MAP_DELETE(map_ptr) AVS_VECTOR_DELETE(map_ptr)
+
+/**
+ * Removes all elements from the map, executing the following block (if any)
+ * for each of them. The element about to be removed is available through
+ * @p elem.
+ *
+ * @code
+ * AVS_FLAT_MAP(entry_t) map = ...;
+ * entry_t *entry;
+ * AVS_FLAT_MAP_CLEAR(&map, entry) {
+ *     free(entry->value);
+ * }
+ * @endcode
+ *
+ * @param map_ptr Pointer to the map object to make empty.
+ * @param elem    Element pointer variable.
+ */
+#define AVS_FLAT_MAP_CLEAR(map_ptr, elem) AVS_VECTOR_CLEAR((map_ptr), (elem))
+
+/**
+ * Complexity: O(1).
+ *
+ * @returns Total number of elements stored in the map.
+ */
+#define AVS_FLAT_MAP_SIZE(map) AVS_VECTOR_SIZE(map)
+
+/**
+ * Inserts a copy of the value pointed to by @p val_ptr into the map, if an
+ * equivalent element does not yet exist in it.
+ *
+ * Complexity: O((log n) * c + n), where:
+ * - n - number of elements in @p map,
+ * - c - complexity of the comparator.
+ *
+ * @param map     Map to insert the element into.
+ * @param val_ptr Pointer to the value to insert.
+ *
+ * @returns:
+ * - pointer to the inserted element on success,
+ * - a pointer to the equivalent element if one already existed in the map,
+ * - NULL in case of memory allocation failure.
+ */
+#define AVS_FLAT_MAP_INSERT(map, val_ptr) \
+    (_AVS_FLAT_MAP_TYPECHECK(*(map), (val_ptr)), \
+     AVS_FLAT_MAP_CALL_WITH_ELEM_CAST__(avs_flat_map_insert__, (map), \
+                                        (val_ptr)))
+
+/**
+ * Removes the element equivalent to the value pointed to by @p val_ptr from
+ * the map, if it exists.
+ *
+ * Complexity: O((log n) * c + n).
+ *
+ * @returns 0 if the element has been removed, or a negative value if the map
+ *          does not contain such element.
+ */
+#define AVS_FLAT_MAP_ERASE(map, val_ptr) \
+    (_AVS_FLAT_MAP_TYPECHECK(*(map), (val_ptr)), \
+     avs_flat_map_erase__((void **) (map), (val_ptr)))
+
+/**
+ * Removes the element pointed to by <c>*elem_ptr</c> from the map, and sets
+ * <c>*elem_ptr</c> to NULL.
+ *
+ * NOTE: when <c>*elem_ptr</c> does not point to an element of @p map, the
+ * behavior is undefined.
+ *
+ * Complexity: O(n).
+ */
+#define AVS_FLAT_MAP_DELETE_ELEM(map, elem_ptr) \
+    do { \
+        _AVS_FLAT_MAP_TYPECHECK(*(map), *(elem_ptr)); \
+        avs_flat_map_delete_elem__((void **) (map), *(elem_ptr)); \
+        *(elem_ptr) = NULL; \
+    } while (0)
+
+/**
+ * Finds the first element in @p map that is greater or equal to @p val_ptr.
+ *
+ * Complexity: O((log n) * c).
+ *
+ * @returns Element pointer on success, NULL if all elements present in @p map
+ *          are strictly less than @p val_ptr.
+ */
+#define AVS_FLAT_MAP_LOWER_BOUND(map, val_ptr) \
+    (_AVS_FLAT_MAP_TYPECHECK(*(map), (val_ptr)), \
+     AVS_FLAT_MAP_CALL_WITH_ELEM_CAST__(avs_flat_map_lower_bound__, (map), \
+                                        (val_ptr)))
+
+/**
+ * Finds the first element in @p map that is strictly greater than
+ * @p val_ptr.
+ *
+ * Complexity: O((log n) * c).
+ *
+ * @returns Element pointer on success, NULL if all elements present in @p map
+ *          are less or equal to @p val_ptr.
+ */
+#define AVS_FLAT_MAP_UPPER_BOUND(map, val_ptr) \
+    (_AVS_FLAT_MAP_TYPECHECK(*(map), (val_ptr)), \
+     AVS_FLAT_MAP_CALL_WITH_ELEM_CAST__(avs_flat_map_upper_bound__, (map), \
+                                        (val_ptr)))
+
+/**
+ * Finds an element equivalent to @p val_ptr in @p map.
+ *
+ * Complexity: O((log n) * c).
+ *
+ * @returns Found element pointer on success, NULL if @p map does not contain
+ *          such element.
+ */
+#define AVS_FLAT_MAP_FIND(map, val_ptr) \
+    (_AVS_FLAT_MAP_TYPECHECK(*(map), (val_ptr)), \
+     AVS_FLAT_MAP_CALL_WITH_ELEM_CAST__(avs_flat_map_find__, (map), \
+                                        (val_ptr)))
+
+/**
+ * Appends a copy of the value pointed to by @p val_ptr at the end of the map,
+ * without maintaining the ordering.
+ *
+ * This allows building a large map in O(n log n) total time, instead of
+ * O(n^2) for repeated @ref AVS_FLAT_MAP_INSERT. After appending all elements,
+ * @ref AVS_FLAT_MAP_BUILD MUST be called before any other operation on the
+ * map.
+ *
+ * Complexity: amortized O(1).
+ *
+ * @returns 0 on success, negative value in case of memory allocation failure.
+ */
+#define AVS_FLAT_MAP_APPEND_UNSORTED(map, val_ptr) \
+    (_AVS_FLAT_MAP_TYPECHECK(*(map), (val_ptr)), \
+     avs_flat_map_append_unsorted__((void **) (map), (val_ptr)))
+
+/**
+ * Restores the ordering of the map after a series of
+ * @ref AVS_FLAT_MAP_APPEND_UNSORTED calls. If there are equivalent elements,
+ * only one of them (unspecified which) is retained.
+ *
+ * Complexity: O((n log n) * c).
+ */
+#define AVS_FLAT_MAP_BUILD(map) avs_flat_map_build__((void **) (map))
+
+/**
+ * @returns the first (smallest) element in @p map or NULL if it is empty.
+ */
+#define AVS_FLAT_MAP_FIRST(map) AVS_VECTOR_FRONT(map)
+
+/**
+ * @returns the last (greatest) element in @p map or NULL if it is empty.
+ */
+#define AVS_FLAT_MAP_LAST(map) AVS_VECTOR_BACK(map)
+
+/**
+ * Complexity: O(1).
+ *
+ * @returns @p elem successor in @p map, or NULL if there is none.
+ */
+#define AVS_FLAT_MAP_ELEM_NEXT(map, elem) \
+    AVS_FLAT_MAP_CALL_WITH_ELEM_CAST__(avs_flat_map_elem_next__, (map), (elem))
+
+/**
+ * Complexity: O(1).
+ *
+ * @returns @p elem predecessor in @p map, or NULL if there is none.
+ */
+#define AVS_FLAT_MAP_ELEM_PREV(map, elem) \
+    AVS_FLAT_MAP_CALL_WITH_ELEM_CAST__(avs_flat_map_elem_prev__, (map), (elem))
+
+/** Convenience macro for forward iteration on elements of @p map. */
+#define AVS_FLAT_MAP_FOREACH(it, map) \
+    for (_AVS_FLAT_MAP_TYPECHECK(*(map), (it)), \
+            (it) = AVS_FLAT_MAP_FIRST(map); \
+            (it); \
+            (it) = AVS_FLAT_MAP_ELEM_NEXT((map), (it)))
+
+/** Convenience macro for backward iteration on elements of @p map. */
+#define AVS_FLAT_MAP_FOREACH_REVERSE(it, map) \
+    for (_AVS_FLAT_MAP_TYPECHECK(*(map), (it)), \
+            (it) = AVS_FLAT_MAP_LAST(map); \
+            (it); \
+            (it) = AVS_FLAT_MAP_ELEM_PREV((map), (it)))
+
+#endif /* AVS_COMMONS_FLAT_MAP_H */
@@ -65,6 +65,15 @@ typedef struct avs_vector_desc_struct avs_vector_desc_t;
 typedef int (*avs_vector_comparator_func_t)(const void *a,
                                             const void *b);
 
+/**
+ * Key extractor type for @ref AVS_VECTOR_RADIX_SORT_BY.
+ *
+ * @param elem      Pointer to the vector element.
+ *
+ * @return Unsigned integer sort key of the element.
+ */
+typedef uint64_t (*avs_vector_radix_key_func_t)(const void *elem);
+
 /**
  * @name Internal functions
  *
@@ -77,8 +86,14 @@ typedef int (*avs_vector_comparator_func_t)(const void *a,
  */
 /**@{*/
 void **avs_vector_new__(size_t elem_size);
+void **avs_vector_new_small__(size_t elem_size, size_t inline_capacity);
 void avs_vector_delete__(void ***ptr);
 int avs_vector_push__(void ***ptr, const void *elemptr);
+int avs_vector_push_n__(void ***ptr, const void *elems, size_t count);
+int avs_vector_insert_range__(void ***ptr, size_t index,
+                              const void *elems, size_t count);
+void avs_vector_erase_range__(void ***ptr, size_t beg, size_t end);
+void *avs_vector_emplace__(void ***ptr);
 void *avs_vector_pop__(void ***ptr);
 void *avs_vector_remove__(void ***ptr, size_t index);
 
@@ -90,6 +105,10 @@ void *avs_vector_back__(void **vec);
 void avs_vector_sort_range__(void ***ptr, size_t beg, size_t end,
                              avs_vector_comparator_func_t cmp);
 void avs_vector_sort__(void ***ptr, avs_vector_comparator_func_t cmp);
+int avs_vector_radix_sort__(void ***ptr, size_t key_offset, size_t key_width);
+int avs_vector_radix_sort_by__(void ***ptr,
+                               avs_vector_radix_key_func_t key_func,
+                               size_t key_width);
 void avs_vector_swap__(void ***ptr, size_t i, size_t j);
 void avs_vector_reverse__(void ***ptr);
 void avs_vector_reverse_range__(void ***ptr, size_t beg, size_t end);
@@ -119,6 +138,36 @@ int avs_vector_reserve__(void ***ptr, size_t num_elements);
 #define AVS_VECTOR_NEW(element_type) \
     ((AVS_VECTOR(element_type)) avs_vector_new__(sizeof(element_type)))
 
+/**
+ * Vector type with inline storage for a number of elements; see
+ * @ref AVS_SMALL_VECTOR_NEW. It is the same type as
+ * <c>AVS_VECTOR(element_type)</c> and all AVS_VECTOR_* macros work on it.
+ *
+ * @param element_type Type of the vector element.
+ */
+#define AVS_SMALL_VECTOR(element_type) AVS_VECTOR(element_type)
+
+/**
+ * Initializes a vector that keeps up to @p inline_capacity elements in the
+ * same heap block as the vector descriptor.
+ *
+ * A regular vector requires two allocations (the descriptor and the element
+ * storage) as soon as anything is pushed to it. A small vector requires just
+ * one until it grows beyond @p inline_capacity elements, at which point the
+ * elements are moved to a separately allocated block, like in a regular
+ * vector. @ref AVS_VECTOR_FIT moves them back if they fit again.
+ *
+ * Note: pointers to elements are invalidated when the elements are moved
+ * between the inline and heap storage, just like after any reallocation.
+ *
+ * @param element_type    Type of the data contained by the vector.
+ * @param inline_capacity Number of elements that fit in the inline storage.
+ * @return  NULL on failure, non-NULL value otherwise.
+ */
+#define AVS_SMALL_VECTOR_NEW(element_type, inline_capacity) \
+    ((AVS_SMALL_VECTOR(element_type)) \
+            avs_vector_new_small__(sizeof(element_type), (inline_capacity)))
+
 /**
  * Frees internal storage associated with vector, and sets @p *vecptr to NULL.
  *
@@ -148,6 +197,98 @@ int avs_vector_reserve__(void ***ptr, size_t num_elements);
 #define AVS_VECTOR_PUSH(vecptr, elemptr) \
     ((void) (sizeof((elemptr) < **(vecptr))), \
             avs_vector_push__((void ***) (vecptr), (const void *) (elemptr)))
+
+/**
+ * Copies @p count consecutive elements from the array pointed by @p elemsptr
+ * and places them at the end of the vector, growing it at most once.
+ *
+ * Note: If this operation fails then the vector pointed by @p vecptr remains
+ *       unchanged.
+ *
+ * WARNING: @p elemsptr MUST NOT point into the vector itself, as its storage
+ * may be reallocated.
+ *
+ * @param vecptr    Pointer to the initialized AVS_VECTOR
+ * @param elemsptr  Pointer to the first element to copy
+ * @param count     Number of elements to copy
+ * @return 0 on success, negative value in case of an error (for example when
+ *         there is not enough memory)
+ *
+ * Time complexity: amortized O(count)
+ */
+#define AVS_VECTOR_PUSH_N(vecptr, elemsptr, count) \
+    ((void) (sizeof((elemsptr) < **(vecptr))), \
+            avs_vector_push_n__((void ***) (vecptr), \
+                                (const void *) (elemsptr), (count)))
+
+/**
+ * Copies @p count consecutive elements from the array pointed by @p elemsptr
+ * and inserts them before position @p index, moving the elements that follow
+ * using a single memmove.
+ *
+ * Note: If this operation fails then the vector pointed by @p vecptr remains
+ *       unchanged.
+ *
+ * WARNING: @p elemsptr MUST NOT point into the vector itself, and @p index
+ * MUST NOT be greater than AVS_VECTOR_SIZE(*vecptr), otherwise the behavior
+ * is undefined.
+ *
+ * @param vecptr    Pointer to the initialized AVS_VECTOR
+ * @param index     Position at which the first inserted element will be placed
+ * @param elemsptr  Pointer to the first element to copy
+ * @param count     Number of elements to copy
+ * @return 0 on success, negative value in case of an error (for example when
+ *         there is not enough memory)
+ *
+ * Time complexity: O(n + count)
+ */
+#define AVS_VECTOR_INSERT_RANGE(vecptr, index, elemsptr, count) \
+    ((void) (sizeof((elemsptr) < **(vecptr))), \
+            avs_vector_insert_range__((void ***) (vecptr), (index), \
+                                      (const void *) (elemsptr), (count)))
+
+/**
+ * Removes elements in range [beg, end) from the vector, moving the elements
+ * that follow using a single memmove. The capacity remains unchanged.
+ *
+ * WARNING: range [beg, end) MUST be valid, i.e. beg <= end and
+ * end <= AVS_VECTOR_SIZE(*vecptr), otherwise the behavior is undefined.
+ *
+ * @param vecptr    Pointer to the initialized AVS_VECTOR
+ * @param beg       Index of the first element to remove
+ * @param end       Index of the last element to remove + 1
+ *
+ * Time complexity: O(n - end)
+ */
+#define AVS_VECTOR_ERASE_RANGE(vecptr, beg, end) \
+    (avs_vector_erase_range__((void ***) (vecptr), (beg), (end)))
+
+/**
+ * Appends a new, uninitialized element at the end of the vector and returns a
+ * pointer to it, so that it can be constructed in place instead of being
+ * copied from another location.
+ *
+ * The returned pointer is valid as long as NO MODIFYING OPERATION is performed
+ * on the vector.
+ *
+ * @param vecptr    Pointer to the initialized AVS_VECTOR
+ * @return Pointer to the new element, or NULL in case of an error (for example
+ *         when there is not enough memory), in which case the vector remains
+ *         unchanged.
+ *
+ * Time complexity: amortized O(1)
+ */
+#ifdef __cplusplus
+template <typename T>
+static inline T *avs_vector_emplace_impl__(AVS_VECTOR(T) *vecptr) {
+    return (T *) avs_vector_emplace__((void ***) vecptr);
+}
+#define AVS_VECTOR_EMPLACE(vecptr) (avs_vector_emplace_impl__((vecptr)))
+#else
+#define AVS_VECTOR_EMPLACE(vecptr) \
+    ((AVS_TYPEOF_PTR(**(vecptr))) avs_vector_emplace__((void ***) (vecptr)))
+#endif
+
 /**
  * Returns number of elements in the AVS_VECTOR @p vec.
  *
@@ -368,8 +509,8 @@ static inline T *avs_vector_pop_impl__(AVS_VECTOR(T) *vecptr) {
  * @param cmp       Comparator function of type
  *                  @ref avs_vector_comparator_func_t.
  *
- * Time complexity: because standard C quicksort is used as sorting algorithm,
- *                  it is O(nlogn) on average and O(n^2) in a pesimistic case.
+ * Time complexity: O(nlogn). Introsort is used as the sorting algorithm, so
+ *                  the sort is not stable.
  */
 #define AVS_VECTOR_SORT_RANGE(vecptr, begidx, endidx, cmp) \
     (avs_vector_sort_range__((void ***) (vecptr), (begidx), (endidx), (cmp)))
@@ -386,4 +527,215 @@ static inline T *avs_vector_pop_impl__(AVS_VECTOR(T) *vecptr) {
 #define AVS_VECTOR_SORT(vecptr, cmp) \
     (avs_vector_sort__((void ***) (vecptr), (cmp)))
 
+/**
+ * Sorts entire vector pointed by @p vecptr in ascending order of an unsigned
+ * integer key stored inside each element, using LSD radix sort.
+ *
+ * The sort is stable, i.e. elements with equal keys retain their relative
+ * order. It requires a temporary buffer of the same size as the vector data.
+ *
+ * @param vecptr     Pointer to the AVS_VECTOR
+ * @param key_offset Offset of the key within the element, in bytes.
+ * @param key_width  Size of the key, in bytes: 1, 2, 4 or 8. The key is read
+ *                   as an unsigned integer in native byte order.
+ *
+ * @return 0 on success, negative value in case of invalid arguments or if the
+ *         temporary buffer could not be allocated; in the latter case the
+ *         vector is unchanged.
+ *
+ * Time complexity: O(n * key_width)
+ */
+#define AVS_VECTOR_RADIX_SORT(vecptr, key_offset, key_width) \
+    (avs_vector_radix_sort__((void ***) (vecptr), (key_offset), (key_width)))
+
+/**
+ * Equivalent to @ref AVS_VECTOR_RADIX_SORT, with the offset and width of the
+ * key taken from the @p member field of @p element_type.
+ *
+ * Example usage:
+ * @code
+ * typedef struct {
+ *     uint16_t msg_id;
+ *     void *data;
+ * } entry_t;
+ *
+ * AVS_VECTOR(entry_t) entries;
+ * ...
+ * AVS_VECTOR_RADIX_SORT_BY_MEMBER(&entries, entry_t, msg_id);
+ * @endcode
+ */
+#define AVS_VECTOR_RADIX_SORT_BY_MEMBER(vecptr, element_type, member) \
+    AVS_VECTOR_RADIX_SORT((vecptr), offsetof(element_type, member), \
+                          sizeof(((element_type *) 0)->member))
+
+/**
+ * Sorts entire vector pointed by @p vecptr in ascending order of a key
+ * returned by @p key_func, using LSD radix sort.
+ *
+ * @param vecptr    Pointer to the AVS_VECTOR
+ * @param key_func  Key extractor of type @ref avs_vector_radix_key_func_t.
+ *                  It is called several times for each element.
+ * @param key_width Number of least significant bytes of the key that are
+ *                  taken into account, from 1 to 8. Sorting is faster for
+ *                  narrower keys.
+ *
+ * @return As in @ref AVS_VECTOR_RADIX_SORT
+ *
+ * Time complexity: O(n * key_width)
+ */
+#define AVS_VECTOR_RADIX_SORT_BY(vecptr, key_func, key_width) \
+    (avs_vector_radix_sort_by__((void ***) (vecptr), (key_func), (key_width)))
+
+/**
+ * Defines a static function named @p func_name that sorts a whole
+ * <c>AVS_VECTOR(element_type)</c> using @p cmp, with the same algorithm as
+ * @ref AVS_VECTOR_SORT.
+ *
+ * Unlike @ref AVS_VECTOR_SORT, the generated code is specialized for
+ * @p element_type and calls @p cmp directly instead of through a function
+ * pointer, so the compiler is able to inline the comparison. This is
+ * significantly faster for cheap comparators and small element types.
+ *
+ * This macro shall be used at file scope. The generated function has the
+ * following signature:
+ *
+ * @code
+ * static void func_name(AVS_VECTOR(element_type) *vecptr);
+ * @endcode
+ *
+ * Example usage:
+ * @code
+ * static inline int compare_ints(const int *a, const int *b) {
+ *     return *a < *b ? -1 : (*a > *b);
+ * }
+ *
+ * AVS_VECTOR_SORT_INLINE(sort_ints, int, compare_ints)
+ *
+ * void foo(AVS_VECTOR(int) vec) {
+ *     sort_ints(&vec);
+ * }
+ * @endcode
+ *
+ * @param func_name    Name of the function to define.
+ * @param element_type Type of the vector elements.
+ * @param cmp          Name of a function, or a function-like macro, that
+ *                     accepts two <c>const element_type *</c> arguments and
+ *                     returns an integer with the same semantics as
+ *                     @ref avs_vector_comparator_func_t.
+ *
+ * Time complexity: as in @ref AVS_VECTOR_SORT_RANGE
+ */
+#define AVS_VECTOR_SORT_INLINE(func_name, element_type, cmp)                   \
+    static void func_name##_swap__(element_type *a, element_type *b) {         \
+        element_type tmp = *a;                                                 \
+        *a = *b;                                                               \
+        *b = tmp;                                                              \
+    }                                                                          \
+                                                                               \
+    static element_type *func_name##_median__(element_type *a,                 \
+                                              element_type *b,                 \
+                                              element_type *c) {               \
+        if (cmp(a, b) < 0) {                                                   \
+            if (cmp(b, c) < 0) {                                               \
+                return b;                                                      \
+            }                                                                  \
+            return cmp(a, c) < 0 ? c : a;                                      \
+        }                                                                      \
+        if (cmp(a, c) < 0) {                                                   \
+            return a;                                                          \
+        }                                                                      \
+        return cmp(b, c) < 0 ? c : b;                                          \
+    }                                                                          \
+                                                                               \
+    static void func_name##_sift_down__(element_type *base, size_t root,       \
+                                        size_t count) {                        \
+        size_t child;                                                          \
+        while ((child = 2 * root + 1) < count) {                               \
+            if (child + 1 < count && cmp(&base[child], &base[child + 1]) < 0) {\
+                ++child;                                                       \
+            }                                                                  \
+            if (cmp(&base[root], &base[child]) >= 0) {                         \
+                return;                                                        \
+            }                                                                  \
+            func_name##_swap__(&base[root], &base[child]);                     \
+            root = child;                                                      \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static void func_name##_loop__(element_type *base, size_t count,           \
+                                   unsigned depth_limit) {                     \
+        while (count > 16) {                                                   \
+            element_type *first = base;                                        \
+            element_type *middle = base + count / 2;                           \
+            element_type *last = base + count - 1;                             \
+            size_t i = 0;                                                      \
+            size_t j = count;                                                  \
+            if (depth_limit-- == 0) {                                          \
+                for (i = count / 2; i-- > 0;) {                                \
+                    func_name##_sift_down__(base, i, count);                   \
+                }                                                              \
+                for (i = count; i-- > 1;) {                                    \
+                    func_name##_swap__(&base[0], &base[i]);                    \
+                    func_name##_sift_down__(base, 0, i);                       \
+                }                                                              \
+                return;                                                        \
+            }                                                                  \
+            if (count > 128) {                                                 \
+                size_t step = count / 8;                                       \
+                first = func_name##_median__(first, first + step,              \
+                                             first + 2 * step);                \
+                middle = func_name##_median__(middle - step, middle,           \
+                                              middle + step);                  \
+                last = func_name##_median__(last - 2 * step, last - step,      \
+                                            last);                             \
+            }                                                                  \
+            func_name##_swap__(&base[0],                                       \
+                               func_name##_median__(first, middle, last));     \
+            for (;;) {                                                         \
+                do {                                                           \
+                    ++i;                                                       \
+                } while (i < count && cmp(&base[i], &base[0]) < 0);            \
+                do {                                                           \
+                    --j;                                                       \
+                } while (cmp(&base[j], &base[0]) > 0);                         \
+                if (i >= j) {                                                  \
+                    break;                                                     \
+                }                                                              \
+                func_name##_swap__(&base[i], &base[j]);                        \
+            }                                                                  \
+            func_name##_swap__(&base[0], &base[j]);                            \
+            if (j < count - j - 1) {                                           \
+                func_name##_loop__(base, j, depth_limit);                      \
+                base += j + 1;                                                 \
+                count -= j + 1;                                                \
+            } else {                                                           \
+                func_name##_loop__(base + j + 1, count - j - 1, depth_limit);  \
+                count = j;                                                     \
+            }                                                                  \
+        }                                                                      \
+        {                                                                      \
+            size_t i;                                                          \
+            for (i = 1; i < count; ++i) {                                      \
+                element_type tmp = base[i];                                    \
+                size_t j = i;                                                  \
+                for (; j > 0 && cmp(&base[j - 1], &tmp) > 0; --j) {            \
+                    base[j] = base[j - 1];                                     \
+                }                                                              \
+                base[j] = tmp;                                                 \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static void func_name(AVS_VECTOR(element_type) *vecptr) {                  \
+        size_t count = AVS_VECTOR_SIZE(*vecptr);                               \
+        unsigned depth_limit = 0;                                              \
+        size_t n;                                                              \
+        for (n = count; n > 1; n /= 2) {                                       \
+            depth_limit += 2;                                                  \
+        }                                                                      \
+        if (count > 1) {                                                       \
+            func_name##_loop__(**vecptr, count, depth_limit);                  \
+        }                                                                      \
+    }
+
 #endif /* AVS_COMMONS_VECTOR_H */
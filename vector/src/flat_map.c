@@ -0,0 +1,194 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_config.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avsystem/commons/flat_map.h>
+
+#include "sort.h"
+#include "vector_desc.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+static flat_map_desc_t *get_map_desc_unsorted(void **map) {
+    avs_vector_desc_t *desc = get_desc(map);
+    assert(desc->magic == FLAT_MAP_MAGIC && "not a flat map");
+    return AVS_CONTAINER_OF(desc, flat_map_desc_t, vector);
+}
+
+static flat_map_desc_t *get_map_desc(void **map) {
+    flat_map_desc_t *desc = get_map_desc_unsorted(map);
+    assert(!desc->unsorted
+           && "AVS_FLAT_MAP_BUILD not called after AVS_FLAT_MAP_APPEND_UNSORTED");
+    return desc;
+}
+
+static char *elem_at(avs_vector_desc_t *desc, size_t index) {
+    return (char *) desc->data + index * desc->elem_size;
+}
+
+static size_t elem_index(avs_vector_desc_t *desc, const void *elem) {
+    size_t offset = (size_t) ((const char *) elem - (const char *) desc->data);
+    assert(offset % desc->elem_size == 0);
+    assert(offset / desc->elem_size < desc->size);
+    return offset / desc->elem_size;
+}
+
+/* returns index of the first element not less than value */
+static size_t lower_bound_index(flat_map_desc_t *map, const void *value) {
+    size_t beg = 0;
+    size_t count = map->vector.size;
+    while (count > 0) {
+        size_t half = count / 2;
+        if (map->cmp(elem_at(&map->vector, beg + half), value) < 0) {
+            beg += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    return beg;
+}
+
+/* returns index of the first element greater than value */
+static size_t upper_bound_index(flat_map_desc_t *map, const void *value) {
+    size_t beg = 0;
+    size_t count = map->vector.size;
+    while (count > 0) {
+        size_t half = count / 2;
+        if (map->cmp(elem_at(&map->vector, beg + half), value) <= 0) {
+            beg += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    return beg;
+}
+
+static void *elem_or_null(avs_vector_desc_t *desc, size_t index) {
+    return index < desc->size ? elem_at(desc, index) : NULL;
+}
+
+void **avs_flat_map_new__(size_t elem_size, avs_vector_comparator_func_t cmp) {
+    flat_map_desc_t *desc;
+    assert(cmp);
+    desc = (flat_map_desc_t *) calloc(1, sizeof(flat_map_desc_t));
+    if (!desc) {
+        return NULL;
+    }
+    desc->cmp = cmp;
+    desc->vector.magic = FLAT_MAP_MAGIC;
+    desc->vector.elem_size = elem_size;
+    return (void **) &desc->vector.data;
+}
+
+void *avs_flat_map_lower_bound__(void **map, const void *value) {
+    flat_map_desc_t *desc = get_map_desc(map);
+    return elem_or_null(&desc->vector, lower_bound_index(desc, value));
+}
+
+void *avs_flat_map_upper_bound__(void **map, const void *value) {
+    flat_map_desc_t *desc = get_map_desc(map);
+    return elem_or_null(&desc->vector, upper_bound_index(desc, value));
+}
+
+void *avs_flat_map_find__(void **map, const void *value) {
+    flat_map_desc_t *desc = get_map_desc(map);
+    void *elem = elem_or_null(&desc->vector, lower_bound_index(desc, value));
+    if (elem && desc->cmp(elem, value) == 0) {
+        return elem;
+    }
+    return NULL;
+}
+
+void *avs_flat_map_insert__(void **map, const void *value) {
+    flat_map_desc_t *desc = get_map_desc(map);
+    size_t index = lower_bound_index(desc, value);
+    if (index < desc->vector.size
+            && desc->cmp(elem_at(&desc->vector, index), value) == 0) {
+        return elem_at(&desc->vector, index);
+    }
+    if (avs_vector_insert_range__(&map, index, value, 1)) {
+        return NULL;
+    }
+    return elem_at(&desc->vector, index);
+}
+
+int avs_flat_map_erase__(void **map, const void *value) {
+    void *elem = avs_flat_map_find__(map, value);
+    if (!elem) {
+        return -1;
+    }
+    avs_flat_map_delete_elem__(map, elem);
+    return 0;
+}
+
+void avs_flat_map_delete_elem__(void **map, void *elem) {
+    size_t index = elem_index(&get_map_desc(map)->vector, elem);
+    avs_vector_erase_range__(&map, index, index + 1);
+}
+
+int avs_flat_map_append_unsorted__(void **map, const void *value) {
+    flat_map_desc_t *desc = get_map_desc_unsorted(map);
+    if (avs_vector_push__(&map, value)) {
+        return -1;
+    }
+    desc->unsorted = 1;
+    return 0;
+}
+
+void avs_flat_map_build__(void **map) {
+    flat_map_desc_t *desc = get_map_desc_unsorted(map);
+    avs_vector_desc_t *vec = &desc->vector;
+    size_t out;
+    size_t in;
+    if (!desc->unsorted) {
+        return;
+    }
+    desc->unsorted = 0;
+    if (vec->size < 2) {
+        return;
+    }
+    _avs_vector_sort(vec->data, vec->size, vec->elem_size, desc->cmp);
+    for (out = 0, in = 1; in < vec->size; ++in) {
+        if (desc->cmp(elem_at(vec, out), elem_at(vec, in)) != 0) {
+            if (++out != in) {
+                memcpy(elem_at(vec, out), elem_at(vec, in), vec->elem_size);
+            }
+        }
+    }
+    vec->size = out + 1;
+}
+
+void *avs_flat_map_elem_next__(void **map, const void *elem) {
+    avs_vector_desc_t *desc = &get_map_desc(map)->vector;
+    return elem_or_null(desc, elem_index(desc, elem) + 1);
+}
+
+void *avs_flat_map_elem_prev__(void **map, const void *elem) {
+    avs_vector_desc_t *desc = &get_map_desc(map)->vector;
+    size_t index = elem_index(desc, elem);
+    return index > 0 ? elem_at(desc, index - 1) : NULL;
+}
+
+#ifdef AVS_UNIT_TESTING
+#include "test/test_flat_map.c"
+#endif
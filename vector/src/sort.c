@@ -0,0 +1,291 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_config.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "sort.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+/* partitions not larger than this are sorted with insertion sort */
+#define INSERTION_SORT_THRESHOLD 16
+/* partitions larger than this use ninther instead of median-of-three */
+#define NINTHER_THRESHOLD 128
+
+static void insertion_sort(char *base, size_t count, size_t size,
+                           avs_vector_comparator_func_t cmp) {
+    size_t i;
+    for (i = 1; i < count; ++i) {
+        char *elem = base + i * size;
+        while (elem > base && cmp(elem - size, elem) > 0) {
+            _avs_vector_swap_elements(elem - size, elem, size);
+            elem -= size;
+        }
+    }
+}
+
+static char *median_of_three(char *a, char *b, char *c,
+                             avs_vector_comparator_func_t cmp) {
+    if (cmp(a, b) < 0) {
+        if (cmp(b, c) < 0) {
+            return b;
+        }
+        return cmp(a, c) < 0 ? c : a;
+    }
+    if (cmp(a, c) < 0) {
+        return a;
+    }
+    return cmp(b, c) < 0 ? c : b;
+}
+
+static char *choose_pivot(char *base, size_t count, size_t size,
+                          avs_vector_comparator_func_t cmp) {
+    char *first = base;
+    char *middle = base + (count / 2) * size;
+    char *last = base + (count - 1) * size;
+    if (count > NINTHER_THRESHOLD) {
+        /* Tukey's ninther - makes quadratic behaviour on inputs such as
+         * organ-pipe or sawtooth sequences much less likely */
+        size_t step = (count / 8) * size;
+        first = median_of_three(first, first + step, first + 2 * step, cmp);
+        middle = median_of_three(middle - step, middle, middle + step, cmp);
+        last = median_of_three(last - 2 * step, last - step, last, cmp);
+    }
+    return median_of_three(first, middle, last, cmp);
+}
+
+static void sift_down(char *base, size_t root, size_t count, size_t size,
+                      avs_vector_comparator_func_t cmp) {
+    size_t child;
+    while ((child = 2 * root + 1) < count) {
+        if (child + 1 < count
+                && cmp(base + child * size, base + (child + 1) * size) < 0) {
+            ++child;
+        }
+        if (cmp(base + root * size, base + child * size) >= 0) {
+            return;
+        }
+        _avs_vector_swap_elements(base + root * size, base + child * size,
+                                  size);
+        root = child;
+    }
+}
+
+static void heap_sort(char *base, size_t count, size_t size,
+                      avs_vector_comparator_func_t cmp) {
+    size_t i;
+    for (i = count / 2; i-- > 0;) {
+        sift_down(base, i, count, size, cmp);
+    }
+    for (i = count; i-- > 1;) {
+        _avs_vector_swap_elements(base, base + i * size, size);
+        sift_down(base, 0, i, size, cmp);
+    }
+}
+
+/* Hoare partition around the element at base; stopping on elements equal to
+ * the pivot keeps the split balanced for inputs with many duplicates.
+ * Returns the final index of the pivot. */
+static size_t partition(char *base, size_t count, size_t size,
+                        avs_vector_comparator_func_t cmp) {
+    size_t i = 0;
+    size_t j = count;
+    for (;;) {
+        do {
+            ++i;
+        } while (i < count && cmp(base + i * size, base) < 0);
+        do {
+            --j;
+        } while (cmp(base + j * size, base) > 0);
+        if (i >= j) {
+            break;
+        }
+        _avs_vector_swap_elements(base + i * size, base + j * size, size);
+    }
+    _avs_vector_swap_elements(base, base + j * size, size);
+    return j;
+}
+
+static void introsort(char *base, size_t count, size_t size,
+                      avs_vector_comparator_func_t cmp, unsigned depth_limit) {
+    while (count > INSERTION_SORT_THRESHOLD) {
+        size_t pivot;
+        if (depth_limit-- == 0) {
+            heap_sort(base, count, size, cmp);
+            return;
+        }
+        _avs_vector_swap_elements(base, choose_pivot(base, count, size, cmp),
+                                  size);
+        pivot = partition(base, count, size, cmp);
+        /* recurse into the smaller part, to bound the stack depth */
+        if (pivot < count - pivot - 1) {
+            introsort(base, pivot, size, cmp, depth_limit);
+            base += (pivot + 1) * size;
+            count -= pivot + 1;
+        } else {
+            introsort(base + (pivot + 1) * size, count - pivot - 1, size, cmp,
+                      depth_limit);
+            count = pivot;
+        }
+    }
+    insertion_sort(base, count, size, cmp);
+}
+
+void _avs_vector_sort(void *base, size_t count, size_t size,
+                      avs_vector_comparator_func_t cmp) {
+    unsigned depth_limit = 0;
+    size_t n;
+    for (n = count; n > 1; n /= 2) {
+        depth_limit += 2;
+    }
+    introsort((char *) base, count, size, cmp, depth_limit);
+}
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+
+static uint64_t read_key(const char *elem,
+                         avs_vector_radix_key_func_t key_func,
+                         size_t key_offset, size_t key_width) {
+    if (key_func) {
+        return key_func(elem);
+    }
+    elem += key_offset;
+    switch (key_width) {
+    case 1:
+        return (uint8_t) *elem;
+    case 2: {
+        uint16_t key;
+        memcpy(&key, elem, sizeof(key));
+        return key;
+    }
+    case 4: {
+        uint32_t key;
+        memcpy(&key, elem, sizeof(key));
+        return key;
+    }
+    default: {
+        uint64_t key;
+        memcpy(&key, elem, sizeof(key));
+        return key;
+    }
+    }
+}
+
+static void copy_element(char *dst, const char *src, size_t size) {
+    /* fixed-size memcpy() calls are compiled into plain moves */
+    switch (size) {
+    case 2:
+        memcpy(dst, src, 2);
+        break;
+    case 4:
+        memcpy(dst, src, 4);
+        break;
+    case 8:
+        memcpy(dst, src, 8);
+        break;
+    case 16:
+        memcpy(dst, src, 16);
+        break;
+    default:
+        memcpy(dst, src, size);
+    }
+}
+
+static size_t key_digit(uint64_t key, size_t digit) {
+    return (size_t) (key >> (digit * RADIX_BITS)) & (RADIX_SIZE - 1);
+}
+
+int _avs_vector_radix_sort(void *base, size_t count, size_t size,
+                           avs_vector_radix_key_func_t key_func,
+                           size_t key_offset, size_t key_width) {
+    size_t (*histograms)[RADIX_SIZE];
+    char *scratch;
+    char *src = (char *) base;
+    char *dst;
+    size_t digit;
+    size_t i;
+
+    if (key_func) {
+        if (key_width < 1 || key_width > sizeof(uint64_t)) {
+            return -1;
+        }
+    } else if ((key_width != 1 && key_width != 2 && key_width != 4
+                    && key_width != 8)
+               || key_offset > size || key_width > size - key_offset) {
+        return -1;
+    }
+    if (count < 2) {
+        return 0;
+    }
+
+    /* histograms of all digits are gathered in a single pass; the scratch
+     * buffer for elements lives in the same allocation, right after them */
+    if (size
+            && count > (SIZE_MAX - key_width * sizeof(*histograms)) / size) {
+        return -1;
+    }
+    histograms = (size_t (*)[RADIX_SIZE]) calloc(
+            1, key_width * sizeof(*histograms) + count * size);
+    if (!histograms) {
+        return -1;
+    }
+    scratch = (char *) &histograms[key_width];
+    dst = scratch;
+
+    for (i = 0; i < count; ++i) {
+        uint64_t key = read_key(src + i * size, key_func, key_offset,
+                                key_width);
+        for (digit = 0; digit < key_width; ++digit) {
+            ++histograms[digit][key_digit(key, digit)];
+        }
+    }
+
+    for (digit = 0; digit < key_width; ++digit) {
+        size_t *offsets = histograms[digit];
+        size_t sum = 0;
+        uint64_t first_key = read_key(src, key_func, key_offset, key_width);
+        char *tmp;
+        if (offsets[key_digit(first_key, digit)] == count) {
+            /* all elements share this digit, the pass would not change
+             * anything */
+            continue;
+        }
+        for (i = 0; i < RADIX_SIZE; ++i) {
+            size_t bucket_size = offsets[i];
+            offsets[i] = sum;
+            sum += bucket_size;
+        }
+        for (i = 0; i < count; ++i) {
+            const char *elem = src + i * size;
+            uint64_t key = read_key(elem, key_func, key_offset, key_width);
+            copy_element(dst + (offsets[key_digit(key, digit)]++) * size,
+                         elem, size);
+        }
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != base) {
+        memcpy(base, src, count * size);
+    }
+    free(histograms);
+    return 0;
+}
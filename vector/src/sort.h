@@ -0,0 +1,98 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_VECTOR_SORT_H
+#define AVS_COMMONS_VECTOR_SORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <avsystem/commons/vector.h>
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+#define _AVS_VECTOR_SWAP_WORDS(A, B, Type, Count)   \
+    do {                                            \
+        size_t _i;                                  \
+        for (_i = 0; _i < (Count); ++_i) {          \
+            Type _a;                                \
+            Type _b;                                \
+            memcpy(&_a, (A) + _i * sizeof(Type), sizeof(Type)); \
+            memcpy(&_b, (B) + _i * sizeof(Type), sizeof(Type)); \
+            memcpy((A) + _i * sizeof(Type), &_b, sizeof(Type)); \
+            memcpy((B) + _i * sizeof(Type), &_a, sizeof(Type)); \
+        }                                           \
+    } while (0)
+
+/**
+ * Swaps two non-overlapping (or identical) elements of @p size bytes.
+ *
+ * Common element sizes are swapped using whole-word loads and stores; the
+ * compiler turns the fixed-size <c>memcpy()</c> calls into plain moves, so
+ * this does not impose any alignment requirements.
+ */
+static inline void _avs_vector_swap_elements(char *a, char *b, size_t size) {
+    switch (size) {
+    case 4:
+        _AVS_VECTOR_SWAP_WORDS(a, b, uint32_t, 1);
+        break;
+    case 8:
+        _AVS_VECTOR_SWAP_WORDS(a, b, uint64_t, 1);
+        break;
+    case 16:
+        _AVS_VECTOR_SWAP_WORDS(a, b, uint64_t, 2);
+        break;
+    case 32:
+        _AVS_VECTOR_SWAP_WORDS(a, b, uint64_t, 4);
+        break;
+    default: {
+        size_t words = size / sizeof(uint64_t);
+        size_t tail = words * sizeof(uint64_t);
+        _AVS_VECTOR_SWAP_WORDS(a, b, uint64_t, words);
+        _AVS_VECTOR_SWAP_WORDS(a + tail, b + tail, uint8_t, size - tail);
+    }
+    }
+}
+
+/**
+ * Sorts @p count elements of @p size bytes each, starting at @p base, using
+ * introsort: quicksort with median-of-three (or ninther, for larger inputs)
+ * pivot selection, switching to heapsort when the recursion gets too deep and
+ * to insertion sort for small partitions. The worst case is O(n log n).
+ */
+void _avs_vector_sort(void *base, size_t count, size_t size,
+                      avs_vector_comparator_func_t cmp);
+
+/**
+ * Sorts @p count elements of @p size bytes each, starting at @p base, using
+ * LSD radix sort on 8-bit digits. The sort is stable.
+ *
+ * The key is obtained by calling @p key_func, or, if it is NULL, by reading a
+ * native-endian unsigned integer of @p key_width bytes (1, 2, 4 or 8) located
+ * @p key_offset bytes into each element. Only the @p key_width least
+ * significant bytes of the key are taken into account.
+ *
+ * @return 0 for success, or -1 in case of invalid arguments or if the scratch
+ *         buffer could not be allocated.
+ */
+int _avs_vector_radix_sort(void *base, size_t count, size_t size,
+                           avs_vector_radix_key_func_t key_func,
+                           size_t key_offset, size_t key_width);
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* AVS_COMMONS_VECTOR_SORT_H */
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avsystem/commons/unit/test.h>
+
+typedef struct {
+    int key;
+    int value;
+} flat_map_entry_t;
+
+static int compare_entries(const void *a_, const void *b_) {
+    const flat_map_entry_t *a = (const flat_map_entry_t *) a_;
+    const flat_map_entry_t *b = (const flat_map_entry_t *) b_;
+    return (a->key > b->key) - (a->key < b->key);
+}
+
+static void assert_map_keys(AVS_FLAT_MAP(flat_map_entry_t) map,
+                            const int *keys, size_t count) {
+    flat_map_entry_t *it;
+    size_t i = 0;
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_SIZE(map), count);
+    AVS_FLAT_MAP_FOREACH(it, map) {
+        AVS_UNIT_ASSERT_EQUAL(it->key, keys[i++]);
+    }
+    AVS_UNIT_ASSERT_EQUAL(i, count);
+    AVS_FLAT_MAP_FOREACH_REVERSE(it, map) {
+        AVS_UNIT_ASSERT_EQUAL(it->key, keys[--i]);
+    }
+    AVS_UNIT_ASSERT_EQUAL(i, 0);
+}
+
+AVS_UNIT_TEST(avs_flat_map, insert_find_erase) {
+    static const int KEYS[] = { 5, 1, 9, 3, 7 };
+    static const int SORTED_KEYS[] = { 1, 3, 5, 7, 9 };
+    static const int AFTER_ERASE[] = { 1, 5, 9 };
+    AVS_FLAT_MAP(flat_map_entry_t) map =
+            AVS_FLAT_MAP_NEW(flat_map_entry_t, compare_entries);
+    flat_map_entry_t entry;
+    flat_map_entry_t *elem;
+    size_t i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(map);
+    for (i = 0; i < sizeof(KEYS) / sizeof(*KEYS); ++i) {
+        entry.key = KEYS[i];
+        entry.value = KEYS[i] * 10;
+        elem = AVS_FLAT_MAP_INSERT(map, &entry);
+        AVS_UNIT_ASSERT_NOT_NULL(elem);
+        AVS_UNIT_ASSERT_EQUAL(elem->key, KEYS[i]);
+    }
+    assert_map_keys(map, SORTED_KEYS, 5);
+
+    /* inserting an equivalent element returns the existing one */
+    entry.key = 3;
+    entry.value = -1;
+    elem = AVS_FLAT_MAP_INSERT(map, &entry);
+    AVS_UNIT_ASSERT_NOT_NULL(elem);
+    AVS_UNIT_ASSERT_EQUAL(elem->value, 30);
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_SIZE(map), 5);
+
+    entry.key = 7;
+    elem = AVS_FLAT_MAP_FIND(map, &entry);
+    AVS_UNIT_ASSERT_NOT_NULL(elem);
+    AVS_UNIT_ASSERT_EQUAL(elem->value, 70);
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_ELEM_PREV(map, elem)->key, 5);
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_ELEM_NEXT(map, elem)->key, 9);
+    AVS_UNIT_ASSERT_NULL(AVS_FLAT_MAP_ELEM_PREV(map, AVS_FLAT_MAP_FIRST(map)));
+    AVS_UNIT_ASSERT_NULL(AVS_FLAT_MAP_ELEM_NEXT(map, AVS_FLAT_MAP_LAST(map)));
+
+    entry.key = 4;
+    AVS_UNIT_ASSERT_NULL(AVS_FLAT_MAP_FIND(map, &entry));
+    AVS_UNIT_ASSERT_FAILED(AVS_FLAT_MAP_ERASE(map, &entry));
+
+    entry.key = 3;
+    AVS_UNIT_ASSERT_SUCCESS(AVS_FLAT_MAP_ERASE(map, &entry));
+    entry.key = 7;
+    elem = AVS_FLAT_MAP_FIND(map, &entry);
+    AVS_FLAT_MAP_DELETE_ELEM(map, &elem);
+    AVS_UNIT_ASSERT_NULL(elem);
+    assert_map_keys(map, AFTER_ERASE, 3);
+
+    AVS_FLAT_MAP_CLEAR(&map, elem) {
+        AVS_UNIT_ASSERT_EQUAL(elem->value, elem->key * 10);
+    }
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_SIZE(map), 0);
+    AVS_UNIT_ASSERT_NULL(AVS_FLAT_MAP_FIRST(map));
+    AVS_FLAT_MAP_DELETE(&map);
+    AVS_UNIT_ASSERT_NULL(map);
+}
+
+AVS_UNIT_TEST(avs_flat_map, bounds) {
+    static const int KEYS[] = { 10, 20, 30 };
+    AVS_FLAT_MAP(flat_map_entry_t) map =
+            AVS_FLAT_MAP_NEW(flat_map_entry_t, compare_entries);
+    flat_map_entry_t entry = { 0, 0 };
+    size_t i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(map);
+    entry.key = 10;
+    AVS_UNIT_ASSERT_NULL(AVS_FLAT_MAP_LOWER_BOUND(map, &entry));
+    AVS_UNIT_ASSERT_NULL(AVS_FLAT_MAP_UPPER_BOUND(map, &entry));
+
+    for (i = 0; i < sizeof(KEYS) / sizeof(*KEYS); ++i) {
+        entry.key = KEYS[i];
+        AVS_UNIT_ASSERT_NOT_NULL(AVS_FLAT_MAP_INSERT(map, &entry));
+    }
+
+    entry.key = 5;
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_LOWER_BOUND(map, &entry)->key, 10);
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_UPPER_BOUND(map, &entry)->key, 10);
+    entry.key = 20;
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_LOWER_BOUND(map, &entry)->key, 20);
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_UPPER_BOUND(map, &entry)->key, 30);
+    entry.key = 25;
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_LOWER_BOUND(map, &entry)->key, 30);
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_UPPER_BOUND(map, &entry)->key, 30);
+    entry.key = 30;
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_LOWER_BOUND(map, &entry)->key, 30);
+    AVS_UNIT_ASSERT_NULL(AVS_FLAT_MAP_UPPER_BOUND(map, &entry));
+    entry.key = 31;
+    AVS_UNIT_ASSERT_NULL(AVS_FLAT_MAP_LOWER_BOUND(map, &entry));
+
+    AVS_FLAT_MAP_DELETE(&map);
+}
+
+AVS_UNIT_TEST(avs_flat_map, build_from_unsorted) {
+    static const int KEYS[] = { 8, 3, 8, 1, 5, 3, 3, 9, 1 };
+    static const int SORTED_KEYS[] = { 1, 3, 5, 8, 9 };
+    AVS_FLAT_MAP(flat_map_entry_t) map =
+            AVS_FLAT_MAP_NEW(flat_map_entry_t, compare_entries);
+    flat_map_entry_t entry = { 0, 0 };
+    size_t i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(map);
+    /* building an empty map is a no-op */
+    AVS_FLAT_MAP_BUILD(map);
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_SIZE(map), 0);
+
+    for (i = 0; i < sizeof(KEYS) / sizeof(*KEYS); ++i) {
+        entry.key = KEYS[i];
+        AVS_UNIT_ASSERT_SUCCESS(AVS_FLAT_MAP_APPEND_UNSORTED(map, &entry));
+    }
+    AVS_FLAT_MAP_BUILD(map);
+    assert_map_keys(map, SORTED_KEYS, 5);
+
+    entry.key = 5;
+    AVS_UNIT_ASSERT_NOT_NULL(AVS_FLAT_MAP_FIND(map, &entry));
+
+    AVS_FLAT_MAP_DELETE(&map);
+}
+
+AVS_UNIT_TEST(avs_flat_map, many_elements) {
+    AVS_FLAT_MAP(flat_map_entry_t) map =
+            AVS_FLAT_MAP_NEW(flat_map_entry_t, compare_entries);
+    flat_map_entry_t entry = { 0, 0 };
+    flat_map_entry_t *it;
+    int expected;
+    int i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(map);
+    /* insert 0..999 in a scrambled order; 7 is coprime with 1000 */
+    for (i = 0; i < 1000; ++i) {
+        entry.key = (i * 7) % 1000;
+        AVS_UNIT_ASSERT_NOT_NULL(AVS_FLAT_MAP_INSERT(map, &entry));
+    }
+    AVS_UNIT_ASSERT_EQUAL(AVS_FLAT_MAP_SIZE(map), 1000);
+    for (i = 0; i < 1000; i += 2) {
+        entry.key = i;
+        AVS_UNIT_ASSERT_SUCCESS(AVS_FLAT_MAP_ERASE(map, &entry));
+    }
+    expected = 1;
+    AVS_FLAT_MAP_FOREACH(it, map) {
+        AVS_UNIT_ASSERT_EQUAL(it->key, expected);
+        expected += 2;
+    }
+    AVS_UNIT_ASSERT_EQUAL(expected, 1001);
+
+    AVS_FLAT_MAP_DELETE(&map);
+}
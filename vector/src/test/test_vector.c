@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -152,6 +153,90 @@ AVS_UNIT_TEST(avs_vector, remove) {
     AVS_VECTOR_DELETE(&v);
 }
 
+static void assert_vector_contents(AVS_VECTOR(int) vec, const int *expected,
+                                   size_t count) {
+    size_t i;
+    AVS_UNIT_ASSERT_EQUAL(AVS_VECTOR_SIZE(vec), count);
+    for (i = 0; i < count; ++i) {
+        AVS_UNIT_ASSERT_EQUAL((*vec)[i], expected[i]);
+    }
+}
+
+AVS_UNIT_TEST(avs_vector, push_n) {
+    static const int DATA[] = { 1, 2, 3, 4, 5 };
+    static const int EXPECTED[] = { 1, 2, 3, 4, 5, 1, 2 };
+    AVS_VECTOR(int) v = AVS_VECTOR_NEW(int);
+    AVS_UNIT_ASSERT_NOT_NULL(v);
+
+    AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_PUSH_N(&v, DATA, 0));
+    AVS_UNIT_ASSERT_EQUAL(AVS_VECTOR_SIZE(v), 0);
+    AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_PUSH_N(&v, DATA, 5));
+    AVS_UNIT_ASSERT_EQUAL(AVS_VECTOR_CAPACITY(v), 5);
+    AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_PUSH_N(&v, DATA, 2));
+    assert_vector_contents(v, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+    AVS_VECTOR_DELETE(&v);
+}
+
+AVS_UNIT_TEST(avs_vector, insert_range) {
+    static const int DATA[] = { 10, 11, 12 };
+    static const int EXPECTED[] = { 10, 0, 1, 10, 11, 12, 2, 3, 10, 11 };
+    AVS_VECTOR(int) v = AVS_VECTOR_NEW(int);
+    int i;
+    AVS_UNIT_ASSERT_NOT_NULL(v);
+    for (i = 0; i < 4; ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_PUSH(&v, &i));
+    }
+
+    AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_INSERT_RANGE(&v, 2, DATA, 3));
+    AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_INSERT_RANGE(&v, 0, DATA, 1));
+    AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_INSERT_RANGE(&v, 8, DATA, 2));
+    AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_INSERT_RANGE(&v, 3, DATA, 0));
+    assert_vector_contents(v, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+    AVS_VECTOR_DELETE(&v);
+}
+
+AVS_UNIT_TEST(avs_vector, erase_range) {
+    static const int EXPECTED[] = { 0, 1, 5, 6 };
+    AVS_VECTOR(int) v = AVS_VECTOR_NEW(int);
+    size_t capacity;
+    int i;
+    AVS_UNIT_ASSERT_NOT_NULL(v);
+    for (i = 0; i < 9; ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_PUSH(&v, &i));
+    }
+    capacity = AVS_VECTOR_CAPACITY(v);
+
+    AVS_VECTOR_ERASE_RANGE(&v, 2, 5);
+    AVS_VECTOR_ERASE_RANGE(&v, 4, 6);
+    AVS_VECTOR_ERASE_RANGE(&v, 1, 1);
+    assert_vector_contents(v, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+    AVS_UNIT_ASSERT_EQUAL(AVS_VECTOR_CAPACITY(v), capacity);
+
+    AVS_VECTOR_ERASE_RANGE(&v, 0, AVS_VECTOR_SIZE(v));
+    AVS_UNIT_ASSERT_EQUAL(AVS_VECTOR_SIZE(v), 0);
+    AVS_VECTOR_DELETE(&v);
+}
+
+AVS_UNIT_TEST(avs_vector, emplace) {
+    AVS_VECTOR(sample_nonpod_t) v = AVS_VECTOR_NEW(sample_nonpod_t);
+    sample_nonpod_t *elem;
+    int i;
+    AVS_UNIT_ASSERT_NOT_NULL(v);
+    for (i = 0; i < 3; ++i) {
+        AVS_UNIT_ASSERT_NOT_NULL((elem = AVS_VECTOR_EMPLACE(&v)));
+        make_sample_nonpod(sizeof(int), elem);
+        *elem->data = i;
+    }
+    AVS_UNIT_ASSERT_EQUAL(AVS_VECTOR_SIZE(v), 3);
+    for (i = 0; i < 3; ++i) {
+        AVS_UNIT_ASSERT_EQUAL(*(*v)[i].data, i);
+    }
+    AVS_VECTOR_CLEAR(&v, elem) {
+        free(elem->data);
+    }
+    AVS_VECTOR_DELETE(&v);
+}
+
 static int decreasing(const void *a, const void *b) {
     const int *p = (const int *) a;
     const int *q = (const int *) b;
@@ -162,6 +247,45 @@ static int increasing(const void *a, const void *b) {
     return decreasing(b, a);
 }
 
+AVS_UNIT_TEST(avs_vector, small_vector) {
+    static const int EXPECTED[] = { 0, 1, 2, 3, 4 };
+    AVS_SMALL_VECTOR(int) v = AVS_SMALL_VECTOR_NEW(int, 4);
+    avs_vector_desc_t *desc;
+    int i;
+    AVS_UNIT_ASSERT_NOT_NULL(v);
+    desc = get_desc((void **) v);
+
+    AVS_UNIT_ASSERT_EQUAL(AVS_VECTOR_CAPACITY(v), 4);
+    for (i = 0; i < 4; ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_PUSH(&v, &i));
+    }
+    AVS_UNIT_ASSERT_TRUE(data_is_inline(desc));
+    AVS_UNIT_ASSERT_EQUAL(AVS_VECTOR_CAPACITY(v), 4);
+
+    /* spill to the heap */
+    AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_PUSH(&v, &i));
+    AVS_UNIT_ASSERT_FALSE(data_is_inline(desc));
+    assert_vector_contents(v, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+
+    /* and back */
+    AVS_VECTOR_ERASE_RANGE(&v, 3, 5);
+    AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_FIT(&v));
+    AVS_UNIT_ASSERT_TRUE(data_is_inline(desc));
+    AVS_UNIT_ASSERT_EQUAL(AVS_VECTOR_CAPACITY(v), 4);
+    assert_vector_contents(v, EXPECTED, 3);
+
+    AVS_VECTOR_SORT(&v, decreasing);
+    AVS_UNIT_ASSERT_EQUAL((*v)[0], 2);
+    AVS_VECTOR_DELETE(&v);
+
+    /* deleting a vector that spilled */
+    v = AVS_SMALL_VECTOR_NEW(int, 1);
+    AVS_UNIT_ASSERT_NOT_NULL(v);
+    AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_PUSH_N(&v, EXPECTED, 5));
+    assert_vector_contents(v, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+    AVS_VECTOR_DELETE(&v);
+}
+
 AVS_UNIT_TEST(avs_vector, sort) {
     AVS_VECTOR(int) u = AVS_VECTOR_NEW(int);
     int i;
@@ -187,6 +311,205 @@ AVS_UNIT_TEST(avs_vector, sort) {
     AVS_VECTOR_DELETE(&u);
 }
 
+typedef enum {
+    PATTERN_RANDOM,
+    PATTERN_FEW_UNIQUE,
+    PATTERN_SORTED,
+    PATTERN_REVERSED,
+    PATTERN_ORGAN_PIPE
+} sort_pattern_t;
+
+static uint32_t pattern_key(sort_pattern_t pattern, size_t i, size_t count,
+                            uint32_t *seed) {
+    switch (pattern) {
+    case PATTERN_RANDOM:
+        *seed = *seed * 1103515245u + 12345u;
+        return *seed >> 8;
+    case PATTERN_FEW_UNIQUE:
+        *seed = *seed * 1103515245u + 12345u;
+        return (*seed >> 8) % 4;
+    case PATTERN_SORTED:
+        return (uint32_t) i;
+    case PATTERN_REVERSED:
+        return (uint32_t) (count - i);
+    default:
+        return (uint32_t) (i < count / 2 ? i : count - i);
+    }
+}
+
+/* elements start with a 32-bit key, the rest of the element is filled with
+ * bytes derived from it, to detect corruption during swapping */
+static void make_element(char *elem, size_t size, uint32_t key) {
+    size_t i;
+    memcpy(elem, &key, sizeof(key));
+    for (i = sizeof(key); i < size; ++i) {
+        elem[i] = (char) (key + i);
+    }
+}
+
+static int compare_keys(const void *a, const void *b) {
+    uint32_t key_a;
+    uint32_t key_b;
+    memcpy(&key_a, a, sizeof(key_a));
+    memcpy(&key_b, b, sizeof(key_b));
+    return key_a < key_b ? -1 : (key_a > key_b);
+}
+
+static void check_sort(size_t elem_size, size_t count,
+                       sort_pattern_t pattern) {
+    void **vec = avs_vector_new__(elem_size);
+    char *elem = (char *) malloc(elem_size);
+    char *expected = (char *) malloc(elem_size);
+    uint32_t seed = 42;
+    size_t i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(vec);
+    AVS_UNIT_ASSERT_NOT_NULL(elem);
+    AVS_UNIT_ASSERT_NOT_NULL(expected);
+    for (i = 0; i < count; ++i) {
+        make_element(elem, elem_size, pattern_key(pattern, i, count, &seed));
+        AVS_UNIT_ASSERT_SUCCESS(avs_vector_push__(&vec, elem));
+    }
+
+    avs_vector_sort__(&vec, compare_keys);
+
+    AVS_UNIT_ASSERT_EQUAL(avs_vector_size__(vec), count);
+    for (i = 0; i < count; ++i) {
+        char *actual = (char *) avs_vector_at__(vec, i);
+        uint32_t key;
+        if (i > 0) {
+            AVS_UNIT_ASSERT_TRUE(
+                    compare_keys(avs_vector_at__(vec, i - 1), actual) <= 0);
+        }
+        memcpy(&key, actual, sizeof(key));
+        make_element(expected, elem_size, key);
+        AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(actual, expected, elem_size);
+    }
+
+    free(expected);
+    free(elem);
+    avs_vector_delete__(&vec);
+}
+
+AVS_UNIT_TEST(avs_vector, sort_element_sizes_and_patterns) {
+    static const size_t SIZES[] = { 4, 8, 12, 16, 32, 40 };
+    static const size_t COUNTS[] = { 0, 1, 2, 17, 129, 5000 };
+    size_t size_idx;
+    size_t count_idx;
+    int pattern;
+
+    for (size_idx = 0; size_idx < AVS_ARRAY_SIZE(SIZES); ++size_idx) {
+        for (count_idx = 0; count_idx < AVS_ARRAY_SIZE(COUNTS); ++count_idx) {
+            for (pattern = PATTERN_RANDOM; pattern <= PATTERN_ORGAN_PIPE;
+                    ++pattern) {
+                check_sort(SIZES[size_idx], COUNTS[count_idx],
+                           (sort_pattern_t) pattern);
+            }
+        }
+    }
+}
+
+static int compare_ints(const int *a, const int *b) {
+    return *a < *b ? -1 : (*a > *b);
+}
+
+AVS_VECTOR_SORT_INLINE(sort_ints_inline, int, compare_ints)
+
+AVS_UNIT_TEST(avs_vector, sort_inline) {
+    AVS_VECTOR(int) u = AVS_VECTOR_NEW(int);
+    uint32_t seed = 1;
+    int i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(u);
+    sort_ints_inline(&u);
+    AVS_UNIT_ASSERT_EQUAL(AVS_VECTOR_SIZE(u), 0);
+
+    for (i = 0; i < 3000; ++i) {
+        int value = (int) (pattern_key(PATTERN_RANDOM, 0, 0, &seed) % 1000);
+        AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_PUSH(&u, &value));
+    }
+    sort_ints_inline(&u);
+    AVS_UNIT_ASSERT_EQUAL(AVS_VECTOR_SIZE(u), 3000);
+    for (i = 1; i < 3000; ++i) {
+        AVS_UNIT_ASSERT_TRUE((*u)[i - 1] <= (*u)[i]);
+    }
+    AVS_VECTOR_DELETE(&u);
+}
+
+typedef struct {
+    uint16_t msg_id;
+    uint64_t id;
+    uint32_t seq;
+} radix_entry_t;
+
+AVS_UNIT_TEST(avs_vector, radix_sort_is_stable) {
+    AVS_VECTOR(radix_entry_t) u = AVS_VECTOR_NEW(radix_entry_t);
+    uint32_t seed = 7;
+    uint32_t i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(u);
+    for (i = 0; i < 2000; ++i) {
+        radix_entry_t entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.msg_id = (uint16_t) (pattern_key(PATTERN_RANDOM, 0, 0, &seed)
+                                   % 300);
+        entry.seq = i;
+        AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_PUSH(&u, &entry));
+    }
+    AVS_UNIT_ASSERT_SUCCESS(
+            AVS_VECTOR_RADIX_SORT_BY_MEMBER(&u, radix_entry_t, msg_id));
+    for (i = 1; i < 2000; ++i) {
+        const radix_entry_t *prev = &(*u)[i - 1];
+        const radix_entry_t *next = &(*u)[i];
+        AVS_UNIT_ASSERT_TRUE(prev->msg_id <= next->msg_id);
+        if (prev->msg_id == next->msg_id) {
+            AVS_UNIT_ASSERT_TRUE(prev->seq < next->seq);
+        }
+    }
+    AVS_VECTOR_DELETE(&u);
+}
+
+static uint64_t radix_entry_id(const void *elem) {
+    return ((const radix_entry_t *) elem)->id;
+}
+
+AVS_UNIT_TEST(avs_vector, radix_sort_by_key_func) {
+    AVS_VECTOR(radix_entry_t) u = AVS_VECTOR_NEW(radix_entry_t);
+    uint32_t seed = 3;
+    uint32_t i;
+
+    AVS_UNIT_ASSERT_NOT_NULL(u);
+    for (i = 0; i < 1000; ++i) {
+        radix_entry_t entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.id = ((uint64_t) pattern_key(PATTERN_RANDOM, 0, 0, &seed) << 40)
+                   | pattern_key(PATTERN_RANDOM, 0, 0, &seed);
+        AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_PUSH(&u, &entry));
+    }
+    AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_RADIX_SORT_BY(&u, radix_entry_id, 8));
+    for (i = 1; i < 1000; ++i) {
+        AVS_UNIT_ASSERT_TRUE((*u)[i - 1].id <= (*u)[i].id);
+    }
+    AVS_VECTOR_DELETE(&u);
+}
+
+AVS_UNIT_TEST(avs_vector, radix_sort_invalid_key) {
+    AVS_VECTOR(uint32_t) u = AVS_VECTOR_NEW(uint32_t);
+    AVS_UNIT_ASSERT_NOT_NULL(u);
+    AVS_UNIT_ASSERT_FAILED(AVS_VECTOR_RADIX_SORT(&u, 0, 3));
+    AVS_UNIT_ASSERT_FAILED(AVS_VECTOR_RADIX_SORT(&u, 2, 4));
+    AVS_UNIT_ASSERT_FAILED(AVS_VECTOR_RADIX_SORT_BY(&u, radix_entry_id, 9));
+    AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_RADIX_SORT(&u, 0, 4));
+    AVS_VECTOR_DELETE(&u);
+}
+
+AVS_UNIT_TEST(avs_vector, radix_sort_scratch_size_overflow) {
+    uint32_t dummy = 0;
+    /* fails before the elements are accessed */
+    AVS_UNIT_ASSERT_FAILED(_avs_vector_radix_sort(&dummy, SIZE_MAX / 2,
+                                                  sizeof(dummy), NULL, 0, 4));
+}
+
 AVS_UNIT_TEST(avs_vector, reverse) {
     AVS_VECTOR(int) u = AVS_VECTOR_NEW(int);
     int i;
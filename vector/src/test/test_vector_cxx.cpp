@@ -14,4 +14,6 @@
  * limitations under the License.
  */
 
+#include "../flat_map.c"
+#include "../sort.c"
 #include "../vector.c"
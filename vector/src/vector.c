@@ -24,30 +24,17 @@
 
 #include <avsystem/commons/vector.h>
 
-VISIBILITY_SOURCE_BEGIN
-
-struct avs_vector_desc_struct {
-    uint64_t magic;
-    size_t size;
-    size_t capacity;
-    size_t elem_size;
-    void *data;
-};
-static const uint64_t magic = 0xb5e4189902ba0aaULL;
+#include "sort.h"
+#include "vector_desc.h"
 
-#define AVS_VECTOR_DESC__(vec) \
-    ((avs_vector_desc_t*)(intptr_t) \
-        ((const char*)(vec) - offsetof(avs_vector_desc_t,data)))
+VISIBILITY_SOURCE_BEGIN
 
-static avs_vector_desc_t *get_desc(void **ptr) {
-    avs_vector_desc_t *desc;
-    assert(ptr && "NULL vector pointer");
-    desc = AVS_VECTOR_DESC__(ptr);
-    assert(desc->magic == magic && "invalid vector pointer");
-    return desc;
+/* Helper functions that do not perform pointer validity checks */
+static int data_is_inline(avs_vector_desc_t *desc) {
+    return desc->inline_capacity > 0
+            && desc->data == (void *) desc->inline_storage.bytes;
 }
 
-/* Helper functions that do not perform pointer validity checks */
 static void *vector_at_internal(avs_vector_desc_t *desc, size_t index) {
     if (index >= desc->size) {
         return NULL;
@@ -74,18 +61,10 @@ static void *vector_pop_internal(avs_vector_desc_t *desc) {
 
 static void vector_swap_internal(avs_vector_desc_t *desc, size_t i, size_t j) {
     assert(i < desc->size && j < desc->size);
-    if (i == j) {
-        return;
-    } else {
-        size_t k;
-        uint8_t tmp;
-        uint8_t *first = (uint8_t *) desc->data + i * desc->elem_size;
-        uint8_t *second = (uint8_t *) desc->data + j * desc->elem_size;
-        for (k = 0; k < desc->elem_size; ++k) {
-            tmp = *first;
-            *first++ = *second;
-            *second++ = tmp;
-        }
+    if (i != j) {
+        _avs_vector_swap_elements((char *) desc->data + i * desc->elem_size,
+                                  (char *) desc->data + j * desc->elem_size,
+                                  desc->elem_size);
     }
 }
 
@@ -102,13 +81,30 @@ vector_reverse_range_internal(avs_vector_desc_t *desc, size_t beg, size_t end) {
 
 /* API methods implementation */
 void **avs_vector_new__(size_t elem_size) {
-    avs_vector_desc_t *desc =
-        (avs_vector_desc_t *) calloc(1, sizeof(avs_vector_desc_t));
+    return avs_vector_new_small__(elem_size, 0);
+}
+
+void **avs_vector_new_small__(size_t elem_size, size_t inline_capacity) {
+    avs_vector_desc_t *desc;
+    uint64_t inline_size = (uint64_t) inline_capacity * elem_size;
+    if (inline_size != (size_t) inline_size
+            || (size_t) inline_size
+                    > SIZE_MAX - offsetof(avs_vector_desc_t, inline_storage)) {
+        return NULL;
+    }
+    desc = (avs_vector_desc_t *) calloc(
+            1, offsetof(avs_vector_desc_t, inline_storage)
+                       + (size_t) inline_size);
     if (!desc) {
         return NULL;
     }
-    desc->magic = magic;
+    desc->magic = VECTOR_MAGIC;
     desc->elem_size = elem_size;
+    if (inline_capacity > 0) {
+        desc->inline_capacity = inline_capacity;
+        desc->capacity = inline_capacity;
+        desc->data = desc->inline_storage.bytes;
+    }
     return (void **) &desc->data;
 }
 
@@ -118,15 +114,37 @@ void avs_vector_delete__(void ***ptr) {
         return;
     }
     desc = get_desc(*ptr);
-    free(desc->data);
-    free(desc);
+    if (!data_is_inline(desc)) {
+        free(desc->data);
+    }
+    if (desc->magic == FLAT_MAP_MAGIC) {
+        free(AVS_CONTAINER_OF(desc, flat_map_desc_t, vector));
+    } else {
+        free(desc);
+    }
     *ptr = NULL;
 }
 
+static int ensure_capacity(avs_vector_desc_t *desc, size_t num_elements);
+
+static int ensure_space_for(avs_vector_desc_t *desc, size_t count) {
+    size_t new_capacity;
+    if (desc->capacity - desc->size >= count) {
+        return 0;
+    }
+    if (count > SIZE_MAX - desc->size) {
+        return -1;
+    }
+    new_capacity = desc->size == 0 ? 1 : 2 * desc->size;
+    if (new_capacity < desc->size + count) {
+        new_capacity = desc->size + count;
+    }
+    return ensure_capacity(desc, new_capacity);
+}
+
 int avs_vector_push__(void ***ptr, const void *elemptr) {
     avs_vector_desc_t *desc = get_desc(*ptr);
-    if (desc->capacity - desc->size == 0
-            && avs_vector_reserve__(ptr, desc->size == 0 ? 1 : 2 * desc->size)) {
+    if (ensure_space_for(desc, 1)) {
         return -1;
     }
     memcpy((char *) desc->data + desc->size * desc->elem_size, elemptr,
@@ -135,6 +153,51 @@ int avs_vector_push__(void ***ptr, const void *elemptr) {
     return 0;
 }
 
+int avs_vector_push_n__(void ***ptr, const void *elems, size_t count) {
+    return avs_vector_insert_range__(ptr, avs_vector_size__(*ptr), elems,
+                                     count);
+}
+
+int avs_vector_insert_range__(void ***ptr, size_t index,
+                              const void *elems, size_t count) {
+    avs_vector_desc_t *desc = get_desc(*ptr);
+    char *dst;
+    assert(index <= desc->size);
+    if (count == 0) {
+        return 0;
+    }
+    if (ensure_space_for(desc, count)) {
+        return -1;
+    }
+    dst = (char *) desc->data + index * desc->elem_size;
+    memmove(dst + count * desc->elem_size, dst,
+            (desc->size - index) * desc->elem_size);
+    memcpy(dst, elems, count * desc->elem_size);
+    desc->size += count;
+    return 0;
+}
+
+void avs_vector_erase_range__(void ***ptr, size_t beg, size_t end) {
+    avs_vector_desc_t *desc = get_desc(*ptr);
+    char *dst;
+    assert(beg <= end && end <= desc->size);
+    if (beg == end) {
+        return;
+    }
+    dst = (char *) desc->data + beg * desc->elem_size;
+    memmove(dst, dst + (end - beg) * desc->elem_size,
+            (desc->size - end) * desc->elem_size);
+    desc->size -= end - beg;
+}
+
+void *avs_vector_emplace__(void ***ptr) {
+    avs_vector_desc_t *desc = get_desc(*ptr);
+    if (ensure_space_for(desc, 1)) {
+        return NULL;
+    }
+    return (char *) desc->data + desc->size++ * desc->elem_size;
+}
+
 void *avs_vector_pop__(void ***ptr) {
     return vector_pop_internal(get_desc(*ptr));
 }
@@ -182,13 +245,27 @@ void avs_vector_sort_range__(void ***ptr, size_t beg, size_t end,
                              avs_vector_comparator_func_t cmp) {
     avs_vector_desc_t *desc = get_desc(*ptr);
     assert(end > beg);
-    qsort((char *) desc->data + beg * desc->elem_size, end - beg,
-          desc->elem_size, cmp);
+    _avs_vector_sort((char *) desc->data + beg * desc->elem_size, end - beg,
+                     desc->elem_size, cmp);
 }
 
 void avs_vector_sort__(void ***ptr, avs_vector_comparator_func_t cmp) {
     avs_vector_desc_t *desc = get_desc(*ptr);
-    qsort((char *) desc->data, desc->size, desc->elem_size, cmp);
+    _avs_vector_sort(desc->data, desc->size, desc->elem_size, cmp);
+}
+
+int avs_vector_radix_sort__(void ***ptr, size_t key_offset, size_t key_width) {
+    avs_vector_desc_t *desc = get_desc(*ptr);
+    return _avs_vector_radix_sort(desc->data, desc->size, desc->elem_size,
+                                  NULL, key_offset, key_width);
+}
+
+int avs_vector_radix_sort_by__(void ***ptr,
+                               avs_vector_radix_key_func_t key_func,
+                               size_t key_width) {
+    avs_vector_desc_t *desc = get_desc(*ptr);
+    return _avs_vector_radix_sort(desc->data, desc->size, desc->elem_size,
+                                  key_func, 0, key_width);
 }
 
 void avs_vector_swap__(void ***ptr, size_t i, size_t j) {
@@ -209,7 +286,17 @@ int avs_vector_fit__(void ***ptr) {
     if (*ptr == NULL) {
         return 0;
     }
-    if (desc->size == 0 || desc->size == desc->capacity) {
+    if (desc->size == 0 || desc->size == desc->capacity
+            || data_is_inline(desc)) {
+        return 0;
+    }
+    if (desc->size <= desc->inline_capacity) {
+        /* move back to the inline storage */
+        memcpy(desc->inline_storage.bytes, desc->data,
+               desc->size * desc->elem_size);
+        free(desc->data);
+        desc->data = desc->inline_storage.bytes;
+        desc->capacity = desc->inline_capacity;
         return 0;
     }
     new_data = malloc(desc->size * desc->elem_size);
@@ -229,8 +316,16 @@ static int ensure_capacity(avs_vector_desc_t *desc, size_t num_elements) {
     if (new_capacity != (size_t) new_capacity) {
         return -1;
     }
-    new_data = realloc(desc->data, (size_t) new_capacity);
-    if (!new_data) {
+    if (data_is_inline(desc)) {
+        if (num_elements <= desc->inline_capacity) {
+            return 0;
+        }
+        /* spill to the heap */
+        if (!(new_data = malloc((size_t) new_capacity))) {
+            return -1;
+        }
+        memcpy(new_data, desc->data, desc->size * desc->elem_size);
+    } else if (!(new_data = realloc(desc->data, (size_t) new_capacity))) {
         return -1;
     }
     desc->capacity = num_elements;
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2017 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_VECTOR_DESC_H
+#define AVS_COMMONS_VECTOR_DESC_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <avsystem/commons/defs.h>
+#include <avsystem/commons/vector.h>
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+struct avs_vector_desc_struct {
+    uint64_t magic;
+    size_t size;
+    size_t capacity;
+    size_t elem_size;
+    /* number of elements that fit in inline_storage; data points to it
+     * until the vector outgrows it */
+    size_t inline_capacity;
+    void *data;
+    union {
+        char bytes[1]; /* variable length */
+        avs_max_align_t align;
+    } inline_storage;
+};
+#define VECTOR_MAGIC 0xb5e4189902ba0aaULL
+#define FLAT_MAP_MAGIC 0x2f6b8d0c91e3a74dULL
+
+/* flat maps (see flat_map.h) are vectors allocated with extra state in front
+ * of the vector descriptor; their descriptor carries FLAT_MAP_MAGIC */
+typedef struct {
+    avs_vector_comparator_func_t cmp;
+    int unsorted;
+    avs_vector_desc_t vector; /* must be last - ends with inline_storage */
+} flat_map_desc_t;
+
+#define AVS_VECTOR_DESC__(vec) \
+    ((avs_vector_desc_t*)(intptr_t) \
+        ((const char*)(vec) - offsetof(avs_vector_desc_t,data)))
+
+static inline avs_vector_desc_t *get_desc(void **ptr) {
+    avs_vector_desc_t *desc;
+    assert(ptr && "NULL vector pointer");
+    desc = AVS_VECTOR_DESC__(ptr);
+    assert((desc->magic == VECTOR_MAGIC || desc->magic == FLAT_MAP_MAGIC)
+           && "invalid vector pointer");
+    return desc;
+}
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* AVS_COMMONS_VECTOR_DESC_H */